@@ -0,0 +1,565 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "tree_generator.h"
+#include "core/repository.h"
+#include "core/backup.h"
+#include "core/restore.h"
+#include "filters/attribute_filter.h"
+#include "storage/package/package_export.h"
+
+using namespace backuprestore;
+using namespace backuprestore::bench;
+
+namespace {
+
+const char* const kPassword = "br-bench";
+
+/**
+ * @brief 基准配置（命令行参数）
+ */
+struct BenchConfig {
+    std::vector<std::string> shapes;
+    double scale = 1.0;
+    std::filesystem::path work_dir;
+    bool keep = false;
+    std::size_t repeat = 1;
+    std::size_t jobs = 1;
+    std::uint64_t seed = 1;
+    std::string repo_mode = "mirror";   // mirror | compress | chunked
+    std::uint64_t pack_threshold = 0;
+    pkg::Options pkg;
+    std::string pkg_desc = "header";
+    std::string format = "json";        // json | tsv
+    std::filesystem::path output;
+};
+
+/**
+ * @brief 子进程中一次操作的测量结果（经管道传回父进程）
+ */
+struct ChildReport {
+    int ok = 0;
+    double seconds = 0;
+    int io_valid = 0;
+    std::int64_t syscr = 0;
+    std::int64_t syscw = 0;
+    std::int64_t read_bytes = 0;
+    std::int64_t write_bytes = 0;
+};
+
+/**
+ * @brief 一次操作的完整测量结果
+ */
+struct Measurement {
+    bool ok = false;
+    double seconds = 0;
+    bool io_valid = false;
+    std::int64_t syscr = 0;
+    std::int64_t syscw = 0;
+    std::int64_t read_bytes = 0;
+    std::int64_t write_bytes = 0;
+    long peak_rss_kb = 0;
+    double user_s = 0;
+    double sys_s = 0;
+    long voluntary_switches = 0;
+    long involuntary_switches = 0;
+};
+
+struct ProcIo {
+    bool valid = false;
+    std::int64_t syscr = 0;
+    std::int64_t syscw = 0;
+    std::int64_t read_bytes = 0;
+    std::int64_t write_bytes = 0;
+};
+
+/**
+ * @brief 读取 /proc/self/io（内核未开启任务 I/O 统计时 valid 为 false）
+ * syscr/syscw 是 read/write 类系统调用次数，read_bytes/write_bytes 是实际到达块设备的字节数
+ */
+ProcIo readProcIo() {
+    ProcIo io;
+    std::ifstream in("/proc/self/io");
+    std::string key;
+    std::int64_t value = 0;
+    int seen = 0;
+    while (in >> key >> value) {
+        if (key == "syscr:") {
+            io.syscr = value;
+            seen++;
+        } else if (key == "syscw:") {
+            io.syscw = value;
+            seen++;
+        } else if (key == "read_bytes:") {
+            io.read_bytes = value;
+        } else if (key == "write_bytes:") {
+            io.write_bytes = value;
+        }
+    }
+    io.valid = seen == 2;
+    return io;
+}
+
+double nowSeconds() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+double toSeconds(const timeval& tv) {
+    return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) / 1e6;
+}
+
+/**
+ * @brief 在子进程中执行 op 并测量
+ *
+ * 每个操作独占一个进程：峰值 RSS（ru_maxrss）和 /proc/self/io 计数都只反映这一个操作，
+ * 不受之前操作的堆增长影响。子进程的标准输出重定向到 /dev/null，以免打断机器可读的输出
+ */
+Measurement runMeasured(const std::function<bool()>& op) {
+    Measurement m;
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::perror("pipe");
+        return m;
+    }
+    std::cout.flush();
+    std::cerr.flush();
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::perror("fork");
+        close(fds[0]);
+        close(fds[1]);
+        return m;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDOUT_FILENO);
+            close(devnull);
+        }
+        ChildReport report;
+        ProcIo before = readProcIo();
+        double start = nowSeconds();
+        bool ok = false;
+        try {
+            ok = op();
+        } catch (const std::exception& e) {
+            std::cerr << "错误: " << e.what() << std::endl;
+        }
+        report.seconds = nowSeconds() - start;
+        ProcIo after = readProcIo();
+        report.ok = ok ? 1 : 0;
+        report.io_valid = (before.valid && after.valid) ? 1 : 0;
+        report.syscr = after.syscr - before.syscr;
+        report.syscw = after.syscw - before.syscw;
+        report.read_bytes = after.read_bytes - before.read_bytes;
+        report.write_bytes = after.write_bytes - before.write_bytes;
+        ssize_t n = write(fds[1], &report, sizeof(report));
+        _exit(n == static_cast<ssize_t>(sizeof(report)) && ok ? 0 : 1);
+    }
+
+    close(fds[1]);
+    ChildReport report;
+    std::size_t got = 0;
+    while (got < sizeof(report)) {
+        ssize_t n = read(fds[0], reinterpret_cast<char*>(&report) + got, sizeof(report) - got);
+        if (n <= 0) {
+            break;
+        }
+        got += static_cast<std::size_t>(n);
+    }
+    close(fds[0]);
+
+    int status = 0;
+    rusage usage{};
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        std::perror("wait4");
+        return m;
+    }
+    if (got == sizeof(report)) {
+        m.ok = report.ok != 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        m.seconds = report.seconds;
+        m.io_valid = report.io_valid != 0;
+        m.syscr = report.syscr;
+        m.syscw = report.syscw;
+        m.read_bytes = report.read_bytes;
+        m.write_bytes = report.write_bytes;
+    }
+    m.peak_rss_kb = usage.ru_maxrss;
+    m.user_s = toSeconds(usage.ru_utime);
+    m.sys_s = toSeconds(usage.ru_stime);
+    m.voluntary_switches = usage.ru_nvcsw;
+    m.involuntary_switches = usage.ru_nivcsw;
+    return m;
+}
+
+std::string formatDouble(double value) {
+    std::ostringstream oss;
+    oss.precision(6);
+    oss << value;
+    return oss.str();
+}
+
+/**
+ * @brief 输出一条结果记录：json 为每行一个对象，tsv 为制表符分隔（首条记录前输出表头）
+ */
+class Reporter {
+public:
+    Reporter(std::ostream& out, std::string format) : out_(out), format_(std::move(format)) {}
+
+    void report(const BenchConfig& config, const TreeShape& shape, const TreeStats& stats,
+                const std::string& op, std::size_t run, const Measurement& m) {
+        std::size_t entries = stats.files + stats.symlinks;
+        double files_per_s = m.seconds > 0 ? static_cast<double>(entries) / m.seconds : 0;
+        double mb_per_s = m.seconds > 0 ? static_cast<double>(stats.bytes) / 1e6 / m.seconds : 0;
+        auto io = [&m](std::int64_t value) {
+            return m.io_valid ? std::to_string(value) : std::string("null");
+        };
+
+        std::vector<std::pair<std::string, std::string>> fields = {
+            {"version", quote(BR_VERSION)},
+            {"shape", quote(shape.name)},
+            {"op", quote(op)},
+            {"run", std::to_string(run)},
+            {"scale", formatDouble(config.scale)},
+            {"repo_mode", quote(config.repo_mode)},
+            {"package", quote(config.pkg_desc)},
+            {"jobs", std::to_string(config.jobs)},
+            {"ok", m.ok ? "true" : "false"},
+            {"files", std::to_string(stats.files)},
+            {"symlinks", std::to_string(stats.symlinks)},
+            {"bytes", std::to_string(stats.bytes)},
+            {"seconds", formatDouble(m.seconds)},
+            {"files_per_s", formatDouble(files_per_s)},
+            {"mb_per_s", formatDouble(mb_per_s)},
+            {"read_syscalls", io(m.syscr)},
+            {"write_syscalls", io(m.syscw)},
+            {"disk_read_bytes", io(m.read_bytes)},
+            {"disk_write_bytes", io(m.write_bytes)},
+            {"peak_rss_kb", std::to_string(m.peak_rss_kb)},
+            {"user_s", formatDouble(m.user_s)},
+            {"sys_s", formatDouble(m.sys_s)},
+            {"voluntary_switches", std::to_string(m.voluntary_switches)},
+            {"involuntary_switches", std::to_string(m.involuntary_switches)},
+        };
+
+        if (format_ == "tsv") {
+            if (!header_done_) {
+                for (std::size_t i = 0; i < fields.size(); ++i) {
+                    out_ << (i ? "\t" : "") << fields[i].first;
+                }
+                out_ << "\n";
+                header_done_ = true;
+            }
+            for (std::size_t i = 0; i < fields.size(); ++i) {
+                out_ << (i ? "\t" : "") << unquote(fields[i].second);
+            }
+            out_ << "\n";
+        } else {
+            out_ << "{";
+            for (std::size_t i = 0; i < fields.size(); ++i) {
+                out_ << (i ? "," : "") << "\"" << fields[i].first << "\":" << fields[i].second;
+            }
+            out_ << "}\n";
+        }
+        out_.flush();
+    }
+
+private:
+    std::ostream& out_;
+    std::string format_;
+    bool header_done_ = false;
+
+    // 只用于形状名、模式名等内部生成的 ASCII 字符串
+    static std::string quote(const std::string& s) {
+        std::string r = "\"";
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                r += '\\';
+            }
+            r += c;
+        }
+        return r + "\"";
+    }
+
+    static std::string unquote(const std::string& s) {
+        if (s.size() >= 2 && s.front() == '"') {
+            return s.substr(1, s.size() - 2);
+        }
+        return s;
+    }
+};
+
+std::shared_ptr<Repository> openRepository(const BenchConfig& config, const std::filesystem::path& path) {
+    auto repo = std::make_shared<Repository>(path);
+    if (!repo->initialize()) {
+        return nullptr;
+    }
+    repo->setChunking(config.repo_mode == "chunked");
+    repo->setCompression(config.repo_mode == "compress");
+    repo->setPackThreshold(config.pack_threshold);
+    return repo;
+}
+
+void removeAll(const std::filesystem::path& path) {
+    std::error_code ec;
+    std::filesystem::remove_all(path, ec);
+}
+
+/**
+ * @brief 对一个形状依次测量 generate、backup、restore、export、import
+ */
+bool runShape(const BenchConfig& config, const TreeShape& shape, Reporter& reporter) {
+    std::filesystem::path base = config.work_dir / shape.name;
+    std::filesystem::path source = base / "source";
+    std::filesystem::path repo = base / "repo";
+    std::filesystem::path target = base / "restore";
+    std::filesystem::path package = base / "repo.sepkg";
+    std::filesystem::path imported = base / "imported";
+    removeAll(base);
+
+    // 统计由父进程生成（子进程中的结果无法带回），生成耗时单独作为 generate 记录
+    TreeStats stats;
+    Measurement gen;
+    {
+        double start = nowSeconds();
+        gen.ok = generateTree(shape, source, config.seed, stats);
+        gen.seconds = nowSeconds() - start;
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        gen.peak_rss_kb = usage.ru_maxrss;
+    }
+    reporter.report(config, shape, stats, "generate", 0, gen);
+    if (!gen.ok) {
+        return false;
+    }
+
+    bool all_ok = true;
+    for (std::size_t run = 1; run <= config.repeat; ++run) {
+        removeAll(repo);
+        removeAll(target);
+        removeAll(package);
+        removeAll(imported);
+
+        Measurement m = runMeasured([&]() {
+            auto r = openRepository(config, repo);
+            if (!r) {
+                return false;
+            }
+            Backup backup(r);
+            backup.setJobs(config.jobs);
+            return backup.execute(source, nullptr);
+        });
+        reporter.report(config, shape, stats, "backup", run, m);
+        if (!m.ok) {
+            all_ok = false;
+            continue;
+        }
+
+        m = runMeasured([&]() {
+            auto r = std::make_shared<Repository>(repo);
+            if (!r->loadIndex()) {
+                return false;
+            }
+            Restore restore(r);
+            restore.setJobs(config.jobs);
+            return restore.execute(target);
+        });
+        reporter.report(config, shape, stats, "restore", run, m);
+        all_ok = all_ok && m.ok;
+
+        m = runMeasured([&]() {
+            return pkg::export_repo_to_package(repo, package, config.pkg);
+        });
+        reporter.report(config, shape, stats, "export", run, m);
+        if (!m.ok) {
+            all_ok = false;
+            continue;
+        }
+
+        m = runMeasured([&]() {
+            return pkg::import_package_to_repo(package, imported, config.pkg.password, config.jobs);
+        });
+        reporter.report(config, shape, stats, "import", run, m);
+        all_ok = all_ok && m.ok;
+    }
+
+    if (!config.keep) {
+        removeAll(base);
+    }
+    return all_ok;
+}
+
+void printUsage(const char* program) {
+    std::cout << "用法: " << program << " [选项]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "生成合成目录树，分别测量 backup、restore、export、import 的耗时与资源用量，" << std::endl;
+    std::cout << "每个操作在独立子进程中执行，结果按行输出（json 或 tsv）" << std::endl;
+    std::cout << std::endl;
+    std::cout << "选项:" << std::endl;
+    std::cout << "  --shape <名称>        只运行指定形状（可多次指定，默认全部）" << std::endl;
+    std::cout << "  --list-shapes         列出内置形状" << std::endl;
+    std::cout << "  --scale <倍数>        缩放形状规模（默认 1；huge 缩放文件大小，其它缩放文件数）" << std::endl;
+    std::cout << "  --repeat <N>          每个形状重复测量 N 次（默认 1）" << std::endl;
+    std::cout << "  --jobs <N>            backup/restore/import 线程数与 export 编码线程数（默认 1）" << std::endl;
+    std::cout << "  --seed <N>            生成内容的随机种子（默认 1）" << std::endl;
+    std::cout << "  --repo-mode <模式>    mirror（默认）| compress | chunked" << std::endl;
+    std::cout << "  --pack-small <大小>   小于该大小的文件写入段文件（同 backup --pack-small）" << std::endl;
+    std::cout << "  --pkg-pack <布局>     header（默认）| toc" << std::endl;
+    std::cout << "  --pkg-compress <算法> none（默认）| rle | lz" << std::endl;
+    std::cout << "  --pkg-encrypt <算法>  none（默认）| xor | rc4 | chacha20（固定口令）" << std::endl;
+    std::cout << "  --work-dir <目录>     工作目录（默认系统临时目录下的 br-bench-<pid>）" << std::endl;
+    std::cout << "  --keep                保留生成的目录树、仓库和包" << std::endl;
+    std::cout << "  --format json|tsv     输出格式（默认 json，每行一个对象）" << std::endl;
+    std::cout << "  --output <文件>       结果追加写入文件（默认标准输出）" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+    std::string pkg_pack = "header";
+    std::string pkg_compress = "none";
+    std::string pkg_encrypt = "none";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--list-shapes") {
+            for (const auto& shape : builtinShapes()) {
+                std::cout << shape.name << "\t" << shape.description << std::endl;
+            }
+            return 0;
+        } else if (arg == "--shape" && has_value) {
+            std::string name = argv[++i];
+            if (name != "all" && !findShape(name)) {
+                std::cerr << "错误: 未知形状: " << name << "（用 --list-shapes 查看）" << std::endl;
+                return 1;
+            }
+            config.shapes.push_back(name);
+        } else if (arg == "--scale" && has_value) {
+            config.scale = std::stod(argv[++i]);
+            if (!(config.scale > 0)) {
+                std::cerr << "错误: --scale 必须大于 0" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--repeat" && has_value) {
+            config.repeat = std::max<std::size_t>(1, std::stoul(argv[++i]));
+        } else if (arg == "--jobs" && has_value) {
+            config.jobs = static_cast<std::size_t>(std::stoul(argv[++i]));
+        } else if (arg == "--seed" && has_value) {
+            config.seed = std::stoull(argv[++i]);
+        } else if (arg == "--repo-mode" && has_value) {
+            config.repo_mode = argv[++i];
+            if (config.repo_mode != "mirror" && config.repo_mode != "compress" &&
+                config.repo_mode != "chunked") {
+                std::cerr << "错误: 无效的仓库模式: " << config.repo_mode << std::endl;
+                return 1;
+            }
+        } else if (arg == "--pack-small" && has_value) {
+            if (!parseSize(argv[++i], config.pack_threshold)) {
+                std::cerr << "错误: 无效的大小: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--pkg-pack" && has_value) {
+            pkg_pack = argv[++i];
+        } else if (arg == "--pkg-compress" && has_value) {
+            pkg_compress = argv[++i];
+        } else if (arg == "--pkg-encrypt" && has_value) {
+            pkg_encrypt = argv[++i];
+        } else if (arg == "--work-dir" && has_value) {
+            config.work_dir = argv[++i];
+        } else if (arg == "--keep") {
+            config.keep = true;
+        } else if (arg == "--format" && has_value) {
+            config.format = argv[++i];
+            if (config.format != "json" && config.format != "tsv") {
+                std::cerr << "错误: 无效的输出格式: " << config.format << std::endl;
+                return 1;
+            }
+        } else if (arg == "--output" && has_value) {
+            config.output = argv[++i];
+        } else {
+            std::cerr << "错误: 未识别参数: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    config.pkg.packAlg = pkg::parsePack(pkg_pack);
+    config.pkg.compressAlg = pkg::parseCompress(pkg_compress);
+    config.pkg.encryptAlg = pkg::parseEncrypt(pkg_encrypt);
+    config.pkg.jobs = config.jobs;
+    if (config.pkg.encryptAlg != pkg::EncryptAlg::None) {
+        config.pkg.password = kPassword;
+    }
+    config.pkg_desc = pkg_pack + "/" + pkg_compress + "/" + pkg_encrypt;
+
+    bool owns_work_dir = config.work_dir.empty();
+    if (owns_work_dir) {
+        config.work_dir = std::filesystem::temp_directory_path() /
+                          ("br-bench-" + std::to_string(getpid()));
+    }
+
+    std::vector<TreeShape> shapes;
+    bool all = config.shapes.empty();
+    for (const auto& name : config.shapes) {
+        all = all || name == "all";
+    }
+    for (const auto& shape : builtinShapes()) {
+        bool selected = all;
+        for (const auto& name : config.shapes) {
+            selected = selected || name == shape.name;
+        }
+        if (selected) {
+            shapes.push_back(scaleShape(shape, config.scale));
+        }
+    }
+
+    std::ofstream file;
+    if (!config.output.empty()) {
+        file.open(config.output, std::ios::app);
+        if (!file) {
+            std::cerr << "错误: 无法打开输出文件: " << config.output << std::endl;
+            return 1;
+        }
+    }
+    Reporter reporter(config.output.empty() ? std::cout : file, config.format);
+
+    bool ok = true;
+    for (const auto& shape : shapes) {
+        std::cerr << "[br-bench] " << shape.name << ": " << shape.files << " 个文件, "
+                  << shape.symlinks << " 个符号链接" << std::endl;
+        if (!runShape(config, shape, reporter)) {
+            std::cerr << "[br-bench] " << shape.name << " 有操作失败" << std::endl;
+            ok = false;
+        }
+    }
+
+    if (owns_work_dir && !config.keep) {
+        removeAll(config.work_dir);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,683 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "tree_generator.h"
+#include "filters/attribute_filter.h"
+#include "storage/package/binary_io.h"
+#include "storage/package/compress_lz.h"
+#include "storage/package/compress_rle.h"
+#include "storage/package/encrypt_chacha.h"
+#include "storage/package/encrypt_rc4.h"
+#include "storage/package/encrypt_xor.h"
+#include "storage/package/pack_toc.h"
+
+// ===== 全局分配计数：替换 operator new/delete，统计每次操作的分配次数和字节数 =====
+
+// 替换后的 operator new 本身用 malloc 分配，GCC 内联后会误报 free 与 new 不匹配
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+namespace {
+std::atomic<std::uint64_t> g_allocs{0};
+std::atomic<std::uint64_t> g_alloc_bytes{0};
+} // namespace
+
+void* operator new(std::size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { operator delete(p); }
+
+using namespace backuprestore::bench;
+
+namespace {
+
+// ===== 周期计数：优先 perf 的 CPU 周期，其次 TSC（参考周期，不随频率变化），都没有时只报告 ns =====
+
+class CycleCounter {
+public:
+    CycleCounter() {
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if (fd_ >= 0) {
+            source_ = "perf";
+        } else {
+#if defined(__x86_64__) || defined(__i386__)
+            source_ = "tsc";
+#else
+            source_ = "none";
+#endif
+        }
+    }
+
+    ~CycleCounter() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    CycleCounter(const CycleCounter&) = delete;
+    CycleCounter& operator=(const CycleCounter&) = delete;
+
+    const char* source() const { return source_; }
+    bool available() const { return std::strcmp(source_, "none") != 0; }
+
+    std::uint64_t read() const {
+        if (fd_ >= 0) {
+            std::uint64_t value = 0;
+            if (::read(fd_, &value, sizeof(value)) == static_cast<ssize_t>(sizeof(value))) {
+                return value;
+            }
+            return 0;
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+private:
+    int fd_ = -1;
+    const char* source_ = "none";
+};
+
+// 丢弃写入内容、只记录位置的流缓冲区（pack_toc_write 需要 tellp）
+class NullBuf : public std::streambuf {
+protected:
+    int_type overflow(int_type c) override {
+        ++pos_;
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char*, std::streamsize n) override {
+        pos_ += n;
+        return n;
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) override {
+        if (dir == std::ios_base::cur && off == 0) {
+            return pos_type(pos_);
+        }
+        return pos_type(off_type(-1));
+    }
+
+private:
+    std::streamoff pos_ = 0;
+};
+
+// 防止被测结果被优化掉
+volatile std::uint64_t g_sink = 0;
+
+/**
+ * @brief 一个被测操作：prepare 不计时，run 计时并返回输出字节数
+ */
+class Benchmark {
+public:
+    virtual ~Benchmark() = default;
+    virtual const char* name() const = 0;
+    // 结果随输入内容变化（压缩类）时对每种数据分别测量，否则只用随机数据
+    virtual bool contentSensitive() const { return false; }
+    virtual void prepare(const std::vector<std::uint8_t>& input) = 0;
+    virtual std::size_t run() = 0;
+};
+
+const std::string kPassword = "br-microbench";
+const std::vector<std::uint8_t> kSalt(16, 0x5A);
+
+class RleCompress : public Benchmark {
+public:
+    const char* name() const override { return "rle_compress"; }
+    bool contentSensitive() const override { return true; }
+    void prepare(const std::vector<std::uint8_t>& input) override { in_ = &input; }
+    std::size_t run() override { return pkg::rle_compress(*in_).size(); }
+
+private:
+    const std::vector<std::uint8_t>* in_ = nullptr;
+};
+
+class RleDecompress : public Benchmark {
+public:
+    const char* name() const override { return "rle_decompress"; }
+    bool contentSensitive() const override { return true; }
+    void prepare(const std::vector<std::uint8_t>& input) override { encoded_ = pkg::rle_compress(input); }
+    std::size_t run() override { return pkg::rle_decompress(encoded_).size(); }
+
+private:
+    std::vector<std::uint8_t> encoded_;
+};
+
+class LzCompress : public Benchmark {
+public:
+    const char* name() const override { return "lz_compress"; }
+    bool contentSensitive() const override { return true; }
+    void prepare(const std::vector<std::uint8_t>& input) override { in_ = &input; }
+    std::size_t run() override { return pkg::lz_compress(*in_).size(); }
+
+private:
+    const std::vector<std::uint8_t>* in_ = nullptr;
+};
+
+class LzDecompress : public Benchmark {
+public:
+    const char* name() const override { return "lz_decompress"; }
+    bool contentSensitive() const override { return true; }
+    void prepare(const std::vector<std::uint8_t>& input) override { encoded_ = pkg::lz_compress(input); }
+    std::size_t run() override { return pkg::lz_decompress(encoded_).size(); }
+
+private:
+    std::vector<std::uint8_t> encoded_;
+};
+
+class XorCrypt : public Benchmark {
+public:
+    const char* name() const override { return "xor_crypt"; }
+    void prepare(const std::vector<std::uint8_t>& input) override { in_ = &input; }
+    std::size_t run() override {
+        auto out = pkg::xor_crypt(*in_, kPassword, kSalt);
+        g_sink = g_sink + (out.empty() ? 0 : out.back());
+        return out.size();
+    }
+
+private:
+    const std::vector<std::uint8_t>* in_ = nullptr;
+};
+
+class Rc4Crypt : public Benchmark {
+public:
+    const char* name() const override { return "rc4_crypt"; }
+    void prepare(const std::vector<std::uint8_t>& input) override { in_ = &input; }
+    std::size_t run() override {
+        auto out = pkg::rc4_crypt(*in_, kPassword, kSalt);
+        g_sink = g_sink + (out.empty() ? 0 : out.back());
+        return out.size();
+    }
+
+private:
+    const std::vector<std::uint8_t>* in_ = nullptr;
+};
+
+class ChachaCrypt : public Benchmark {
+public:
+    const char* name() const override { return "chacha_crypt"; }
+    void prepare(const std::vector<std::uint8_t>& input) override {
+        in_ = &input;
+        key_.fill(0x42);  // 不测 PBKDF2
+    }
+    std::size_t run() override {
+        auto out = pkg::chacha_crypt(*in_, key_, 1);
+        g_sink = g_sink + (out.empty() ? 0 : out.back());
+        return out.size();
+    }
+
+private:
+    const std::vector<std::uint8_t>* in_ = nullptr;
+    pkg::ChaChaKey key_{};
+};
+
+// 小端整数：按 u64 顺序写/读整个缓冲区
+class LeWrite : public Benchmark {
+public:
+    const char* name() const override { return "le_write"; }
+    void prepare(const std::vector<std::uint8_t>& input) override { in_ = &input; }
+    std::size_t run() override {
+        const std::size_t count = in_->size() / 8;
+        pkg::ByteWriter w(count * 8);
+        const std::uint8_t* p = in_->data();
+        for (std::size_t i = 0; i < count; ++i) {
+            w.le<std::uint64_t>(pkg::load_le<std::uint64_t>(p + i * 8) + i);
+        }
+        return w.size();
+    }
+
+private:
+    const std::vector<std::uint8_t>* in_ = nullptr;
+};
+
+class LeRead : public Benchmark {
+public:
+    const char* name() const override { return "le_read"; }
+    void prepare(const std::vector<std::uint8_t>& input) override { in_ = &input; }
+    std::size_t run() override {
+        const std::size_t count = in_->size() / 8;
+        pkg::ByteReader r(pkg::ByteSpan(in_->data(), count * 8));
+        std::uint64_t sum = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            sum += r.le<std::uint64_t>();
+        }
+        g_sink = g_sink + sum;
+        return count * 8;
+    }
+
+private:
+    const std::vector<std::uint8_t>* in_ = nullptr;
+};
+
+// 字符串：u32 长度 + 内容，长度 8-64 字节（类似仓库相对路径）
+std::vector<std::string> makeStrings(const std::vector<std::uint8_t>& input) {
+    std::vector<std::string> strings;
+    std::size_t pos = 0;
+    while (pos < input.size()) {
+        std::size_t len = 8 + input[pos] % 57;
+        if (pos + 4 + len > input.size()) {
+            break;
+        }
+        std::string s(len, 'a');
+        for (std::size_t i = 0; i < len; ++i) {
+            s[i] = static_cast<char>('a' + input[pos + i] % 26);
+        }
+        strings.push_back(std::move(s));
+        pos += 4 + len;
+    }
+    return strings;
+}
+
+class StringWrite : public Benchmark {
+public:
+    const char* name() const override { return "string_write"; }
+    void prepare(const std::vector<std::uint8_t>& input) override {
+        strings_ = makeStrings(input);
+        bytes_ = 0;
+        for (const auto& s : strings_) {
+            bytes_ += 4 + s.size();
+        }
+    }
+    std::size_t run() override {
+        pkg::ByteWriter w(bytes_);
+        for (const auto& s : strings_) {
+            w.string(s);
+        }
+        return w.size();
+    }
+
+private:
+    std::vector<std::string> strings_;
+    std::size_t bytes_ = 0;
+};
+
+class StringRead : public Benchmark {
+public:
+    const char* name() const override { return "string_read"; }
+    void prepare(const std::vector<std::uint8_t>& input) override {
+        auto strings = makeStrings(input);
+        count_ = strings.size();
+        pkg::ByteWriter w;
+        for (const auto& s : strings) {
+            w.string(s);
+        }
+        encoded_ = w.buffer();
+    }
+    std::size_t run() override {
+        pkg::ByteReader r(encoded_);
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < count_; ++i) {
+            total += r.string().size();
+        }
+        g_sink = g_sink + total;
+        return encoded_.size();
+    }
+
+private:
+    std::vector<std::uint8_t> encoded_;
+    std::size_t count_ = 0;
+};
+
+// TOC 包：输入切成 4 KiB 的 blob，每个 blob 一个条目
+constexpr std::size_t kTocBlobSize = 4096;
+
+void makeToc(const std::vector<std::uint8_t>& input, std::vector<pkg::TocItem>& toc,
+             std::vector<std::vector<std::uint8_t>>& blobs) {
+    toc.clear();
+    blobs.clear();
+    for (std::size_t pos = 0, i = 0; pos < input.size(); pos += kTocBlobSize, ++i) {
+        std::size_t n = std::min(kTocBlobSize, input.size() - pos);
+        char path[64];
+        std::snprintf(path, sizeof(path), "dir%03zu/file%06zu.dat", i % 256, i);
+        pkg::TocItem item;
+        item.relPath = path;
+        item.originalSize = n;
+        item.checksum = i;
+        item.hasChecksum = true;
+        toc.push_back(std::move(item));
+        blobs.emplace_back(input.begin() + static_cast<std::ptrdiff_t>(pos),
+                           input.begin() + static_cast<std::ptrdiff_t>(pos + n));
+    }
+}
+
+class TocWrite : public Benchmark {
+public:
+    const char* name() const override { return "pack_toc_write"; }
+    void prepare(const std::vector<std::uint8_t>& input) override { makeToc(input, toc_, blobs_); }
+    std::size_t run() override {
+        NullBuf buf;
+        std::ostream os(&buf);
+        pkg::pack_toc_write(os, toc_, blobs_);
+        return static_cast<std::size_t>(os.tellp());
+    }
+
+private:
+    std::vector<pkg::TocItem> toc_;
+    std::vector<std::vector<std::uint8_t>> blobs_;
+};
+
+class TocRead : public Benchmark {
+public:
+    const char* name() const override { return "pack_toc_read"; }
+    void prepare(const std::vector<std::uint8_t>& input) override {
+        std::vector<pkg::TocItem> toc;
+        std::vector<std::vector<std::uint8_t>> blobs;
+        makeToc(input, toc, blobs);
+        std::ostringstream os;
+        pkg::pack_toc_write(os, toc, blobs);
+        is_ = std::make_unique<std::istringstream>(os.str());
+    }
+    std::size_t run() override {
+        std::vector<pkg::TocItem> toc;
+        std::vector<std::vector<std::uint8_t>> blobs;
+        is_->clear();
+        pkg::pack_toc_read(*is_, toc, blobs);
+        return blobs.size();
+    }
+
+private:
+    std::unique_ptr<std::istringstream> is_;
+};
+
+std::vector<std::unique_ptr<Benchmark>> allBenchmarks() {
+    std::vector<std::unique_ptr<Benchmark>> list;
+    list.push_back(std::make_unique<RleCompress>());
+    list.push_back(std::make_unique<RleDecompress>());
+    list.push_back(std::make_unique<LzCompress>());
+    list.push_back(std::make_unique<LzDecompress>());
+    list.push_back(std::make_unique<XorCrypt>());
+    list.push_back(std::make_unique<Rc4Crypt>());
+    list.push_back(std::make_unique<ChachaCrypt>());
+    list.push_back(std::make_unique<LeWrite>());
+    list.push_back(std::make_unique<LeRead>());
+    list.push_back(std::make_unique<StringWrite>());
+    list.push_back(std::make_unique<StringRead>());
+    list.push_back(std::make_unique<TocWrite>());
+    list.push_back(std::make_unique<TocRead>());
+    return list;
+}
+
+struct DataKind {
+    const char* name;
+    Content content;
+};
+
+const DataKind kDataKinds[] = {
+    {"text", Content::Text},
+    {"random", Content::Random},
+    {"runs", Content::Runs},
+};
+
+struct MicroConfig {
+    std::vector<std::string> filters;      // 名称子串，空表示全部
+    std::vector<std::string> data;         // 空表示全部
+    std::uint64_t min_size = 4 * 1024;
+    std::uint64_t max_size = 64ULL * 1024 * 1024;
+    std::uint64_t target = 16ULL * 1024 * 1024;  // 每轮至少处理的字节数
+    std::size_t repeat = 3;
+    std::string format = "json";
+};
+
+struct Result {
+    std::size_t iterations = 0;
+    double seconds = 0;              // 最快一轮
+    std::uint64_t cycles = 0;        // 最快一轮
+    std::uint64_t allocs = 0;        // 每次操作
+    std::uint64_t alloc_bytes = 0;   // 每次操作
+    std::size_t output_bytes = 0;
+};
+
+Result measure(Benchmark& bench, std::size_t size, const MicroConfig& config, const CycleCounter& counter) {
+    Result result;
+    result.iterations = static_cast<std::size_t>(std::max<std::uint64_t>(1, config.target / size));
+    result.output_bytes = bench.run();  // 预热（页面、缓存、thread_local 状态）
+
+    for (std::size_t round = 0; round < config.repeat; ++round) {
+        std::uint64_t allocs = g_allocs.load(std::memory_order_relaxed);
+        std::uint64_t alloc_bytes = g_alloc_bytes.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        std::uint64_t c0 = counter.read();
+        for (std::size_t i = 0; i < result.iterations; ++i) {
+            g_sink = g_sink + bench.run();
+        }
+        std::uint64_t c1 = counter.read();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (round == 0 || seconds < result.seconds) {
+            result.seconds = seconds;
+            result.cycles = c1 - c0;
+        }
+        result.allocs = (g_allocs.load(std::memory_order_relaxed) - allocs) / result.iterations;
+        result.alloc_bytes = (g_alloc_bytes.load(std::memory_order_relaxed) - alloc_bytes) / result.iterations;
+    }
+    return result;
+}
+
+std::string formatDouble(double value) {
+    std::ostringstream oss;
+    oss.precision(6);
+    oss << value;
+    return oss.str();
+}
+
+void report(std::ostream& out, const MicroConfig& config, bool& header_done, const char* bench,
+            const char* data, std::size_t size, const Result& r, const CycleCounter& counter) {
+    double bytes = static_cast<double>(size) * static_cast<double>(r.iterations);
+    std::vector<std::pair<std::string, std::string>> fields = {
+        {"version", std::string("\"") + BR_VERSION + "\""},
+        {"bench", std::string("\"") + bench + "\""},
+        {"data", std::string("\"") + data + "\""},
+        {"size", std::to_string(size)},
+        {"iterations", std::to_string(r.iterations)},
+        {"seconds", formatDouble(r.seconds)},
+        {"ns_per_byte", formatDouble(r.seconds * 1e9 / bytes)},
+        {"cycles_per_byte", counter.available() ? formatDouble(static_cast<double>(r.cycles) / bytes) : "null"},
+        {"cycle_source", std::string("\"") + counter.source() + "\""},
+        {"mb_per_s", formatDouble(r.seconds > 0 ? bytes / 1e6 / r.seconds : 0)},
+        {"output_bytes", std::to_string(r.output_bytes)},
+        {"allocs_per_op", std::to_string(r.allocs)},
+        {"alloc_bytes_per_op", std::to_string(r.alloc_bytes)},
+    };
+    if (config.format == "tsv") {
+        if (!header_done) {
+            for (std::size_t i = 0; i < fields.size(); ++i) {
+                out << (i ? "\t" : "") << fields[i].first;
+            }
+            out << "\n";
+            header_done = true;
+        }
+        for (std::size_t i = 0; i < fields.size(); ++i) {
+            std::string v = fields[i].second;
+            if (v.size() >= 2 && v.front() == '"') {
+                v = v.substr(1, v.size() - 2);
+            }
+            out << (i ? "\t" : "") << v;
+        }
+        out << "\n";
+    } else {
+        out << "{";
+        for (std::size_t i = 0; i < fields.size(); ++i) {
+            out << (i ? "," : "") << "\"" << fields[i].first << "\":" << fields[i].second;
+        }
+        out << "}\n";
+    }
+    out.flush();
+}
+
+bool selected(const std::vector<std::string>& list, const std::string& name, bool substring) {
+    if (list.empty()) {
+        return true;
+    }
+    for (const auto& item : list) {
+        if (substring ? name.find(item) != std::string::npos : name == item) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void printUsage(const char* program) {
+    std::cout << "用法: " << program << " [选项]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "pkg 编解码与序列化微基准：缓冲区大小从 --min-size 起按 4 倍递增到 --max-size，" << std::endl;
+    std::cout << "报告 ns/字节、周期/字节（perf 或 TSC）和每次操作的分配次数/字节数" << std::endl;
+    std::cout << std::endl;
+    std::cout << "选项:" << std::endl;
+    std::cout << "  --filter <子串>     只运行名称包含子串的基准（可多次指定）" << std::endl;
+    std::cout << "  --data <类型>       压缩类基准的输入：text | random | runs（可多次指定，默认全部）" << std::endl;
+    std::cout << "  --min-size <大小>   最小缓冲区（默认 4K）" << std::endl;
+    std::cout << "  --max-size <大小>   最大缓冲区（默认 64M；完整范围用 1G）" << std::endl;
+    std::cout << "  --target <大小>     每轮至少处理的字节数，小缓冲区据此重复多次（默认 16M）" << std::endl;
+    std::cout << "  --repeat <N>        每项测量 N 轮，取最快一轮（默认 3）" << std::endl;
+    std::cout << "  --format json|tsv   输出格式（默认 json，每行一个对象）" << std::endl;
+    std::cout << "  --output <文件>     结果追加写入文件（默认标准输出）" << std::endl;
+    std::cout << "  --list              列出全部基准" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    MicroConfig config;
+    std::string output;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        auto size_arg = [&](std::uint64_t& value) {
+            if (!backuprestore::parseSize(argv[++i], value) || value == 0) {
+                std::cerr << "错误: 无效的大小: " << argv[i] << std::endl;
+                return false;
+            }
+            return true;
+        };
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--list") {
+            for (const auto& bench : allBenchmarks()) {
+                std::cout << bench->name() << std::endl;
+            }
+            return 0;
+        } else if (arg == "--filter" && has_value) {
+            config.filters.push_back(argv[++i]);
+        } else if (arg == "--data" && has_value) {
+            config.data.push_back(argv[++i]);
+        } else if (arg == "--min-size" && has_value) {
+            if (!size_arg(config.min_size)) return 1;
+        } else if (arg == "--max-size" && has_value) {
+            if (!size_arg(config.max_size)) return 1;
+        } else if (arg == "--target" && has_value) {
+            if (!size_arg(config.target)) return 1;
+        } else if (arg == "--repeat" && has_value) {
+            config.repeat = std::max<std::size_t>(1, std::stoul(argv[++i]));
+        } else if (arg == "--format" && has_value) {
+            config.format = argv[++i];
+            if (config.format != "json" && config.format != "tsv") {
+                std::cerr << "错误: 无效的输出格式: " << config.format << std::endl;
+                return 1;
+            }
+        } else if (arg == "--output" && has_value) {
+            output = argv[++i];
+        } else {
+            std::cerr << "错误: 未识别参数: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::ofstream file;
+    if (!output.empty()) {
+        file.open(output, std::ios::app);
+        if (!file) {
+            std::cerr << "错误: 无法打开输出文件: " << output << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = output.empty() ? std::cout : file;
+
+    CycleCounter counter;
+    std::cerr << "[br-microbench] 周期计数: " << counter.source()
+              << "，chacha20 实现: " << pkg::chacha_impl_name() << std::endl;
+
+    auto benchmarks = allBenchmarks();
+    const std::vector<std::uint8_t> empty;
+    bool header_done = false;
+    for (std::uint64_t size = config.min_size; size <= config.max_size; size *= 4) {
+        for (const auto& kind : kDataKinds) {
+            bool data_selected = selected(config.data, kind.name, false);
+            bool is_random = std::strcmp(kind.name, "random") == 0;
+            std::vector<std::uint8_t> input;
+            for (const auto& bench : benchmarks) {
+                if (!selected(config.filters, bench->name(), true)) {
+                    continue;
+                }
+                // 与内容无关的基准只用随机数据测一次
+                if (bench->contentSensitive() ? !data_selected : !is_random) {
+                    continue;
+                }
+                if (input.empty()) {
+                    input.resize(static_cast<std::size_t>(size));
+                    fillBuffer(kind.content, size, input.data(), input.size());
+                }
+                bench->prepare(input);
+                Result r = measure(*bench, static_cast<std::size_t>(size), config, counter);
+                report(out, config, header_done, bench->name(), kind.name,
+                       static_cast<std::size_t>(size), r, counter);
+                bench->prepare(empty);  // 释放准备的数据
+            }
+        }
+    }
+    return static_cast<int>(g_sink & 0);
+}
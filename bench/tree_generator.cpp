@@ -0,0 +1,290 @@
+#include "tree_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+namespace backuprestore {
+namespace bench {
+
+namespace {
+
+constexpr std::uint64_t MiB = 1024 * 1024;
+
+/**
+ * @brief splitmix64：足够快且可复现的伪随机序列
+ */
+class SplitMix64 {
+public:
+    explicit SplitMix64(std::uint64_t seed) : state_(seed) {}
+
+    std::uint64_t next() {
+        std::uint64_t z = (state_ += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    /**
+     * @brief [lo, hi] 内的均匀整数
+     */
+    std::uint64_t range(std::uint64_t lo, std::uint64_t hi) {
+        return hi <= lo ? lo : lo + next() % (hi - lo + 1);
+    }
+
+private:
+    std::uint64_t state_;
+};
+
+const char* const kWords[] = {
+    "backup", "restore", "repository", "index", "chunk", "segment", "metadata",
+    "the", "of", "and", "a", "to", "in", "is", "file", "directory", "data",
+    "snapshot", "verify", "checksum", "block", "stream", "package", "export",
+    "import", "offset", "length", "mode", "owner", "time", "path", "link",
+};
+constexpr std::size_t kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+void fillText(SplitMix64& rng, char* buf, std::size_t n) {
+    std::size_t pos = 0;
+    while (pos < n) {
+        std::uint64_t r = rng.next();
+        const char* word = kWords[r % kWordCount];
+        std::size_t len = std::strlen(word);
+        std::size_t take = std::min(len, n - pos);
+        std::memcpy(buf + pos, word, take);
+        pos += take;
+        if (pos < n) {
+            // 大约每 12 个词换一行
+            buf[pos++] = ((r >> 32) % 12 == 0) ? '\n' : ' ';
+        }
+    }
+}
+
+void fillRandom(SplitMix64& rng, char* buf, std::size_t n) {
+    std::size_t pos = 0;
+    while (pos + 8 <= n) {
+        std::uint64_t v = rng.next();
+        std::memcpy(buf + pos, &v, 8);
+        pos += 8;
+    }
+    if (pos < n) {
+        std::uint64_t v = rng.next();
+        std::memcpy(buf + pos, &v, n - pos);
+    }
+}
+
+void fillRuns(SplitMix64& rng, char* buf, std::size_t n) {
+    std::size_t pos = 0;
+    while (pos < n) {
+        std::uint64_t r = rng.next();
+        std::size_t len = std::min<std::size_t>(1 + r % 64, n - pos);
+        std::memset(buf + pos, static_cast<int>((r >> 8) & 0xFF), len);
+        pos += len;
+    }
+}
+
+void fill(Content content, SplitMix64& rng, char* buf, std::size_t n) {
+    switch (content) {
+    case Content::Text:
+        fillText(rng, buf, n);
+        break;
+    case Content::Runs:
+        fillRuns(rng, buf, n);
+        break;
+    default:
+        fillRandom(rng, buf, n);
+        break;
+    }
+}
+
+bool writeFile(const std::filesystem::path& path, std::uint64_t size, Content content,
+               SplitMix64& rng, std::vector<char>& buffer) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "无法创建文件: " << path << std::endl;
+        return false;
+    }
+    std::uint64_t written = 0;
+    while (written < size) {
+        std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(buffer.size(), size - written));
+        if (content == Content::Mixed) {
+            fill(written < size / 2 ? Content::Text : Content::Random, rng, buffer.data(), n);
+        } else {
+            fill(content, rng, buffer.data(), n);
+        }
+        out.write(buffer.data(), static_cast<std::streamsize>(n));
+        written += n;
+    }
+    if (!out) {
+        std::cerr << "写入文件失败: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string branchName(std::size_t branch) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "b%03zu", branch);
+    return name;
+}
+
+std::string levelName(std::size_t level) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "l%02zu", level);
+    return name;
+}
+
+std::string fileName(std::size_t index) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "f%06zu.dat", index);
+    return name;
+}
+
+std::uint64_t hashName(const std::string& name) {
+    std::uint64_t h = 1469598103934665603ULL;  // FNV-1a
+    for (unsigned char c : name) {
+        h = (h ^ c) * 1099511628211ULL;
+    }
+    return h;
+}
+
+} // namespace
+
+const std::vector<TreeShape>& builtinShapes() {
+    static const std::vector<TreeShape> shapes = {
+        {"tiny", "20000 个 64B-4KiB 文本小文件，分布在 200 个目录",
+         20000, 64, 4096, 200, 1, 0, Content::Text},
+        {"huge", "4 个 128MiB 文件，前半文本、后半随机",
+         4, 128 * MiB, 128 * MiB, 1, 1, 0, Content::Mixed},
+        {"deep", "2000 个文件分布在 4 条 64 层深的目录链中",
+         2000, 512, 8192, 4, 64, 0, Content::Text},
+        {"symlinks", "1000 个文件和 9000 个符号链接（含悬空链接和目录链接）",
+         1000, 256, 8192, 10, 2, 9000, Content::Text},
+        {"compressible", "256 个 1MiB 文本文件",
+         256, MiB, MiB, 16, 1, 0, Content::Text},
+        {"incompressible", "256 个 1MiB 随机数据文件",
+         256, MiB, MiB, 16, 1, 0, Content::Random},
+    };
+    return shapes;
+}
+
+const TreeShape* findShape(const std::string& name) {
+    for (const auto& shape : builtinShapes()) {
+        if (shape.name == name) {
+            return &shape;
+        }
+    }
+    return nullptr;
+}
+
+TreeShape scaleShape(const TreeShape& shape, double scale) {
+    TreeShape scaled = shape;
+    auto apply = [scale](std::uint64_t value) -> std::uint64_t {
+        if (value == 0) {
+            return 0;
+        }
+        return std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::llround(value * scale)));
+    };
+    if (shape.name == "huge") {
+        scaled.min_size = apply(shape.min_size);
+        scaled.max_size = apply(shape.max_size);
+    } else {
+        scaled.files = static_cast<std::size_t>(apply(shape.files));
+        scaled.symlinks = static_cast<std::size_t>(apply(shape.symlinks));
+    }
+    return scaled;
+}
+
+void fillBuffer(Content content, std::uint64_t seed, std::uint8_t* data, std::size_t n) {
+    SplitMix64 rng(seed);
+    char* buf = reinterpret_cast<char*>(data);
+    if (content == Content::Mixed) {
+        fill(Content::Text, rng, buf, n / 2);
+        fill(Content::Random, rng, buf + n / 2, n - n / 2);
+    } else {
+        fill(content, rng, buf, n);
+    }
+}
+
+bool generateTree(const TreeShape& shape, const std::filesystem::path& root,
+                  std::uint64_t seed, TreeStats& stats) {
+    stats = TreeStats{};
+    std::error_code ec;
+    std::filesystem::create_directories(root, ec);
+    if (ec) {
+        std::cerr << "无法创建目录: " << root << ": " << ec.message() << std::endl;
+        return false;
+    }
+
+    // 每个目录节点 (branch, level) 的相对路径
+    std::size_t branches = std::max<std::size_t>(1, shape.branches);
+    std::size_t depth = std::max<std::size_t>(1, shape.depth);
+    std::vector<std::filesystem::path> dirs;
+    dirs.reserve(branches * depth);
+    for (std::size_t b = 0; b < branches; ++b) {
+        std::filesystem::path dir = branchName(b);
+        for (std::size_t l = 1; l <= depth; ++l) {
+            if (l > 1) {
+                dir /= levelName(l);
+            }
+            dirs.push_back(dir);
+        }
+        std::filesystem::create_directories(root / dir, ec);
+        if (ec) {
+            std::cerr << "无法创建目录: " << root / dir << ": " << ec.message() << std::endl;
+            return false;
+        }
+    }
+    stats.dirs = dirs.size();
+
+    SplitMix64 rng(seed ^ hashName(shape.name));
+    std::vector<char> buffer(static_cast<std::size_t>(std::min<std::uint64_t>(MiB, std::max<std::uint64_t>(shape.max_size, 1))));
+    std::vector<std::filesystem::path> files;
+    files.reserve(shape.files);
+    for (std::size_t i = 0; i < shape.files; ++i) {
+        std::filesystem::path rel = dirs[i % dirs.size()] / fileName(i);
+        std::uint64_t size = rng.range(shape.min_size, shape.max_size);
+        if (!writeFile(root / rel, size, shape.content, rng, buffer)) {
+            return false;
+        }
+        files.push_back(rel);
+        stats.files++;
+        stats.bytes += size;
+    }
+
+    if (shape.symlinks > 0) {
+        std::filesystem::path links = root / "links";
+        std::filesystem::create_directories(links, ec);
+        if (ec) {
+            std::cerr << "无法创建目录: " << links << ": " << ec.message() << std::endl;
+            return false;
+        }
+        stats.dirs++;
+        for (std::size_t i = 0; i < shape.symlinks; ++i) {
+            std::filesystem::path target;
+            if (i % 50 == 49) {
+                target = std::filesystem::path("..") / dirs[i % dirs.size()];
+            } else if (i % 10 == 9 || files.empty()) {
+                target = std::filesystem::path("..") / "missing" / fileName(i);
+            } else {
+                target = std::filesystem::path("..") / files[i % files.size()];
+            }
+            char name[32];
+            std::snprintf(name, sizeof(name), "s%06zu", i);
+            std::filesystem::create_symlink(target, links / name, ec);
+            if (ec) {
+                std::cerr << "无法创建符号链接: " << links / name << ": " << ec.message() << std::endl;
+                return false;
+            }
+            stats.symlinks++;
+        }
+    }
+    return true;
+}
+
+} // namespace bench
+} // namespace backuprestore
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace backuprestore {
+namespace bench {
+
+/**
+ * @brief 合成文件的内容类型
+ */
+enum class Content {
+    Text,    // 小词表随机拼出的文本（可压缩）
+    Random,  // 伪随机字节（不可压缩）
+    Mixed,   // 文件前半为文本、后半为随机字节
+    Runs     // 随机长度（1-64）的重复字节段（RLE 的有利情况）
+};
+
+/**
+ * @brief 合成目录树的形状
+ *
+ * 目录由 branches 条分支组成，每条分支嵌套 depth 层（b000/l01/l02/...），
+ * 普通文件按轮转方式分布到全部 branches*depth 个目录中；
+ * 符号链接统一放在 links/ 下，指向已生成的文件（每 10 个有一个悬空链接，每 50 个有一个指向目录）
+ */
+struct TreeShape {
+    std::string name;
+    std::string description;
+    std::size_t files = 0;
+    std::uint64_t min_size = 0;   // 文件大小在 [min_size, max_size] 内均匀分布
+    std::uint64_t max_size = 0;
+    std::size_t branches = 1;
+    std::size_t depth = 1;
+    std::size_t symlinks = 0;
+    Content content = Content::Text;
+};
+
+/**
+ * @brief 生成结果统计
+ */
+struct TreeStats {
+    std::size_t files = 0;
+    std::size_t symlinks = 0;
+    std::size_t dirs = 0;
+    std::uint64_t bytes = 0;      // 普通文件内容总字节数
+};
+
+/**
+ * @brief 内置形状：tiny、huge、deep、symlinks、compressible、incompressible
+ */
+const std::vector<TreeShape>& builtinShapes();
+
+/**
+ * @brief 按名称查找内置形状
+ * @return 未找到时返回 nullptr
+ */
+const TreeShape* findShape(const std::string& name);
+
+/**
+ * @brief 按比例缩放形状：huge 缩放文件大小，其它形状缩放文件和链接数量（至少保留 1 个）
+ */
+TreeShape scaleShape(const TreeShape& shape, double scale);
+
+/**
+ * @brief 用 content 类型的伪随机内容填满 data（相同 seed 结果相同；Mixed 前半文本、后半随机）
+ */
+void fillBuffer(Content content, std::uint64_t seed, std::uint8_t* data, std::size_t n);
+
+/**
+ * @brief 在 root 下生成目录树（root 必须不存在或为空）；相同 shape 与 seed 生成的内容完全相同
+ * @return 是否成功
+ */
+bool generateTree(const TreeShape& shape, const std::filesystem::path& root,
+                  std::uint64_t seed, TreeStats& stats);
+
+} // namespace bench
+} // namespace backuprestore
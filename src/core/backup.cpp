@@ -1,11 +1,54 @@
 #include "core/backup.h"
+#include "core/dir_scanner.h"
 #include "core/file_utils.h"
+#include "core/io_scheduler.h"
+#include "core/progress.h"
+#include "core/stats.h"
 #include "metadata/metadata.h"
 #include "metadata/filesystem.h"
+#include "core/thread_pool.h"
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <map>
+#include <set>
 
 namespace backuprestore {
 
+namespace {
+
+// 批量 I/O 时每批的文件数：一批文件的各阶段各自提交一次
+const std::size_t kBatchFiles = 64;
+
+// st_nlink > 1 的普通文件按 (st_dev, st_ino) 分组，组内按路径排序，第一个之外的成员记入 deferred；
+// 扫描范围内只出现一次的 inode 不成组。Windows 下 st_ino 恒为 0，不分组
+void groupHardLinks(const std::vector<FileRecord>& files,
+                    std::vector<std::vector<std::size_t>>& groups,
+                    std::vector<char>& deferred) {
+    std::map<std::pair<std::uint64_t, std::uint64_t>, std::vector<std::size_t>> by_inode;
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        const FileRecord& record = files[i];
+        if (record.nlink > 1 && record.ino != 0 && !record.isSymlink()) {
+            by_inode[{record.dev, record.ino}].push_back(i);
+        }
+    }
+    for (auto& entry : by_inode) {
+        std::vector<std::size_t>& group = entry.second;
+        if (group.size() < 2) {
+            continue;
+        }
+        std::sort(group.begin(), group.end(), [&](std::size_t a, std::size_t b) {
+            return files[a].relative < files[b].relative;
+        });
+        for (std::size_t k = 1; k < group.size(); ++k) {
+            deferred[group[k]] = 1;
+        }
+        groups.push_back(std::move(group));
+    }
+}
+
+} // namespace
+
 Backup::Backup(std::shared_ptr<Repository> repo) : repo_(repo) {
 }
 
@@ -18,72 +61,440 @@ bool Backup::execute(const std::filesystem::path& source_root,
 
     backup_count_ = 0;
     skipped_count_ = 0;
+    unchanged_count_ = 0;
+    removed_count_ = 0;
+    hardlink_count_ = 0;
 
-    // 获取所有文件
-    std::vector<std::filesystem::path> files;
-    FileUtils::getFilesRecursive(source_root, files);
+    // 增量模式：先加载上次备份的索引作为比较基准
+    if (incremental_ && !repo_->loadIndex()) {
+        std::cerr << "加载上次备份索引失败" << std::endl;
+        return false;
+    }
+
+    // 上次备份被中断时，日志中已完成的条目载入索引，本次与增量模式一样跳过未变化的文件
+    std::size_t resumed = 0;
+    if (!resume_) {
+        repo_->discardJournal();
+    }
+    if (!repo_->beginJournal(resumed)) {
+        return false;
+    }
+    resumed_ = resumed > 0;
+    if (resumed_) {
+        std::cout << "从中断的备份继续: " << resumed << " 个文件已在上次完成" << std::endl;
+    }
+
+    // 扫描所有文件：每个条目只 stat 一次，记录中的元数据直接用于后续步骤；
+    // 过滤器判定不可能包含任何文件的子目录不会被进入
+    std::size_t jobs = jobs_ == 0 ? ThreadPool::defaultThreads() : jobs_;
+    const bool batched = batch_io_ && BatchIo::supported();
+    if (batch_io_ && !batched) {
+        std::cerr << "提示: 当前内核不支持 io_uring，改用线程池逐个文件备份" << std::endl;
+    }
+    std::vector<FileRecord> files;
+    if (!DirScanner::scan(source_root, files, jobs, filter, batched)) {
+        return false;
+    }
 
     std::cout << "找到 " << files.size() << " 个文件" << std::endl;
 
-    // 备份每个文件
-    for (const auto& file_path : files) {
-        // 应用过滤器
-        if (filter && !filter->shouldInclude(file_path)) {
-            skipped_count_++;
-            continue;
+    if (progress_) {
+        std::uint64_t total_bytes = 0;
+        for (const auto& record : files) {
+            total_bytes += record.size;
         }
+        progress_->start(files.size(), total_bytes, "备份");
+    }
 
-        // 检查文件类型是否支持
-        auto file_type = FilesystemUtils::getFileType(file_path);
-        if (!FilesystemUtils::isBackupSupported(file_type)) {
-            skipped_count_++;
-            continue;
-        }
+    // 备份每个文件（jobs>1 时并行：计数原子累加，索引插入由 Repository 加锁）
+    std::vector<Outcome> outcomes;
+    std::vector<std::filesystem::path> relative_paths;
+    storeRecords(files, source_root, filter, jobs, batched, outcomes, relative_paths);
 
-        if (backupFile(file_path, source_root)) {
-            backup_count_++;
-        } else {
-            skipped_count_++;
+    if (progress_ && progress_->cancelled()) {
+        repo_->endJournal();
+        progress_->finish(false);
+        std::cerr << "备份已取消，索引未更新；下次备份将从中断处继续" << std::endl;
+        return false;
+    }
+
+    // 续传时索引中可能有上次完成、但这次已不在源目录中的条目，与增量模式一样清理
+    const bool prune = incremental_ || resumed_;
+    std::set<std::filesystem::path> seen;
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        switch (outcomes[i]) {
+            case Outcome::Stored:    backup_count_++; break;
+            case Outcome::Unchanged: unchanged_count_++; break;
+            case Outcome::Skipped:   skipped_count_++; continue;
         }
+        if (prune) {
+            seen.insert(relative_paths[i]);
+        }
+    }
+
+    // 增量模式：源目录中已不存在（或本次被过滤掉）的条目从仓库中移除
+    if (prune) {
+        removed_count_ = repo_->retainOnly(seen);
     }
 
-    // 保存索引
+    // 保存索引（成功后删除日志）
     if (!repo_->saveIndex()) {
+        repo_->endJournal();
         std::cerr << "保存索引失败" << std::endl;
+        if (progress_) {
+            progress_->finish(false);
+        }
         return false;
     }
+    if (progress_) {
+        progress_->finish(true);
+    }
 
     std::cout << "备份完成: " << backup_count_ << " 个文件已备份, " 
               << skipped_count_ << " 个文件已跳过" << std::endl;
+    if (repo_->isChunking()) {
+        const auto& chunks = repo_->chunkStore();
+        std::cout << "去重: 新增 " << chunks.getNewChunks() << " 个块 ("
+                  << chunks.getNewBytes() << " 字节), 复用 " << chunks.getDedupChunks()
+                  << " 个块 (" << chunks.getDedupBytes() << " 字节)" << std::endl;
+    }
+    const auto& packs = repo_->packStore();
+    if (packs.getNewRecords() > 0) {
+        std::cout << "小文件打包: " << packs.getNewRecords() << " 个文件追加到段文件 ("
+                  << packs.getNewBytes() << " 字节)" << std::endl;
+    }
+    const auto& deltas = repo_->deltaStore();
+    if (deltas.getDeltaFiles() > 0 || deltas.getBaseFiles() > 0) {
+        std::cout << "差量存储: " << deltas.getDeltaFiles() << " 个文件写入差量 (新数据 "
+                  << deltas.getLiteralBytes() << " 字节, 复用 " << deltas.getMatchedBytes()
+                  << " 字节), " << deltas.getBaseFiles() << " 个文件整体存储" << std::endl;
+    }
+    if (hardlink_count_ > 0) {
+        std::cout << "硬链接: " << hardlink_count_ << " 个文件与同一 inode 的其它路径共享数据，只记录链接"
+                  << std::endl;
+    }
+    std::string copies = repo_->copyStatsSummary();
+    if (!copies.empty()) {
+        std::cout << "复制方式: " << copies << std::endl;
+    }
+    if (prune) {
+        std::cout << "增量: " << unchanged_count_ << " 个文件未变化, "
+                  << removed_count_ << " 个文件已从仓库移除" << std::endl;
+    }
 
     return true;
 }
 
-bool Backup::backupFile(const std::filesystem::path& source_path,
-                        const std::filesystem::path& source_root) {
-    try {
-        // 计算相对路径
-        auto relative_path = FileUtils::getRelativePath(source_root, source_path);
-        
-        // 读取元数据
-        Metadata metadata;
-        if (!metadata.loadFromFile(source_path)) {
-            std::cerr << "读取元数据失败: " << source_path << std::endl;
+bool Backup::executeChanges(const std::filesystem::path& source_root,
+                            const std::vector<FileRecord>& changed,
+                            const std::vector<std::string>& scope,
+                            const FilterBase* filter) {
+    // 同一 inode 的其它路径不在变化集合中，无法确定哪个路径保存数据：按完整的增量备份处理
+    auto multiplyLinked = [](const std::vector<FileRecord>& records) {
+        return std::any_of(records.begin(), records.end(), [](const FileRecord& record) {
+            return record.nlink > 1 && !record.isSymlink();
+        });
+    };
+    if (multiplyLinked(changed)) {
+        return execute(source_root, filter);
+    }
+
+    backup_count_ = 0;
+    skipped_count_ = 0;
+    unchanged_count_ = 0;
+    removed_count_ = 0;
+    hardlink_count_ = 0;
+    std::size_t resumed = 0;
+    if (!repo_->beginJournal(resumed)) {
+        return false;
+    }
+    const std::size_t jobs = jobs_ == 0 ? ThreadPool::defaultThreads() : jobs_;
+    const bool batched = batch_io_ && BatchIo::supported();
+
+    // 路径本身或某级父目录在 scope 中（按目录逐级查找，与 scope 的大小无关）
+    const std::set<std::string> scopes(scope.begin(), scope.end());
+    auto inScope = [&](const std::string& key) {
+        for (std::size_t pos = key.size(); pos != std::string::npos && pos > 0; pos = key.rfind('/', pos - 1)) {
+            if (scopes.count(key.substr(0, pos))) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // 存储 records，未被跳过的路径记入 present；取消时返回 false
+    std::set<std::string> present;
+    auto store = [&](const std::vector<FileRecord>& records) {
+        if (progress_) {
+            std::uint64_t total_bytes = 0;
+            for (const auto& record : records) {
+                total_bytes += record.size;
+            }
+            progress_->start(records.size(), total_bytes, "备份");
+        }
+        std::vector<Outcome> outcomes;
+        std::vector<std::filesystem::path> relative_paths;
+        storeRecords(records, source_root, filter, jobs, batched, outcomes, relative_paths);
+        if (progress_) {
+            progress_->finish(!progress_->cancelled());
+            if (progress_->cancelled()) {
+                return false;
+            }
+        }
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            switch (outcomes[i]) {
+                case Outcome::Stored:    backup_count_++; break;
+                case Outcome::Unchanged: unchanged_count_++; break;
+                case Outcome::Skipped:   skipped_count_++; continue;
+            }
+            present.insert(records[i].relative);
+        }
+        return true;
+    };
+    if (!store(changed)) {
+        repo_->endJournal();
+        return false;
+    }
+
+    // scope 之下本次没有存储的条目已被删除、移走或被过滤。指向 scope 中路径的硬链接条目不再与之
+    // 共享 inode（或数据所在的路径已删除），重新 stat 后按独立的文件存储
+    std::vector<FileRecord> orphans;
+    removed_count_ = repo_->removeWhere([&](const std::string& key, const Metadata& metadata) {
+        if (inScope(key) && !present.count(key)) {
+            return true;
+        }
+        if (!metadata.hardlink.empty() && inScope(metadata.hardlink)) {
+            FileRecord record;
+            if (DirScanner::statEntry(source_root, key, record) != DirScanner::EntryKind::File) {
+                return true;
+            }
+            orphans.push_back(std::move(record));
+        }
+        return false;
+    });
+    if (!orphans.empty()) {
+        if (multiplyLinked(orphans)) {
+            repo_->endJournal();
+            return execute(source_root, filter);
+        }
+        const std::size_t skipped = skipped_count_;
+        if (!store(orphans)) {
+            repo_->endJournal();
             return false;
         }
+        if (skipped_count_ > skipped) {
+            // 被过滤掉的硬链接条目指向的数据已不存在
+            std::set<std::string> dropped;
+            for (const auto& record : orphans) {
+                if (!present.count(record.relative)) {
+                    dropped.insert(record.relative);
+                }
+            }
+            removed_count_ += repo_->removeWhere([&](const std::string& key, const Metadata&) {
+                return dropped.count(key) > 0;
+            });
+        }
+    }
 
-        // 存储到仓库
+    return repo_->saveIndex();
+}
+
+void Backup::storeRecords(const std::vector<FileRecord>& files,
+                          const std::filesystem::path& source_root,
+                          const FilterBase* filter,
+                          std::size_t jobs,
+                          bool batched,
+                          std::vector<Outcome>& outcomes,
+                          std::vector<std::filesystem::path>& relative_paths) {
+    // 同一 inode 的多个路径只有组内第一个保存数据，其余路径等数据存好之后记为指向它的硬链接条目
+    std::vector<std::vector<std::size_t>> link_groups;
+    std::vector<char> deferred(files.size(), 0);
+    groupHardLinks(files, link_groups, deferred);
+
+    outcomes.assign(files.size(), Outcome::Skipped);
+    relative_paths.assign(files.size(), std::filesystem::path());
+    auto reportProgress = [&](std::size_t i) {
+        if (outcomes[i] == Outcome::Skipped) {
+            progress_->fileSkipped();
+        } else {
+            progress_->fileDone(files[i].size);
+        }
+        progress_->poll(files[i].relative);
+    };
+    if (batched) {
+        const std::size_t batches = (files.size() + kBatchFiles - 1) / kBatchFiles;
+        ThreadPool::parallelFor(batches, jobs, [&](std::size_t b) {
+            const std::size_t begin = b * kBatchFiles;
+            processBatch(files, begin, std::min(files.size(), begin + kBatchFiles),
+                         source_root, filter, deferred, outcomes, relative_paths);
+        });
+    } else {
+        // 小文件与大文件分两条队列，按源文件与仓库所在设备限制并发。
+        // 存储时边读边算校验和（压缩时还要顺序喂给压缩器），每个文件只能由一个线程顺序读取，不切分
+        IoScheduler scheduler(jobs);
+        const std::uint64_t repo_dev = IoScheduler::deviceOf(repo_->path());
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            if (!deferred[i]) {
+                scheduler.add(i, files[i].size, files[i].dev, repo_dev);
+            }
+        }
+        scheduler.run([&](std::size_t i) {
+            if (progress_ && progress_->cancelled()) {
+                return;
+            }
+            outcomes[i] = processFile(files[i], source_root, filter, relative_paths[i]);
+            if (progress_) {
+                reportProgress(i);
+            }
+        });
+    }
+
+    // 硬链接组的其余路径：数据所在的路径被过滤或存储失败时，由下一个路径保存数据
+    std::atomic<std::size_t> linked{0};
+    ThreadPool::parallelFor(link_groups.size(), jobs, [&](std::size_t g) {
+        const std::vector<std::size_t>& group = link_groups[g];
+        std::size_t data = group[0];
+        for (std::size_t k = 1; k < group.size(); ++k) {
+            if (progress_ && progress_->cancelled()) {
+                return;
+            }
+            const std::size_t i = group[k];
+            if (outcomes[data] == Outcome::Skipped) {
+                outcomes[i] = processFile(files[i], source_root, filter, relative_paths[i]);
+                data = i;
+            } else {
+                outcomes[i] = processFile(files[i], source_root, filter, relative_paths[i], nullptr,
+                                          &files[data].relative);
+                if (outcomes[i] != Outcome::Skipped) {
+                    linked.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            if (progress_) {
+                reportProgress(i);
+            }
+        }
+    });
+    hardlink_count_ = linked.load();
+}
+
+void Backup::processBatch(const std::vector<FileRecord>& files, std::size_t begin, std::size_t end,
+                          const std::filesystem::path& source_root,
+                          const FilterBase* filter,
+                          const std::vector<char>& deferred,
+                          std::vector<Outcome>& outcomes,
+                          std::vector<std::filesystem::path>& relative_paths) {
+    if (progress_ && progress_->cancelled()) {
+        return;
+    }
+    std::vector<BatchStoreEntry> batch;
+    std::vector<std::size_t> owners;  // batch[k] 对应的 files 下标
+    for (std::size_t i = begin; i < end; ++i) {
+        if (deferred[i]) {
+            continue;
+        }
+        outcomes[i] = processFile(files[i], source_root, filter, relative_paths[i], &batch);
+        if (owners.size() < batch.size()) {
+            owners.push_back(i);
+        }
+    }
+    if (!batch.empty()) {
+        // 每个工作线程持有一个队列，线程退出时释放
+        thread_local BatchIo io;
+        LatencyTimer latency(batch.size());
+        repo_->storeBatch(batch, io);
+        for (std::size_t k = 0; k < batch.size(); ++k) {
+            if (!batch[k].ok) {
+                outcomes[owners[k]] = Outcome::Skipped;
+            }
+        }
+    }
+    if (progress_) {
+        for (std::size_t i = begin; i < end; ++i) {
+            if (deferred[i]) {
+                continue;
+            }
+            if (outcomes[i] == Outcome::Skipped) {
+                progress_->fileSkipped();
+            } else {
+                progress_->fileDone(files[i].size);
+            }
+        }
+        progress_->poll(files[end - 1].relative);
+    }
+}
+
+Backup::Outcome Backup::processFile(const FileRecord& record,
+                                    const std::filesystem::path& source_root,
+                                    const FilterBase* filter,
+                                    std::filesystem::path& relative_path,
+                                    std::vector<BatchStoreEntry>* batch,
+                                    const std::string* link_target) {
+    const std::filesystem::path file_path = source_root / record.relative;
+
+    // 元数据来自扫描记录，过滤和备份都不再访问文件系统
+    Metadata metadata;
+    record.toMetadata(metadata);
+
+    // 应用过滤器
+    if (filter) {
+        StatTimer timer(StatPhase::Filter);
+        if (!filter->shouldIncludeEntry(file_path, metadata)) {
+            return Outcome::Skipped;
+        }
+    }
+
+    // 检查文件类型是否支持（类型来自扫描时的 stat）
+    try {
+        auto file_type = FilesystemUtils::getFileType(record.mode);
+        if (!FilesystemUtils::isBackupSupported(file_type)) {
+            return Outcome::Skipped;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "获取文件类型失败: " << file_path << " - " << e.what() << std::endl;
+        return Outcome::Skipped;
+    }
+
+    if (link_target) {
+        metadata.hardlink = *link_target;
+    }
+    return backupFile(record, metadata, file_path, relative_path, batch);
+}
+
+Backup::Outcome Backup::backupFile(const FileRecord& record,
+                                   const Metadata& metadata,
+                                   const std::filesystem::path& source_path,
+                                   std::filesystem::path& relative_path,
+                                   std::vector<BatchStoreEntry>* batch) {
+    try {
+        relative_path = record.relative;
+
+        // 增量模式或续传：与索引中的记录一致则跳过复制，索引条目保持不变
+        if ((incremental_ || resumed_) && repo_->isUnchanged(relative_path, metadata)) {
+            return Outcome::Unchanged;
+        }
+
+        // 硬链接条目不读取源文件，数据已由同一 inode 的另一路径保存
+        if (!metadata.hardlink.empty()) {
+            return repo_->storeHardLink(relative_path, metadata) ? Outcome::Stored : Outcome::Skipped;
+        }
+
+        // 小文件留给调用方批量存储
+        if (batch && repo_->canStoreBatched(metadata)) {
+            batch->push_back(BatchStoreEntry{source_path, relative_path, metadata});
+            return Outcome::Stored;
+        }
+
+        // 存储到仓库（计入单文件耗时直方图）
+        LatencyTimer latency;
         if (!repo_->storeFile(source_path, relative_path, metadata)) {
-            return false;
+            return Outcome::Skipped;
         }
 
-        return true;
+        return Outcome::Stored;
     } catch (const std::exception& e) {
         std::cerr << "备份文件失败: " << source_path << " - " << e.what() << std::endl;
-        return false;
+        return Outcome::Skipped;
     }
 }
 
 } // namespace backuprestore
-
-
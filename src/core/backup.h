@@ -3,11 +3,15 @@
 #include <filesystem>
 #include <string>
 #include <memory>
+#include <vector>
+#include "core/dir_scanner.h"
 #include "core/repository.h"
 #include "filters/filter_base.h"
 
 namespace backuprestore {
 
+class ProgressReporter;
+
 /**
  * @brief 备份操作类
  * 负责将目录树备份到仓库
@@ -29,6 +33,19 @@ public:
     bool execute(const std::filesystem::path& source_root,
                  const FilterBase* filter = nullptr);
 
+    /**
+     * @brief 只备份变化的路径（持续备份模式），不扫描源目录，使用 Repository 中已加载的索引
+     * 等于 scope 中某个路径或位于其下、但不在 changed 中（或被跳过）的条目从仓库中移除；
+     * changed 中有多个硬链接的文件时，同一 inode 的其它路径未知，改为执行一次完整的 execute
+     * @param changed 变化路径重新 stat 得到的记录
+     * @param scope 发生变化的文件和目录（相对 source_root，'/' 分隔）
+     * @return 是否成功（成功时已保存索引）
+     */
+    bool executeChanges(const std::filesystem::path& source_root,
+                        const std::vector<FileRecord>& changed,
+                        const std::vector<std::string>& scope,
+                        const FilterBase* filter = nullptr);
+
     /**
      * @brief 获取备份的文件数量
      */
@@ -39,16 +56,123 @@ public:
      */
     std::size_t getSkippedCount() const { return skipped_count_; }
 
+    /**
+     * @brief 设置并行备份的工作线程数
+     * @param jobs 线程数（0 表示硬件并发数，1 表示串行）
+     */
+    void setJobs(std::size_t jobs) { jobs_ = jobs; }
+
+    /**
+     * @brief 设置增量模式
+     * 增量模式下先加载上次的索引，未变化的文件不再复制，已删除的文件从仓库移除
+     */
+    void setIncremental(bool incremental) { incremental_ = incremental; }
+
+    /**
+     * @brief 获取未变化（增量模式下未复制）的文件数量
+     */
+    std::size_t getUnchangedCount() const { return unchanged_count_; }
+
+    /**
+     * @brief 获取从仓库中移除（源中已删除）的文件数量
+     */
+    std::size_t getRemovedCount() const { return removed_count_; }
+
+    /**
+     * @brief 获取记为硬链接条目（数据由同一 inode 的另一路径保存）的文件数量
+     */
+    std::size_t getHardLinkCount() const { return hardlink_count_; }
+
+    /**
+     * @brief 设置进度汇总器（可选）
+     * 扫描完成后调用其 start，工作线程每处理一个文件累加计数并 poll；取消后不再处理新文件，也不保存索引
+     */
+    void setProgress(ProgressReporter* progress) { progress_ = progress; }
+
+    /**
+     * @brief 设置是否使用 io_uring 批量 I/O（仅 Linux 5.6+）
+     * 扫描时批量 statx；小文件每 64 个一批读入并写入仓库（Repository::storeBatch）。
+     * 内核不支持时提示后退回线程池逐个文件处理；块存储和硬链接模式下只影响扫描
+     */
+    void setBatchIo(bool enabled) { batch_io_ = enabled; }
+
+    /**
+     * @brief 设置是否从上次中断的备份续传（默认开启）
+     * 备份过程中已存入仓库的条目每 256 条追加到仓库的 journal.bin；进程被终止或取消后，
+     * 下次备份先载入日志中的条目，未变化的文件不再复制。关闭时丢弃日志重新开始
+     */
+    void setResume(bool resume) { resume_ = resume; }
+
 private:
+    /**
+     * @brief 单个文件的处理结果
+     */
+    enum class Outcome {
+        Stored,     // 已复制到仓库
+        Unchanged,  // 增量模式下未变化
+        Skipped     // 被过滤、不支持或失败
+    };
+
     std::shared_ptr<Repository> repo_;
     std::size_t backup_count_ = 0;
     std::size_t skipped_count_ = 0;
+    std::size_t unchanged_count_ = 0;
+    std::size_t removed_count_ = 0;
+    std::size_t hardlink_count_ = 0;
+    std::size_t jobs_ = 1;
+    bool incremental_ = false;
+    bool batch_io_ = false;
+    bool resume_ = true;
+    bool resumed_ = false;  // 本次是否载入了上次中断留下的日志
+    ProgressReporter* progress_ = nullptr;
+
+    /**
+     * @brief 备份 files 中的所有记录：硬链接组的其余路径在组内第一个路径存储之后只记录链接
+     * @param outcomes 输出各记录的处理结果
+     * @param relative_paths 输出各记录的相对路径
+     */
+    void storeRecords(const std::vector<FileRecord>& files,
+                      const std::filesystem::path& source_root,
+                      const FilterBase* filter,
+                      std::size_t jobs,
+                      bool batched,
+                      std::vector<Outcome>& outcomes,
+                      std::vector<std::filesystem::path>& relative_paths);
+
+    /**
+     * @brief 处理单个扫描记录（过滤、类型检查、备份）
+     * @param relative_path 输出相对路径（结果不为 Skipped 时有效）
+     * @param batch 非空时可批量存储的文件只加入 batch，结果暂记为 Stored，由调用方批量存储后修正
+     * @param link_target 非空时该文件与这个已存储的路径是同一 inode，只记录硬链接条目
+     */
+    Outcome processFile(const FileRecord& record,
+                        const std::filesystem::path& source_root,
+                        const FilterBase* filter,
+                        std::filesystem::path& relative_path,
+                        std::vector<BatchStoreEntry>* batch = nullptr,
+                        const std::string* link_target = nullptr);
 
     /**
      * @brief 备份单个文件
+     * @param metadata 由扫描记录得到的元数据
+     * @param source_path 源文件完整路径（source_root / record.relative）
+     */
+    Outcome backupFile(const FileRecord& record,
+                       const Metadata& metadata,
+                       const std::filesystem::path& source_path,
+                       std::filesystem::path& relative_path,
+                       std::vector<BatchStoreEntry>* batch);
+
+    /**
+     * @brief 处理 files[begin, end)：逐个过滤和检查后，可批量存储的文件经本线程的 io_uring 队列一次存储
+     * deferred 中标记的硬链接组成员留到数据所在的路径存储之后处理
      */
-    bool backupFile(const std::filesystem::path& source_path,
-                    const std::filesystem::path& source_root);
+    void processBatch(const std::vector<FileRecord>& files, std::size_t begin, std::size_t end,
+                      const std::filesystem::path& source_root,
+                      const FilterBase* filter,
+                      const std::vector<char>& deferred,
+                      std::vector<Outcome>& outcomes,
+                      std::vector<std::filesystem::path>& relative_paths);
 };
 
 } // namespace backuprestore
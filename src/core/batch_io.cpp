@@ -0,0 +1,485 @@
+#include "core/batch_io.h"
+#include "core/file_utils.h"
+#include "core/stats.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+// 需要 5.6 的头文件：OPENAT/READ/WRITE/CLOSE/STATX 操作与 IORING_REGISTER_PROBE
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(STATX_BASIC_STATS)
+#define BR_HAVE_IO_URING 1
+#endif
+#endif
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
+#ifdef BR_HAVE_IO_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#endif
+
+namespace backuprestore {
+
+#ifdef BR_HAVE_IO_URING
+
+namespace {
+
+int ringSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ringEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int ringRegister(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+void statxToStat(const struct statx& stx, struct stat& st) {
+    std::memset(&st, 0, sizeof(st));
+    st.st_mode = stx.stx_mode;
+    st.st_size = static_cast<off_t>(stx.stx_size);
+    st.st_blocks = static_cast<blkcnt_t>(stx.stx_blocks);
+    st.st_blksize = static_cast<blksize_t>(stx.stx_blksize);
+    st.st_dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+    st.st_rdev = makedev(stx.stx_rdev_major, stx.stx_rdev_minor);
+    st.st_ino = static_cast<ino_t>(stx.stx_ino);
+    st.st_nlink = static_cast<nlink_t>(stx.stx_nlink);
+    st.st_uid = stx.stx_uid;
+    st.st_gid = stx.stx_gid;
+    st.st_atim.tv_sec = stx.stx_atime.tv_sec;
+    st.st_atim.tv_nsec = stx.stx_atime.tv_nsec;
+    st.st_mtim.tv_sec = stx.stx_mtime.tv_sec;
+    st.st_mtim.tv_nsec = stx.stx_mtime.tv_nsec;
+    st.st_ctim.tv_sec = stx.stx_ctime.tv_sec;
+    st.st_ctim.tv_nsec = stx.stx_ctime.tv_nsec;
+}
+
+} // namespace
+
+/**
+ * @brief 直接用系统调用操作的 io_uring 队列（不依赖 liburing）
+ */
+struct BatchIo::Ring {
+    int fd = -1;
+    void* sq_ptr = MAP_FAILED;
+    std::size_t sq_len = 0;
+    void* cq_ptr = MAP_FAILED;
+    std::size_t cq_len = 0;
+    io_uring_sqe* sqes = nullptr;
+    std::size_t sqes_len = 0;
+
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned sq_mask = 0;
+    unsigned sq_entries = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    std::vector<int> results;
+
+    bool setup(unsigned depth) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd = ringSetup(depth, &params);
+        if (fd < 0) {
+            return false;
+        }
+        sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_len = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            sq_len = cq_len = std::max(sq_len, cq_len);
+        }
+        sq_ptr = ::mmap(nullptr, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED) {
+            return false;
+        }
+        if (single) {
+            cq_ptr = sq_ptr;
+        } else {
+            cq_ptr = ::mmap(nullptr, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cq_ptr == MAP_FAILED) {
+                return false;
+            }
+        }
+        sqes_len = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqe_ptr = ::mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqe_ptr == MAP_FAILED) {
+            return false;
+        }
+        sqes = static_cast<io_uring_sqe*>(sqe_ptr);
+
+        char* sq = static_cast<char*>(sq_ptr);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        sq_entries = params.sq_entries;
+        char* cq = static_cast<char*>(cq_ptr);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    ~Ring() {
+        if (sqes) ::munmap(sqes, sqes_len);
+        if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) ::munmap(cq_ptr, cq_len);
+        if (sq_ptr != MAP_FAILED) ::munmap(sq_ptr, sq_len);
+        if (fd >= 0) ::close(fd);
+    }
+
+    /**
+     * @brief 对 [0, count) 中 prep 返回 true 的下标各提交一个请求，按队列深度分批提交并等待全部完成
+     * prep(i, sqe) 填写已清零的 sqe；完成结果（cqe.res）写入 results[i]，未提交的下标为 -ECANCELED
+     */
+    template <typename Prep>
+    void run(std::size_t count, Prep prep) {
+        results.assign(count, -ECANCELED);
+        std::size_t i = 0;
+        while (i < count) {
+            unsigned queued = 0;
+            unsigned tail = *sq_tail;  // 只有本线程写 tail
+            for (; i < count && queued < sq_entries; ++i) {
+                unsigned index = tail & sq_mask;
+                io_uring_sqe* sqe = &sqes[index];
+                std::memset(sqe, 0, sizeof(*sqe));
+                if (!prep(i, sqe)) {
+                    continue;
+                }
+                sqe->user_data = i;
+                sq_array[index] = index;
+                ++tail;
+                ++queued;
+            }
+            if (queued == 0) {
+                break;
+            }
+            __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+            submitAndWait(queued);
+        }
+    }
+
+    void submitAndWait(unsigned queued) {
+        unsigned to_submit = queued;
+        unsigned remaining = queued;
+        while (remaining > 0) {
+            int rc = ringEnter(fd, to_submit, remaining, IORING_ENTER_GETEVENTS);
+            if (rc < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                    continue;
+                }
+                // 队列本身出错：已入队的请求仍会完成，只能继续等待；不应发生
+                to_submit = 0;
+            } else {
+                to_submit -= std::min<unsigned>(to_submit, static_cast<unsigned>(rc));
+            }
+            unsigned head = *cq_head;
+            unsigned ctail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+            while (head != ctail) {
+                const io_uring_cqe& cqe = cqes[head & cq_mask];
+                results[static_cast<std::size_t>(cqe.user_data)] = cqe.res;
+                ++head;
+                --remaining;
+            }
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+        }
+    }
+};
+
+BatchIo::BatchIo(unsigned depth) : ring_(std::make_unique<Ring>()) {
+    if (!supported() || !ring_->setup(depth)) {
+        ring_.reset();
+    }
+}
+
+BatchIo::~BatchIo() = default;
+
+bool BatchIo::supported() {
+    static const bool result = [] {
+        Ring ring;
+        if (!ring.setup(4)) {
+            return false;
+        }
+        const unsigned kOps = 256;
+        std::vector<unsigned char> buffer(sizeof(io_uring_probe) + kOps * sizeof(io_uring_probe_op), 0);
+        auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+        if (ringRegister(ring.fd, IORING_REGISTER_PROBE, probe, kOps) < 0) {
+            return false;
+        }
+        for (unsigned op : {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE,
+                            IORING_OP_STATX, IORING_OP_FSYNC}) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                return false;
+            }
+        }
+        return true;
+    }();
+    return result;
+}
+
+bool BatchIo::valid() const {
+    return ring_ != nullptr;
+}
+
+void BatchIo::statAt(int dirfd, const std::vector<const char*>& names,
+                     std::vector<struct stat>& stats, std::vector<int>& errors) {
+    StatTimer timer(StatPhase::Stat);
+    stats.resize(names.size());
+    errors.assign(names.size(), 0);
+    if (!ring_) {
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            if (::fstatat(dirfd, names[i], &stats[i], AT_SYMLINK_NOFOLLOW) != 0) {
+                errors[i] = errno;
+            }
+        }
+        return;
+    }
+    std::vector<struct statx> buffers(names.size());
+    ring_->run(names.size(), [&](std::size_t i, io_uring_sqe* sqe) {
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = dirfd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(names[i]);
+        sqe->len = STATX_BASIC_STATS;
+        sqe->off = reinterpret_cast<std::uint64_t>(&buffers[i]);
+        sqe->statx_flags = AT_SYMLINK_NOFOLLOW;
+        return true;
+    });
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        int res = ring_->results[i];
+        errors[i] = res < 0 ? -res : 0;
+        if (res >= 0) {
+            statxToStat(buffers[i], stats[i]);
+        }
+    }
+}
+
+void BatchIo::readFiles(std::vector<ReadRequest>& requests) {
+    StatTimer timer(StatPhase::Read);
+    const std::size_t n = requests.size();
+    if (!ring_) {
+        for (auto& request : requests) request.error = ENOSYS;
+        return;
+    }
+
+    // 1. openat
+    ring_->run(n, [&](std::size_t i, io_uring_sqe* sqe) {
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<std::uint64_t>(requests[i].path.c_str());
+        sqe->open_flags = O_RDONLY | O_CLOEXEC | O_NOFOLLOW;
+        return true;
+    });
+    std::vector<int> fds(n, -1);
+    for (std::size_t i = 0; i < n; ++i) {
+        int res = ring_->results[i];
+        requests[i].error = res < 0 ? -res : 0;
+        fds[i] = res;
+    }
+
+    // 2. read：多读 1 字节以发现扫描后变大的文件
+    ring_->run(n, [&](std::size_t i, io_uring_sqe* sqe) {
+        if (fds[i] < 0) {
+            return false;
+        }
+        ReadRequest& request = requests[i];
+        request.data.resize(static_cast<std::size_t>(request.exact ? request.size + 1 : request.size));
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fds[i];
+        sqe->addr = reinterpret_cast<std::uint64_t>(request.data.data());
+        sqe->len = static_cast<unsigned>(request.data.size());
+        sqe->off = 0;
+        return true;
+    });
+    std::uint64_t bytes = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (fds[i] < 0) {
+            continue;
+        }
+        ReadRequest& request = requests[i];
+        int res = ring_->results[i];
+        if (res < 0) {
+            request.error = -res;
+            res = 0;
+        } else if (request.exact ? static_cast<std::uint64_t>(res) != request.size
+                                 : static_cast<std::uint64_t>(res) >= request.size) {
+            request.error = request.exact ? ESTALE : EFBIG;
+        }
+        request.data.resize(static_cast<std::size_t>(res));
+        bytes += static_cast<std::uint64_t>(res);
+    }
+    timer.addBytes(bytes);
+
+    // 3. close
+    ring_->run(n, [&](std::size_t i, io_uring_sqe* sqe) {
+        if (fds[i] < 0) {
+            return false;
+        }
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = fds[i];
+        return true;
+    });
+}
+
+void BatchIo::writeFiles(std::vector<WriteRequest>& requests) {
+    StatTimer timer(StatPhase::Write);
+    const std::size_t n = requests.size();
+    if (!ring_) {
+        for (auto& request : requests) request.error = ENOSYS;
+        return;
+    }
+
+    // 1. openat（与 FileUtils::openForWrite 相同的标志）
+    ring_->run(n, [&](std::size_t i, io_uring_sqe* sqe) {
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<std::uint64_t>(requests[i].path.c_str());
+        sqe->len = requests[i].mode;
+        sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW;
+        return true;
+    });
+    for (std::size_t i = 0; i < n; ++i) {
+        int res = ring_->results[i];
+        requests[i].fd = res < 0 ? -1 : res;
+        requests[i].error = res < 0 ? -res : 0;
+    }
+
+    // 2. write
+    ring_->run(n, [&](std::size_t i, io_uring_sqe* sqe) {
+        const WriteRequest& request = requests[i];
+        if (request.fd < 0 || request.size == 0) {
+            return false;
+        }
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = request.fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(request.data);
+        sqe->len = static_cast<unsigned>(request.size);
+        sqe->off = 0;
+        return true;
+    });
+    std::uint64_t bytes = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        WriteRequest& request = requests[i];
+        if (request.fd < 0 || request.size == 0) {
+            continue;
+        }
+        int res = ring_->results[i];
+        if (res < 0) {
+            request.error = -res;
+            continue;
+        }
+        std::size_t written = static_cast<std::size_t>(res);
+        if (written < request.size &&
+            !FileUtils::pwriteAll(request.fd, request.data + written, request.size - written, written, request.path)) {
+            request.error = EIO;
+            continue;
+        }
+        bytes += request.size;
+    }
+    timer.addBytes(bytes);
+}
+
+void BatchIo::syncFiles(std::vector<WriteRequest>& requests) {
+    if (!ring_) {
+        return;
+    }
+    ring_->run(requests.size(), [&](std::size_t i, io_uring_sqe* sqe) {
+        if (requests[i].fd < 0 || requests[i].error != 0) {
+            return false;
+        }
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = requests[i].fd;
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        return true;
+    });
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+        int res = ring_->results[i];
+        if (res < 0 && res != -ECANCELED && requests[i].error == 0) {
+            requests[i].error = -res;
+        }
+    }
+}
+
+void BatchIo::closeFiles(std::vector<WriteRequest>& requests) {
+    if (!ring_) {
+        return;
+    }
+    ring_->run(requests.size(), [&](std::size_t i, io_uring_sqe* sqe) {
+        if (requests[i].fd < 0) {
+            return false;
+        }
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = requests[i].fd;
+        return true;
+    });
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+        if (requests[i].fd < 0) {
+            continue;
+        }
+        int res = ring_->results[i];
+        if (res < 0 && requests[i].error == 0) {
+            requests[i].error = -res;
+        }
+        requests[i].fd = -1;
+    }
+}
+
+#else // !BR_HAVE_IO_URING
+
+struct BatchIo::Ring {};
+
+BatchIo::BatchIo(unsigned) {
+}
+
+BatchIo::~BatchIo() = default;
+
+bool BatchIo::supported() {
+    return false;
+}
+
+bool BatchIo::valid() const {
+    return false;
+}
+
+void BatchIo::statAt(int dirfd, const std::vector<const char*>& names,
+                     std::vector<struct stat>& stats, std::vector<int>& errors) {
+    stats.resize(names.size());
+    errors.assign(names.size(), ENOSYS);
+#ifndef _WIN32
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        errors[i] = ::fstatat(dirfd, names[i], &stats[i], AT_SYMLINK_NOFOLLOW) == 0 ? 0 : errno;
+    }
+#else
+    (void)dirfd;
+#endif
+}
+
+void BatchIo::readFiles(std::vector<ReadRequest>& requests) {
+    for (auto& request : requests) request.error = ENOSYS;
+}
+
+void BatchIo::writeFiles(std::vector<WriteRequest>& requests) {
+    for (auto& request : requests) request.error = ENOSYS;
+}
+
+void BatchIo::syncFiles(std::vector<WriteRequest>&) {
+}
+
+void BatchIo::closeFiles(std::vector<WriteRequest>&) {
+}
+
+#endif // BR_HAVE_IO_URING
+
+} // namespace backuprestore
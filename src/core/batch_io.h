@@ -0,0 +1,105 @@
+#pragma once
+
+#include <sys/stat.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace backuprestore {
+
+/**
+ * @brief 基于 io_uring 的小文件批量 I/O（仅 Linux）
+ *
+ * 一批文件的 openat / read / write / statx / close 各自一次提交、一次等待，
+ * 用几次 io_uring_enter 代替每个文件的多次阻塞系统调用。
+ * 内核不支持（< 5.6、被 seccomp 或 io_uring_disabled 禁用）时 supported() 为 false，
+ * 调用方应退回逐个文件的同步路径。每个实例只能由一个线程使用（各工作线程各持一个队列）
+ */
+class BatchIo {
+public:
+    /**
+     * @brief 走批量路径的最大文件大小：整个文件一次读入内存
+     */
+    static constexpr std::uint64_t kMaxFileSize = 64 * 1024;
+
+    /**
+     * @brief 默认队列深度（一次提交的最大请求数）
+     */
+    static constexpr unsigned kDefaultDepth = 128;
+
+    /**
+     * @brief 一个读请求：读入整个文件
+     */
+    struct ReadRequest {
+        std::string path;
+        std::uint64_t size = 0;          // exact 时为期望大小，否则为上限（文件须小于它）
+        bool exact = true;               // 读到的字节数与 size 不同时视为失败（文件在扫描后被修改）
+        std::vector<std::uint8_t> data;  // 输出
+        int error = 0;                   // 0 表示成功，否则为 errno
+    };
+
+    /**
+     * @brief 一个写请求：创建（截断）文件并写入全部数据，成功后 fd 保持打开
+     * 目标处已有的符号链接不会被写穿（O_NOFOLLOW，报 ELOOP）
+     */
+    struct WriteRequest {
+        std::string path;
+        const std::uint8_t* data = nullptr;
+        std::size_t size = 0;
+        std::uint32_t mode = 0600;       // 新建文件时的权限（受 umask 影响）
+        int fd = -1;                     // 输出：由调用方应用元数据后交给 closeFiles
+        int error = 0;
+    };
+
+    explicit BatchIo(unsigned depth = kDefaultDepth);
+    ~BatchIo();
+
+    BatchIo(const BatchIo&) = delete;
+    BatchIo& operator=(const BatchIo&) = delete;
+
+    /**
+     * @brief 当前内核是否支持所需的 io_uring 操作（结果缓存，只探测一次）
+     */
+    static bool supported();
+
+    /**
+     * @brief 队列是否创建成功
+     */
+    bool valid() const;
+
+    /**
+     * @brief 批量 statx（不跟随符号链接），结果转换为 struct stat；队列不可用时逐个 fstatat
+     * @param dirfd 名称所在目录
+     * @param errors 输出每个名称的 errno（0 表示成功）
+     */
+    void statAt(int dirfd, const std::vector<const char*>& names,
+                std::vector<struct stat>& stats, std::vector<int>& errors);
+
+    /**
+     * @brief 批量读入整个文件：openat → read → close
+     */
+    void readFiles(std::vector<ReadRequest>& requests);
+
+    /**
+     * @brief 批量创建并写入文件：openat → write（短写用 pwrite 补齐）
+     */
+    void writeFiles(std::vector<WriteRequest>& requests);
+
+    /**
+     * @brief 对写入成功的文件批量 fdatasync
+     */
+    void syncFiles(std::vector<WriteRequest>& requests);
+
+    /**
+     * @brief 批量关闭写请求中仍打开的 fd；close 报告的延迟写入错误记入 error
+     */
+    void closeFiles(std::vector<WriteRequest>& requests);
+
+private:
+    struct Ring;
+    std::unique_ptr<Ring> ring_;
+};
+
+} // namespace backuprestore
@@ -0,0 +1,397 @@
+#include "core/binary_index.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace backuprestore {
+
+namespace {
+
+const char kMagic[8] = {'B', 'R', 'I', 'N', 'D', 'E', 'X', '\0'};
+const std::size_t kHeaderSize = 64;
+const std::size_t kRecordSize = 56;
+
+// 记录内各字段的偏移
+const std::size_t kRecSize = 0;
+const std::size_t kRecMtime = 8;
+const std::size_t kRecPathOffset = 16;
+const std::size_t kRecExtraOffset = 24;
+const std::size_t kRecExtraLen = 32;
+const std::size_t kRecMtimeNsec = 36;
+const std::size_t kRecMode = 40;
+const std::size_t kRecUid = 44;
+const std::size_t kRecGid = 48;
+const std::size_t kRecFlags = 52;
+
+const std::uint32_t kFlagSymlink = 1u << 0;
+const std::uint32_t kFlagChunked = 1u << 1;
+
+void putU32(std::uint8_t* p, std::uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<std::uint8_t>(v >> (8 * i));
+}
+
+void putU64(std::uint8_t* p, std::uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = static_cast<std::uint8_t>(v >> (8 * i));
+}
+
+std::uint32_t getU32(const std::uint8_t* p) {
+    std::uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= static_cast<std::uint32_t>(p[i]) << (8 * i);
+    return v;
+}
+
+std::uint64_t getU64(const std::uint8_t* p) {
+    std::uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v |= static_cast<std::uint64_t>(p[i]) << (8 * i);
+    return v;
+}
+
+void putVarint(std::vector<std::uint8_t>& out, std::uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(v));
+}
+
+std::uint64_t getVarint(const std::uint8_t* base, std::uint64_t end, std::uint64_t& pos) {
+    std::uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= end) throw std::runtime_error("index varint out of range");
+        std::uint8_t b = base[pos++];
+        v |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) return v;
+    }
+    throw std::runtime_error("index varint too long");
+}
+
+std::size_t sharedPrefix(const std::string& a, const std::string& b) {
+    std::size_t n = std::min(a.size(), b.size());
+    std::size_t i = 0;
+    while (i < n && a[i] == b[i]) ++i;
+    return i;
+}
+
+} // namespace
+
+BinaryIndex::~BinaryIndex() {
+    close();
+}
+
+bool BinaryIndex::write(const std::filesystem::path& file,
+                        std::vector<std::pair<std::string, const Metadata*>> entries) {
+    std::sort(entries.begin(), entries.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    return write(file, entries.size(), [&](std::size_t i, std::string& path, Metadata& m) {
+        path = entries[i].first;
+        m = *entries[i].second;
+    });
+}
+
+bool BinaryIndex::write(const std::filesystem::path& file, std::size_t count,
+                        const std::function<void(std::size_t, std::string&, Metadata&)>& entry) {
+    std::vector<std::uint8_t> records(count * kRecordSize);
+    std::vector<std::uint8_t> paths;
+    std::vector<std::uint8_t> extras;
+
+    std::string prev;
+    std::string path;
+    Metadata m;
+    for (std::size_t i = 0; i < count; ++i) {
+        entry(i, path, m);
+        std::uint8_t* rec = records.data() + i * kRecordSize;
+
+        // 路径：每 kRestartInterval 个条目写一次完整路径
+        std::size_t shared = (i % kRestartInterval == 0) ? 0 : sharedPrefix(prev, path);
+        putU64(rec + kRecPathOffset, paths.size());
+        putVarint(paths, shared);
+        putVarint(paths, path.size() - shared);
+        paths.insert(paths.end(), path.begin() + static_cast<std::ptrdiff_t>(shared), path.end());
+        prev.swap(path);
+
+        // 扩展：符号链接目标 + 其它扩展字段文本
+        std::string extra = m.serializeExtra();
+        std::uint64_t extra_offset = extras.size();
+        if (!m.symlink_target.empty() || !extra.empty()) {
+            putVarint(extras, m.symlink_target.size());
+            extras.insert(extras.end(), m.symlink_target.begin(), m.symlink_target.end());
+            extras.insert(extras.end(), extra.begin(), extra.end());
+        }
+
+        std::uint32_t flags = 0;
+        if (m.is_symlink) flags |= kFlagSymlink;
+        if (m.chunked) flags |= kFlagChunked;
+
+        putU64(rec + kRecSize, m.size);
+        putU64(rec + kRecMtime, static_cast<std::uint64_t>(static_cast<std::int64_t>(m.mtime)));
+        putU64(rec + kRecExtraOffset, extra_offset);
+        putU32(rec + kRecExtraLen, static_cast<std::uint32_t>(extras.size() - extra_offset));
+        putU32(rec + kRecMtimeNsec, m.mtime_nsec);
+        putU32(rec + kRecMode, m.mode);
+        putU32(rec + kRecUid, m.uid);
+        putU32(rec + kRecGid, m.gid);
+        putU32(rec + kRecFlags, flags);
+    }
+
+    std::uint8_t header[kHeaderSize] = {};
+    std::uint64_t records_offset = kHeaderSize;
+    std::uint64_t paths_offset = records_offset + records.size();
+    std::uint64_t extras_offset = paths_offset + paths.size();
+    std::memcpy(header, kMagic, sizeof(kMagic));
+    putU32(header + 8, kVersion);
+    putU32(header + 12, kRestartInterval);
+    putU64(header + 16, count);
+    putU64(header + 24, records_offset);
+    putU64(header + 32, paths_offset);
+    putU64(header + 40, paths.size());
+    putU64(header + 48, extras_offset);
+    putU64(header + 56, extras.size());
+
+    // 先写临时文件再 rename，避免中途失败留下半个索引
+    auto tmp = file;
+    tmp += ".tmp";
+    {
+        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+        if (!ofs) {
+            std::cerr << "无法打开索引文件: " << tmp << std::endl;
+            return false;
+        }
+        ofs.write(reinterpret_cast<const char*>(header), kHeaderSize);
+        ofs.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size()));
+        ofs.write(reinterpret_cast<const char*>(paths.data()), static_cast<std::streamsize>(paths.size()));
+        ofs.write(reinterpret_cast<const char*>(extras.data()), static_cast<std::streamsize>(extras.size()));
+        if (!ofs) {
+            std::cerr << "写入索引文件失败: " << tmp << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, file, ec);
+    if (ec) {
+        std::cerr << "替换索引文件失败: " << file << " - " << ec.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool BinaryIndex::open(const std::filesystem::path& file) {
+    close();
+
+#ifdef _WIN32
+    std::ifstream ifs(file, std::ios::binary);
+    if (!ifs) {
+        std::cerr << "无法打开索引文件: " << file << std::endl;
+        return false;
+    }
+    fallback_.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    data_ = fallback_.data();
+    file_size_ = fallback_.size();
+#else
+    int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "无法打开索引文件: " << file << std::endl;
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(kHeaderSize)) {
+        ::close(fd);
+        std::cerr << "索引文件过小或无法读取: " << file << std::endl;
+        return false;
+    }
+    file_size_ = static_cast<std::size_t>(st.st_size);
+    void* map = mmap(nullptr, file_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        std::cerr << "映射索引文件失败: " << file << std::endl;
+        file_size_ = 0;
+        return false;
+    }
+    map_ = map;
+    data_ = static_cast<const std::uint8_t*>(map);
+#endif
+
+    if (file_size_ < kHeaderSize || std::memcmp(data_, kMagic, sizeof(kMagic)) != 0 ||
+        getU32(data_ + 8) != kVersion) {
+        std::cerr << "索引文件格式或版本不匹配: " << file << std::endl;
+        close();
+        return false;
+    }
+
+    restart_interval_ = getU32(data_ + 12);
+    entry_count_ = getU64(data_ + 16);
+    records_offset_ = getU64(data_ + 24);
+    paths_offset_ = getU64(data_ + 32);
+    paths_size_ = getU64(data_ + 40);
+    extras_offset_ = getU64(data_ + 48);
+    extras_size_ = getU64(data_ + 56);
+
+    bool ok = restart_interval_ > 0 &&
+              entry_count_ <= (file_size_ - kHeaderSize) / kRecordSize &&
+              records_offset_ + entry_count_ * kRecordSize <= file_size_ &&
+              paths_offset_ <= file_size_ && paths_size_ <= file_size_ - paths_offset_ &&
+              extras_offset_ <= file_size_ && extras_size_ <= file_size_ - extras_offset_;
+    if (!ok) {
+        std::cerr << "索引文件已损坏: " << file << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void BinaryIndex::close() {
+#ifndef _WIN32
+    if (map_) {
+        munmap(map_, file_size_);
+    }
+#endif
+    map_ = nullptr;
+    fallback_.clear();
+    data_ = nullptr;
+    file_size_ = 0;
+    entry_count_ = 0;
+}
+
+std::uint64_t BinaryIndex::pathOffset(std::size_t i) const {
+    return getU64(data_ + records_offset_ + i * kRecordSize + kRecPathOffset);
+}
+
+void BinaryIndex::decodePath(std::size_t i, std::string& path) const {
+    const std::uint8_t* base = data_ + paths_offset_;
+    std::uint64_t pos = pathOffset(i);
+    std::uint64_t shared = getVarint(base, paths_size_, pos);
+    std::uint64_t len = getVarint(base, paths_size_, pos);
+    if (shared > path.size() || len > paths_size_ - pos) {
+        throw std::runtime_error("index path entry corrupted");
+    }
+    path.resize(static_cast<std::size_t>(shared));
+    path.append(reinterpret_cast<const char*>(base + pos), static_cast<std::size_t>(len));
+}
+
+std::string BinaryIndex::pathAt(std::size_t i) const {
+    std::string path;
+    std::size_t restart = i - i % restart_interval_;
+    for (std::size_t k = restart; k <= i; ++k) {
+        decodePath(k, path);
+    }
+    return path;
+}
+
+bool BinaryIndex::metadataAt(std::size_t i, Metadata& m) const {
+    if (i >= size()) return false;
+    const std::uint8_t* rec = data_ + records_offset_ + i * kRecordSize;
+
+    m.size = getU64(rec + kRecSize);
+    m.mtime = static_cast<std::time_t>(static_cast<std::int64_t>(getU64(rec + kRecMtime)));
+    m.mtime_nsec = getU32(rec + kRecMtimeNsec);
+    m.mode = getU32(rec + kRecMode);
+    m.uid = getU32(rec + kRecUid);
+    m.gid = getU32(rec + kRecGid);
+    std::uint32_t flags = getU32(rec + kRecFlags);
+    m.is_symlink = (flags & kFlagSymlink) != 0;
+
+    std::uint64_t extra_offset = getU64(rec + kRecExtraOffset);
+    std::uint64_t extra_len = getU32(rec + kRecExtraLen);
+    m.symlink_target.clear();
+    if (extra_offset > extras_size_ || extra_len > extras_size_ - extra_offset) {
+        std::cerr << "索引扩展字段越界: 条目 " << i << std::endl;
+        return false;
+    }
+
+    std::string extra;
+    if (extra_len > 0) {
+        const std::uint8_t* base = data_ + extras_offset_;
+        std::uint64_t end = extra_offset + extra_len;
+        std::uint64_t pos = extra_offset;
+        std::uint64_t target_len = getVarint(base, end, pos);
+        if (target_len > end - pos) {
+            std::cerr << "索引扩展字段已损坏: 条目 " << i << std::endl;
+            return false;
+        }
+        m.symlink_target.assign(reinterpret_cast<const char*>(base + pos), static_cast<std::size_t>(target_len));
+        pos += target_len;
+        extra.assign(reinterpret_cast<const char*>(base + pos), static_cast<std::size_t>(end - pos));
+    }
+    if (!m.deserializeExtra(extra)) {
+        return false;
+    }
+    // 块存储的空文件没有块，需要依赖标志位区分
+    m.chunked = (flags & kFlagChunked) != 0;
+    return true;
+}
+
+int BinaryIndex::compareRestart(std::size_t i, const std::string& key) const {
+    const std::uint8_t* base = data_ + paths_offset_;
+    std::uint64_t pos = pathOffset(i);
+    getVarint(base, paths_size_, pos);  // 重启点的共享长度恒为 0
+    std::uint64_t len = getVarint(base, paths_size_, pos);
+    if (len > paths_size_ - pos) {
+        throw std::runtime_error("index path entry corrupted");
+    }
+    std::size_t n = std::min<std::size_t>(static_cast<std::size_t>(len), key.size());
+    int c = std::memcmp(base + pos, key.data(), n);
+    if (c != 0) return c;
+    if (len < key.size()) return -1;
+    return len > key.size() ? 1 : 0;
+}
+
+std::size_t BinaryIndex::lowerBound(const std::string& key) const {
+    if (size() == 0) return 0;
+
+    // 二分查找最后一个 <= key 的重启点
+    std::size_t groups = (size() + restart_interval_ - 1) / restart_interval_;
+    std::size_t lo = 0;
+    std::size_t hi = groups;
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        if (compareRestart(mid * restart_interval_, key) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) return 0;  // key 小于第一个条目
+
+    // 在该组内顺序扫描
+    std::size_t start = (lo - 1) * restart_interval_;
+    std::size_t end = std::min(size(), start + restart_interval_);
+    std::string path;
+    for (std::size_t i = start; i < end; ++i) {
+        decodePath(i, path);
+        if (!(path < key)) return i;
+    }
+    return end;
+}
+
+bool BinaryIndex::find(const std::string& key, Metadata& metadata) const {
+    std::size_t i = lowerBound(key);
+    if (i >= size() || pathAt(i) != key) {
+        return false;
+    }
+    return metadataAt(i, metadata);
+}
+
+BinaryIndex::Cursor::Cursor(const BinaryIndex& index, std::size_t start)
+    : index_(index), pos_(start) {
+    if (valid()) {
+        path_ = index_.pathAt(pos_);
+    }
+}
+
+void BinaryIndex::Cursor::next() {
+    ++pos_;
+    if (valid()) {
+        index_.decodePath(pos_, path_);
+    }
+}
+
+} // namespace backuprestore
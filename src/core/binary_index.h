@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "metadata/metadata.h"
+
+namespace backuprestore {
+
+/**
+ * @brief 二进制索引文件（index.bin），可 mmap 后原地查询，无需整体解析
+ *
+ * 文件布局（所有整数均为小端）：
+ * - 头部（64 字节）：magic "BRINDEX\0"、版本、重启间隔、条目数、各段偏移/长度
+ * - 记录段：每个条目一条定长记录（size/mtime/mode/uid/gid/flags/路径偏移/扩展偏移）
+ * - 路径段：按字节序排序，前缀压缩 [varint 共享长度][varint 后缀长度][后缀]，
+ *   每 restart_interval 个条目重置一次（共享长度为 0），用于二分查找
+ * - 扩展段：[varint 长度][符号链接目标][Metadata::serializeExtra() 文本]
+ */
+class BinaryIndex {
+public:
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::uint32_t kRestartInterval = 16;
+
+    BinaryIndex() = default;
+    ~BinaryIndex();
+
+    BinaryIndex(const BinaryIndex&) = delete;
+    BinaryIndex& operator=(const BinaryIndex&) = delete;
+
+    /**
+     * @brief 写出索引文件
+     * @param file 输出文件路径
+     * @param entries (路径, 元数据) 列表，路径使用 '/' 分隔；函数内部按字节序排序
+     * @return 是否成功
+     */
+    static bool write(const std::filesystem::path& file,
+                      std::vector<std::pair<std::string, const Metadata*>> entries);
+
+    /**
+     * @brief 写出已按路径字节序排好的条目，逐个向 entry 取得，不需要同时持有所有元数据
+     * @param count 条目数
+     * @param entry 填写第 i 个条目的路径（'/' 分隔）和元数据
+     */
+    static bool write(const std::filesystem::path& file, std::size_t count,
+                      const std::function<void(std::size_t, std::string&, Metadata&)>& entry);
+
+    /**
+     * @brief 打开（mmap）索引文件并校验头部
+     * @return 是否成功
+     */
+    bool open(const std::filesystem::path& file);
+
+    /**
+     * @brief 关闭并解除映射
+     */
+    void close();
+
+    bool isOpen() const { return data_ != nullptr; }
+
+    /**
+     * @brief 条目数
+     */
+    std::size_t size() const { return static_cast<std::size_t>(entry_count_); }
+
+    /**
+     * @brief 第 i 个条目的路径
+     */
+    std::string pathAt(std::size_t i) const;
+
+    /**
+     * @brief 第 i 个条目的元数据
+     */
+    bool metadataAt(std::size_t i, Metadata& metadata) const;
+
+    /**
+     * @brief 第一个路径 >= key 的条目下标（字节序），不存在时返回 size()
+     */
+    std::size_t lowerBound(const std::string& key) const;
+
+    /**
+     * @brief 按路径查找条目
+     * @return 是否找到
+     */
+    bool find(const std::string& key, Metadata& metadata) const;
+
+    /**
+     * @brief 在 path（前一个条目的路径）基础上解码第 i 个条目的路径，用于顺序遍历
+     */
+    void decodePath(std::size_t i, std::string& path) const;
+
+    /**
+     * @brief 顺序游标：按序解码路径，复用前缀，避免逐条随机访问
+     */
+    class Cursor {
+    public:
+        Cursor(const BinaryIndex& index, std::size_t start);
+
+        bool valid() const { return pos_ < index_.size(); }
+        void next();
+        std::size_t index() const { return pos_; }
+        const std::string& path() const { return path_; }
+
+    private:
+        const BinaryIndex& index_;
+        std::size_t pos_;
+        std::string path_;
+    };
+
+private:
+    const std::uint8_t* data_ = nullptr;
+    std::size_t file_size_ = 0;
+    void* map_ = nullptr;                // mmap 返回的地址（为空表示使用 fallback_）
+    std::vector<std::uint8_t> fallback_; // 不支持 mmap 的平台：读入内存
+
+    std::uint64_t entry_count_ = 0;
+    std::uint32_t restart_interval_ = kRestartInterval;
+    std::uint64_t records_offset_ = 0;
+    std::uint64_t paths_offset_ = 0;
+    std::uint64_t paths_size_ = 0;
+    std::uint64_t extras_offset_ = 0;
+    std::uint64_t extras_size_ = 0;
+
+    /**
+     * @brief 读取第 i 条记录中的路径偏移
+     */
+    std::uint64_t pathOffset(std::size_t i) const;
+
+
+    /**
+     * @brief 与重启点（完整路径）比较，返回 <0/0/>0
+     */
+    int compareRestart(std::size_t i, const std::string& key) const;
+};
+
+} // namespace backuprestore
@@ -0,0 +1,358 @@
+#include "core/dir_scanner.h"
+#include "core/batch_io.h"
+#include "core/stats.h"
+#include "core/thread_pool.h"
+
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <optional>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace backuprestore {
+
+bool FileRecord::isSymlink() const {
+#ifdef S_IFLNK
+    return (mode & S_IFMT) == S_IFLNK;
+#else
+    return false;
+#endif
+}
+
+void FileRecord::toMetadata(Metadata& metadata) const {
+    metadata.mode = mode;
+    metadata.mtime = static_cast<std::time_t>(mtime);
+    metadata.mtime_nsec = mtime_nsec;
+    metadata.uid = uid;
+    metadata.gid = gid;
+    metadata.size = size;
+    metadata.is_symlink = isSymlink();
+    metadata.symlink_target = symlink_target;
+}
+
+namespace {
+
+void fillRecord(FileRecord& record, const struct stat& st) {
+    record.size = static_cast<std::uint64_t>(st.st_size);
+    record.mtime = static_cast<std::int64_t>(st.st_mtime);
+#ifdef _WIN32
+    record.mtime_nsec = 0;
+#else
+    record.mtime_nsec = static_cast<std::uint32_t>(st.st_mtim.tv_nsec);
+#endif
+    record.dev = static_cast<std::uint64_t>(st.st_dev);
+    record.ino = static_cast<std::uint64_t>(st.st_ino);
+    record.mode = static_cast<std::uint32_t>(st.st_mode);
+    record.uid = static_cast<std::uint32_t>(st.st_uid);
+    record.gid = static_cast<std::uint32_t>(st.st_gid);
+    record.nlink = static_cast<std::uint32_t>(st.st_nlink);
+}
+
+#ifdef __linux__
+
+/**
+ * @brief 目录树中的一个目录：本目录的文件 + 子目录（扫描完成后按深度优先顺序展开）
+ */
+struct DirNode {
+    std::string relative;  // 相对根目录的路径，根目录为空
+    std::vector<FileRecord> files;
+    std::vector<std::unique_ptr<DirNode>> children;
+};
+
+struct ScanContext {
+    std::filesystem::path root;
+    int root_fd = -1;
+    ThreadPool* pool = nullptr;
+    const FilterBase* filter = nullptr;
+    bool batch_io = false;
+};
+
+const std::size_t kDirentBufferSize = 64 * 1024;
+
+// linux_dirent64：d_ino(8) d_off(8) d_reclen(2) d_type(1) d_name[]
+const std::size_t kDirentReclenOffset = 16;
+const std::size_t kDirentTypeOffset = 18;
+const std::size_t kDirentNameOffset = 19;
+
+void scanNode(ScanContext& ctx, DirNode& node);
+
+void addChild(ScanContext& ctx, DirNode& node, const std::string& relative) {
+    node.children.push_back(std::make_unique<DirNode>());
+    DirNode* child = node.children.back().get();
+    child->relative = relative;
+    if (ctx.pool) {
+        // 子目录交给线程池，各自写入自己的节点，互不加锁
+        ctx.pool->submit([&ctx, child] { scanNode(ctx, *child); });
+    } else {
+        scanNode(ctx, *child);
+    }
+}
+
+/**
+ * @brief 处理一个目录项的 stat 结果：目录加入 subdirs，普通文件和符号链接加入 node.files
+ * @param error stat 失败时的 errno（0 表示成功）
+ */
+void addEntry(ScanContext& ctx, DirNode& node, int fd, const std::string& prefix, const char* name,
+              const struct stat& st, int error, std::vector<std::string>& subdirs) {
+    if (error != 0) {
+        std::cerr << "获取文件状态失败: " << (ctx.root / (prefix + name)) << " - "
+                  << std::strerror(error) << std::endl;
+        return;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        subdirs.push_back(prefix + name);  // 仅 DT_UNKNOWN 时会走到这里
+        return;
+    }
+    if (!S_ISREG(st.st_mode) && !S_ISLNK(st.st_mode)) {
+        return;
+    }
+
+    FileRecord record;
+    record.relative = prefix + name;
+    fillRecord(record, st);
+    if (S_ISLNK(st.st_mode)) {
+        // st_size 为目标长度；目标在两次调用间变化时按实际读取长度截断
+        std::string target(static_cast<std::size_t>(st.st_size) + 1, '\0');
+        ssize_t len;
+        {
+            StatTimer timer(StatPhase::Stat);
+            len = ::readlinkat(fd, name, &target[0], target.size());
+        }
+        if (len < 0) {
+            std::cerr << "读取符号链接目标失败: " << (ctx.root / record.relative) << " - "
+                      << std::strerror(errno) << std::endl;
+            return;
+        }
+        target.resize(static_cast<std::size_t>(len));
+        record.symlink_target = std::move(target);
+    }
+    node.files.push_back(std::move(record));
+}
+
+void scanNode(ScanContext& ctx, DirNode& node) {
+    // 根目录直接使用 root_fd；子目录相对 root_fd 打开，未扫描的目录不占用 fd
+    int fd = node.relative.empty()
+        ? ctx.root_fd
+        : ::openat(ctx.root_fd, node.relative.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "无法打开目录: " << (ctx.root / node.relative) << " - "
+                  << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    thread_local std::unique_ptr<char[]> buffer(new char[kDirentBufferSize]);
+    const std::string prefix = node.relative.empty() ? std::string() : node.relative + "/";
+    std::vector<std::string> subdirs;
+    // 批量模式：一次 getdents 读到的待 stat 条目合并为一次 statx 提交（名称指向 buffer，下次读取前处理完）
+    std::vector<const char*> pending;
+    std::vector<struct stat> stats;
+    std::vector<int> errors;
+
+    for (;;) {
+        long n;
+        {
+            StatTimer timer(StatPhase::Scan);
+            n = ::syscall(SYS_getdents64, fd, buffer.get(), kDirentBufferSize);
+            timer.addBytes(n > 0 ? static_cast<std::uint64_t>(n) : 0);
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "读取目录失败: " << (ctx.root / node.relative) << " - "
+                      << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (n == 0) break;
+
+        for (long off = 0; off < n;) {
+            const char* ent = buffer.get() + off;
+            unsigned short reclen;
+            std::memcpy(&reclen, ent + kDirentReclenOffset, sizeof(reclen));
+            off += reclen;
+
+            const char* name = ent + kDirentNameOffset;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            unsigned char type = static_cast<unsigned char>(ent[kDirentTypeOffset]);
+            if (type == DT_DIR) {
+                subdirs.push_back(prefix + name);
+                continue;
+            }
+            if (type != DT_REG && type != DT_LNK && type != DT_UNKNOWN) {
+                continue;  // 管道/设备/套接字：不支持备份，也不需要 stat
+            }
+            if (ctx.batch_io) {
+                pending.push_back(name);
+                continue;
+            }
+
+            struct stat st;
+            int rc;
+            {
+                StatTimer timer(StatPhase::Stat);
+                rc = ::fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW);
+            }
+            addEntry(ctx, node, fd, prefix, name, st, rc == 0 ? 0 : errno, subdirs);
+        }
+
+        if (!pending.empty()) {
+            thread_local BatchIo io;
+            io.statAt(fd, pending, stats, errors);
+            for (std::size_t i = 0; i < pending.size(); ++i) {
+                addEntry(ctx, node, fd, prefix, pending[i], stats[i], errors[i], subdirs);
+            }
+            pending.clear();
+        }
+    }
+
+    if (fd != ctx.root_fd) {
+        ::close(fd);
+    }
+    for (const auto& subdir : subdirs) {
+        // 子树中不可能有文件被包含时整棵跳过，不打开也不读取
+        if (ctx.filter) {
+            StatTimer timer(StatPhase::Filter);
+            if (!ctx.filter->shouldDescend(ctx.root / subdir)) {
+                continue;
+            }
+        }
+        addChild(ctx, node, subdir);
+    }
+}
+
+void flatten(DirNode& node, std::vector<FileRecord>& records) {
+    for (auto& record : node.files) {
+        records.push_back(std::move(record));
+    }
+    for (auto& child : node.children) {
+        flatten(*child, records);
+    }
+}
+
+#endif // __linux__
+
+} // namespace
+
+bool DirScanner::scan(const std::filesystem::path& root,
+                      std::vector<FileRecord>& records,
+                      std::size_t jobs,
+                      const FilterBase* filter,
+                      bool batch_io,
+                      const std::string& subdir) {
+#ifdef __linux__
+    ScanContext ctx;
+    ctx.root = root;
+    ctx.filter = filter;
+    ctx.batch_io = batch_io;
+    ctx.root_fd = ::open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (ctx.root_fd < 0) {
+        std::cerr << "无法打开目录: " << root << " - " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    if (jobs == 0) {
+        jobs = ThreadPool::defaultThreads();
+    }
+    std::optional<ThreadPool> pool;
+    if (jobs > 1) {
+        pool.emplace(jobs);
+        ctx.pool = &*pool;
+    }
+
+    DirNode tree;
+    tree.relative = subdir;
+    scanNode(ctx, tree);
+    if (pool) {
+        pool->wait();
+    }
+    ::close(ctx.root_fd);
+
+    flatten(tree, records);
+    return true;
+#else
+    (void)jobs;
+    (void)batch_io;
+    std::error_code ec;
+    std::filesystem::recursive_directory_iterator it(subdir.empty() ? root : root / subdir, ec), end;
+    if (ec) {
+        std::cerr << "无法打开目录: " << root << " - " << ec.message() << std::endl;
+        return false;
+    }
+    for (; it != end; it.increment(ec)) {
+        if (ec) {
+            std::cerr << "读取目录失败: " << root << " - " << ec.message() << std::endl;
+            break;
+        }
+        if (it->is_directory() && !it->is_symlink() && filter && !filter->shouldDescend(it->path())) {
+            it.disable_recursion_pending();
+            continue;
+        }
+        if (!it->is_regular_file() && !it->is_symlink()) {
+            continue;
+        }
+        struct stat st{};
+        const std::string p = it->path().string();
+        if (::stat(p.c_str(), &st) != 0) {
+            std::cerr << "获取文件状态失败: " << it->path() << std::endl;
+            continue;
+        }
+        FileRecord record;
+        record.relative = it->path().lexically_relative(root).generic_string();
+        fillRecord(record, st);
+        records.push_back(std::move(record));
+    }
+    return true;
+#endif
+}
+
+DirScanner::EntryKind DirScanner::statEntry(const std::filesystem::path& root, const std::string& relative,
+                                             FileRecord& record) {
+    const std::string path = (root / relative).string();
+    struct stat st{};
+    {
+        StatTimer timer(StatPhase::Stat);
+#ifdef _WIN32
+        if (::stat(path.c_str(), &st) != 0) {
+#else
+        if (::lstat(path.c_str(), &st) != 0) {
+#endif
+            return EntryKind::Missing;
+        }
+    }
+    if (S_ISDIR(st.st_mode)) {
+        return EntryKind::Directory;
+    }
+#ifdef S_IFLNK
+    const bool symlink = S_ISLNK(st.st_mode);
+#else
+    const bool symlink = false;
+#endif
+    if (!S_ISREG(st.st_mode) && !symlink) {
+        return EntryKind::Other;
+    }
+    record = FileRecord();
+    record.relative = relative;
+    fillRecord(record, st);
+#ifndef _WIN32
+    if (symlink) {
+        std::string target(static_cast<std::size_t>(st.st_size) + 1, '\0');
+        ssize_t len = ::readlink(path.c_str(), &target[0], target.size());
+        if (len < 0) {
+            return EntryKind::Missing;  // 在两次调用之间被删除或替换
+        }
+        target.resize(static_cast<std::size_t>(len));
+        record.symlink_target = std::move(target);
+    }
+#endif
+    return EntryKind::File;
+}
+
+} // namespace backuprestore
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "filters/filter_base.h"
+#include "metadata/metadata.h"
+
+namespace backuprestore {
+
+/**
+ * @brief 扫描得到的一个条目（普通文件或符号链接）
+ * 扫描时对每个条目只做一次 fstatat，结果随记录传到备份流程的后续步骤，之后不再 stat
+ */
+struct FileRecord {
+    std::string relative;        // 相对扫描根目录的路径（/ 分隔）
+    std::string symlink_target;  // 符号链接目标（仅符号链接）
+    std::uint64_t size = 0;
+    std::int64_t mtime = 0;
+    std::uint64_t dev = 0;
+    std::uint64_t ino = 0;
+    std::uint32_t mtime_nsec = 0;
+    std::uint32_t mode = 0;      // st_mode（含文件类型位）
+    std::uint32_t uid = 0;
+    std::uint32_t gid = 0;
+    std::uint32_t nlink = 0;
+
+    bool isSymlink() const;
+
+    /**
+     * @brief 填充 Metadata（不访问文件系统）
+     */
+    void toMetadata(Metadata& metadata) const;
+};
+
+/**
+ * @brief 目录扫描器
+ * Linux 下用 openat + getdents64 读取目录，按 d_type 区分目录/文件，
+ * 只有普通文件、符号链接以及 d_type 未知的条目才调用 fstatat；
+ * 管道、设备、套接字等不支持的类型直接跳过（与 FileUtils::getFilesRecursive 一致）
+ */
+class DirScanner {
+public:
+    /**
+     * @brief 扫描 root 下的所有普通文件和符号链接（不跟随符号链接进入目录）
+     * @param root 根目录
+     * @param records 输出记录（追加），同一目录的条目相邻
+     * @param jobs 并发扫描子目录的线程数（0 表示硬件并发数，1 表示串行）
+     * @param filter 过滤器（可为空）：shouldDescend 返回 false 的子目录不会被打开；
+     *               文件本身不在这里过滤，由调用方调用 shouldInclude
+     * @param batch_io 为 true 时每批目录项的 stat 合并为一次 io_uring statx 提交（调用方已确认 BatchIo::supported()）
+     * @param subdir 非空时只扫描 root 下的这个子目录（'/' 分隔），记录中的路径仍相对 root
+     * @return 根目录无法打开时返回 false；无法读取的子目录会报错并跳过
+     */
+    static bool scan(const std::filesystem::path& root,
+                     std::vector<FileRecord>& records,
+                     std::size_t jobs = 1,
+                     const FilterBase* filter = nullptr,
+                     bool batch_io = false,
+                     const std::string& subdir = std::string());
+
+    /**
+     * @brief 单个路径的类型
+     */
+    enum class EntryKind {
+        Missing,    // 不存在或无法 stat
+        File,       // 普通文件或符号链接，已填写记录
+        Directory,
+        Other       // 管道、设备、套接字等不支持的类型
+    };
+
+    /**
+     * @brief 按扫描时的方式 lstat 单个路径（不跟随符号链接），用于只处理变化路径的持续备份
+     * @param relative 相对 root 的路径（'/' 分隔）
+     * @param record 类型为 File 时输出记录
+     */
+    static EntryKind statEntry(const std::filesystem::path& root, const std::string& relative,
+                               FileRecord& record);
+};
+
+} // namespace backuprestore
@@ -0,0 +1,211 @@
+#include "core/dir_stats.h"
+#include "core/flat_index.h"
+#include "storage/xxhash64.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace backuprestore {
+
+namespace {
+
+const char kMagic[8] = {'B', 'R', 'D', 'I', 'R', 'S', '0', '1'};
+const std::size_t kHeaderSize = 48;  // magic + 条目数 + 索引大小 + 索引修改时间 + 目录数 + XXH64
+
+void putLe(std::string& out, std::uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+std::uint64_t getLe(const char* p, int bytes) {
+    std::uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) v |= static_cast<std::uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    return v;
+}
+
+// dir 是否为 ancestor 本身或位于其下（ancestor 为空表示根目录）
+bool within(const std::string& dir, const std::string& ancestor) {
+    if (ancestor.empty() || dir == ancestor) {
+        return true;
+    }
+    return dir.size() > ancestor.size() && dir[ancestor.size()] == '/' &&
+           dir.compare(0, ancestor.size(), ancestor) == 0;
+}
+
+// 索引文件的大小和修改时间，用于判断附属文件是否与之对应
+bool indexStamp(const std::filesystem::path& index_file, std::uint64_t& size, std::uint64_t& mtime) {
+    std::error_code ec;
+    size = std::filesystem::file_size(index_file, ec);
+    if (ec) {
+        return false;
+    }
+    auto time = std::filesystem::last_write_time(index_file, ec);
+    mtime = static_cast<std::uint64_t>(time.time_since_epoch().count());
+    return !ec;
+}
+
+} // namespace
+
+void DirectoryStats::Builder::add(const std::string& path, std::uint64_t size) {
+    if (stack_.empty()) {
+        stack_.push_back(Open{});
+    }
+    const std::size_t slash = path.rfind('/');
+    const std::string dir = slash == std::string::npos ? std::string() : path.substr(0, slash);
+
+    // 条目按路径排序，一个目录下的条目连续出现：离开的目录不会再出现，出栈时汇总到父目录
+    while (stack_.size() > 1 && !within(dir, stack_.back().path)) {
+        pop();
+    }
+    while (stack_.back().path != dir) {
+        const std::string& top = stack_.back().path;
+        const std::size_t start = top.empty() ? 0 : top.size() + 1;
+        const std::size_t next = dir.find('/', start);
+        stack_.back().totals.children++;
+        stack_.push_back(Open{dir.substr(0, next), DirectoryTotals{}});
+    }
+    DirectoryTotals& totals = stack_.back().totals;
+    totals.files++;
+    totals.bytes += size;
+    totals.children++;
+}
+
+void DirectoryStats::Builder::pop() {
+    Open closed = std::move(stack_.back());
+    stack_.pop_back();
+    if (!stack_.empty()) {
+        stack_.back().totals.files += closed.totals.files;
+        stack_.back().totals.bytes += closed.totals.bytes;
+    }
+    done_.emplace_back(std::move(closed.path), closed.totals);
+}
+
+DirectoryStats DirectoryStats::Builder::finish() {
+    if (stack_.empty()) {
+        stack_.push_back(Open{});
+    }
+    while (!stack_.empty()) {
+        pop();
+    }
+    DirectoryStats stats;
+    stats.dirs_ = std::move(done_);
+    std::sort(stats.dirs_.begin(), stats.dirs_.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    done_.clear();
+    return stats;
+}
+
+DirectoryStats DirectoryStats::build(const IndexView& view) {
+    Builder builder;
+    Metadata metadata;
+    for (auto it = view.begin(); it != view.end(); ++it) {
+        builder.add(*it, view.metadata(it.index(), metadata) ? metadata.size : 0);
+    }
+    return builder.finish();
+}
+
+std::filesystem::path DirectoryStats::pathFor(const std::filesystem::path& index_file) {
+    std::filesystem::path file = index_file;
+    return file.replace_extension(".dirs");
+}
+
+bool DirectoryStats::write(const std::filesystem::path& index_file, std::uint64_t entries) const {
+    std::uint64_t index_size = 0;
+    std::uint64_t index_mtime = 0;
+    if (!indexStamp(index_file, index_size, index_mtime)) {
+        return false;
+    }
+    std::string body;
+    for (const auto& dir : dirs_) {
+        putLe(body, dir.first.size(), 4);
+        body += dir.first;
+        putLe(body, dir.second.files, 8);
+        putLe(body, dir.second.bytes, 8);
+        putLe(body, dir.second.children, 8);
+    }
+    std::string header(kMagic, sizeof(kMagic));
+    putLe(header, entries, 8);
+    putLe(header, index_size, 8);
+    putLe(header, index_mtime, 8);
+    putLe(header, dirs_.size(), 8);
+    putLe(header, Xxh64::hash(body.data(), body.size()), 8);
+
+    const std::filesystem::path file = pathFor(index_file);
+    auto tmp = file;
+    tmp += ".tmp";
+    {
+        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+        ofs.write(header.data(), static_cast<std::streamsize>(header.size()));
+        ofs.write(body.data(), static_cast<std::streamsize>(body.size()));
+        if (!ofs) {
+            std::cerr << "写入目录统计失败: " << tmp << std::endl;
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, file, ec);
+    if (ec) {
+        std::cerr << "替换目录统计失败: " << file << " - " << ec.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool DirectoryStats::read(const std::filesystem::path& index_file, std::uint64_t entries) {
+    dirs_.clear();
+    std::uint64_t index_size = 0;
+    std::uint64_t index_mtime = 0;
+    std::ifstream in(pathFor(index_file), std::ios::binary);
+    if (!in || !indexStamp(index_file, index_size, index_mtime)) {
+        return false;
+    }
+    char header[kHeaderSize];
+    if (!in.read(header, sizeof(header)) || std::memcmp(header, kMagic, sizeof(kMagic)) != 0 ||
+        getLe(header + 8, 8) != entries || getLe(header + 16, 8) != index_size ||
+        getLe(header + 24, 8) != index_mtime) {
+        return false;
+    }
+    const std::uint64_t count = getLe(header + 32, 8);
+    const std::string body((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (Xxh64::hash(body.data(), body.size()) != getLe(header + 40, 8)) {
+        return false;
+    }
+
+    std::vector<std::pair<std::string, DirectoryTotals>> dirs;
+    dirs.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(count, body.size() / 28)));
+    std::size_t pos = 0;
+    for (std::uint64_t i = 0; i < count; ++i) {
+        if (body.size() - pos < 4) {
+            return false;
+        }
+        const std::size_t len = static_cast<std::size_t>(getLe(body.data() + pos, 4));
+        pos += 4;
+        if (body.size() - pos < len + 24) {
+            return false;
+        }
+        DirectoryTotals totals;
+        totals.files = getLe(body.data() + pos + len, 8);
+        totals.bytes = getLe(body.data() + pos + len + 8, 8);
+        totals.children = getLe(body.data() + pos + len + 16, 8);
+        dirs.emplace_back(body.substr(pos, len), totals);
+        pos += len + 24;
+    }
+    if (pos != body.size()) {
+        return false;
+    }
+    dirs_ = std::move(dirs);
+    return true;
+}
+
+bool DirectoryStats::find(const std::string& dir, DirectoryTotals& totals) const {
+    auto it = std::lower_bound(dirs_.begin(), dirs_.end(), dir,
+                               [](const auto& entry, const std::string& key) { return entry.first < key; });
+    if (it == dirs_.end() || it->first != dir) {
+        return false;
+    }
+    totals = it->second;
+    return true;
+}
+
+} // namespace backuprestore
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+#include "metadata/metadata.h"
+
+namespace backuprestore {
+
+class IndexView;
+
+/**
+ * @brief 一个目录之下（递归）的汇总
+ */
+struct DirectoryTotals {
+    std::uint64_t files = 0;     // 文件数（含符号链接）
+    std::uint64_t bytes = 0;     // 文件原始大小之和
+    std::uint64_t children = 0;  // 直接子项数（文件 + 子目录）
+};
+
+/**
+ * @brief 目录的一个直接子项
+ */
+struct DirectoryEntry {
+    std::string name;
+    bool is_directory = false;
+    Metadata metadata;        // 仅文件
+    DirectoryTotals totals;   // 仅目录
+};
+
+/**
+ * @brief 各目录的文件数与字节数（索引的附属文件，如 index.dirs）
+ *
+ * 随索引一起写出：写索引时条目已按路径字节序排列，同一目录下的条目连续，用一个目录栈一遍得到
+ * 所有目录的汇总。文件布局（小端）：magic "BRDIRS01"、对应索引的条目数/文件大小/修改时间（纳秒）、
+ * 目录数、记录段的 XXH64，之后每个目录一条 [u32 路径长度][路径][u64 文件数][u64 字节数][u64 子项数]，
+ * 按路径排序，根目录的路径为空串。与索引不符（如由旧版本写出的索引）时调用方应重新统计
+ */
+class DirectoryStats {
+public:
+    /**
+     * @brief 按路径字节序逐条加入文件，得到各目录的汇总
+     */
+    class Builder {
+    public:
+        void add(const std::string& path, std::uint64_t size);
+        DirectoryStats finish();
+
+    private:
+        struct Open {
+            std::string path;
+            DirectoryTotals totals;
+        };
+        std::vector<Open> stack_;  // 从根目录到当前目录
+        std::vector<std::pair<std::string, DirectoryTotals>> done_;
+
+        void pop();
+    };
+
+    /**
+     * @brief 遍历视图统计（没有可用的附属文件时使用）
+     */
+    static DirectoryStats build(const IndexView& view);
+
+    /**
+     * @brief 附属文件的路径：索引文件换成 .dirs 扩展名
+     */
+    static std::filesystem::path pathFor(const std::filesystem::path& index_file);
+
+    /**
+     * @brief 写出附属文件（临时文件 + rename），记录 index_file 当前的大小和修改时间
+     * @param entries 索引的条目数
+     */
+    bool write(const std::filesystem::path& index_file, std::uint64_t entries) const;
+
+    /**
+     * @brief 读取附属文件
+     * @return 文件不存在、损坏或与 index_file 不符时返回 false
+     */
+    bool read(const std::filesystem::path& index_file, std::uint64_t entries);
+
+    /**
+     * @brief 查找目录 dir（'/' 分隔，空串为根目录）
+     */
+    bool find(const std::string& dir, DirectoryTotals& totals) const;
+
+    /**
+     * @brief 目录数
+     */
+    std::size_t size() const { return dirs_.size(); }
+
+private:
+    std::vector<std::pair<std::string, DirectoryTotals>> dirs_;  // 按路径排序
+};
+
+} // namespace backuprestore
@@ -1,10 +1,89 @@
 #include "core/file_utils.h"
+#include "core/stats.h"
+#include "storage/xxhash64.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <cerrno>
 #include <cstdint>
+#include <cstring>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#endif
 
 namespace backuprestore {
 
+namespace {
+
+const std::size_t kCopyBufferSize = 1024 * 1024;
+
+// 需要校验和时，不小于该大小的文件仍用内核复制，另起线程读取源文件计算校验和；
+// 更小的文件线程开销不划算，直接用 read/write 边复制边计算
+const std::uint64_t kSideHashMinSize = 4 * 1024 * 1024;
+
+#ifndef _WIN32
+// 出错时关闭 fd 的简单守卫
+struct FdGuard {
+    int fd;
+    explicit FdGuard(int f) : fd(f) {}
+    ~FdGuard() {
+        if (fd >= 0) ::close(fd);
+    }
+    FdGuard(const FdGuard&) = delete;
+    FdGuard& operator=(const FdGuard&) = delete;
+};
+
+// 这些错误表示当前复制方式不适用于该文件/文件系统，应换下一种
+bool isUnsupported(int err) {
+    return err == ENOSYS || err == EXDEV || err == EINVAL || err == EOPNOTSUPP ||
+           err == ENOTTY || err == EPERM || err == EBADF;
+}
+#endif
+
+} // namespace
+
+const char* copyStrategyName(CopyStrategy strategy) {
+    switch (strategy) {
+        case CopyStrategy::Reflink: return "reflink";
+        case CopyStrategy::CopyFileRange: return "copy_file_range";
+        case CopyStrategy::Sendfile: return "sendfile";
+        case CopyStrategy::ReadWrite: return "read/write";
+        case CopyStrategy::HardLink: return "hardlink";
+        case CopyStrategy::Symlink: return "symlink";
+        case CopyStrategy::IoUring: return "io_uring";
+        default: return "unknown";
+    }
+}
+
+const char* syncPolicyName(SyncPolicy policy) {
+    switch (policy) {
+        case SyncPolicy::None: return "none";
+        case SyncPolicy::File: return "file";
+        case SyncPolicy::Filesystem: return "fs";
+        default: return "unknown";
+    }
+}
+
+bool parseSyncPolicy(const std::string& name, SyncPolicy& policy) {
+    for (auto candidate : {SyncPolicy::None, SyncPolicy::File, SyncPolicy::Filesystem}) {
+        if (name == syncPolicyName(candidate)) {
+            policy = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
 void FileUtils::getFilesRecursive(const std::filesystem::path& root, 
                                    std::vector<std::filesystem::path>& files) {
     if (!std::filesystem::exists(root)) {
@@ -29,27 +108,28 @@ bool FileUtils::createDirectories(const std::filesystem::path& path) {
 }
 
 bool FileUtils::copyFile(const std::filesystem::path& from, 
-                         const std::filesystem::path& to) {
+                         const std::filesystem::path& to,
+                         bool create_parents,
+                         bool allow_hardlink,
+                         CopyStrategy* strategy) {
     try {
         // 确保目标目录存在
         auto parent = to.parent_path();
-        if (!parent.empty()) {
+        if (create_parents && !parent.empty()) {
             createDirectories(parent);
         }
 
         if (std::filesystem::is_symlink(from)) {
             // 处理符号链接
-            auto target = std::filesystem::read_symlink(from);
-            if (std::filesystem::exists(to)) {
-                std::filesystem::remove(to);
+            if (!createSymlink(std::filesystem::read_symlink(from), to)) {
+                return false;
+            }
+            if (strategy) {
+                *strategy = CopyStrategy::Symlink;
             }
-            std::filesystem::create_symlink(target, to);
-        } else {
-            // 复制普通文件
-            std::filesystem::copy_file(from, to, 
-                std::filesystem::copy_options::overwrite_existing);
+            return true;
         }
-        return true;
+        return copyRegularFile(from, to, allow_hardlink, strategy);
     } catch (const std::exception& e) {
         std::cerr << "复制文件失败: " << from << " -> " << to 
                   << " - " << e.what() << std::endl;
@@ -57,6 +137,559 @@ bool FileUtils::copyFile(const std::filesystem::path& from,
     }
 }
 
+bool FileUtils::copyRegularFile(const std::filesystem::path& from,
+                                const std::filesystem::path& to,
+                                bool allow_hardlink,
+                                CopyStrategy* strategy,
+                                std::uint64_t* checksum,
+                                SparseMap* layout) {
+    try {
+        CopyStrategy used = CopyStrategy::HardLink;
+        if (allow_hardlink) {
+            // 目标已存在时先删除再链接；跨文件系统等情况下失败时退回复制
+            std::error_code ec;
+            std::filesystem::create_hard_link(from, to, ec);
+            if (ec == std::errc::file_exists) {
+                std::filesystem::remove(to, ec);
+                std::filesystem::create_hard_link(from, to, ec);
+            }
+            if (!ec) {
+                if (strategy) {
+                    *strategy = used;
+                }
+                return !checksum || hashFile(from, *checksum, nullptr, layout);
+            }
+        }
+        if (!copyFileData(from, to, used, checksum, layout)) {
+            return false;
+        }
+        if (strategy) {
+            *strategy = used;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "复制文件失败: " << from << " -> " << to
+                  << " - " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool FileUtils::createSymlink(const std::filesystem::path& target,
+                              const std::filesystem::path& to) {
+    std::error_code ec;
+    std::filesystem::create_symlink(target, to, ec);
+    if (ec == std::errc::file_exists) {
+        std::filesystem::remove(to, ec);
+        std::filesystem::create_symlink(target, to, ec);
+    }
+    if (ec) {
+        std::cerr << "创建符号链接失败: " << to << " -> " << target
+                  << " - " << ec.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool FileUtils::copyFileData(const std::filesystem::path& from,
+                             const std::filesystem::path& to,
+                             CopyStrategy& strategy,
+                             std::uint64_t* checksum,
+                             SparseMap* layout) {
+#ifdef _WIN32
+    std::filesystem::copy_file(from, to, std::filesystem::copy_options::overwrite_existing);
+    strategy = CopyStrategy::ReadWrite;
+    return !checksum || hashFile(from, *checksum, nullptr, layout);
+#else
+    FdGuard out(openForWrite(to));
+    if (out.fd < 0) {
+        return false;
+    }
+    if (!copyToFd(from, out.fd, to, &strategy, true, checksum, layout)) {
+        return false;
+    }
+    int fd = out.fd;
+    out.fd = -1;
+    return closeWritten(fd, to);
+#endif
+}
+
+#ifndef _WIN32
+int FileUtils::openForWrite(const std::filesystem::path& to) {
+    const std::string to_str = to.string();
+    // O_NOFOLLOW：目标处已有的符号链接不写穿，删除后重建为普通文件
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW;
+    int fd = ::open(to_str.c_str(), flags, 0600);
+    if (fd < 0 && errno == ELOOP && ::unlink(to_str.c_str()) == 0) {
+        fd = ::open(to_str.c_str(), flags, 0600);
+    }
+    if (fd < 0) {
+        std::cerr << "无法创建目标文件: " << to << " - " << std::strerror(errno) << std::endl;
+    }
+    return fd;
+}
+
+bool FileUtils::writeAll(int fd, const void* data, std::size_t size, const std::filesystem::path& to) {
+    StatTimer timer(StatPhase::Write, size);
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t w = ::write(fd, p, size);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) {
+            std::cerr << "写入目标文件失败: " << to << " - " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        p += w;
+        size -= static_cast<std::size_t>(w);
+    }
+    return true;
+}
+
+bool FileUtils::syncFileData(int fd, const std::filesystem::path& to) {
+#ifdef __linux__
+    int rc = ::fdatasync(fd);
+#else
+    int rc = ::fsync(fd);
+#endif
+    if (rc != 0) {
+        std::cerr << "同步文件数据失败: " << to << " - " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool FileUtils::closeWritten(int fd, const std::filesystem::path& to) {
+    // 部分文件系统（NFS 等）把延迟写入的错误留到 close 才报告
+    if (::close(fd) != 0) {
+        std::cerr << "写入目标文件失败: " << to << " - " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+namespace {
+
+// 把 [offset, end) 从 in_fd 复制到 out_fd 的相同偏移
+// strategy 为当前可用的最快方式：某种内核复制不被支持时降级，并沿用给之后的区段；
+// hasher 非空时调用方已选择 ReadWrite
+bool copyRange(int in_fd, int out_fd, off_t offset, off_t end, CopyStrategy& strategy,
+               std::vector<char>& buffer, Xxh64* hasher,
+               const std::filesystem::path& from, const std::filesystem::path& to) {
+#ifdef __linux__
+    // 1. copy_file_range：从 offset 继续，不支持时换下一种
+    if (strategy == CopyStrategy::CopyFileRange) {
+        while (offset < end) {
+            loff_t in_off = offset;
+            loff_t out_off = offset;
+            StatTimer timer(StatPhase::Write);
+            ssize_t n = ::copy_file_range(in_fd, &in_off, out_fd, &out_off,
+                                          static_cast<std::size_t>(end - offset), 0);
+            timer.addBytes(n > 0 ? static_cast<std::uint64_t>(n) : 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && !isUnsupported(errno)) {
+                std::cerr << "复制文件数据失败: " << from << " - " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            if (n <= 0) {
+                strategy = CopyStrategy::Sendfile;
+                break;
+            }
+            offset += n;
+        }
+    }
+
+    // 2. sendfile
+    if (strategy == CopyStrategy::Sendfile && offset < end) {
+        if (::lseek(out_fd, offset, SEEK_SET) != offset) {
+            strategy = CopyStrategy::ReadWrite;
+        }
+        while (strategy == CopyStrategy::Sendfile && offset < end) {
+            off_t in_off = offset;
+            StatTimer timer(StatPhase::Write);
+            ssize_t n = ::sendfile(out_fd, in_fd, &in_off, static_cast<std::size_t>(end - offset));
+            timer.addBytes(n > 0 ? static_cast<std::uint64_t>(n) : 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && !isUnsupported(errno)) {
+                std::cerr << "复制文件数据失败: " << from << " - " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            if (n <= 0) {
+                strategy = CopyStrategy::ReadWrite;
+                break;
+            }
+            offset = in_off;
+        }
+    }
+#endif
+
+    // 3. 大缓冲区 read/write（需要校验和时只走这里）
+    if (offset < end) {
+        strategy = CopyStrategy::ReadWrite;
+        buffer.resize(kCopyBufferSize);
+    }
+    while (offset < end) {
+        std::size_t want = static_cast<std::size_t>(std::min<off_t>(end - offset, static_cast<off_t>(buffer.size())));
+        ssize_t n;
+        {
+            StatTimer timer(StatPhase::Read);
+            n = ::pread(in_fd, buffer.data(), want, offset);
+            timer.addBytes(n > 0 ? static_cast<std::uint64_t>(n) : 0);
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            std::cerr << "读取源文件失败: " << from << " - " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        if (n == 0) break;  // 源文件在复制过程中变短
+        if (hasher) {
+            hasher->update(buffer.data(), static_cast<std::size_t>(n));
+        }
+        if (!FileUtils::pwriteAll(out_fd, buffer.data(), static_cast<std::size_t>(n),
+                                  static_cast<std::uint64_t>(offset), to)) {
+            return false;
+        }
+        offset += n;
+    }
+    return true;
+}
+
+// 按顺序读取 fd 的数据区段（layout 不是稀疏时为 [0, size)）计算 XXH64；与内核复制并行的读取侧
+bool hashExtents(int fd, const SparseMap& layout, off_t size, Xxh64& hasher, const std::filesystem::path& from) {
+    std::vector<Extent> extents = layout.extents;
+    if (!layout.sparse) {
+        extents = {{0, static_cast<std::uint64_t>(size)}};
+    }
+    std::vector<char> buffer(kCopyBufferSize);
+    for (const auto& extent : extents) {
+        off_t offset = static_cast<off_t>(extent.offset);
+        const off_t end = offset + static_cast<off_t>(extent.length);
+        while (offset < end) {
+            const std::size_t want = static_cast<std::size_t>(std::min<off_t>(end - offset, static_cast<off_t>(buffer.size())));
+            ssize_t n;
+            {
+                StatTimer timer(StatPhase::Read);
+                n = ::pread(fd, buffer.data(), want, offset);
+                timer.addBytes(n > 0 ? static_cast<std::uint64_t>(n) : 0);
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) {
+                std::cerr << "读取源文件失败: " << from << " - " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            if (n == 0) return true;  // 源文件变短：由 changedSince 发现
+            hasher.update(buffer.data(), static_cast<std::size_t>(n));
+            offset += n;
+        }
+    }
+    return true;
+}
+
+// 源文件自 st 之后是否被修改（大小、mtime 或 ctime 变化）
+bool changedSince(int fd, const struct stat& st) {
+    struct stat now{};
+    if (::fstat(fd, &now) != 0) {
+        return true;
+    }
+    return now.st_size != st.st_size || now.st_mtim.tv_sec != st.st_mtim.tv_sec ||
+           now.st_mtim.tv_nsec != st.st_mtim.tv_nsec || now.st_ctim.tv_sec != st.st_ctim.tv_sec ||
+           now.st_ctim.tv_nsec != st.st_ctim.tv_nsec;
+}
+
+// 离开作用域时等待计算校验和的线程（提前返回时也不会在线程仍读取 fd 时关闭它）
+struct SideThread {
+    std::thread thread;
+    ~SideThread() {
+        if (thread.joinable()) thread.join();
+    }
+};
+
+} // namespace
+
+bool FileUtils::copyToFd(const std::filesystem::path& from, int out_fd,
+                         const std::filesystem::path& to, CopyStrategy* used,
+                         bool copy_mode, std::uint64_t* checksum, SparseMap* layout) {
+    FdGuard in(::open(from.string().c_str(), O_RDONLY | O_CLOEXEC));
+    if (in.fd < 0) {
+        std::cerr << "无法打开源文件: " << from << " - " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    struct stat st{};
+    if (::fstat(in.fd, &st) != 0) {
+        std::cerr << "获取文件状态失败: " << from << std::endl;
+        return false;
+    }
+    if (copy_mode) {
+        // 与 std::filesystem::copy_file 一致：目标权限与源文件相同（不受 umask 影响）
+        ::fchmod(out_fd, st.st_mode & 07777);
+    }
+
+    const off_t size = st.st_size;
+    SparseMap probed;
+    probeExtents(in.fd, static_cast<std::uint64_t>(size), probed);
+    if (layout) {
+        *layout = probed;
+    }
+
+    // 需要校验和的大文件：内核复制的同时由另一个线程按顺序读取源文件计算校验和，
+    // 两边读到的页共享页缓存；小文件数据经用户态缓冲区复制，边读边算
+    const bool side_hash = checksum && static_cast<std::uint64_t>(size) >= kSideHashMinSize;
+    const bool kernel_copy = (checksum == nullptr) || side_hash;
+    CopyStrategy strategy = CopyStrategy::ReadWrite;
+#ifdef __linux__
+    if (kernel_copy) {
+        strategy = CopyStrategy::CopyFileRange;
+    }
+#endif
+
+    // 逐个数据区段复制；空洞不读也不写，最后由 ftruncate 留出
+    std::vector<char> buffer;
+    auto copyData = [&](Xxh64* hash) {
+        if (!probed.sparse) {
+            return copyRange(in.fd, out_fd, 0, size, strategy, buffer, hash, from, to);
+        }
+        for (const auto& extent : probed.extents) {
+            const off_t begin = static_cast<off_t>(extent.offset);
+            if (!copyRange(in.fd, out_fd, begin, begin + static_cast<off_t>(extent.length),
+                           strategy, buffer, hash, from, to)) {
+                return false;
+            }
+        }
+        return setFileSize(out_fd, static_cast<std::uint64_t>(size), to);
+    };
+
+    Xxh64 side_hasher;
+    bool side_ok = true;
+    {
+        SideThread hash_thread;
+        if (side_hash) {
+            hash_thread.thread = std::thread([&] { side_ok = hashExtents(in.fd, probed, size, side_hasher, from); });
+        }
+        bool cloned = false;
+#if defined(__linux__) && defined(FICLONE)
+        // reflink：整文件共享数据块，空洞保持不变
+        if (kernel_copy) {
+            StatTimer timer(StatPhase::Write);
+            if (::ioctl(out_fd, FICLONE, in.fd) == 0) {
+                timer.addBytes(static_cast<std::uint64_t>(st.st_size));
+                strategy = CopyStrategy::Reflink;
+                cloned = true;
+            }
+        }
+#endif
+        if (!cloned && !copyData(checksum && !side_hash ? &side_hasher : nullptr)) {
+            return false;
+        }
+    }
+    if (side_hash && (!side_ok || changedSince(in.fd, st))) {
+        // 源文件在复制期间被修改（或读取失败）：两次读取的数据可能不同，
+        // 改用 read/write 重新复制，保证校验和与写入的数据一致
+        side_hasher = Xxh64();
+        strategy = CopyStrategy::ReadWrite;
+        if (!setFileSize(out_fd, 0, to) || !copyData(&side_hasher)) {
+            return false;
+        }
+    }
+    if (checksum) {
+        *checksum = side_hasher.digest();
+    }
+
+    if (used) {
+        *used = strategy;
+    }
+    return true;
+}
+
+bool FileUtils::copyFileRange(const std::filesystem::path& from, const std::filesystem::path& to,
+                              std::uint64_t offset, std::uint64_t length, CopyStrategy* used) {
+    FdGuard in(::open(from.string().c_str(), O_RDONLY | O_CLOEXEC));
+    if (in.fd < 0) {
+        std::cerr << "无法打开源文件: " << from << " - " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    // 不截断：其它区段可能正由别的线程写入
+    FdGuard out(::open(to.string().c_str(), O_WRONLY | O_CLOEXEC | O_NOFOLLOW));
+    if (out.fd < 0) {
+        std::cerr << "无法打开目标文件: " << to << " - " << std::strerror(errno) << std::endl;
+        return false;
+    }
+#ifdef __linux__
+    CopyStrategy strategy = CopyStrategy::CopyFileRange;
+#else
+    CopyStrategy strategy = CopyStrategy::ReadWrite;
+#endif
+    std::vector<char> buffer;
+    const off_t begin = static_cast<off_t>(offset);
+    if (!copyRange(in.fd, out.fd, begin, begin + static_cast<off_t>(length), strategy, buffer, nullptr, from, to)) {
+        return false;
+    }
+    if (used) {
+        *used = strategy;
+    }
+    const int fd = out.fd;
+    out.fd = -1;
+    return closeWritten(fd, to);
+}
+
+void FileUtils::probeExtents(int fd, std::uint64_t size, SparseMap& layout) {
+    layout = SparseMap();
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    // 已分配的块覆盖整个文件时不可能有空洞，省去 lseek
+    struct stat st{};
+    if (size == 0 || ::fstat(fd, &st) != 0 ||
+        static_cast<std::uint64_t>(st.st_blocks) * 512 >= size) {
+        return;
+    }
+    std::vector<Extent> extents;
+    const off_t end = static_cast<off_t>(size);
+    off_t pos = 0;
+    while (pos < end) {
+        off_t data = ::lseek(fd, pos, SEEK_DATA);
+        if (data < 0 && errno == ENXIO) {
+            break;  // 之后全是空洞
+        }
+        if (data < 0) {
+            return;  // 文件系统不支持：按稠密文件处理
+        }
+        if (data >= end) {
+            break;
+        }
+        off_t hole = ::lseek(fd, data, SEEK_HOLE);
+        if (hole < 0) {
+            return;
+        }
+        hole = std::min(hole, end);
+        extents.push_back({static_cast<std::uint64_t>(data), static_cast<std::uint64_t>(hole - data)});
+        pos = hole;
+    }
+    if (extents.size() == 1 && extents[0].offset == 0 && extents[0].length == size) {
+        return;
+    }
+    layout.sparse = true;
+    layout.extents = std::move(extents);
+#else
+    (void)fd;
+    (void)size;
+#endif
+}
+
+bool FileUtils::pwriteAll(int fd, const void* data, std::size_t size, std::uint64_t offset,
+                          const std::filesystem::path& to) {
+    StatTimer timer(StatPhase::Write, size);
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t w = ::pwrite(fd, p, size, static_cast<off_t>(offset));
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) {
+            std::cerr << "写入目标文件失败: " << to << " - " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        p += w;
+        offset += static_cast<std::uint64_t>(w);
+        size -= static_cast<std::size_t>(w);
+    }
+    return true;
+}
+
+bool FileUtils::setFileSize(int fd, std::uint64_t size, const std::filesystem::path& to) {
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        std::cerr << "设置文件长度失败: " << to << " - " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+#endif // _WIN32
+
+
+bool FileUtils::syncDirectory(const std::filesystem::path& dir) {
+#ifdef _WIN32
+    (void)dir;
+    return true;
+#else
+    FdGuard fd(::open(dir.string().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (fd.fd < 0 || ::fsync(fd.fd) != 0) {
+        std::cerr << "同步目录失败: " << dir << " - " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+#endif
+}
+
+bool FileUtils::syncFilesystem(const std::filesystem::path& path) {
+#ifdef __linux__
+    FdGuard fd(::open(path.string().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (fd.fd < 0 || ::syncfs(fd.fd) != 0) {
+        std::cerr << "同步文件系统失败: " << path << " - " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+#elif !defined(_WIN32)
+    (void)path;
+    ::sync();
+    return true;
+#else
+    (void)path;
+    return true;
+#endif
+}
+
+bool FileUtils::readFile(const std::filesystem::path& path, const ByteSink& sink) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        std::cerr << "无法打开文件: " << path << std::endl;
+        return false;
+    }
+    std::vector<std::uint8_t> buffer(kCopyBufferSize);
+    for (;;) {
+        std::size_t n;
+        {
+            StatTimer timer(StatPhase::Read);
+            ifs.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+            n = static_cast<std::size_t>(ifs.gcount());
+            timer.addBytes(n);
+        }
+        if (n == 0) {
+            break;
+        }
+        if (!sink(buffer.data(), n)) {
+            return false;
+        }
+    }
+    if (ifs.bad()) {
+        std::cerr << "读取文件失败: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool FileUtils::hashFile(const std::filesystem::path& path, std::uint64_t& checksum,
+                         std::uint64_t* size, SparseMap* layout) {
+    ExtentReader reader;
+    if (!reader.open(path, layout != nullptr)) {
+        return false;
+    }
+    Xxh64 hasher;
+    std::uint64_t total = 0;
+    std::vector<std::uint8_t> buffer(kCopyBufferSize);
+    for (;;) {
+        std::int64_t n = reader.read(buffer.data(), buffer.size());
+        if (n < 0) {
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        hasher.update(buffer.data(), static_cast<std::size_t>(n));
+        total += static_cast<std::uint64_t>(n);
+    }
+    checksum = hasher.digest();
+    if (size) {
+        *size = total;
+    }
+    if (layout) {
+        *layout = reader.layout();
+    }
+    return true;
+}
+
 std::int64_t FileUtils::getFileSize(const std::filesystem::path& path) {
     try {
         if (std::filesystem::exists(path) && std::filesystem::is_regular_file(path)) {
@@ -72,6 +705,11 @@ std::filesystem::path FileUtils::getRelativePath(
     const std::filesystem::path& base, 
     const std::filesystem::path& path) {
     try {
+        // 使用词法计算：relative() 会解析符号链接，导致链接被记录成其目标的路径
+        auto rel = path.lexically_relative(base);
+        if (!rel.empty()) {
+            return rel;
+        }
         return std::filesystem::relative(path, base);
     } catch (const std::exception& e) {
         std::cerr << "计算相对路径失败: " << base << " / " << path 
@@ -80,5 +718,183 @@ std::filesystem::path FileUtils::getRelativePath(
     }
 }
 
-} // namespace backuprestore
+ExtentReader::~ExtentReader() {
+#ifndef _WIN32
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+#endif
+}
+
+bool ExtentReader::open(const std::filesystem::path& path, bool detect_holes, const SparseMap* layout) {
+    path_ = path;
+    range_ = 0;
+    pos_ = 0;
+#ifdef _WIN32
+    ifs_.close();
+    ifs_.clear();
+    ifs_.open(path, std::ios::binary);
+    if (!ifs_) {
+        std::cerr << "无法打开文件: " << path << std::endl;
+        return false;
+    }
+    std::error_code ec;
+    size_ = static_cast<std::uint64_t>(std::filesystem::file_size(path, ec));
+    layout_ = layout ? *layout : SparseMap();
+    (void)detect_holes;
+#else
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    fd_ = ::open(path.string().c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st{};
+    if (fd_ < 0 || ::fstat(fd_, &st) != 0) {
+        std::cerr << "无法打开文件: " << path << " - " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    size_ = static_cast<std::uint64_t>(st.st_size);
+    if (layout) {
+        layout_ = *layout;
+    } else if (detect_holes) {
+        FileUtils::probeExtents(fd_, size_, layout_);
+    } else {
+        layout_ = SparseMap();
+    }
+#endif
+    if (layout_.sparse) {
+        ranges_ = layout_.extents;
+    } else {
+        ranges_.assign(1, Extent{0, size_});
+    }
+    return true;
+}
+
+std::int64_t ExtentReader::read(std::uint8_t* buf, std::size_t n) {
+    StatTimer timer(StatPhase::Read);
+    std::size_t got = 0;
+    while (got < n && range_ < ranges_.size()) {
+        const Extent& extent = ranges_[range_];
+        if (pos_ >= extent.length) {
+            ++range_;
+            pos_ = 0;
+            continue;
+        }
+        std::size_t want = static_cast<std::size_t>(std::min<std::uint64_t>(n - got, extent.length - pos_));
+        const std::uint64_t offset = extent.offset + pos_;
+#ifdef _WIN32
+        ifs_.clear();
+        ifs_.seekg(static_cast<std::streamoff>(offset));
+        ifs_.read(reinterpret_cast<char*>(buf + got), static_cast<std::streamsize>(want));
+        std::int64_t r = static_cast<std::int64_t>(ifs_.gcount());
+        if (r == 0 && ifs_.bad()) {
+            std::cerr << "读取文件失败: " << path_ << std::endl;
+            return -1;
+        }
+#else
+        ssize_t r = ::pread(fd_, buf + got, want, static_cast<off_t>(offset));
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0) {
+            std::cerr << "读取文件失败: " << path_ << " - " << std::strerror(errno) << std::endl;
+            return -1;
+        }
+#endif
+        if (r == 0) {
+            range_ = ranges_.size();  // 文件比记录的短：到此为止，由调用方检查长度
+            break;
+        }
+        got += static_cast<std::size_t>(r);
+        pos_ += static_cast<std::uint64_t>(r);
+    }
+    timer.addBytes(got);
+    return static_cast<std::int64_t>(got);
+}
+
+ExtentMapper::ExtentMapper(const SparseMap& layout, Writer writer)
+    : layout_(layout), writer_(std::move(writer)) {
+}
+
+bool ExtentMapper::operator()(const std::uint8_t* data, std::size_t size) {
+    if (!layout_.sparse) {
+        if (size > 0 && !writer_(consumed_, data, size)) {
+            return false;
+        }
+        consumed_ += size;
+        return true;
+    }
+    while (size > 0) {
+        if (extent_ >= layout_.extents.size()) {
+            return false;  // 数据多于区段表
+        }
+        const Extent& extent = layout_.extents[extent_];
+        if (pos_ >= extent.length) {
+            ++extent_;
+            pos_ = 0;
+            continue;
+        }
+        std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(size, extent.length - pos_));
+        if (!writer_(extent.offset + pos_, data, n)) {
+            return false;
+        }
+        data += n;
+        size -= n;
+        pos_ += n;
+        consumed_ += n;
+    }
+    return true;
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
 
+bool MappedFile::open(const std::filesystem::path& path) {
+    close();
+#ifdef _WIN32
+    (void)path;
+    return false;
+#else
+    FdGuard fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    struct stat st{};
+    if (fd.fd < 0 || ::fstat(fd.fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        return false;
+    }
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd.fd, 0);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    // 顺序访问：内核加大预读，已读过的页可以尽早回收
+    ::madvise(map, size, MADV_SEQUENTIAL);
+    data_ = static_cast<const std::uint8_t*>(map);
+    size_ = static_cast<std::uint64_t>(size);
+    return true;
+#endif
+}
+
+void MappedFile::prefetch(std::uint64_t offset, std::uint64_t length) const {
+#ifdef _WIN32
+    (void)offset;
+    (void)length;
+#else
+    if (!data_ || offset >= size_) {
+        return;
+    }
+    // madvise 要求起点按页对齐
+    static const std::uint64_t page = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+    const std::uint64_t begin = offset - offset % page;
+    const std::uint64_t end = std::min(size_, offset + length);
+    ::madvise(const_cast<std::uint8_t*>(data_) + begin, static_cast<std::size_t>(end - begin), MADV_WILLNEED);
+#endif
+}
+
+void MappedFile::close() {
+#ifndef _WIN32
+    if (data_) {
+        ::munmap(const_cast<std::uint8_t*>(data_), static_cast<std::size_t>(size_));
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+} // namespace backuprestore
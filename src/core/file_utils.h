@@ -1,11 +1,176 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 #include <filesystem>
+#ifdef _WIN32
+#include <fstream>
+#endif
+#include "metadata/metadata.h"
 
 namespace backuprestore {
 
+/**
+ * @brief copyFile 实际使用的复制方式
+ */
+enum class CopyStrategy {
+    Reflink,        // FICLONE：共享数据块（XFS/Btrfs 等），几乎不产生 I/O
+    CopyFileRange,  // copy_file_range：内核内复制，可能由文件系统下推
+    Sendfile,       // sendfile：内核内复制，不经过用户态缓冲区
+    ReadWrite,      // 大缓冲区 read/write 循环
+    HardLink,       // 硬链接（仅在调用方允许且源文件不会再被修改时使用）
+    Symlink,        // 源为符号链接：重建链接本身
+    IoUring,        // 小文件整体读入后经 io_uring 批量写出（BatchIo）
+    Count
+};
+
+/**
+ * @brief 复制方式名称（用于统计输出）
+ */
+const char* copyStrategyName(CopyStrategy strategy);
+
+/**
+ * @brief 还原时的持久化策略
+ */
+enum class SyncPolicy {
+    None,        // 不主动同步，由内核择机写回
+    File,        // 每个文件关闭前 fdatasync，最后 fsync 各目录使目录项也落盘
+    Filesystem   // 全部写完后对目标文件系统执行一次 syncfs
+};
+
+/**
+ * @brief 持久化策略名称（none/file/fs）
+ */
+const char* syncPolicyName(SyncPolicy policy);
+
+/**
+ * @brief 按名称解析持久化策略
+ * @return 名称无效时返回 false
+ */
+bool parseSyncPolicy(const std::string& name, SyncPolicy& policy);
+
+/**
+ * @brief 数据接收回调：按顺序接收一段数据，返回 false 时中止
+ */
+using ByteSink = std::function<bool(const std::uint8_t* data, std::size_t size)>;
+
+/**
+ * @brief 按顺序读取文件的数据区段内容：空洞被跳过，不产生读 I/O
+ * 没有空洞或系统不支持 SEEK_DATA/SEEK_HOLE 时整个文件视为一个区段
+ */
+class ExtentReader {
+public:
+    ExtentReader() = default;
+    ~ExtentReader();
+
+    ExtentReader(const ExtentReader&) = delete;
+    ExtentReader& operator=(const ExtentReader&) = delete;
+
+    /**
+     * @brief 打开文件（可重复调用以读取下一个文件）
+     * @param detect_holes 是否探测空洞（false 时按稠密文件读取）
+     * @param layout 非空时按给定的布局读取（如索引中记录的区段表），不再探测
+     * @return 是否成功（失败时已输出错误信息）
+     */
+    bool open(const std::filesystem::path& path, bool detect_holes, const SparseMap* layout = nullptr);
+
+    /**
+     * @brief 文件的数据布局（open 之后有效）
+     */
+    const SparseMap& layout() const { return layout_; }
+
+    /**
+     * @brief 打开时的文件大小
+     */
+    std::uint64_t size() const { return size_; }
+
+    /**
+     * @brief 读取接下来最多 n 字节的数据，可跨区段
+     * @return 读取的字节数，0 表示已读完，-1 表示出错（已输出错误信息）
+     */
+    std::int64_t read(std::uint8_t* buf, std::size_t n);
+
+private:
+    std::filesystem::path path_;
+#ifdef _WIN32
+    std::ifstream ifs_;
+#else
+    int fd_ = -1;
+#endif
+    SparseMap layout_;
+    std::vector<Extent> ranges_;  // 实际要读取的区段（稠密文件为 [0, size)）
+    std::uint64_t size_ = 0;
+    std::size_t range_ = 0;       // 当前区段
+    std::uint64_t pos_ = 0;       // 当前区段内已读取的字节数
+};
+
+/**
+ * @brief 把按顺序到来的数据区段内容映射回文件中的偏移（ExtentReader 的逆过程）
+ * 稠密布局按顺序映射
+ */
+class ExtentMapper {
+public:
+    using Writer = std::function<bool(std::uint64_t offset, const std::uint8_t* data, std::size_t size)>;
+
+    ExtentMapper(const SparseMap& layout, Writer writer);
+
+    /**
+     * @brief 写入接下来的一段数据（可作为 ByteSink 使用）
+     * @return writer 失败或数据超出区段表时返回 false
+     */
+    bool operator()(const std::uint8_t* data, std::size_t size);
+
+    /**
+     * @brief 已写入的数据字节数
+     */
+    std::uint64_t consumed() const { return consumed_; }
+
+private:
+    const SparseMap& layout_;
+    Writer writer_;
+    std::size_t extent_ = 0;
+    std::uint64_t pos_ = 0;       // 当前区段内已写入的字节数
+    std::uint64_t consumed_ = 0;
+};
+
+/**
+ * @brief 只读映射整个文件（mmap + MADV_SEQUENTIAL），顺序处理大文件时直接读取页缓存，不再复制到读缓冲区
+ * 映射期间文件被截断时访问越界部分会触发 SIGBUS：只用于导出仓库等不会被并发修改的文件
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief 映射文件（可重复调用以映射下一个文件）
+     * @return 失败、空文件或平台不支持 mmap 时返回 false（不输出错误信息，调用方退回普通读取）
+     */
+    bool open(const std::filesystem::path& path);
+
+    /**
+     * @brief 解除映射
+     */
+    void close();
+
+    /**
+     * @brief 提示内核异步预读 [offset, offset+length)（MADV_WILLNEED），不等待读完
+     */
+    void prefetch(std::uint64_t offset, std::uint64_t length) const;
+
+    const std::uint8_t* data() const { return data_; }
+    std::uint64_t size() const { return size_; }
+
+private:
+    const std::uint8_t* data_ = nullptr;
+    std::uint64_t size_ = 0;
+};
+
 /**
  * @brief 文件工具类，提供文件操作的封装
  */
@@ -28,12 +193,136 @@ public:
 
     /**
      * @brief 复制文件
+     * 依次尝试 reflink -> copy_file_range -> sendfile -> read/write，前一种不被支持时
+     * 从已复制的位置继续用下一种；目标文件权限与源文件相同
      * @param from 源文件路径
      * @param to 目标文件路径
+     * @param create_parents 是否先创建目标的父目录（调用方已建好目录树时可关闭）
+     * @param allow_hardlink 是否优先创建硬链接（源与目标共享 inode，要求源文件之后不再修改）
+     * @param strategy 输出实际使用的复制方式（可为空）
      * @return 是否成功
      */
     static bool copyFile(const std::filesystem::path& from, 
-                         const std::filesystem::path& to);
+                         const std::filesystem::path& to,
+                         bool create_parents = true,
+                         bool allow_hardlink = false,
+                         CopyStrategy* strategy = nullptr);
+
+    /**
+     * @brief 复制已知为普通文件的 from（不检查源类型，用于扫描阶段已取得类型的备份流程）
+     * 目标的父目录须已存在；目标已存在时覆盖（已有的符号链接会被替换而不是写穿）
+     * @param allow_hardlink 是否优先创建硬链接，失败时退回复制
+     * @param strategy 输出实际使用的复制方式（可为空）
+     * @param checksum 非空时输出源文件数据区段的 XXH64（计算方式见 copyToFd；硬链接时单独读一遍源文件）
+     * @param layout 非空时输出源文件的数据布局；空洞在目标中保持为空洞
+     * @return 是否成功
+     */
+    static bool copyRegularFile(const std::filesystem::path& from,
+                                const std::filesystem::path& to,
+                                bool allow_hardlink = false,
+                                CopyStrategy* strategy = nullptr,
+                                std::uint64_t* checksum = nullptr,
+                                SparseMap* layout = nullptr);
+
+    /**
+     * @brief 按顺序读取文件内容交给 sink
+     * @return 文件无法读取或 sink 返回 false 时返回 false
+     */
+    static bool readFile(const std::filesystem::path& path, const ByteSink& sink);
+
+    /**
+     * @brief 计算文件内容的 XXH64
+     * @param size 输出读取的字节数（可为空）
+     * @param layout 非空时跳过空洞，只对数据区段计算，并输出数据布局
+     */
+    static bool hashFile(const std::filesystem::path& path, std::uint64_t& checksum,
+                         std::uint64_t* size = nullptr, SparseMap* layout = nullptr);
+
+    /**
+     * @brief 在 to 处创建指向 target 的符号链接，已存在的 to 先删除
+     * @return 是否成功
+     */
+    static bool createSymlink(const std::filesystem::path& target,
+                              const std::filesystem::path& to);
+
+#ifndef _WIN32
+    /**
+     * @brief 创建（或截断）普通文件并返回可写 fd，已有的符号链接会被替换而不是写穿
+     * 初始权限为 0600，最终权限由调用方在 fd 上设置
+     * @return fd，失败返回 -1（已输出错误信息）
+     */
+    static int openForWrite(const std::filesystem::path& to);
+
+    /**
+     * @brief 把 from 的数据复制到已打开的 out_fd（复制方式同 copyFile）
+     * 源文件有空洞时只复制数据区段，目标中的空洞由 ftruncate 留出
+     * @param to out_fd 对应的路径（仅用于错误信息）
+     * @param strategy 输出实际使用的复制方式（可为空）
+     * @param copy_mode 是否把源文件权限设置到 out_fd
+     * @param checksum 非空时输出数据区段的 XXH64：不小于 4 MiB 的文件仍用内核复制，同时由另一个线程
+     *                 读取源文件计算；源文件在复制期间被修改时改用 read/write 重新复制。
+     *                 更小的文件用 read/write 边复制边计算
+     * @param layout 非空时输出源文件的数据布局
+     */
+    static bool copyToFd(const std::filesystem::path& from, int out_fd,
+                         const std::filesystem::path& to, CopyStrategy* strategy = nullptr,
+                         bool copy_mode = false, std::uint64_t* checksum = nullptr,
+                         SparseMap* layout = nullptr);
+
+    /**
+     * @brief 把 from 的 [offset, offset + length) 复制到已存在的 to 的相同偏移（分段并行还原使用）
+     * from 与 to 各自单独打开，多个线程可同时复制同一文件的不同区段；依次尝试 copy_file_range -> sendfile -> read/write
+     * @param strategy 输出实际使用的复制方式（可为空）
+     */
+    static bool copyFileRange(const std::filesystem::path& from, const std::filesystem::path& to,
+                              std::uint64_t offset, std::uint64_t length, CopyStrategy* strategy = nullptr);
+
+    /**
+     * @brief 用 SEEK_DATA/SEEK_HOLE 探测 fd 的数据区段
+     * 已分配块数不少于文件大小（没有空洞）时不做探测；系统不支持时视为没有空洞
+     * @param size 文件大小
+     * @param layout 输出数据布局
+     */
+    static void probeExtents(int fd, std::uint64_t size, SparseMap& layout);
+
+    /**
+     * @brief 在指定偏移循环 pwrite 直到全部写入
+     * @param to fd 对应的路径（仅用于错误信息）
+     */
+    static bool pwriteAll(int fd, const void* data, std::size_t size, std::uint64_t offset,
+                          const std::filesystem::path& to);
+
+    /**
+     * @brief 设置文件长度（ftruncate），末尾未写入的部分成为空洞
+     */
+    static bool setFileSize(int fd, std::uint64_t size, const std::filesystem::path& to);
+
+    /**
+     * @brief 循环 write 直到全部写入
+     * @param to fd 对应的路径（仅用于错误信息）
+     */
+    static bool writeAll(int fd, const void* data, std::size_t size, const std::filesystem::path& to);
+
+    /**
+     * @brief 把 fd 的数据持久化（Linux 下为 fdatasync，其它系统为 fsync）
+     */
+    static bool syncFileData(int fd, const std::filesystem::path& to);
+
+    /**
+     * @brief 关闭写入用的 fd 并检查错误（延迟写入的错误可能在 close 时才报告）
+     */
+    static bool closeWritten(int fd, const std::filesystem::path& to);
+#endif
+
+    /**
+     * @brief fsync 目录本身，使其中新建的目录项持久化
+     */
+    static bool syncDirectory(const std::filesystem::path& dir);
+
+    /**
+     * @brief 同步 path 所在的整个文件系统（Linux 下为 syncfs，其它 POSIX 系统退回 sync）
+     */
+    static bool syncFilesystem(const std::filesystem::path& path);
 
     /**
      * @brief 获取文件大小
@@ -51,6 +340,16 @@ public:
     static std::filesystem::path getRelativePath(
         const std::filesystem::path& base, 
         const std::filesystem::path& path);
+
+private:
+    /**
+     * @brief 复制普通文件的数据（不处理符号链接和硬链接）
+     */
+    static bool copyFileData(const std::filesystem::path& from,
+                             const std::filesystem::path& to,
+                             CopyStrategy& strategy,
+                             std::uint64_t* checksum,
+                             SparseMap* layout);
 };
 
 } // namespace backuprestore
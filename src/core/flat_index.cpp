@@ -0,0 +1,404 @@
+#include "core/flat_index.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <sstream>
+
+namespace backuprestore {
+
+namespace {
+
+const std::uint32_t kFlagSymlink = 1u << 0;
+const std::uint32_t kFlagChunked = 1u << 1;
+const std::uint32_t kFlagChecksum = 1u << 2;
+const std::uint32_t kFlagPacked = 1u << 3;
+
+// 块列表与稀疏区段表，格式与 Metadata::serializeExtra() 中的对应字段相同
+std::string encodeExtra(const Metadata& m) {
+    if (!m.chunked && !m.layout.sparse) {
+        return std::string();
+    }
+    std::ostringstream oss;
+    if (m.chunked) {
+        oss << "chunks=";
+        for (std::size_t i = 0; i < m.chunks.size(); ++i) {
+            if (i > 0) oss << ",";
+            oss << m.chunks[i];
+        }
+    }
+    if (m.layout.sparse) {
+        if (m.chunked) oss << "\t";
+        oss << "sparse=";
+        for (std::size_t i = 0; i < m.layout.extents.size(); ++i) {
+            if (i > 0) oss << ",";
+            oss << m.layout.extents[i].offset << "+" << m.layout.extents[i].length;
+        }
+    }
+    return oss.str();
+}
+
+} // namespace
+
+std::string_view StringArena::store(std::string_view s) {
+    if (s.empty()) {
+        return std::string_view();
+    }
+    if (s.size() > left_) {
+        // 超过块大小的字符串单独占一块，不浪费当前块的剩余空间
+        std::size_t size = std::max(kBlockSize, s.size());
+        blocks_.emplace_back(new char[size]);
+        allocated_ += size;
+        if (size > kBlockSize) {
+            std::memcpy(blocks_.back().get(), s.data(), s.size());
+            return std::string_view(blocks_.back().get(), s.size());
+        }
+        cur_ = blocks_.back().get();
+        left_ = size;
+    }
+    std::memcpy(cur_, s.data(), s.size());
+    std::string_view stored(cur_, s.size());
+    cur_ += s.size();
+    left_ -= s.size();
+    return stored;
+}
+
+void StringArena::clear() {
+    blocks_.clear();
+    cur_ = nullptr;
+    left_ = 0;
+    allocated_ = 0;
+}
+
+FlatIndex::FlatIndex() {
+    dirs_.emplace_back();
+}
+
+void FlatIndex::clear() {
+    records_.clear();
+    sorted_count_ = 0;
+    pending_.clear();
+    dirs_.assign(1, Dir());
+    dir_ids_.clear();
+    interned_.clear();
+    arena_.clear();
+}
+
+std::string_view FlatIndex::intern(std::string_view s) {
+    if (s.empty()) {
+        return std::string_view();
+    }
+    auto it = interned_.find(s);
+    if (it != interned_.end()) {
+        return it->second;
+    }
+    std::string_view stored = arena_.store(s);
+    interned_.emplace(stored, stored);
+    return stored;
+}
+
+bool FlatIndex::findDir(const std::string& path, std::size_t& start, std::uint32_t& dir) const {
+    for (std::size_t slash = path.find('/', start); slash != std::string::npos; slash = path.find('/', start)) {
+        std::string_view component(path.data() + start, slash - start);
+        if (!component.empty()) {  // 连续的 '/' 忽略
+            auto it = dir_ids_.find(NameKey{dir, component});
+            if (it == dir_ids_.end()) {
+                return false;
+            }
+            dir = it->second;
+        }
+        start = slash + 1;
+    }
+    return true;
+}
+
+std::uint32_t FlatIndex::createDirs(const std::string& path, std::size_t& start, std::uint32_t dir) {
+    for (std::size_t slash = path.find('/', start); slash != std::string::npos; slash = path.find('/', start)) {
+        std::string_view component(path.data() + start, slash - start);
+        start = slash + 1;
+        if (component.empty()) {
+            continue;
+        }
+        auto it = dir_ids_.find(NameKey{dir, component});
+        if (it != dir_ids_.end()) {
+            dir = it->second;
+            continue;
+        }
+        Dir node;
+        node.parent = dir;
+        node.name = arena_.store(component);
+        dirs_.push_back(node);
+        dir = static_cast<std::uint32_t>(dirs_.size() - 1);
+        dir_ids_.emplace(NameKey{node.parent, node.name}, dir);
+    }
+    return dir;
+}
+
+void FlatIndex::assign(Record& r, const Metadata& m) {
+    r.symlink_target = intern(m.symlink_target);
+    r.compression = intern(m.compression);
+    r.hardlink = intern(m.hardlink);
+    r.extra = arena_.store(encodeExtra(m));
+    r.size = m.size;
+    r.mtime = static_cast<std::int64_t>(m.mtime);
+    r.checksum = m.checksum;
+    r.pack_offset = m.pack_offset;
+    r.pack_length = m.pack_length;
+    r.mtime_nsec = m.mtime_nsec;
+    r.mode = m.mode;
+    r.uid = m.uid;
+    r.gid = m.gid;
+    r.pack_segment = m.pack_segment;
+    r.delta_depth = m.delta_depth;
+    r.flags = 0;
+    if (m.is_symlink) r.flags |= kFlagSymlink;
+    if (m.chunked) r.flags |= kFlagChunked;
+    if (m.has_checksum) r.flags |= kFlagChecksum;
+    if (m.packed) r.flags |= kFlagPacked;
+}
+
+void FlatIndex::insert(const std::string& path, const Metadata& metadata) {
+    std::size_t start = 0;
+    std::uint32_t dir = 0;
+    if (!findDir(path, start, dir)) {
+        dir = createDirs(path, start, dir);
+    }
+    std::string_view name(path.data() + start, path.size() - start);
+
+    auto pending = pending_.find(NameKey{dir, name});
+    if (pending != pending_.end()) {
+        assign(records_[pending->second], metadata);
+        return;
+    }
+
+    std::string scratch;
+    std::size_t pos = lowerBound(path, scratch);
+    if (pos < sorted_count_) {
+        scratch.clear();
+        appendPath(pos, scratch);
+        if (scratch == path) {
+            assign(records_[pos], metadata);
+            return;
+        }
+    }
+
+    // 按序到达（大于所有已有条目）时直接成为有序部分的末尾
+    const bool ordered = sorted() && pos == sorted_count_;
+    Record record;
+    record.dir = dir;
+    record.name = arena_.store(name);
+    assign(record, metadata);
+    records_.push_back(record);
+    if (ordered) {
+        ++sorted_count_;
+    } else {
+        pending_.emplace(NameKey{dir, record.name}, static_cast<std::uint32_t>(records_.size() - 1));
+    }
+}
+
+bool FlatIndex::find(const std::string& path, Metadata& metadata) const {
+    std::size_t start = 0;
+    std::uint32_t dir = 0;
+    if (!findDir(path, start, dir)) {
+        return false;
+    }
+    std::string_view name(path.data() + start, path.size() - start);
+    auto pending = pending_.find(NameKey{dir, name});
+    if (pending != pending_.end()) {
+        return metadataAt(pending->second, metadata);
+    }
+    std::string scratch;
+    std::size_t pos = lowerBound(path, scratch);
+    if (pos >= sorted_count_) {
+        return false;
+    }
+    scratch.clear();
+    appendPath(pos, scratch);
+    return scratch == path && metadataAt(pos, metadata);
+}
+
+void FlatIndex::sort() {
+    if (sorted()) {
+        return;
+    }
+    // 所有路径拼接到一个缓冲区中比较，避免排序时反复沿目录表拼接
+    std::string paths;
+    std::vector<std::size_t> offsets(records_.size() + 1, 0);
+    for (std::size_t i = 0; i < records_.size(); ++i) {
+        appendPath(i, paths);
+        offsets[i + 1] = paths.size();
+    }
+    auto path = [&](std::uint32_t i) {
+        return std::string_view(paths.data() + offsets[i], offsets[i + 1] - offsets[i]);
+    };
+    auto less = [&](std::uint32_t a, std::uint32_t b) { return path(a) < path(b); };
+
+    std::vector<std::uint32_t> order(records_.size());
+    std::iota(order.begin(), order.end(), 0u);
+    auto middle = order.begin() + static_cast<std::ptrdiff_t>(sorted_count_);
+    std::sort(middle, order.end(), less);
+    std::inplace_merge(order.begin(), middle, order.end(), less);
+
+    std::vector<Record> records;
+    records.reserve(records_.size());
+    for (std::uint32_t i : order) {
+        records.push_back(records_[i]);
+    }
+    records_.swap(records);
+    sorted_count_ = records_.size();
+    pending_.clear();
+}
+
+void FlatIndex::appendDir(std::uint32_t dir, std::string& out) const {
+    if (dir == 0) {
+        return;
+    }
+    const Dir& node = dirs_[dir];
+    appendDir(node.parent, out);
+    out.append(node.name.data(), node.name.size());
+    out.push_back('/');
+}
+
+void FlatIndex::appendPath(std::size_t i, std::string& out) const {
+    const Record& r = records_[i];
+    appendDir(r.dir, out);
+    out.append(r.name.data(), r.name.size());
+}
+
+std::string FlatIndex::pathAt(std::size_t i) const {
+    std::string path;
+    appendPath(i, path);
+    return path;
+}
+
+std::size_t FlatIndex::lowerBound(const std::string& key, std::string& scratch) const {
+    std::size_t lo = 0;
+    std::size_t hi = sorted_count_;
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        scratch.clear();
+        appendPath(mid, scratch);
+        if (scratch < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+std::size_t FlatIndex::lowerBound(const std::string& key) const {
+    std::string scratch;
+    return lowerBound(key, scratch);
+}
+
+bool FlatIndex::metadataAt(std::size_t i, Metadata& m) const {
+    if (i >= records_.size()) {
+        return false;
+    }
+    const Record& r = records_[i];
+    // 先解析变长字段（同时清空其它扩展字段），再填写定长字段
+    if (!m.deserializeExtra(std::string(r.extra))) {
+        return false;
+    }
+    m.symlink_target.assign(r.symlink_target.data(), r.symlink_target.size());
+    m.compression.assign(r.compression.data(), r.compression.size());
+    m.hardlink.assign(r.hardlink.data(), r.hardlink.size());
+    m.size = r.size;
+    m.mtime = static_cast<std::time_t>(r.mtime);
+    m.mtime_nsec = r.mtime_nsec;
+    m.mode = r.mode;
+    m.uid = r.uid;
+    m.gid = r.gid;
+    m.is_symlink = (r.flags & kFlagSymlink) != 0;
+    // 块存储的空文件没有块，需要依赖标志位区分
+    m.chunked = (r.flags & kFlagChunked) != 0;
+    m.has_checksum = (r.flags & kFlagChecksum) != 0;
+    m.checksum = r.checksum;
+    m.packed = (r.flags & kFlagPacked) != 0;
+    m.pack_segment = r.pack_segment;
+    m.pack_offset = r.pack_offset;
+    m.pack_length = r.pack_length;
+    m.delta_depth = r.delta_depth;
+    return true;
+}
+
+std::size_t FlatIndex::removeIf(const std::function<bool(const std::string&, const Metadata&)>& remove) {
+    sort();
+    std::size_t kept = 0;
+    std::string path;
+    Metadata metadata;
+    for (std::size_t i = 0; i < records_.size(); ++i) {
+        path.clear();
+        appendPath(i, path);
+        if (metadataAt(i, metadata) && remove(path, metadata)) {
+            continue;
+        }
+        records_[kept++] = records_[i];
+    }
+    std::size_t removed = records_.size() - kept;
+    records_.resize(kept);
+    sorted_count_ = kept;
+    return removed;
+}
+
+std::string IndexView::path(std::size_t i) const {
+    return disk_ ? disk_->pathAt(begin_ + i) : flat_->pathAt(begin_ + i);
+}
+
+bool IndexView::metadata(std::size_t i, Metadata& metadata) const {
+    return disk_ ? disk_->metadataAt(begin_ + i, metadata) : flat_->metadataAt(begin_ + i, metadata);
+}
+
+IndexView IndexView::prefix(std::string prefix) const {
+    while (!prefix.empty() && prefix.back() == '/') {
+        prefix.pop_back();
+    }
+    if (prefix.empty()) {
+        return *this;
+    }
+    IndexView view = *this;
+    // 路径恰好为 prefix 的条目（文件或符号链接，此时不会有以它为目录的条目）
+    std::size_t exact = lowerBound(prefix);
+    if (exact < end_ && (disk_ ? disk_->pathAt(exact) : flat_->pathAt(exact)) == prefix) {
+        view.begin_ = exact;
+        view.end_ = exact + 1;
+        return view;
+    }
+    // 目录 prefix 之下：["prefix/", "prefix0")，'0' 是 '/' 之后的下一个字节
+    prefix.push_back('/');
+    view.begin_ = lowerBound(prefix);
+    prefix.back() = '/' + 1;
+    view.end_ = lowerBound(prefix);
+    return view;
+}
+
+std::size_t IndexView::lowerBound(const std::string& key) const {
+    std::size_t pos = disk_ ? disk_->lowerBound(key) : flat_ ? flat_->lowerBound(key) : 0;
+    return std::min(std::max(pos, begin_), end_);
+}
+
+IndexView::iterator::iterator(const IndexView& view, std::size_t pos)
+    : view_(&view), pos_(pos) {
+    if (pos_ < view_->end_) {
+        path_ = view_->disk_ ? view_->disk_->pathAt(pos_) : view_->flat_->pathAt(pos_);
+    }
+}
+
+IndexView::iterator& IndexView::iterator::operator++() {
+    ++pos_;
+    if (pos_ < view_->end_) {
+        load();
+    }
+    return *this;
+}
+
+void IndexView::iterator::load() {
+    if (view_->disk_) {
+        view_->disk_->decodePath(pos_, path_);
+    } else {
+        path_.clear();
+        view_->flat_->appendPath(pos_, path_);
+    }
+}
+
+} // namespace backuprestore
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "core/binary_index.h"
+#include "metadata/metadata.h"
+
+namespace backuprestore {
+
+/**
+ * @brief 只追加的字符串池：按块分配，已存入的字符串地址不变
+ */
+class StringArena {
+public:
+    /**
+     * @brief 复制 s 到池中，返回指向池内副本的视图
+     */
+    std::string_view store(std::string_view s);
+
+    /**
+     * @brief 释放所有块
+     */
+    void clear();
+
+    /**
+     * @brief 已分配的字节数（用于统计）
+     */
+    std::size_t capacity() const { return allocated_; }
+
+private:
+    static constexpr std::size_t kBlockSize = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* cur_ = nullptr;
+    std::size_t left_ = 0;
+    std::size_t allocated_ = 0;
+};
+
+/**
+ * @brief 内存中的扁平索引：按路径字节序排列的定长记录数组，取代 std::map<path, Metadata>
+ *
+ * - 路径拆成（所在目录, 文件名）：目录表中每个目录只保存一次（父目录 id, 名称）
+ * - 文件名、目录名保存在 StringArena 中；符号链接目标和压缩算法名去重后共享
+ * - 块列表和稀疏区段表等变长字段以 serializeExtra() 的文本格式存入池中，读取时解析
+ *
+ * 新条目按序到达时（如从磁盘索引加载）直接追加到有序部分；乱序到达时先追加到未排序的尾部，
+ * 由哈希表查找，sort() 时合并。被替换或删除的条目在池中的字符串直到 clear() 才释放。
+ * 不是线程安全的，由调用方加锁
+ */
+class FlatIndex {
+public:
+    FlatIndex();
+
+    /**
+     * @brief 条目数（含未排序的尾部）
+     */
+    std::size_t size() const { return records_.size(); }
+    bool empty() const { return records_.empty(); }
+
+    /**
+     * @brief 是否所有条目都已有序（按下标访问前必须为 true）
+     */
+    bool sorted() const { return sorted_count_ == records_.size(); }
+
+    /**
+     * @brief 清空条目、目录表和字符串池
+     */
+    void clear();
+
+    /**
+     * @brief 预留条目数
+     */
+    void reserve(std::size_t n) { records_.reserve(n); }
+
+    /**
+     * @brief 插入条目，路径已存在时替换其元数据
+     * @param path 相对路径，使用 '/' 分隔
+     */
+    void insert(const std::string& path, const Metadata& metadata);
+
+    /**
+     * @brief 按路径查找条目
+     * @return 是否找到
+     */
+    bool find(const std::string& path, Metadata& metadata) const;
+
+    /**
+     * @brief 把未排序的尾部合并进有序部分
+     */
+    void sort();
+
+    /**
+     * @brief 第一个路径 >= key 的条目下标（需已 sort），不存在时返回 size()
+     */
+    std::size_t lowerBound(const std::string& key) const;
+
+    /**
+     * @brief 第 i 个条目的路径（需已 sort）
+     */
+    std::string pathAt(std::size_t i) const;
+
+    /**
+     * @brief 把第 i 个条目的路径追加到 out
+     */
+    void appendPath(std::size_t i, std::string& out) const;
+
+    /**
+     * @brief 第 i 个条目的元数据
+     */
+    bool metadataAt(std::size_t i, Metadata& metadata) const;
+
+    /**
+     * @brief 删除 remove 返回 true 的条目（先 sort，按路径顺序依次询问）
+     * @return 删除的条目数
+     */
+    std::size_t removeIf(const std::function<bool(const std::string&, const Metadata&)>& remove);
+
+private:
+    // 一个条目：文件名在池中，所在目录为目录表下标；变长字段为池内的视图
+    struct Record {
+        std::string_view name;
+        std::string_view symlink_target;  // 去重后共享
+        std::string_view compression;     // 去重后共享
+        std::string_view hardlink;        // 去重后共享（同一 inode 的各链接指向同一条目）
+        std::string_view extra;           // 块列表与稀疏区段表（serializeExtra 格式）
+        std::uint64_t size = 0;
+        std::int64_t mtime = 0;
+        std::uint64_t checksum = 0;
+        std::uint64_t pack_offset = 0;
+        std::uint64_t pack_length = 0;
+        std::uint32_t dir = 0;
+        std::uint32_t mtime_nsec = 0;
+        std::uint32_t mode = 0;
+        std::uint32_t uid = 0;
+        std::uint32_t gid = 0;
+        std::uint32_t pack_segment = 0;
+        std::uint32_t delta_depth = 0;
+        std::uint32_t flags = 0;
+    };
+
+    // 目录表中的一个目录；下标 0 为根（名称为空）
+    struct Dir {
+        std::uint32_t parent = 0;
+        std::string_view name;
+    };
+
+    // (父目录, 名称)：既用于查找子目录，也用于查找未排序尾部中的条目
+    struct NameKey {
+        std::uint32_t parent;
+        std::string_view name;
+        bool operator==(const NameKey& other) const {
+            return parent == other.parent && name == other.name;
+        }
+    };
+    struct NameKeyHash {
+        std::size_t operator()(const NameKey& key) const {
+            return std::hash<std::string_view>()(key.name) * 31 + key.parent;
+        }
+    };
+
+    StringArena arena_;
+    std::vector<Dir> dirs_;
+    std::unordered_map<NameKey, std::uint32_t, NameKeyHash> dir_ids_;
+    std::unordered_map<std::string_view, std::string_view> interned_;
+    std::vector<Record> records_;   // [0, sorted_count_) 按路径有序，其后为未排序的新条目
+    std::size_t sorted_count_ = 0;
+    std::unordered_map<NameKey, std::uint32_t, NameKeyHash> pending_;  // 未排序尾部的条目下标
+
+    /**
+     * @brief 从 start 处沿目录表查找 path 的各级目录：全部存在时返回 true，start 移到文件名的起点；
+     * 否则返回 false，start 停在第一个不存在的目录组件，dir 为已找到的最深目录
+     */
+    bool findDir(const std::string& path, std::size_t& start, std::uint32_t& dir) const;
+
+    /**
+     * @brief 从 start 处逐级创建 path 剩余的目录，返回文件所在目录的 id
+     */
+    std::uint32_t createDirs(const std::string& path, std::size_t& start, std::uint32_t dir);
+
+    /**
+     * @brief 去重存储（符号链接目标、压缩算法名）
+     */
+    std::string_view intern(std::string_view s);
+
+    /**
+     * @brief 用元数据填写记录（名称和目录不变）
+     */
+    void assign(Record& record, const Metadata& metadata);
+
+    void appendDir(std::uint32_t dir, std::string& out) const;
+
+    /**
+     * @brief 在有序部分中查找 key，scratch 用于拼接路径
+     */
+    std::size_t lowerBound(const std::string& key, std::string& scratch) const;
+};
+
+/**
+ * @brief 索引的只读视图：按路径字节序排列的条目，按下标或迭代器访问，不复制路径列表
+ * 底层为 mmap 的 BinaryIndex 或内存中（已 sort）的 FlatIndex；索引修改或重新加载后失效。
+ * 可被多个线程同时读取
+ */
+class IndexView {
+public:
+    IndexView() = default;
+    explicit IndexView(const BinaryIndex& index) : disk_(&index), end_(index.size()) {}
+    explicit IndexView(const FlatIndex& index) : flat_(&index), end_(index.size()) {}
+
+    std::size_t size() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+
+    /**
+     * @brief 第 i 个条目的相对路径（'/' 分隔）
+     */
+    std::string path(std::size_t i) const;
+
+    /**
+     * @brief 第 i 个条目的元数据
+     */
+    bool metadata(std::size_t i, Metadata& metadata) const;
+
+    /**
+     * @brief 路径等于 prefix 或位于目录 prefix 之下的条目（prefix 末尾的 / 可省略，空串表示全部）
+     * 在有序索引上二分查找出连续的一段，不解析其余条目
+     */
+    IndexView prefix(std::string prefix) const;
+
+    /**
+     * @brief 视图中第一个路径 >= key 的条目下标（二分查找），不存在时返回 size()
+     */
+    std::size_t position(const std::string& key) const { return lowerBound(key) - begin_; }
+
+    /**
+     * @brief 顺序迭代器：解引用得到当前条目的路径，index() 为其在视图中的下标
+     * mmap 索引按序解码时复用前缀
+     */
+    class iterator {
+    public:
+        iterator(const IndexView& view, std::size_t pos);
+
+        const std::string& operator*() const { return path_; }
+        const std::string* operator->() const { return &path_; }
+        iterator& operator++();
+        bool operator==(const iterator& other) const { return pos_ == other.pos_; }
+        bool operator!=(const iterator& other) const { return pos_ != other.pos_; }
+        std::size_t index() const { return pos_ - view_->begin_; }
+
+    private:
+        const IndexView* view_;
+        std::size_t pos_;
+        std::string path_;
+
+        void load();
+    };
+
+    iterator begin() const { return iterator(*this, begin_); }
+    iterator end() const { return iterator(*this, end_); }
+
+private:
+    const BinaryIndex* disk_ = nullptr;
+    const FlatIndex* flat_ = nullptr;
+    std::size_t begin_ = 0;  // 底层索引中的起止下标
+    std::size_t end_ = 0;
+
+    /**
+     * @brief 底层索引中第一个路径 >= key 的下标，限制在 [begin_, end_] 内
+     */
+    std::size_t lowerBound(const std::string& key) const;
+};
+
+} // namespace backuprestore
@@ -0,0 +1,353 @@
+#include "core/io_scheduler.h"
+#include "core/thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#endif
+
+namespace backuprestore {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 每个文件折算的字节数（open/close/元数据），使小文件也计入吞吐量
+const std::uint64_t kFileCost = 64 * 1024;
+
+// 调优的观测窗口：窗口结束后按这段时间的吞吐量调整一次并发上限
+const Clock::duration kTuneWindow = std::chrono::milliseconds(200);
+
+// 旋转磁盘的初始并发上限：留一点队列深度给电梯调度，又不至于来回寻道
+const std::size_t kRotationalDepth = 2;
+
+// 吞吐量下降超过该比例时反向调整
+const double kTuneTolerance = 0.95;
+
+enum Lane { kSmallLane = 0, kLargeLane = 1 };
+
+struct Device {
+    std::size_t depth = 1;     // 当前并发上限
+    std::size_t inflight = 0;  // 正在进行的任务数
+    std::uint64_t cost = 0;    // 本窗口内完成的工作量
+    Clock::time_point window_start;
+    double last_rate = 0;
+    int direction = 1;
+};
+
+// 一个被切分的文件：所有区段结束后由最后一个区段调用 finish
+struct Split {
+    std::atomic<std::size_t> pending{0};
+    std::atomic<bool> ok{true};
+};
+
+struct Task {
+    enum Kind { Whole, Begin, Range } kind = Whole;
+    std::size_t index = 0;
+    std::uint64_t size = 0;
+    std::uint64_t offset = 0;
+    std::uint64_t length = 0;
+    std::shared_ptr<Split> split;
+};
+
+// 同一 (源设备, 目标设备) 的两条队列
+struct Route {
+    Device* src = nullptr;
+    Device* dst = nullptr;
+    std::deque<Task> lanes[2];
+};
+
+class SchedulerRun {
+public:
+    SchedulerRun(std::size_t jobs, bool auto_tune, std::uint64_t chunk_size,
+                 const std::function<void(std::size_t)>& fn, const IoScheduler::Splitter* splitter)
+        : jobs_(jobs), auto_tune_(auto_tune), chunk_size_(chunk_size), fn_(fn), splitter_(splitter) {}
+
+    void add(const Task& task, Lane lane, std::uint64_t src_dev, std::uint64_t dst_dev) {
+        auto key = std::make_pair(src_dev, dst_dev);
+        auto found = route_index_.find(key);
+        if (found == route_index_.end()) {
+            found = route_index_.emplace(key, routes_.size()).first;
+            routes_.emplace_back();
+            routes_.back().src = device(src_dev);
+            routes_.back().dst = device(dst_dev);
+        }
+        routes_[found->second].lanes[lane].push_back(task);
+        ++queued_;
+    }
+
+    // 大文件队列从大到小：最长的任务最先开始，尾部不会只剩一个大文件在跑
+    void sortLargeLanes() {
+        for (auto& route : routes_) {
+            std::stable_sort(route.lanes[kLargeLane].begin(), route.lanes[kLargeLane].end(),
+                             [](const Task& a, const Task& b) { return a.size > b.size; });
+        }
+    }
+
+    void run() {
+        const Clock::time_point now = Clock::now();
+        for (auto& entry : devices_) {
+            entry.second.window_start = now;
+        }
+        const std::size_t large_workers = std::max<std::size_t>(1, jobs_ / 4);
+        ThreadPool pool(jobs_);
+        for (std::size_t w = 0; w < jobs_; ++w) {
+            pool.submit([this, lane = w < large_workers ? kLargeLane : kSmallLane] { work(lane); });
+        }
+        pool.wait();
+    }
+
+private:
+    std::size_t jobs_;
+    bool auto_tune_;
+    std::uint64_t chunk_size_;
+    const std::function<void(std::size_t)>& fn_;
+    const IoScheduler::Splitter* splitter_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<std::uint64_t, Device> devices_;  // std::map：插入后元素地址不变
+    std::deque<Route> routes_;
+    std::map<std::pair<std::uint64_t, std::uint64_t>, std::size_t> route_index_;
+    std::size_t queued_ = 0;
+    std::size_t active_ = 0;
+    std::size_t next_route_ = 0;  // 轮转起点，各设备轮流得到空位
+
+    Device* device(std::uint64_t dev) {
+        auto found = devices_.find(dev);
+        if (found == devices_.end()) {
+            found = devices_.emplace(dev, Device()).first;
+            found->second.depth = IoScheduler::isRotational(dev) ? std::min(kRotationalDepth, jobs_) : jobs_;
+        }
+        return &found->second;
+    }
+
+    static bool hasRoom(const Route& route) {
+        return route.src->inflight < route.src->depth &&
+               (route.dst == route.src || route.dst->inflight < route.dst->depth);
+    }
+
+    // 先在自己的队列、再在另一条队列中找源/目标设备都有空位的任务（调用方持有锁）
+    bool take(Lane lane, Task& task, Route*& taken) {
+        for (Lane pass : {lane, lane == kSmallLane ? kLargeLane : kSmallLane}) {
+            for (std::size_t k = 0; k < routes_.size(); ++k) {
+                Route& route = routes_[(next_route_ + k) % routes_.size()];
+                std::deque<Task>& queue = route.lanes[pass];
+                if (queue.empty() || !hasRoom(route)) {
+                    continue;
+                }
+                task = std::move(queue.front());
+                queue.pop_front();
+                --queued_;
+                next_route_ = (next_route_ + k + 1) % routes_.size();
+                taken = &route;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(Lane lane) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            Task task;
+            Route* route = nullptr;
+            if (!take(lane, task, route)) {
+                // 正在运行的任务可能切分出新的区段，全部结束前不退出
+                if (queued_ == 0 && active_ == 0) {
+                    cv_.notify_all();
+                    return;
+                }
+                cv_.wait(lock);
+                continue;
+            }
+            ++active_;
+            ++route->src->inflight;
+            if (route->dst != route->src) {
+                ++route->dst->inflight;
+            }
+            lock.unlock();
+
+            const std::uint64_t cost = execute(task, route);
+
+            lock.lock();
+            --active_;
+            release(*route->src, cost);
+            if (route->dst != route->src) {
+                release(*route->dst, cost);
+            }
+            cv_.notify_all();
+        }
+    }
+
+    // 执行一个任务（不持有锁），返回计入吞吐量的工作量
+    std::uint64_t execute(Task& task, Route* route) {
+        try {
+            switch (task.kind) {
+                case Task::Whole:
+                    fn_(task.index);
+                    return task.size + kFileCost;
+                case Task::Begin:
+                    beginSplit(task, route);
+                    return kFileCost;
+                case Task::Range:
+                    finishRange(task, guarded([&] { return splitter_->range(task.index, task.offset, task.length); }));
+                    return task.length;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "I/O 任务异常: " << e.what() << std::endl;
+        }
+        return 0;
+    }
+
+    // 切分的各步骤抛出异常时按失败处理，保证 finish 恰好调用一次
+    static bool guarded(const std::function<bool()>& step) {
+        try {
+            return step();
+        } catch (const std::exception& e) {
+            std::cerr << "I/O 任务异常: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    // 切分：begin 成功后把各区段按顺序放到大文件队列最前面，尽快完成这个文件
+    void beginSplit(const Task& task, Route* route) {
+        if (!guarded([&] { return splitter_->begin(task.index); })) {
+            splitter_->finish(task.index, false);
+            return;
+        }
+        const std::uint64_t chunks = (task.size + chunk_size_ - 1) / chunk_size_;
+        auto split = std::make_shared<Split>();
+        split->pending = static_cast<std::size_t>(chunks);
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::deque<Task>& queue = route->lanes[kLargeLane];
+        for (std::uint64_t c = chunks; c-- > 0;) {
+            Task range;
+            range.kind = Task::Range;
+            range.index = task.index;
+            range.offset = c * chunk_size_;
+            range.length = std::min(chunk_size_, task.size - range.offset);
+            range.size = range.length;
+            range.split = split;
+            queue.push_front(std::move(range));
+        }
+        queued_ += static_cast<std::size_t>(chunks);
+    }
+
+    void finishRange(const Task& task, bool ok) {
+        if (!ok) {
+            task.split->ok = false;
+        }
+        if (task.split->pending.fetch_sub(1) == 1) {
+            splitter_->finish(task.index, task.split->ok.load());
+        }
+    }
+
+    // 任务结束：归还空位；窗口结束时按吞吐量的变化爬山调整一步（调用方持有锁）
+    void release(Device& dev, std::uint64_t cost) {
+        --dev.inflight;
+        if (!auto_tune_) {
+            return;
+        }
+        dev.cost += cost;
+        const Clock::time_point now = Clock::now();
+        const Clock::duration elapsed = now - dev.window_start;
+        if (elapsed < kTuneWindow) {
+            return;
+        }
+        const double rate = static_cast<double>(dev.cost) / std::chrono::duration<double>(elapsed).count();
+        if (dev.last_rate > 0 && rate < dev.last_rate * kTuneTolerance) {
+            dev.direction = -dev.direction;  // 上一步让吞吐下降了：往回走
+        }
+        if (dev.direction < 0 && dev.depth <= 1) {
+            dev.direction = 1;
+        } else if (dev.direction > 0 && dev.depth >= jobs_) {
+            dev.direction = -1;
+        }
+        dev.depth = dev.direction > 0 ? dev.depth + 1 : dev.depth - 1;
+        dev.last_rate = rate;
+        dev.cost = 0;
+        dev.window_start = now;
+    }
+};
+
+} // namespace
+
+IoScheduler::IoScheduler(std::size_t jobs) : jobs_(jobs == 0 ? ThreadPool::defaultThreads() : jobs) {
+}
+
+void IoScheduler::add(std::size_t index, std::uint64_t size, std::uint64_t src_dev, std::uint64_t dst_dev,
+                      bool splittable) {
+    items_.push_back(Item{index, size, src_dev, dst_dev, splittable});
+}
+
+void IoScheduler::run(const std::function<void(std::size_t)>& fn, const Splitter* splitter) {
+    auto splits = [&](const Item& item) {
+        return splitter && item.splittable && chunk_size_ > 0 && item.size >= 2 * chunk_size_;
+    };
+    // 只有一个任务时不必调度，除非它是要切成区段并行处理的大文件（如 restore --path 单个大文件）
+    if (jobs_ <= 1 || items_.empty() || (items_.size() == 1 && !splits(items_[0]))) {
+        for (const Item& item : items_) {
+            fn(item.index);
+        }
+        items_.clear();
+        return;
+    }
+
+    SchedulerRun run(jobs_, auto_tune_, chunk_size_, fn, splitter);
+    for (const Item& item : items_) {
+        Task task;
+        task.index = item.index;
+        task.size = item.size;
+        if (splits(item)) {
+            task.kind = Task::Begin;
+        }
+        run.add(task, item.size < small_limit_ ? kSmallLane : kLargeLane, item.src_dev, item.dst_dev);
+    }
+    items_.clear();
+    run.sortLargeLanes();
+    run.run();
+}
+
+std::uint64_t IoScheduler::deviceOf(const std::filesystem::path& path) {
+#ifdef _WIN32
+    (void)path;
+    return 0;
+#else
+    struct stat st{};
+    if (::stat(path.c_str(), &st) != 0) {
+        return 0;
+    }
+    return static_cast<std::uint64_t>(st.st_dev);
+#endif
+}
+
+bool IoScheduler::isRotational(std::uint64_t dev) {
+#ifdef __linux__
+    // 分区没有自己的 queue 目录，取所在磁盘的
+    const std::string base = "/sys/dev/block/" + std::to_string(major(static_cast<dev_t>(dev))) + ":" +
+                             std::to_string(minor(static_cast<dev_t>(dev)));
+    for (const char* queue : {"/queue/rotational", "/../queue/rotational"}) {
+        std::ifstream in(base + queue);
+        char flag = 0;
+        if (in >> flag) {
+            return flag == '1';
+        }
+    }
+#else
+    (void)dev;
+#endif
+    return false;
+}
+
+} // namespace backuprestore
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+namespace backuprestore {
+
+/**
+ * @brief 按文件大小与所在设备调度并行 I/O（并行备份/还原使用）
+ *
+ * - 两条队列：小文件（以元数据操作为主）按提交顺序处理，大文件按大小从大到小处理。
+ *   约四分之一的工作线程优先取大文件，其余优先取小文件，自己的队列空了才取另一条，
+ *   一个几十 GB 的文件不会挡住其后成千上万的小文件
+ * - 每个设备（st_dev）有自己的并发上限，任务的源设备和目标设备都有空位时才开始；
+ *   初始上限按设备类型：旋转磁盘为 2，其它（SSD/NVMe/tmpfs 等）为工作线程数
+ * - 自动调优：每个设备按观测到的吞吐量（字节数 + 每个文件折算的固定开销）爬山调整并发上限，
+ *   吞吐下降时反向，范围为 [1, 工作线程数]
+ * - 提供 Splitter 时，可切分的大文件按 chunk 大小切成区段，由多个线程并行处理
+ */
+class IoScheduler {
+public:
+    /**
+     * @brief 可切分任务的处理函数（均可在多个线程同时调用）
+     */
+    struct Splitter {
+        std::function<bool(std::size_t)> begin;  // 切分前调用一次（如创建目标文件）；返回 false 时不处理区段
+        std::function<bool(std::size_t, std::uint64_t, std::uint64_t)> range;  // 处理 [offset, offset + length)
+        std::function<void(std::size_t, bool)> finish;  // 所有区段结束后调用一次，ok 表示 begin 与所有区段都成功
+    };
+
+    static constexpr std::uint64_t kDefaultSmallFileLimit = 1024 * 1024;
+    static constexpr std::uint64_t kDefaultChunkSize = 64 * 1024 * 1024;
+
+    /**
+     * @brief 构造函数
+     * @param jobs 工作线程数（0 表示硬件并发数，1 表示在当前线程按提交顺序执行）
+     */
+    explicit IoScheduler(std::size_t jobs);
+
+    /**
+     * @brief 小于该大小的文件进入小文件队列（默认 1 MiB）
+     */
+    void setSmallFileLimit(std::uint64_t bytes) { small_limit_ = bytes; }
+
+    /**
+     * @brief 切分的区段大小（默认 64 MiB）；不小于两个区段的可切分任务才会切分，0 表示不切分
+     */
+    void setChunkSize(std::uint64_t bytes) { chunk_size_ = bytes; }
+
+    /**
+     * @brief 是否按吞吐量自动调整各设备的并发上限（默认开启）
+     */
+    void setAutoTune(bool enabled) { auto_tune_ = enabled; }
+
+    /**
+     * @brief 提交任务
+     * @param index 任务下标（传给处理函数）
+     * @param size 数据字节数
+     * @param src_dev 读取所在设备（st_dev）
+     * @param dst_dev 写入所在设备（st_dev）
+     * @param splittable 是否可以交给 Splitter 分段处理
+     */
+    void add(std::size_t index, std::uint64_t size, std::uint64_t src_dev, std::uint64_t dst_dev,
+             bool splittable = false);
+
+    /**
+     * @brief 处理所有已提交的任务，全部结束后返回
+     * @param fn 处理整个任务；不切分的任务（包括串行执行时的所有任务）都交给它
+     * @param splitter 非空时用于可切分的大任务
+     */
+    void run(const std::function<void(std::size_t)>& fn, const Splitter* splitter = nullptr);
+
+    /**
+     * @brief 工作线程数
+     */
+    std::size_t jobs() const { return jobs_; }
+
+    /**
+     * @brief 路径所在设备（st_dev），无法获取时返回 0
+     */
+    static std::uint64_t deviceOf(const std::filesystem::path& path);
+
+    /**
+     * @brief 设备是否为旋转磁盘（Linux 读取 /sys/dev/block/<major>:<minor>/queue/rotational）
+     * 不是块设备（tmpfs、overlay 等）或无法判断时返回 false
+     */
+    static bool isRotational(std::uint64_t dev);
+
+private:
+    struct Item {
+        std::size_t index;
+        std::uint64_t size;
+        std::uint64_t src_dev;
+        std::uint64_t dst_dev;
+        bool splittable;
+    };
+
+    std::size_t jobs_;
+    std::uint64_t small_limit_ = kDefaultSmallFileLimit;
+    std::uint64_t chunk_size_ = kDefaultChunkSize;
+    bool auto_tune_ = true;
+    std::vector<Item> items_;
+};
+
+} // namespace backuprestore
@@ -0,0 +1,133 @@
+#include "core/journal.h"
+#include "storage/xxhash64.h"
+#include <cstring>
+#include <iostream>
+
+namespace backuprestore {
+
+namespace {
+
+const char kMagic[8] = {'B', 'R', 'J', 'O', 'U', 'R', 'N', '1'};
+const std::size_t kRecordHeader = 12;  // u32 长度 + u64 XXH64
+
+void putLe(std::string& out, std::uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+std::uint64_t getLe(const char* p, int bytes) {
+    std::uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) v |= static_cast<std::uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    return v;
+}
+
+} // namespace
+
+bool BackupJournal::read(const std::filesystem::path& file,
+                         const std::function<void(const std::string&, const Metadata&)>& fn,
+                         std::uint64_t* valid_bytes) {
+    if (valid_bytes) {
+        *valid_bytes = 0;
+    }
+    std::error_code ec;
+    if (!std::filesystem::exists(file, ec)) {
+        return true;
+    }
+    std::ifstream in(file, std::ios::binary);
+    char magic[sizeof(kMagic)];
+    if (!in || !in.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+        std::cerr << "备份日志格式不匹配: " << file << std::endl;
+        return false;
+    }
+
+    const std::uint64_t size = std::filesystem::file_size(file, ec);
+    std::uint64_t valid = sizeof(kMagic);
+    char header[kRecordHeader];
+    std::string payload;
+    Metadata metadata;
+    while (in.read(header, sizeof(header))) {
+        std::uint32_t len = static_cast<std::uint32_t>(getLe(header, 4));
+        std::uint64_t hash = getLe(header + 4, 8);
+        if (ec || len < 4 || len > size - valid - sizeof(header)) {
+            break;  // 被中断的最后一批
+        }
+        payload.resize(len);
+        if (!in.read(&payload[0], len) || Xxh64::hash(payload.data(), payload.size()) != hash) {
+            break;
+        }
+        std::uint64_t path_len = getLe(payload.data(), 4);
+        if (path_len > len - 4 || !metadata.deserialize(payload.substr(4 + path_len))) {
+            break;
+        }
+        fn(payload.substr(4, path_len), metadata);
+        valid += sizeof(header) + len;
+    }
+    if (valid_bytes) {
+        *valid_bytes = valid;
+    }
+    return true;
+}
+
+bool BackupJournal::open(const std::filesystem::path& file) {
+    close();
+    file_ = file;
+
+    // 保留有效的记录，截掉被中断写入的尾部，之后的追加才能被读到
+    std::uint64_t valid = 0;
+    std::error_code ec;
+    bool reuse = std::filesystem::exists(file, ec) &&
+                 read(file, [](const std::string&, const Metadata&) {}, &valid);
+    if (reuse) {
+        std::filesystem::resize_file(file, valid, ec);
+        reuse = !ec;
+    }
+
+    out_.open(file, std::ios::binary | (reuse ? std::ios::app : std::ios::trunc));
+    if (!out_) {
+        std::cerr << "无法打开备份日志: " << file << std::endl;
+        return false;
+    }
+    if (!reuse) {
+        out_.write(kMagic, sizeof(kMagic));
+        out_.flush();
+    }
+    return static_cast<bool>(out_);
+}
+
+void BackupJournal::append(const std::string& path, const Metadata& metadata) {
+    std::string payload;
+    putLe(payload, path.size(), 4);
+    payload += path;
+    payload += metadata.serialize();
+    putLe(buffer_, payload.size(), 4);
+    putLe(buffer_, Xxh64::hash(payload.data(), payload.size()), 8);
+    buffer_ += payload;
+    ++buffered_;
+}
+
+bool BackupJournal::flush() {
+    if (!out_.is_open()) {
+        return false;
+    }
+    if (!buffer_.empty()) {
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        out_.flush();
+        buffer_.clear();
+        buffered_ = 0;
+    }
+    if (!out_) {
+        std::cerr << "写入备份日志失败: " << file_ << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void BackupJournal::close() {
+    if (out_.is_open()) {
+        out_.close();
+    }
+    out_.clear();
+    buffer_.clear();
+    buffered_ = 0;
+}
+
+} // namespace backuprestore
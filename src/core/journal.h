@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include "metadata/metadata.h"
+
+namespace backuprestore {
+
+/**
+ * @brief 备份日志（journal.bin）：记录本次备份中已存入仓库的条目，备份中断后据此续传
+ *
+ * 文件为 8 字节 magic "BRJOURN1" 加若干条记录，每条为
+ * [u32 长度][u64 XXH64][u32 路径长度][相对路径][Metadata::serialize()]（小端）。
+ * 条目先在内存中缓冲，flush 时一次写出；读取时遇到不完整或校验失败的记录即停止
+ * （进程被终止时最后一批可能只写了一半）。不 fsync：保证进程被终止后可续传，断电时最后几批可能丢失
+ */
+class BackupJournal {
+public:
+    /**
+     * @brief 每缓冲多少条记录写出一次
+     */
+    static constexpr std::size_t kBatchEntries = 256;
+
+    /**
+     * @brief 逐条读取日志中的有效记录
+     * @param valid_bytes 非空时输出有效部分的长度（之后的内容为损坏的尾部）
+     * @return 文件不存在时返回 true 且不调用 fn；无法读取或 magic 不符时返回 false
+     */
+    static bool read(const std::filesystem::path& file,
+                     const std::function<void(const std::string&, const Metadata&)>& fn,
+                     std::uint64_t* valid_bytes = nullptr);
+
+    /**
+     * @brief 打开日志准备追加：截掉损坏的尾部；不存在或无法识别时重新创建
+     * @return 是否成功
+     */
+    bool open(const std::filesystem::path& file);
+
+    bool isOpen() const { return out_.is_open(); }
+
+    /**
+     * @brief 追加一条记录到缓冲区
+     */
+    void append(const std::string& path, const Metadata& metadata);
+
+    /**
+     * @brief 缓冲区中尚未写出的记录数
+     */
+    std::size_t buffered() const { return buffered_; }
+
+    /**
+     * @brief 写出缓冲区
+     * @return 是否成功
+     */
+    bool flush();
+
+    /**
+     * @brief 丢弃缓冲区并关闭文件（需要保留的记录先 flush）
+     */
+    void close();
+
+private:
+    std::filesystem::path file_;
+    std::ofstream out_;
+    std::string buffer_;
+    std::size_t buffered_ = 0;
+};
+
+} // namespace backuprestore
@@ -0,0 +1,252 @@
+#include "core/package_restore.h"
+#include "core/file_utils.h"
+#include "core/stats.h"
+#include "core/thread_pool.h"
+#include "metadata/metadata.h"
+#include <iostream>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace backuprestore {
+
+namespace {
+
+// 临时仓库在目标目录下的名称（只放需要仓库读取逻辑的条目，还原结束后删除）
+const char kStagingDir[] = ".restore-package";
+
+// 仓库中的数据目录，包内条目的相对路径以它开头
+const std::string kDataPrefix = "data/";
+
+bool startsWith(const std::string& s, const char* prefix) {
+    return s.compare(0, std::char_traits<char>::length(prefix), prefix) == 0;
+}
+
+// 数据就是 data/ 下原样保存的文件内容，可以直接解码到目标位置
+bool isDirect(const Metadata& metadata) {
+    return !metadata.is_symlink && metadata.hardlink.empty() && !metadata.chunked && !metadata.packed &&
+           metadata.compression.empty() && metadata.delta_depth == 0;
+}
+
+} // namespace
+
+PackageRestore::PackageRestore(const std::filesystem::path& package_file) : package_file_(package_file) {
+}
+
+bool PackageRestore::extract(const pkg::EntryTargetFn& target, const pkg::EntryDoneFn& done) {
+    std::vector<std::string> failures;
+    pkg::extract_entries(package_file_, password_, target, done, failures, jobs_);
+    for (const auto& failure : failures) {
+        std::cerr << "解码包条目失败: " << failure << std::endl;
+    }
+    return failures.empty();
+}
+
+bool PackageRestore::execute(const std::filesystem::path& target_root) {
+    restore_count_ = 0;
+    failed_count_ = 0;
+    staged_count_ = 0;
+
+    if (pkg::is_stdio_path(package_file_)) {
+        std::cerr << "restore-package 需要先读取包中的索引，不支持从标准输入读取" << std::endl;
+        return false;
+    }
+    if (!FileUtils::createDirectories(target_root)) {
+        return false;
+    }
+    const std::filesystem::path staging = target_root / kStagingDir;
+    std::error_code ec;
+    std::filesystem::remove_all(staging, ec);
+
+    bool ok = false;
+    try {
+        ok = restoreFrom(staging, target_root);
+    } catch (const std::exception& e) {
+        std::cerr << "从包还原失败: " << e.what() << std::endl;
+    }
+    std::filesystem::remove_all(staging, ec);
+    return ok;
+}
+
+bool PackageRestore::restoreFrom(const std::filesystem::path& staging,
+                                 const std::filesystem::path& target_root) {
+    // 第一步：只解码仓库索引；两种格式都在时 loadIndex 优先使用 index.bin
+    extract([&](const pkg::TocItem& item) {
+        return item.relPath == "index.bin" || item.relPath == "index.txt" ? staging / item.relPath
+                                                                          : std::filesystem::path();
+    }, nullptr);
+    if (!std::filesystem::exists(staging / "index.bin") && !std::filesystem::exists(staging / "index.txt")) {
+        std::cerr << "包中没有可用的仓库索引（index.bin 或 index.txt）" << std::endl;
+        return false;
+    }
+    Repository repo(staging);
+    if (!repo.loadIndex()) {
+        std::cerr << "加载索引失败" << std::endl;
+        return false;
+    }
+    const IndexView files = repo.files();
+    std::cout << "包中仓库有 " << files.size() << " 个文件" << std::endl;
+
+    // 第二步：按存储方式分类，并一次性建好目录骨架
+    std::unordered_map<std::string, std::size_t> direct;  // 包内路径 data/<path> -> 视图下标
+    std::unordered_set<std::string> staged_data;          // 需要进临时仓库的 data/ 条目
+    std::vector<std::size_t> staged;
+    std::vector<std::size_t> symlinks;
+    std::vector<std::size_t> links;
+    bool need_chunks = false;
+    bool need_packs = false;
+    bool need_deltas = false;
+    std::vector<char> restored(files.size(), 0);
+    std::vector<char> failed(files.size(), 0);
+    std::set<std::filesystem::path> dirs;
+    {
+        Metadata metadata;
+        for (auto it = files.begin(); it != files.end(); ++it) {
+            const std::size_t i = it.index();
+            if (!files.metadata(i, metadata)) {
+                std::cerr << "读取索引条目失败: " << *it << std::endl;
+                failed[i] = 1;
+                continue;
+            }
+            for (auto dir = std::filesystem::path(*it).parent_path(); !dir.empty(); dir = dir.parent_path()) {
+                if (!dirs.insert(dir).second) {
+                    break;
+                }
+            }
+            if (metadata.is_symlink) {
+                symlinks.push_back(i);
+            } else if (!metadata.hardlink.empty()) {
+                links.push_back(i);
+            } else if (isDirect(metadata)) {
+                direct.emplace(kDataPrefix + *it, i);
+            } else {
+                staged.push_back(i);
+                need_chunks = need_chunks || metadata.chunked;
+                need_packs = need_packs || metadata.packed;
+                need_deltas = need_deltas || metadata.delta_depth > 0;
+                if (!metadata.chunked && !metadata.packed) {
+                    staged_data.insert(kDataPrefix + *it);
+                }
+            }
+        }
+    }
+    for (const auto& dir : dirs) {
+        std::error_code ec;
+        std::filesystem::create_directory(target_root / dir, ec);
+        if (ec) {
+            std::cerr << "创建目录失败: " << (target_root / dir) << " - " << ec.message() << std::endl;
+            return false;
+        }
+    }
+
+    // 第三步：镜像条目直接解码到最终位置，写完即应用元数据；其余条目需要的数据解码到临时仓库
+    // done 在解码的写出线程中依次调用，restored 只在这里修改
+    std::vector<char> found(files.size(), 0);
+    extract([&](const pkg::TocItem& item) {
+        auto it = direct.find(item.relPath);
+        if (it != direct.end()) {
+            found[it->second] = 1;
+            return target_root / std::filesystem::path(item.relPath.substr(kDataPrefix.size()));
+        }
+        if (staged_data.count(item.relPath) || (need_chunks && startsWith(item.relPath, "chunks/")) ||
+            (need_packs && startsWith(item.relPath, "packs/")) ||
+            (need_deltas && startsWith(item.relPath, "deltas/"))) {
+            return staging / item.relPath;
+        }
+        return std::filesystem::path();
+    }, [&](const pkg::TocItem& item, const std::filesystem::path& out) {
+        auto it = direct.find(item.relPath);
+        if (it == direct.end()) {
+            return;
+        }
+        Metadata metadata;
+        if (files.metadata(it->second, metadata) && !metadata.applyToFile(out)) {
+            std::cerr << "警告: 应用元数据失败: " << out << std::endl;
+        }
+        restored[it->second] = 1;
+    });
+    for (const auto& entry : direct) {
+        if (!found[entry.second]) {
+            std::cerr << "包中不存在文件: " << entry.first << std::endl;
+        }
+    }
+
+    // 第四步：其余条目用临时仓库的读取逻辑还原，再重建符号链接和硬链接
+    const std::size_t jobs = jobs_ == 0 ? ThreadPool::defaultThreads() : jobs_;
+    ThreadPool::parallelFor(staged.size(), jobs, [&](std::size_t k) {
+        const std::size_t i = staged[k];
+        const std::filesystem::path relative_path = files.path(i);
+        Metadata metadata;
+        LatencyTimer latency;
+        restored[i] = repo.restoreFileData(relative_path, target_root / relative_path, metadata) ? 1 : 0;
+    });
+    staged_count_ = staged.size();
+
+    for (std::size_t i : symlinks) {
+        Metadata metadata;
+        const std::filesystem::path target_path = target_root / files.path(i);
+        if (!files.metadata(i, metadata) || !FileUtils::createSymlink(metadata.symlink_target, target_path)) {
+            continue;
+        }
+        if (!metadata.applyToFile(target_path)) {
+            std::cerr << "警告: 应用元数据失败: " << target_path << std::endl;
+        }
+        restored[i] = 1;
+    }
+
+    if (!links.empty()) {
+        restoreHardLinks(files, links, target_root, restored);
+    }
+
+    for (char ok : restored) {
+        if (ok) {
+            restore_count_++;
+        } else {
+            failed_count_++;
+        }
+    }
+
+    std::cout << "还原完成: " << restore_count_ << " 个文件已还原, "
+              << failed_count_ << " 个文件失败" << std::endl;
+    if (staged_count_ > 0) {
+        std::cout << "其中 " << staged_count_ << " 个文件（压缩/段文件/块存储/差量）经临时仓库还原" << std::endl;
+    }
+    return failed_count_ == 0;
+}
+
+void PackageRestore::restoreHardLinks(const IndexView& files, const std::vector<std::size_t>& links,
+                                      const std::filesystem::path& target_root,
+                                      std::vector<char>& restored) {
+    Metadata metadata;
+    for (std::size_t i : links) {
+        const std::filesystem::path relative_path = files.path(i);
+        const std::filesystem::path target_path = target_root / relative_path;
+        if (!files.metadata(i, metadata)) {
+            continue;
+        }
+        // 数据所在的条目在有序索引中二分查找
+        const std::size_t pos = files.position(metadata.hardlink);
+        if (pos >= files.size() || files.path(pos) != metadata.hardlink || !restored[pos]) {
+            std::cerr << "还原文件失败: " << relative_path << " - 硬链接指向的条目未还原: "
+                      << metadata.hardlink << std::endl;
+            continue;
+        }
+        const std::filesystem::path anchor = target_root / metadata.hardlink;
+        std::error_code ec;
+        std::filesystem::remove(target_path, ec);
+        std::filesystem::create_hard_link(anchor, target_path, ec);
+        if (ec) {
+            // 属性由 inode 共享；复制时需要另外应用
+            std::cerr << "警告: 创建硬链接失败，改为复制数据: " << target_path << " - " << ec.message() << std::endl;
+            if (!FileUtils::copyFile(anchor, target_path)) {
+                continue;
+            }
+            if (!metadata.applyToFile(target_path)) {
+                std::cerr << "警告: 应用元数据失败: " << target_path << std::endl;
+            }
+        }
+        restored[i] = 1;
+    }
+}
+
+} // namespace backuprestore
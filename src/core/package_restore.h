@@ -0,0 +1,85 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "core/repository.h"
+#include "storage/package/package_export.h"
+
+namespace backuprestore {
+
+/**
+ * @brief 从单文件包直接还原目录树（restore-package）
+ * 先只解码包中的仓库索引（index.bin 或旧版 index.txt），再把 data/ 下的未压缩镜像条目
+ * 直接解码到目标目录的最终位置，每个文件写完即应用元数据，不经过中间仓库，数据只落盘一次。
+ * 压缩镜像、段文件、块存储和差量条目需要仓库的读取逻辑：只把它们用到的包条目解码到
+ * 目标目录下的临时仓库（.restore-package），还原后删除
+ */
+class PackageRestore {
+public:
+    /**
+     * @brief 构造函数
+     * @param package_file 包文件路径（需要可 seek，不支持标准输入）
+     */
+    explicit PackageRestore(const std::filesystem::path& package_file);
+
+    /**
+     * @brief 执行还原
+     * @param target_root 目标目录根路径
+     * @return 是否全部成功
+     */
+    bool execute(const std::filesystem::path& target_root);
+
+    /**
+     * @brief 设置解密密码（包被加密时必须）
+     */
+    void setPassword(const std::string& password) { password_ = password; }
+
+    /**
+     * @brief 设置分块包并行解码的线程数（0 表示硬件并发数）
+     */
+    void setJobs(std::size_t jobs) { jobs_ = jobs; }
+
+    /**
+     * @brief 获取还原的文件数量
+     */
+    std::size_t getRestoreCount() const { return restore_count_; }
+
+    /**
+     * @brief 获取失败的文件数量
+     */
+    std::size_t getFailedCount() const { return failed_count_; }
+
+    /**
+     * @brief 获取经临时仓库还原的文件数量
+     */
+    std::size_t getStagedCount() const { return staged_count_; }
+
+private:
+    std::filesystem::path package_file_;
+    std::string password_;
+    std::size_t jobs_ = 0;
+    std::size_t restore_count_ = 0;
+    std::size_t failed_count_ = 0;
+    std::size_t staged_count_ = 0;
+
+    /**
+     * @brief 在临时仓库 staging 中解出索引后按条目的存储方式还原（execute 负责创建与删除 staging）
+     */
+    bool restoreFrom(const std::filesystem::path& staging, const std::filesystem::path& target_root);
+
+    /**
+     * @brief 解码 target 选中的包条目，失败的条目逐个输出到 stderr
+     * @return 是否没有失败的条目
+     */
+    bool extract(const pkg::EntryTargetFn& target, const pkg::EntryDoneFn& done);
+
+    /**
+     * @brief 硬链接条目 files[links[k]] 链接到数据所在条目已还原的路径，无法链接时复制该文件
+     */
+    void restoreHardLinks(const IndexView& files, const std::vector<std::size_t>& links,
+                          const std::filesystem::path& target_root,
+                          std::vector<char>& restored);
+};
+
+} // namespace backuprestore
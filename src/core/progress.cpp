@@ -0,0 +1,98 @@
+#include "core/progress.h"
+#include <thread>
+
+namespace backuprestore {
+
+ProgressReporter::ProgressReporter(ProgressCallback* callback, std::chrono::milliseconds interval)
+    : callback_(callback),
+      interval_ns_(static_cast<std::uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count())) {
+}
+
+void ProgressReporter::start(std::size_t total_files, std::uint64_t total_bytes,
+                             const std::string& operation_name) {
+    done_.store(0, std::memory_order_relaxed);
+    failed_.store(0, std::memory_order_relaxed);
+    skipped_.store(0, std::memory_order_relaxed);
+    bytes_.store(0, std::memory_order_relaxed);
+    cancelled_.store(false, std::memory_order_relaxed);
+
+    total_files_ = total_files;
+    total_bytes_ = total_bytes;
+    start_ns_ = last_ns_ = now();
+    last_files_ = 0;
+    last_bytes_ = 0;
+    last_file_.clear();
+    next_emit_ns_.store(start_ns_ + interval_ns_, std::memory_order_relaxed);
+
+    if (callback_) {
+        callback_->onStart(total_files, operation_name);
+        cancelled_.store(callback_->shouldCancel(), std::memory_order_relaxed);
+    }
+}
+
+void ProgressReporter::tryEmit(const std::filesystem::path& current_file, bool force) {
+    if (force) {
+        // finish() 在工作线程结束后调用，通常不会等待
+        while (emitting_.exchange(true, std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    } else if (emitting_.exchange(true, std::memory_order_acquire)) {
+        return;  // 其它线程正在发送
+    }
+
+    const std::uint64_t t = now();
+    if (force || t >= next_emit_ns_.load(std::memory_order_relaxed)) {
+        if (!current_file.empty()) {
+            last_file_ = current_file;
+        }
+
+        ProgressEvent event;
+        event.current_file = last_file_;
+        event.failed = failed_.load(std::memory_order_relaxed);
+        event.skipped = skipped_.load(std::memory_order_relaxed);
+        event.files_done = done_.load(std::memory_order_relaxed) + event.failed + event.skipped;
+        event.files_total = total_files_;
+        event.bytes_done = bytes_.load(std::memory_order_relaxed);
+        event.bytes_total = total_bytes_;
+        if (total_bytes_ > 0) {
+            event.percentage = event.bytes_done * 100.0 / total_bytes_;
+        } else if (total_files_ > 0) {
+            event.percentage = event.files_done * 100.0 / total_files_;
+        } else {
+            event.percentage = 100.0;
+        }
+        if (event.percentage > 100.0) {
+            event.percentage = 100.0;  // 文件在备份期间变大
+        }
+        event.elapsed_seconds = (t - start_ns_) / 1e9;
+        if (t > last_ns_) {
+            const double window = (t - last_ns_) / 1e9;
+            event.files_per_second = (event.files_done - last_files_) / window;
+            event.bytes_per_second = (event.bytes_done - last_bytes_) / window;
+        }
+        last_ns_ = t;
+        last_files_ = event.files_done;
+        last_bytes_ = event.bytes_done;
+
+        callback_->onProgressUpdate(event);
+        if (callback_->shouldCancel()) {
+            cancelled_.store(true, std::memory_order_relaxed);
+        }
+        next_emit_ns_.store(now() + interval_ns_, std::memory_order_relaxed);
+    }
+    emitting_.store(false, std::memory_order_release);
+}
+
+void ProgressReporter::finish(bool success) {
+    if (!callback_) {
+        return;
+    }
+    tryEmit({}, true);
+    const std::size_t failed = failed_.load(std::memory_order_relaxed);
+    const std::size_t skipped = skipped_.load(std::memory_order_relaxed);
+    callback_->onComplete(done_.load(std::memory_order_relaxed), failed, skipped,
+                          success && !cancelled());
+}
+
+} // namespace backuprestore
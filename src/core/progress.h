@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include "gui/gui_interface.h"
+
+namespace backuprestore {
+
+/**
+ * @brief 进度汇总器：工作线程只做 relaxed 原子累加，按固定频率向 ProgressCallback 发出合并后的事件
+ *
+ * 每处理完一个文件调用 fileDone/fileFailed/fileSkipped，再调用 poll()；
+ * poll() 只比较一次时钟，到期时由抢到发送权的一个线程发出 onProgressUpdate 并检查 shouldCancel()，
+ * 其它线程直接返回。回调因此不会被并发调用，取消状态在一个上报周期内生效
+ */
+class ProgressReporter {
+public:
+    static constexpr std::chrono::milliseconds kDefaultInterval{100};
+
+    /**
+     * @brief 构造函数
+     * @param callback 进度回调（可为 nullptr，此时所有调用都是空操作）
+     * @param interval 两次进度事件之间的最短间隔（默认 100ms，即 10 Hz）
+     */
+    explicit ProgressReporter(ProgressCallback* callback,
+                              std::chrono::milliseconds interval = kDefaultInterval);
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+    /**
+     * @brief 开始一次操作：清零计数并调用 onStart
+     * @param total_bytes 总字节数（未知时为 0，百分比按文件数计算）
+     */
+    void start(std::size_t total_files, std::uint64_t total_bytes, const std::string& operation_name);
+
+    /**
+     * @brief 一个文件处理成功
+     */
+    void fileDone(std::uint64_t bytes) {
+        done_.fetch_add(1, std::memory_order_relaxed);
+        bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 一个文件处理失败
+     */
+    void fileFailed() { failed_.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief 一个文件被跳过
+     */
+    void fileSkipped() { skipped_.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief 到达上报时间时发出进度事件并检查取消（任意线程均可调用）
+     * @param current_file 调用线程正在处理或刚处理完的文件，到期时作为事件的当前文件
+     * @return 是否已取消
+     */
+    bool poll(const std::filesystem::path& current_file) {
+        if (!callback_) {
+            return false;
+        }
+        if (now() >= next_emit_ns_.load(std::memory_order_relaxed)) {
+            tryEmit(current_file, false);
+        }
+        return cancelled();
+    }
+
+    /**
+     * @brief 是否已取消（只读取缓存的状态，不调用回调）
+     */
+    bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 结束操作：立即发出最后一个进度事件，再调用 onComplete
+     */
+    void finish(bool success);
+
+private:
+    ProgressCallback* callback_;
+    std::uint64_t interval_ns_;
+
+    // 工作线程累加的计数单独占一个缓存行，发送状态不与它们共享
+    alignas(64) std::atomic<std::size_t> done_{0};
+    std::atomic<std::size_t> failed_{0};
+    std::atomic<std::size_t> skipped_{0};
+    std::atomic<std::uint64_t> bytes_{0};
+
+    alignas(64) std::atomic<std::uint64_t> next_emit_ns_{0};
+    std::atomic<bool> emitting_{false};
+    std::atomic<bool> cancelled_{false};
+
+    // 以下只由持有发送权的线程访问
+    std::size_t total_files_ = 0;
+    std::uint64_t total_bytes_ = 0;
+    std::uint64_t start_ns_ = 0;
+    std::uint64_t last_ns_ = 0;
+    std::size_t last_files_ = 0;
+    std::uint64_t last_bytes_ = 0;
+    std::filesystem::path last_file_;
+
+    static std::uint64_t now() {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    /**
+     * @brief 抢占发送权并发出事件；force 为 false 时重新检查是否到期
+     */
+    void tryEmit(const std::filesystem::path& current_file, bool force);
+};
+
+} // namespace backuprestore
@@ -0,0 +1,63 @@
+#include "core/prune.h"
+#include <ctime>
+#include <iostream>
+
+namespace backuprestore {
+
+Prune::Prune(std::shared_ptr<Repository> repo) : repo_(repo) {
+}
+
+bool Prune::execute() {
+    deleted_count_ = 0;
+    removed_chunks_ = 0;
+    removed_segments_ = 0;
+    removed_bytes_ = 0;
+
+    auto snapshots = repo_->listSnapshots();
+    for (const auto& name : delete_names_) {
+        bool found = false;
+        for (const auto& snapshot : snapshots) {
+            found = found || snapshot.name == name;
+        }
+        if (!found) {
+            std::cerr << "快照不存在: " << name << std::endl;
+            return false;
+        }
+    }
+
+    // 没有保留规则时只删除明确指定的快照；有规则时删除不被任何规则保留的快照
+    const bool has_rules = keep_last_ > 0 || keep_within_ > 0;
+    const std::time_t now = std::time(nullptr);
+    bool ok = true;
+    for (std::size_t i = 0; i < snapshots.size(); ++i) {
+        const auto& snapshot = snapshots[i];
+        bool remove = delete_names_.count(snapshot.name) > 0;
+        if (!remove && has_rules) {
+            // snapshots 按创建时间从旧到新排列
+            bool recent = keep_last_ > 0 && snapshots.size() - i <= keep_last_;
+            bool within = keep_within_ > 0 && now - snapshot.created < keep_within_;
+            remove = !recent && !within;
+        }
+        if (!remove) {
+            continue;
+        }
+        if (repo_->deleteSnapshot(snapshot.name)) {
+            std::cout << "已删除快照: " << snapshot.name << std::endl;
+            deleted_count_++;
+        } else {
+            ok = false;
+        }
+    }
+
+    if (!repo_->collectGarbage(removed_chunks_, removed_segments_, removed_bytes_)) {
+        std::cerr << "回收未引用的数据失败" << std::endl;
+        return false;
+    }
+
+    std::cout << "清理完成: 删除 " << deleted_count_ << " 个快照, 回收 "
+              << removed_chunks_ << " 个块、" << removed_segments_ << " 个段文件 ("
+              << removed_bytes_ << " 字节)" << std::endl;
+    return ok;
+}
+
+} // namespace backuprestore
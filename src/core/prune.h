@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include "core/repository.h"
+
+namespace backuprestore {
+
+/**
+ * @brief 快照清理操作类
+ * 按保留规则删除快照清单，再回收所有快照和当前索引都不再引用的块
+ */
+class Prune {
+public:
+    /**
+     * @brief 构造函数
+     * @param repo 备份仓库
+     */
+    explicit Prune(std::shared_ptr<Repository> repo);
+
+    /**
+     * @brief 执行清理
+     * @return 是否成功
+     */
+    bool execute();
+
+    /**
+     * @brief 保留最新的 n 个快照（0 表示不按数量保留）
+     */
+    void setKeepLast(std::size_t n) { keep_last_ = n; }
+
+    /**
+     * @brief 保留最近 seconds 秒内创建的快照（0 表示不按时间保留）
+     */
+    void setKeepWithin(std::int64_t seconds) { keep_within_ = seconds; }
+
+    /**
+     * @brief 明确删除一个快照（不受保留规则影响）
+     */
+    void addDelete(const std::string& name) { delete_names_.insert(name); }
+
+    /**
+     * @brief 获取删除的快照数量
+     */
+    std::size_t getDeletedCount() const { return deleted_count_; }
+
+    /**
+     * @brief 获取回收的块数量/段文件数量/字节数
+     */
+    std::size_t getRemovedChunks() const { return removed_chunks_; }
+    std::size_t getRemovedSegments() const { return removed_segments_; }
+    std::uint64_t getRemovedBytes() const { return removed_bytes_; }
+
+private:
+    std::shared_ptr<Repository> repo_;
+    std::size_t keep_last_ = 0;
+    std::int64_t keep_within_ = 0;
+    std::set<std::string> delete_names_;
+    std::size_t deleted_count_ = 0;
+    std::size_t removed_chunks_ = 0;
+    std::size_t removed_segments_ = 0;
+    std::uint64_t removed_bytes_ = 0;
+};
+
+} // namespace backuprestore
@@ -1,15 +1,31 @@
 #include "core/repository.h"
 #include "core/file_utils.h"
+#include "core/stats.h"
+#include "storage/xxhash64.h"
+#include <sys/stat.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
 
 namespace backuprestore {
 
 Repository::Repository(const std::filesystem::path& repo_path)
     : repo_path_(repo_path),
       data_dir_(repo_path / "data"),
-      index_file_(repo_path / "index.txt") {
+      index_file_(repo_path / "index.bin"),
+      legacy_index_file_(repo_path / "index.txt"),
+      snapshots_dir_(repo_path / "snapshots"),
+      journal_file_(repo_path / "journal.bin"),
+      chunk_store_(repo_path / "chunks"),
+      pack_store_(repo_path / "packs"),
+      delta_store_(repo_path / "deltas") {
 }
 
 bool Repository::initialize() {
@@ -24,25 +40,289 @@ bool Repository::initialize() {
 }
 
 std::filesystem::path Repository::getStoragePath(const std::filesystem::path& relative_path) const {
-    // 将相对路径转换为仓库中的存储路径
-    // 使用相对路径本身作为存储路径（可以添加哈希等优化）
+    // 镜像模式：使用相对路径本身作为存储路径
+    // 按内容去重的存储见 ChunkStore（setChunking）
     return data_dir_ / relative_path;
 }
 
+bool Repository::storeMirror(const std::filesystem::path& source_path,
+                             const std::filesystem::path& storage_path,
+                             const Metadata& metadata,
+                             std::uint64_t* checksum,
+                             SparseMap* layout) {
+    if (!ensureDirectory(storage_path.parent_path())) {
+        return false;
+    }
+    CopyStrategy strategy = CopyStrategy::Symlink;
+    if (metadata.is_symlink) {
+        if (!FileUtils::createSymlink(metadata.symlink_target, storage_path)) {
+            return false;
+        }
+    } else if (!FileUtils::copyRegularFile(source_path, storage_path, hardlink_, &strategy,
+                                           checksum, layout)) {
+        return false;
+    }
+    copy_counts_[static_cast<std::size_t>(strategy)].fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool Repository::shouldPack(const Metadata& metadata) const {
+    return !chunking_ && pack_threshold_ > 0 && !metadata.is_symlink && metadata.size < pack_threshold_;
+}
+
+bool Repository::shouldDelta(const Metadata& metadata) const {
+    // 差量对照未压缩的镜像计算；硬链接的镜像会随源文件一起变化，没有可对照的上一版本
+    return !chunking_ && !compressing_ && !hardlink_ && delta_threshold_ > 0 && !metadata.is_symlink &&
+           metadata.size >= delta_threshold_ && !shouldPack(metadata);
+}
+
+bool Repository::storeDelta(const std::filesystem::path& source_path,
+                            const std::filesystem::path& relative_path,
+                            Metadata& stored) {
+    const std::string key = relative_path.generic_string();
+    const auto storage_path = getStoragePath(relative_path);
+    ExtentReader reader;
+    if (!reader.open(source_path, true)) {
+        return false;
+    }
+    if (reader.layout().sparse) {
+        // 差量按稠密内容计算：稀疏文件仍存为保留空洞的镜像
+        delta_store_.remove(key);
+        return storeMirror(source_path, storage_path, stored,
+                           stored.has_checksum ? &stored.checksum : nullptr, &stored.layout);
+    }
+
+    Metadata previous;
+    bool chained;
+    {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        chained = getMetadata(relative_path, previous);
+    }
+    std::error_code ec;
+    chained = chained && !previous.chunked && !previous.packed && !previous.is_symlink &&
+              previous.compression.empty() && !previous.layout.sparse && previous.has_checksum &&
+              previous.delta_depth < max_delta_depth_ &&
+              std::filesystem::exists(storage_path, ec) &&
+              delta_store_.hasSignature(key, previous.delta_depth, previous.size, previous.checksum);
+
+    // 差量存储总是记录校验和：下一个版本据此确认签名对应索引中的版本
+    stored.has_checksum = true;
+    if (chained) {
+        stored.delta_depth = previous.delta_depth;
+        return delta_store_.storeDelta(reader, key, stored.delta_depth, stored.checksum);
+    }
+    if (!ensureDirectory(storage_path.parent_path())) {
+        return false;
+    }
+    stored.delta_depth = 0;
+    return delta_store_.storeBase(reader, key, storage_path, stored.checksum);
+}
+
+bool Repository::storePacked(const std::filesystem::path& source_path,
+                             const std::filesystem::path& relative_path,
+                             Metadata& stored,
+                             std::uint64_t* checksum) {
+    // 小文件一次读完；段中记录的名称即仓库中的相对路径
+    thread_local std::vector<std::uint8_t> data;
+    data.clear();
+    data.reserve(static_cast<std::size_t>(stored.size));
+    bool ok = FileUtils::readFile(source_path, [&](const std::uint8_t* p, std::size_t n) {
+        data.insert(data.end(), p, p + n);
+        return true;
+    });
+    if (!ok) {
+        return false;
+    }
+    if (checksum) {
+        *checksum = Xxh64::hash(data.data(), data.size());
+    }
+    return appendPacked(data.data(), data.size(), relative_path, stored);
+}
+
+bool Repository::appendPacked(const std::uint8_t* data, std::size_t size,
+                              const std::filesystem::path& relative_path,
+                              Metadata& stored) {
+    thread_local std::vector<std::uint8_t> compressed;
+    if (stored.compression == "lz") {
+        compressor_.compressBuffer(data, size, compressed);
+        data = compressed.data();
+        size = compressed.size();
+    }
+    PackLocation location;
+    if (!pack_store_.append(relative_path.generic_string(), data, size, location)) {
+        return false;
+    }
+    stored.packed = true;
+    stored.pack_segment = location.segment;
+    stored.pack_offset = location.offset;
+    stored.pack_length = location.length;
+    return true;
+}
+
+bool Repository::ensureDirectory(const std::filesystem::path& dir) {
+    std::lock_guard<std::mutex> lock(dirs_mutex_);
+    if (known_dirs_.count(dir.native()) > 0) {
+        return true;
+    }
+    if (!FileUtils::createDirectories(dir)) {
+        return false;
+    }
+    known_dirs_.insert(dir.native());
+    return true;
+}
+
+bool Repository::copyData(const std::filesystem::path& from, const std::filesystem::path& to,
+                          bool create_parents, bool allow_hardlink) const {
+    CopyStrategy strategy = CopyStrategy::ReadWrite;
+    if (!FileUtils::copyFile(from, to, create_parents, allow_hardlink, &strategy)) {
+        return false;
+    }
+    copy_counts_[static_cast<std::size_t>(strategy)].fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+std::string Repository::copyStatsSummary() const {
+    std::string summary;
+    for (std::size_t i = 0; i < copy_counts_.size(); ++i) {
+        std::size_t n = copy_counts_[i].load(std::memory_order_relaxed);
+        if (n == 0) {
+            continue;
+        }
+        if (!summary.empty()) {
+            summary += ", ";
+        }
+        summary += copyStrategyName(static_cast<CopyStrategy>(i));
+        summary += " " + std::to_string(n);
+    }
+    return summary;
+}
+
+std::string Repository::compressionFor(const Metadata& metadata) const {
+    // 符号链接在镜像中仍以链接形式保存，不压缩
+    if (chunking_ || !compressing_ || metadata.is_symlink) {
+        return "";
+    }
+    return "lz";
+}
+
+Metadata Repository::prepareStored(const Metadata& metadata) const {
+    Metadata stored = metadata;
+    stored.compression = compressionFor(metadata);
+    // 校验和在存储路径读取源文件时一并计算，不额外读一遍
+    stored.has_checksum = checksums_ && !stored.is_symlink;
+    stored.checksum = 0;
+    // 稀疏文件只存数据区段，区段表记录在元数据中，恢复时据此重建空洞
+    stored.layout = SparseMap();
+    stored.chunked = chunking_;
+    stored.chunks.clear();
+    stored.packed = false;
+    stored.delta_depth = 0;
+    return stored;
+}
+
+void Repository::commitStored(const std::filesystem::path& relative_path, Metadata&& stored) {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    materialize();
+    const std::string key = relative_path.generic_string();
+    Metadata previous;
+    if (!stored.chunked && index_.find(key, previous) && !previous.chunked && !previous.packed &&
+        previous.hardlink.empty()) {
+        const bool linked = !stored.hardlink.empty();
+        if (stored.packed || linked) {
+            // 之前存放在 data/ 镜像中：已改存到段文件或成为硬链接条目，删除旧镜像
+            std::error_code ec;
+            std::filesystem::remove(getStoragePath(relative_path), ec);
+        }
+        if (previous.delta_depth > 0 && stored.delta_depth == 0 && (linked || !shouldDelta(stored))) {
+            // 不再按差量存储（如关闭了 --delta）：镜像已是完整的新版本，旧的差量链失效
+            delta_store_.remove(key);
+        }
+    }
+    index_.insert(key, stored);
+    dir_stats_valid_ = false;
+    if (journal_.isOpen()) {
+        journal_.append(key, stored);
+        if (journal_.buffered() >= BackupJournal::kBatchEntries) {
+            flushJournal();
+        }
+    }
+}
+
+void Repository::flushJournal() {
+    // 日志中的段文件记录必须在段数据写出之后才可见
+    if (!pack_store_.flush() || !journal_.flush()) {
+        std::cerr << "警告: 备份日志写入失败，本次备份中断后将无法续传" << std::endl;
+        journal_.close();
+    }
+}
+
+bool Repository::beginJournal(std::size_t& resumed) {
+    resumed = 0;
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    if (read_only_) {
+        return true;
+    }
+    bool ok = BackupJournal::read(journal_file_, [&](const std::string& path, const Metadata& metadata) {
+        materialize();
+        index_.insert(path, metadata);
+        dir_stats_valid_ = false;
+        ++resumed;
+    });
+    if (!ok) {
+        // 无法识别的日志不能续传，重新开始记录
+        resumed = 0;
+    }
+    return journal_.open(journal_file_);
+}
+
+void Repository::endJournal() {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    if (journal_.isOpen()) {
+        flushJournal();
+        journal_.close();
+    }
+}
+
+void Repository::discardJournal() {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    journal_.close();
+    std::error_code ec;
+    std::filesystem::remove(journal_file_, ec);
+}
+
 bool Repository::storeFile(const std::filesystem::path& source_path,
                            const std::filesystem::path& relative_path,
                            const Metadata& metadata) {
     try {
-        auto storage_path = getStoragePath(relative_path);
-        
-        // 复制文件
-        if (!FileUtils::copyFile(source_path, storage_path)) {
+        Metadata stored = prepareStored(metadata);
+        std::uint64_t* checksum = stored.has_checksum ? &stored.checksum : nullptr;
+        SparseMap* layout = stored.is_symlink ? nullptr : &stored.layout;
+
+        if (chunking_) {
+            // 块存储：符号链接只需记录目标，普通文件分块去重
+            if (!stored.is_symlink && !chunk_store_.storeFile(source_path, stored.chunks, checksum, layout)) {
+                return false;
+            }
+        } else if (shouldPack(stored)) {
+            // 小文件追加到段文件，不占用 data/ 中的 inode
+            if (!storePacked(source_path, relative_path, stored, checksum)) {
+                return false;
+            }
+        } else if (shouldDelta(stored)) {
+            // 大文件修改后只写入相对上一版本的差量
+            if (!storeDelta(source_path, relative_path, stored)) {
+                return false;
+            }
+        } else if (!stored.compression.empty()) {
+            if (!compressor_.compress(source_path, getStoragePath(relative_path), checksum, layout)) {
+                return false;
+            }
+        } else if (!storeMirror(source_path, getStoragePath(relative_path), stored, checksum, layout)) {
             return false;
         }
 
         // 保存元数据到索引
-        index_[relative_path] = metadata;
-
+        commitStored(relative_path, std::move(stored));
         return true;
     } catch (const std::exception& e) {
         std::cerr << "存储文件失败: " << source_path << " - " << e.what() << std::endl;
@@ -50,55 +330,762 @@ bool Repository::storeFile(const std::filesystem::path& source_path,
     }
 }
 
+bool Repository::storeHardLink(const std::filesystem::path& relative_path, const Metadata& metadata) {
+    // 数据、校验和与区段表都属于数据所在的条目，这里只保留文件属性和链接目标
+    Metadata stored = prepareStored(metadata);
+    stored.compression.clear();
+    stored.has_checksum = false;
+    stored.chunked = false;
+    commitStored(relative_path, std::move(stored));
+    return true;
+}
+
+bool Repository::canStoreBatched(const Metadata& metadata) const {
+    return !chunking_ && !hardlink_ && !metadata.is_symlink && metadata.size <= BatchIo::kMaxFileSize &&
+           !shouldDelta(metadata);
+}
+
+void Repository::storeBatch(std::vector<BatchStoreEntry>& entries, BatchIo& io) {
+    // 1. 批量读入源文件（大小须与扫描时一致，否则退回 storeFile 重新读取）
+    thread_local std::vector<BatchIo::ReadRequest> reads;
+    reads.resize(entries.size());
+    std::vector<char> eligible(entries.size(), 0);
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        BatchIo::ReadRequest& read = reads[i];
+        read.path = entries[i].source_path.string();
+        read.size = entries[i].metadata.size;
+        read.exact = true;
+        read.error = 0;
+        eligible[i] = canStoreBatched(entries[i].metadata) ? 1 : 0;
+    }
+    if (io.valid()) {
+        io.readFiles(reads);
+    }
+
+    // 2. 段文件条目直接追加；镜像/压缩条目准备写请求
+    thread_local std::vector<std::vector<std::uint8_t>> compressed;
+    compressed.resize(entries.size());
+    std::vector<Metadata> stored(entries.size());
+    std::vector<BatchIo::WriteRequest> writes;
+    std::vector<std::size_t> owners;  // writes[k] 对应的条目下标
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        if (!eligible[i] || !io.valid() || reads[i].error != 0) {
+            continue;
+        }
+        try {
+            BatchStoreEntry& entry = entries[i];
+            const std::vector<std::uint8_t>& data = reads[i].data;
+            stored[i] = prepareStored(entry.metadata);
+            if (stored[i].has_checksum) {
+                stored[i].checksum = Xxh64::hash(data.data(), data.size());
+            }
+            if (shouldPack(stored[i])) {
+                if (appendPacked(data.data(), data.size(), entry.relative_path, stored[i])) {
+                    commitStored(entry.relative_path, std::move(stored[i]));
+                    entry.ok = true;
+                }
+                continue;
+            }
+            auto storage_path = getStoragePath(entry.relative_path);
+            if (!ensureDirectory(storage_path.parent_path())) {
+                continue;
+            }
+            BatchIo::WriteRequest write;
+            write.path = storage_path.string();
+            if (stored[i].compression.empty()) {
+                // 镜像文件权限与源文件相同，写入后 fchmod（与 copyRegularFile 一致）
+                write.data = data.data();
+                write.size = data.size();
+                write.mode = 0600;
+            } else {
+                compressor_.compressBuffer(data.data(), data.size(), compressed[i]);
+                write.data = compressed[i].data();
+                write.size = compressed[i].size();
+                write.mode = 0666;
+            }
+            writes.push_back(std::move(write));
+            owners.push_back(i);
+        } catch (const std::exception& e) {
+            std::cerr << "存储文件失败: " << entries[i].source_path << " - " << e.what() << std::endl;
+        }
+    }
+
+    // 3. 批量创建并写入，镜像设置权限后批量关闭
+    io.writeFiles(writes);
+#ifndef _WIN32
+    for (std::size_t k = 0; k < writes.size(); ++k) {
+        const Metadata& m = stored[owners[k]];
+        if (writes[k].error == 0 && m.compression.empty()) {
+            ::fchmod(writes[k].fd, static_cast<mode_t>(m.mode & 07777));
+        }
+    }
+#endif
+    io.closeFiles(writes);
+    for (std::size_t k = 0; k < writes.size(); ++k) {
+        std::size_t i = owners[k];
+        if (writes[k].error != 0) {
+            continue;  // 目标处为符号链接（ELOOP）等情况由 storeFile 处理并报告
+        }
+        if (stored[i].compression.empty()) {
+            copy_counts_[static_cast<std::size_t>(CopyStrategy::IoUring)].fetch_add(1, std::memory_order_relaxed);
+        }
+        commitStored(entries[i].relative_path, std::move(stored[i]));
+        entries[i].ok = true;
+    }
+
+    // 4. 其余条目逐个存储
+    for (auto& entry : entries) {
+        if (!entry.ok) {
+            entry.ok = storeFile(entry.source_path, entry.relative_path, entry.metadata);
+        }
+    }
+}
+
+bool Repository::resolveHardLink(std::filesystem::path& relative_path, Metadata& metadata,
+                                 std::string& error) const {
+    const std::string target = metadata.hardlink;
+    if (!getMetadata(target, metadata)) {
+        error = "硬链接指向的条目不存在: " + target;
+        return false;
+    }
+    if (!metadata.hardlink.empty()) {
+        error = "硬链接指向的条目本身也是硬链接: " + target;
+        return false;
+    }
+    relative_path = target;
+    return true;
+}
+
+bool Repository::lookupForRestore(const std::filesystem::path& relative_path,
+                                  Metadata& metadata) const {
+    if (!getMetadata(relative_path, metadata)) {
+        std::cerr << "索引中不存在文件: " << relative_path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Repository::restoreData(const std::filesystem::path& relative_path,
+                             const Metadata& metadata,
+                             const std::filesystem::path& target_path,
+                             bool create_parents,
+                             SyncPolicy sync) const {
+    if (!metadata.hardlink.empty()) {
+        // 单独还原硬链接条目时复制数据所在条目的内容（同一 inode，属性也相同）
+        std::filesystem::path data_path = relative_path;
+        Metadata data = metadata;
+        std::string error;
+        if (!resolveHardLink(data_path, data, error)) {
+            std::cerr << "恢复文件失败: " << relative_path << " - " << error << std::endl;
+            return false;
+        }
+        return restoreData(data_path, data, target_path, create_parents, sync);
+    }
+    auto storage_path = getStoragePath(relative_path);
+    if (!metadata.chunked) {
+        if (!metadata.packed && !std::filesystem::exists(std::filesystem::symlink_status(storage_path))) {
+            std::cerr << "仓库中不存在文件: " << relative_path << std::endl;
+            return false;
+        }
+        if (!metadata.compression.empty() && metadata.compression != "lz") {
+            std::cerr << "不支持的压缩算法: " << metadata.compression << " - " << relative_path << std::endl;
+            return false;
+        }
+    }
+
+    auto parent = target_path.parent_path();
+    if (create_parents && !parent.empty()) {
+        FileUtils::createDirectories(parent);
+    }
+
+    if (metadata.is_symlink) {
+        // 符号链接没有可打开的 fd：按记录的目标重建后按路径应用时间和属主
+        if (!FileUtils::createSymlink(metadata.symlink_target, target_path)) {
+            return false;
+        }
+        copy_counts_[static_cast<std::size_t>(CopyStrategy::Symlink)].fetch_add(1, std::memory_order_relaxed);
+        if (!metadata.applyToFile(target_path)) {
+            std::cerr << "警告: 应用元数据失败: " << target_path << std::endl;
+        }
+        return true;
+    }
+
+#ifdef _WIN32
+    (void)sync;
+    bool ok;
+    if (!metadata.chunked && !metadata.packed && metadata.compression.empty() && metadata.delta_depth == 0) {
+        ok = copyData(storage_path, target_path, false, false);
+    } else {
+        std::ofstream ofs(target_path, std::ios::binary | std::ios::trunc);
+        if (!ofs) {
+            std::cerr << "无法创建目标文件: " << target_path << std::endl;
+            return false;
+        }
+        ExtentMapper mapper(metadata.layout, [&](std::uint64_t offset, const std::uint8_t* data, std::size_t n) {
+            ofs.seekp(static_cast<std::streamoff>(offset));
+            ofs.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(n));
+            return static_cast<bool>(ofs);
+        });
+        std::string error;
+        ok = readStoredData(relative_path, metadata, std::ref(mapper), error);
+        ofs.close();
+        if (!ok) {
+            std::cerr << "恢复文件失败: " << relative_path << " - " << error << std::endl;
+        } else if (metadata.layout.sparse) {
+            std::error_code ec;
+            std::filesystem::resize_file(target_path, metadata.size, ec);
+            ok = !ec;
+        }
+    }
+    if (ok && !metadata.applyToFile(target_path)) {
+        std::cerr << "警告: 应用元数据失败: " << target_path << std::endl;
+    }
+    return ok;
+#else
+    // 每个文件只打开一次：写数据、设置属主/权限/时间、按需 fdatasync 都在同一个 fd 上完成
+    int fd = FileUtils::openForWrite(target_path);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok;
+    if (!metadata.chunked && !metadata.packed && metadata.compression.empty() && metadata.delta_depth == 0) {
+        // 镜像中的空洞与源文件一致，copyToFd 会重新探测
+        CopyStrategy strategy = CopyStrategy::ReadWrite;
+        ok = FileUtils::copyToFd(storage_path, fd, target_path, &strategy);
+        if (ok) {
+            copy_counts_[static_cast<std::size_t>(strategy)].fetch_add(1, std::memory_order_relaxed);
+        }
+    } else {
+        // 数据区段按区段表写回原偏移，空洞不写，最后用 ftruncate 补齐长度
+        ExtentMapper mapper(metadata.layout, [&](std::uint64_t offset, const std::uint8_t* data, std::size_t n) {
+            return FileUtils::pwriteAll(fd, data, n, offset, target_path);
+        });
+        std::string error;
+        ok = readStoredData(relative_path, metadata, std::ref(mapper), error);
+        if (!ok) {
+            std::cerr << "恢复文件失败: " << relative_path << " - " << error << std::endl;
+        }
+        if (ok && metadata.layout.sparse) {
+            ok = FileUtils::setFileSize(fd, metadata.size, target_path);
+        }
+    }
+    if (ok && !metadata.applyToFd(fd, target_path)) {
+        std::cerr << "警告: 应用元数据失败: " << target_path << std::endl;
+        // 不计为失败，数据已写入
+    }
+    if (ok && sync == SyncPolicy::File) {
+        ok = FileUtils::syncFileData(fd, target_path);
+    }
+    return FileUtils::closeWritten(fd, target_path) && ok;
+#endif
+}
+
 bool Repository::restoreFile(const std::filesystem::path& relative_path,
                              const std::filesystem::path& target_path,
                              Metadata& metadata) {
     try {
-        auto storage_path = getStoragePath(relative_path);
-        
-        if (!std::filesystem::exists(storage_path)) {
-            std::cerr << "仓库中不存在文件: " << relative_path << std::endl;
+        if (!lookupForRestore(relative_path, metadata)) {
+            return false;
+        }
+        // 恢复文件并应用元数据
+        return restoreData(relative_path, metadata, target_path, true, SyncPolicy::None);
+    } catch (const std::exception& e) {
+        std::cerr << "恢复文件失败: " << relative_path << " - " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool Repository::restoreFileData(const std::filesystem::path& relative_path,
+                                 const std::filesystem::path& target_path,
+                                 Metadata& metadata,
+                                 SyncPolicy sync) {
+    try {
+        if (!lookupForRestore(relative_path, metadata)) {
             return false;
         }
+        return restoreData(relative_path, metadata, target_path, false, sync);
+    } catch (const std::exception& e) {
+        std::cerr << "恢复文件失败: " << relative_path << " - " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool Repository::restoreHardLink(const std::filesystem::path& relative_path,
+                                 const std::filesystem::path& anchor,
+                                 const std::filesystem::path& target_path,
+                                 Metadata& metadata,
+                                 SyncPolicy sync) {
+    if (!anchor.empty()) {
+        std::error_code ec;
+        std::filesystem::create_hard_link(anchor, target_path, ec);
+        if (ec == std::errc::file_exists) {
+            std::filesystem::remove(target_path, ec);
+            if (!ec) {
+                std::filesystem::create_hard_link(anchor, target_path, ec);
+            }
+        }
+        if (!ec) {
+            // 属性由 inode 共享，已随数据所在的路径还原
+            copy_counts_[static_cast<std::size_t>(CopyStrategy::HardLink)].fetch_add(1, std::memory_order_relaxed);
+            return getMetadata(relative_path, metadata);
+        }
+        std::cerr << "警告: 创建硬链接失败，改为复制数据: " << target_path << " - " << ec.message() << std::endl;
+    }
+    return restoreFileData(relative_path, target_path, metadata, sync);
+}
+
+bool Repository::canRestoreSplit(const Metadata& metadata) const {
+#ifdef _WIN32
+    (void)metadata;
+    return false;
+#else
+    return !metadata.is_symlink && metadata.hardlink.empty() && !metadata.chunked && !metadata.packed &&
+           metadata.compression.empty() && metadata.delta_depth == 0 && !metadata.layout.sparse;
+#endif
+}
+
+bool Repository::beginSplitRestore(const Metadata& metadata, const std::filesystem::path& target_path) {
+#ifdef _WIN32
+    (void)metadata;
+    (void)target_path;
+    return false;
+#else
+    int fd = FileUtils::openForWrite(target_path);
+    if (fd < 0) {
+        return false;
+    }
+    // 先设好长度，各区段按偏移写入时不再扩展文件
+    const bool ok = FileUtils::setFileSize(fd, metadata.size, target_path);
+    return FileUtils::closeWritten(fd, target_path) && ok;
+#endif
+}
+
+bool Repository::restoreRange(const std::filesystem::path& relative_path, const std::filesystem::path& target_path,
+                              std::uint64_t offset, std::uint64_t length) {
+#ifdef _WIN32
+    (void)relative_path;
+    (void)target_path;
+    (void)offset;
+    (void)length;
+    return false;
+#else
+    CopyStrategy strategy = CopyStrategy::ReadWrite;
+    if (!FileUtils::copyFileRange(getStoragePath(relative_path), target_path, offset, length, &strategy)) {
+        return false;
+    }
+    if (offset == 0) {
+        // 每个文件按第一个区段的复制方式计数一次
+        copy_counts_[static_cast<std::size_t>(strategy)].fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+#endif
+}
+
+bool Repository::finishSplitRestore(const std::filesystem::path& target_path, const Metadata& metadata,
+                                    SyncPolicy sync) {
+#ifdef _WIN32
+    (void)target_path;
+    (void)metadata;
+    (void)sync;
+    return false;
+#else
+    int fd = ::open(target_path.c_str(), O_WRONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd < 0) {
+        std::cerr << "无法打开目标文件: " << target_path << " - " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    bool ok = true;
+    if (!metadata.applyToFd(fd, target_path)) {
+        std::cerr << "警告: 应用元数据失败: " << target_path << std::endl;
+    }
+    if (sync == SyncPolicy::File) {
+        ok = FileUtils::syncFileData(fd, target_path);
+    }
+    return FileUtils::closeWritten(fd, target_path) && ok;
+#endif
+}
+
+void Repository::restoreBatch(std::vector<BatchRestoreEntry>& entries, BatchIo& io, SyncPolicy sync) {
+    // 1. 查索引并挑出可批量处理的条目：data/ 镜像（未压缩或 lz）经 io_uring 读取，段文件条目按记录位置读取
+    thread_local std::vector<BatchIo::ReadRequest> reads;
+    thread_local std::vector<std::vector<std::uint8_t>> buffers;
+    reads.clear();
+    buffers.resize(entries.size());
+    std::vector<std::size_t> read_owner;                       // reads[k] 对应的条目下标
+    std::vector<const std::vector<std::uint8_t>*> contents(entries.size(), nullptr);
+    std::vector<char> found(entries.size(), 0);
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        BatchRestoreEntry& entry = entries[i];
+        if (!getMetadata(entry.relative_path, entry.metadata)) {
+            continue;  // 由逐个还原路径报告
+        }
+        found[i] = 1;
+        const Metadata& m = entry.metadata;
+        if (!io.valid() || m.chunked || m.is_symlink || !m.hardlink.empty() || m.layout.sparse || m.delta_depth > 0 ||
+            m.size > BatchIo::kMaxFileSize ||
+            (!m.compression.empty() && m.compression != "lz")) {
+            continue;
+        }
+        if (m.packed) {
+            std::string error;
+            std::vector<std::uint8_t>& out = buffers[i];
+            out.clear();
+            bool ok = readStoredData(entry.relative_path, m, [&](const std::uint8_t* data, std::size_t n) {
+                out.insert(out.end(), data, data + n);
+                return true;
+            }, error);
+            if (ok && out.size() == m.size) {
+                contents[i] = &out;
+            }
+            continue;
+        }
+        BatchIo::ReadRequest read;
+        read.path = getStoragePath(entry.relative_path).string();
+        if (m.compression.empty()) {
+            read.size = m.size;
+            read.exact = true;
+        } else {
+            // 压缩数据的大小未记录：按上限读取，超出时退回流式解压
+            read.size = m.size + m.size / 8 + 1024;
+            read.exact = false;
+        }
+        reads.push_back(std::move(read));
+        read_owner.push_back(i);
+    }
+    io.readFiles(reads);
+    for (std::size_t k = 0; k < reads.size(); ++k) {
+        std::size_t i = read_owner[k];
+        const Metadata& m = entries[i].metadata;
+        if (reads[k].error != 0) {
+            continue;
+        }
+        if (m.compression.empty()) {
+            contents[i] = &reads[k].data;
+            continue;
+        }
+        std::vector<std::uint8_t>& out = buffers[i];
+        out.clear();
+        bool ok = LzCompressor::decompressBuffer(reads[k].data.data(), reads[k].data.size(),
+                                                 [&](const std::uint8_t* data, std::size_t n) {
+            out.insert(out.end(), data, data + n);
+            return true;
+        }, entries[i].relative_path.string());
+        if (ok && out.size() == m.size) {
+            contents[i] = &out;
+        }
+    }
+
+    // 2. 批量创建并写入目标文件，在同一个 fd 上应用元数据，按需 fdatasync 后批量关闭
+    std::vector<BatchIo::WriteRequest> writes;
+    std::vector<std::size_t> write_owner;
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        if (!contents[i]) {
+            continue;
+        }
+        BatchIo::WriteRequest write;
+        write.path = entries[i].target_path.string();
+        write.data = contents[i]->data();
+        write.size = contents[i]->size();
+        write.mode = 0600;
+        writes.push_back(std::move(write));
+        write_owner.push_back(i);
+    }
+    io.writeFiles(writes);
+    for (std::size_t k = 0; k < writes.size(); ++k) {
+        const BatchRestoreEntry& entry = entries[write_owner[k]];
+        if (writes[k].error == 0 && !entry.metadata.applyToFd(writes[k].fd, entry.target_path)) {
+            std::cerr << "警告: 应用元数据失败: " << entry.target_path << std::endl;
+        }
+    }
+    if (sync == SyncPolicy::File) {
+        io.syncFiles(writes);
+    }
+    io.closeFiles(writes);
+    for (std::size_t k = 0; k < writes.size(); ++k) {
+        BatchRestoreEntry& entry = entries[write_owner[k]];
+        if (writes[k].error != 0) {
+            continue;  // 目标处为符号链接（ELOOP）等情况由逐个还原路径处理并报告
+        }
+        if (!entry.metadata.packed && entry.metadata.compression.empty()) {
+            copy_counts_[static_cast<std::size_t>(CopyStrategy::IoUring)].fetch_add(1, std::memory_order_relaxed);
+        }
+        entry.ok = true;
+    }
+
+    // 3. 其余条目逐个还原
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        BatchRestoreEntry& entry = entries[i];
+        if (entry.ok) {
+            continue;
+        }
+        try {
+            entry.ok = (found[i] || lookupForRestore(entry.relative_path, entry.metadata)) &&
+                       restoreData(entry.relative_path, entry.metadata, entry.target_path, false, sync);
+        } catch (const std::exception& e) {
+            std::cerr << "恢复文件失败: " << entry.relative_path << " - " << e.what() << std::endl;
+        }
+    }
+}
 
-        // 从索引获取元数据
-        auto it = index_.find(relative_path);
-        if (it == index_.end()) {
-            std::cerr << "索引中不存在文件: " << relative_path << std::endl;
+bool Repository::verifyFile(const std::filesystem::path& relative_path,
+                            const Metadata& metadata,
+                            std::string& error) const {
+    if (!metadata.hardlink.empty()) {
+        // 数据在链接指向的条目中，由该条目校验
+        std::filesystem::path data_path = relative_path;
+        Metadata data = metadata;
+        return resolveHardLink(data_path, data, error);
+    }
+    auto storage_path = getStoragePath(relative_path);
+    if (metadata.is_symlink) {
+        // 块存储中的符号链接只有索引记录；镜像中应为指向同一目标的链接
+        if (metadata.chunked) {
+            return true;
+        }
+        std::error_code ec;
+        auto target = std::filesystem::read_symlink(storage_path, ec);
+        if (ec) {
+            error = "仓库中的符号链接不存在或不可读: " + ec.message();
+            return false;
+        }
+        if (target.string() != metadata.symlink_target) {
+            error = "符号链接目标不一致: " + target.string();
             return false;
         }
-        metadata = it->second;
+        return true;
+    }
 
-        // 恢复文件
-        if (!FileUtils::copyFile(storage_path, target_path)) {
+    Xxh64 hasher;
+    std::uint64_t size = 0;
+    auto sink = [&](const std::uint8_t* data, std::size_t n) {
+        hasher.update(data, n);
+        size += n;
+        return true;
+    };
+    if (!readStoredData(relative_path, metadata, sink, error)) {
+        return false;
+    }
+    // 稀疏文件只存储和校验数据区段
+    const std::uint64_t expected = metadata.layout.dataLength(metadata.size);
+    if (size != expected) {
+        error = "大小不一致: 索引 " + std::to_string(expected) + ", 实际 " + std::to_string(size);
+        return false;
+    }
+    if (metadata.has_checksum && hasher.digest() != metadata.checksum) {
+        error = "校验和不一致: 索引 " + Xxh64::toHex(metadata.checksum) + ", 实际 " + Xxh64::toHex(hasher.digest());
+        return false;
+    }
+    return true;
+}
+
+bool Repository::readStoredData(const std::filesystem::path& relative_path,
+                                const Metadata& metadata,
+                                const ByteSink& sink,
+                                std::string& error) const {
+    if (!metadata.hardlink.empty()) {
+        std::filesystem::path data_path = relative_path;
+        Metadata data = metadata;
+        return resolveHardLink(data_path, data, error) && readStoredData(data_path, data, sink, error);
+    }
+    bool ok;
+    if (metadata.chunked) {
+        std::vector<std::uint8_t> chunk;
+        for (const auto& id : metadata.chunks) {
+            if (!chunk_store_.readChunk(id, chunk)) {
+                error = "块缺失或不可读: " + id;
+                return false;
+            }
+            if (!sink(chunk.data(), chunk.size())) {
+                error = "数据超出区段表或写入失败";
+                return false;
+            }
+        }
+        return true;
+    }
+    if (metadata.packed) {
+        thread_local std::vector<std::uint8_t> data;
+        PackLocation location{metadata.pack_segment, metadata.pack_offset, metadata.pack_length};
+        if (!pack_store_.read(location, data)) {
+            error = "段文件缺失或不可读: " + pack_store_.segmentPath(location.segment).string();
+            return false;
+        }
+        if (metadata.compression.empty()) {
+            ok = sink(data.data(), data.size());
+        } else if (metadata.compression == "lz") {
+            ok = LzCompressor::decompressBuffer(data.data(), data.size(), sink, relative_path.string());
+        } else {
+            error = "不支持的压缩算法: " + metadata.compression;
             return false;
         }
+        if (!ok) {
+            error = "段中的数据无法解压或写入失败";
+        }
+        return ok;
+    }
+    auto storage_path = getStoragePath(relative_path);
+    if (metadata.delta_depth > 0) {
+        // 镜像为基础版本，依次叠加各差量
+        return delta_store_.read(storage_path, relative_path.generic_string(), metadata.delta_depth, sink, error);
+    }
+    if (metadata.compression.empty()) {
+        // 镜像按索引中的区段表读取，与存储时计算校验和的方式一致
+        ExtentReader reader;
+        ok = reader.open(storage_path, false, metadata.layout.sparse ? &metadata.layout : nullptr);
+        std::vector<std::uint8_t> buffer(1024 * 1024);
+        while (ok) {
+            std::int64_t n = reader.read(buffer.data(), buffer.size());
+            if (n <= 0) {
+                ok = (n == 0);
+                break;
+            }
+            ok = sink(buffer.data(), static_cast<std::size_t>(n));
+        }
+    } else if (metadata.compression == "lz") {
+        // 解压不依赖压缩级别，使用局部实例保证 const 与线程安全
+        LzCompressor decompressor;
+        ok = decompressor.decompressTo(storage_path, sink);
+    } else {
+        error = "不支持的压缩算法: " + metadata.compression;
+        return false;
+    }
+    if (!ok) {
+        error = "仓库数据缺失、无法读取或超出区段表";
+    }
+    return ok;
+}
 
-        // 应用元数据
-        if (!metadata.applyToFile(target_path)) {
-            std::cerr << "警告: 应用元数据失败: " << target_path << std::endl;
-            // 不返回false，文件已复制成功
+bool Repository::isUnchanged(const std::filesystem::path& relative_path,
+                             const Metadata& metadata) const {
+    Metadata previous;
+    {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        if (!getMetadata(relative_path, previous)) {
+            return false;
         }
+    }
+    if (!previous.sameContentAs(metadata)) {
+        return false;
+    }
+    if (!previous.hardlink.empty()) {
+        // 硬链接条目没有自己的数据：指向的条目仍在即可，该条目是否变化单独判断
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        Metadata target;
+        return getMetadata(previous.hardlink, target) && target.hardlink.empty();
+    }
+    // 存储方式切换（镜像 <-> 块存储、压缩开关）时需要重新存储
+    if (previous.chunked != chunking_ || previous.compression != compressionFor(metadata)) {
+        return false;
+    }
+    // 旧条目没有校验和时重新存储一次，以便之后能够校验
+    if (checksums_ && !previous.is_symlink && !previous.has_checksum) {
+        return false;
+    }
+    if (previous.chunked) {
+        return true;
+    }
+    // 打包阈值变化时按新的设置重新存储
+    if (previous.packed != shouldPack(metadata)) {
+        return false;
+    }
+    if (previous.packed) {
+        return pack_store_.hasSegment(previous.pack_segment);
+    }
+
+    // 仓库中的数据被外部删除时仍需重新备份
+    std::error_code ec;
+    return std::filesystem::exists(std::filesystem::symlink_status(getStoragePath(relative_path), ec));
+}
 
+std::size_t Repository::retainOnly(const std::set<std::filesystem::path>& keep) {
+    return removeWhere([&](const std::string& key, const Metadata&) {
+        return keep.count(std::filesystem::path(key)) == 0;
+    });
+}
+
+std::size_t Repository::removeWhere(const std::function<bool(const std::string&, const Metadata&)>& remove) {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    materialize();
+    dir_stats_valid_ = false;
+    return index_.removeIf([&](const std::string& key, const Metadata& metadata) {
+        if (!remove(key, metadata)) {
+            return false;
+        }
+        const std::filesystem::path path(key);
+        // 块可能被其它文件共享、段文件中还有其它记录，这里只删除镜像数据（及其差量）
+        std::error_code ec;
+        if (!metadata.chunked && !metadata.packed && metadata.hardlink.empty()) {
+            std::filesystem::remove(getStoragePath(path), ec);
+            if (!metadata.is_symlink) {
+                delta_store_.remove(key);
+            }
+        }
+        if (ec) {
+            std::cerr << "警告: 删除仓库数据失败: " << path << " - " << ec.message() << std::endl;
+        }
         return true;
-    } catch (const std::exception& e) {
-        std::cerr << "恢复文件失败: " << relative_path << " - " << e.what() << std::endl;
+    });
+}
+
+void Repository::materialize() {
+    if (!disk_only_) {
+        return;
+    }
+    // 磁盘索引已按路径排序：逐条追加到有序部分末尾
+    Metadata metadata;
+    index_.reserve(disk_index_.size());
+    for (BinaryIndex::Cursor cur(disk_index_, 0); cur.valid(); cur.next()) {
+        if (disk_index_.metadataAt(cur.index(), metadata)) {
+            index_.insert(cur.path(), metadata);
+        }
+    }
+    disk_index_.close();
+    disk_only_ = false;
+}
+
+bool Repository::writeIndex(const std::filesystem::path& file) {
+    index_.sort();
+    // 目录汇总在同一遍中得到，写在索引旁边；写不出时之后按需重新统计，不影响索引本身
+    DirectoryStats::Builder dirs;
+    bool ok = BinaryIndex::write(file, index_.size(), [&](std::size_t i, std::string& path, Metadata& metadata) {
+        path.clear();
+        index_.appendPath(i, path);
+        index_.metadataAt(i, metadata);
+        dirs.add(path, metadata.size);
+    });
+    if (!ok) {
         return false;
     }
+    DirectoryStats stats = dirs.finish();
+    stats.write(file, index_.size());
+    if (file == index_file_) {
+        dir_stats_ = std::move(stats);
+        dir_stats_valid_ = true;
+    }
+    return true;
 }
 
 bool Repository::saveIndex() {
     try {
-        std::ofstream ofs(index_file_);
-        if (!ofs.is_open()) {
-            std::cerr << "无法打开索引文件: " << index_file_ << std::endl;
+        StatTimer timer(StatPhase::IndexSave);
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        if (read_only_) {
+            std::cerr << "快照是只读的，不能保存索引" << std::endl;
             return false;
         }
-
-        for (const auto& [path, metadata] : index_) {
-            ofs << path.string() << "\t" << metadata.serialize() << "\n";
+        materialize();
+        // 索引引用的段数据必须先写出
+        if (!pack_store_.flush() || !writeIndex(index_file_)) {
+            return false;
         }
+        std::error_code size_ec;
+        auto index_size = std::filesystem::file_size(index_file_, size_ec);
+        timer.addBytes(size_ec ? 0 : index_size);
 
+        // 迁移完成：旧文本索引已被二进制索引取代；日志中的条目都已写入新索引
+        std::error_code ec;
+        std::filesystem::remove(legacy_index_file_, ec);
+        journal_.close();
+        std::filesystem::remove(journal_file_, ec);
         return true;
     } catch (const std::exception& e) {
         std::cerr << "保存索引失败: " << e.what() << std::endl;
@@ -108,17 +1095,34 @@ bool Repository::saveIndex() {
 
 bool Repository::loadIndex() {
     try {
-        if (!std::filesystem::exists(index_file_)) {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        index_.clear();
+        disk_index_.close();
+        disk_only_ = false;
+        dir_stats_valid_ = false;
+
+        if (std::filesystem::exists(index_file_)) {
+            if (!disk_index_.open(index_file_)) {
+                return false;
+            }
+            disk_only_ = true;
+            return true;
+        }
+        if (read_only_) {
+            std::cerr << "快照清单不存在: " << index_file_ << std::endl;
+            return false;
+        }
+
+        if (!std::filesystem::exists(legacy_index_file_)) {
             return true;  // 索引文件不存在，返回成功（空索引）
         }
 
-        std::ifstream ifs(index_file_);
+        std::ifstream ifs(legacy_index_file_);
         if (!ifs.is_open()) {
-            std::cerr << "无法打开索引文件: " << index_file_ << std::endl;
+            std::cerr << "无法打开索引文件: " << legacy_index_file_ << std::endl;
             return false;
         }
 
-        index_.clear();
         std::string line;
         while (std::getline(ifs, line)) {
             if (line.empty()) continue;
@@ -131,9 +1135,10 @@ bool Repository::loadIndex() {
 
             Metadata metadata;
             if (metadata.deserialize(metadata_str)) {
-                index_[path_str] = metadata;
+                index_.insert(path_str, metadata);
             }
         }
+        index_.sort();
 
         return true;
     } catch (const std::exception& e) {
@@ -142,23 +1147,289 @@ bool Repository::loadIndex() {
     }
 }
 
-std::vector<std::filesystem::path> Repository::listFiles() const {
-    std::vector<std::filesystem::path> files;
-    for (const auto& [path, _] : index_) {
-        files.push_back(path);
+IndexView Repository::files() {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    if (disk_only_) {
+        return IndexView(disk_index_);
     }
-    return files;
+    index_.sort();
+    return IndexView(index_);
 }
 
 bool Repository::getMetadata(const std::filesystem::path& relative_path, Metadata& metadata) const {
-    auto it = index_.find(relative_path);
-    if (it == index_.end()) {
+    if (disk_only_) {
+        return disk_index_.find(relative_path.generic_string(), metadata);
+    }
+    return index_.find(relative_path.generic_string(), metadata);
+}
+
+const DirectoryStats& Repository::directoryStatsLocked() {
+    if (!dir_stats_valid_) {
+        if (disk_only_ && dir_stats_.read(index_file_, disk_index_.size())) {
+            dir_stats_valid_ = true;
+        } else {
+            if (!disk_only_) {
+                index_.sort();
+            }
+            dir_stats_ = DirectoryStats::build(disk_only_ ? IndexView(disk_index_) : IndexView(index_));
+            dir_stats_valid_ = true;
+        }
+    }
+    return dir_stats_;
+}
+
+bool Repository::directoryTotals(const std::string& dir, DirectoryTotals& totals) {
+    std::string key = dir;
+    while (!key.empty() && key.back() == '/') {
+        key.pop_back();
+    }
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    return directoryStatsLocked().find(key, totals);
+}
+
+bool Repository::listDirectory(const std::string& dir, std::size_t offset, std::size_t limit,
+                               std::vector<DirectoryEntry>& entries, std::size_t* total) {
+    entries.clear();
+    std::string key = dir;
+    while (!key.empty() && key.back() == '/') {
+        key.pop_back();
+    }
+    DirectoryTotals totals;
+    if (!directoryTotals(key, totals)) {
         return false;
     }
-    metadata = it->second;
+    if (total) {
+        *total = static_cast<std::size_t>(totals.children);
+    }
+
+    const IndexView view = files().prefix(key);
+    const std::string base = key.empty() ? std::string() : key + "/";
+    std::size_t child = 0;
+    for (std::size_t pos = 0; pos < view.size() && entries.size() < limit;) {
+        const std::string path = view.path(pos);
+        const std::size_t slash = path.find('/', base.size());
+        if (slash == std::string::npos) {
+            if (child++ >= offset) {
+                DirectoryEntry entry;
+                entry.name = path.substr(base.size());
+                view.metadata(pos, entry.metadata);
+                entries.push_back(std::move(entry));
+            }
+            ++pos;
+            continue;
+        }
+        // 子目录：整棵子树是 ["sub/", "sub0") 一段，'0' 是 '/' 之后的下一个字节
+        std::string sub = path.substr(0, slash);
+        if (child++ >= offset) {
+            DirectoryEntry entry;
+            entry.name = sub.substr(base.size());
+            entry.is_directory = true;
+            std::lock_guard<std::mutex> lock(index_mutex_);
+            directoryStatsLocked().find(sub, entry.totals);
+            entries.push_back(std::move(entry));
+        }
+        sub.push_back('/' + 1);
+        pos = view.position(sub);
+    }
     return true;
 }
 
-} // namespace backuprestore
+bool Repository::isValidSnapshotName(const std::string& name) {
+    if (name.empty() || name[0] == '.') {
+        return false;
+    }
+    return std::all_of(name.begin(), name.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '_' || c == '-';
+    });
+}
+
+std::filesystem::path Repository::snapshotPath(const std::string& name) const {
+    return snapshots_dir_ / (name + ".bin");
+}
+
+bool Repository::createSnapshot(const std::string& name) {
+    if (!isValidSnapshotName(name)) {
+        std::cerr << "无效的快照名: " << name << std::endl;
+        return false;
+    }
+    try {
+        std::lock_guard<std::mutex> lock(index_mutex_);
+        materialize();
+        // data/ 中的镜像只保存最新版本，快照只能引用按内容寻址的块
+        index_.sort();
+        Metadata metadata;
+        for (std::size_t i = 0; i < index_.size(); ++i) {
+            if (index_.metadataAt(i, metadata) && !metadata.chunked && metadata.hardlink.empty()) {
+                std::cerr << "快照只能引用块存储中的数据，镜像条目: " << index_.pathAt(i) << std::endl;
+                return false;
+            }
+        }
+        auto file = snapshotPath(name);
+        if (std::filesystem::exists(file)) {
+            std::cerr << "快照已存在: " << name << std::endl;
+            return false;
+        }
+        if (!FileUtils::createDirectories(snapshots_dir_)) {
+            return false;
+        }
+        return writeIndex(file);
+    } catch (const std::exception& e) {
+        std::cerr << "创建快照失败: " << name << " - " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool Repository::hasSnapshot(const std::string& name) const {
+    std::error_code ec;
+    return isValidSnapshotName(name) && std::filesystem::exists(snapshotPath(name), ec);
+}
+
+bool Repository::useSnapshot(const std::string& name) {
+    if (!hasSnapshot(name)) {
+        std::cerr << "快照不存在: " << name << std::endl;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    index_file_ = snapshotPath(name);
+    read_only_ = true;
+    return true;
+}
+
+std::vector<SnapshotInfo> Repository::listSnapshots() const {
+    std::vector<SnapshotInfo> snapshots;
+    std::error_code ec;
+    if (!std::filesystem::is_directory(snapshots_dir_, ec)) {
+        return snapshots;
+    }
+    for (const auto& entry : std::filesystem::directory_iterator(snapshots_dir_, ec)) {
+        if (entry.path().extension() != ".bin") {
+            continue;
+        }
+        SnapshotInfo info;
+        info.name = entry.path().stem().string();
+        if (!isValidSnapshotName(info.name)) {
+            continue;  // 写入中的临时文件等
+        }
+        struct stat st;
+        if (::stat(entry.path().string().c_str(), &st) == 0) {
+            info.created = st.st_mtime;
+#ifndef _WIN32
+            info.created_nsec = static_cast<std::uint32_t>(st.st_mtim.tv_nsec);
+#endif
+        }
+        BinaryIndex manifest;
+        if (manifest.open(entry.path())) {
+            info.files = manifest.size();
+            // 清单旁的目录汇总中根目录即为总字节数；没有时遍历清单
+            DirectoryStats dirs;
+            DirectoryTotals totals;
+            if (dirs.read(entry.path(), manifest.size()) && dirs.find("", totals)) {
+                info.bytes = totals.bytes;
+            } else {
+                Metadata metadata;
+                for (std::size_t i = 0; i < manifest.size(); ++i) {
+                    if (manifest.metadataAt(i, metadata)) {
+                        info.bytes += metadata.size;
+                    }
+                }
+            }
+        }
+        snapshots.push_back(std::move(info));
+    }
+    std::sort(snapshots.begin(), snapshots.end(), [](const SnapshotInfo& a, const SnapshotInfo& b) {
+        if (a.created != b.created) return a.created < b.created;
+        if (a.created_nsec != b.created_nsec) return a.created_nsec < b.created_nsec;
+        return a.name < b.name;
+    });
+    return snapshots;
+}
+
+bool Repository::deleteSnapshot(const std::string& name) {
+    std::error_code ec;
+    if (!isValidSnapshotName(name) || !std::filesystem::remove(snapshotPath(name), ec)) {
+        std::cerr << "删除快照失败: " << name;
+        if (ec) {
+            std::cerr << " - " << ec.message();
+        }
+        std::cerr << std::endl;
+        return false;
+    }
+    std::filesystem::remove(DirectoryStats::pathFor(snapshotPath(name)), ec);
+    return true;
+}
+
+bool Repository::collectGarbage(std::size_t& removed_chunks, std::size_t& removed_segments,
+                                std::uint64_t& removed_bytes) {
+    removed_chunks = 0;
+    removed_segments = 0;
+    removed_bytes = 0;
+    if (read_only_) {
+        std::cerr << "打开快照时不能回收数据" << std::endl;
+        return false;
+    }
+    try {
+        // 先标记：当前索引与所有快照清单引用的块和段；任何一份读不出来都不能安全删除
+        std::unordered_set<std::string> referenced;
+        std::unordered_set<std::uint32_t> segments;
+        if (!loadIndex()) {
+            return false;
+        }
+        Metadata metadata;
+        const IndexView current = files();
+        for (std::size_t i = 0; i < current.size(); ++i) {
+            if (!current.metadata(i, metadata)) {
+                // 读不出的条目引用了哪些块和段无从得知，继续回收会删除仍在使用的数据
+                std::cerr << "当前索引已损坏，停止回收: " << index_file_ << " 条目 " << i << std::endl;
+                return false;
+            }
+            if (metadata.chunked) {
+                referenced.insert(metadata.chunks.begin(), metadata.chunks.end());
+            }
+            if (metadata.packed) {
+                segments.insert(metadata.pack_segment);
+            }
+        }
+        // 中断的备份留下的日志：其中的条目在续传时会直接进入索引，引用的数据也要保留
+        auto mark = [&](const std::string&, const Metadata& entry) {
+            if (entry.chunked) {
+                referenced.insert(entry.chunks.begin(), entry.chunks.end());
+            }
+            if (entry.packed) {
+                segments.insert(entry.pack_segment);
+            }
+        };
+        if (!BackupJournal::read(journal_file_, mark)) {
+            std::cerr << "读取备份日志失败，停止回收: " << journal_file_ << std::endl;
+            return false;
+        }
+        for (const auto& snapshot : listSnapshots()) {
+            BinaryIndex manifest;
+            if (!manifest.open(snapshotPath(snapshot.name))) {
+                std::cerr << "读取快照清单失败，停止回收: " << snapshot.name << std::endl;
+                return false;
+            }
+            for (std::size_t i = 0; i < manifest.size(); ++i) {
+                if (!manifest.metadataAt(i, metadata)) {
+                    std::cerr << "快照清单已损坏，停止回收: " << snapshot.name << std::endl;
+                    return false;
+                }
+                referenced.insert(metadata.chunks.begin(), metadata.chunks.end());
+                if (metadata.packed) {
+                    segments.insert(metadata.pack_segment);
+                }
+            }
+        }
 
+        // 再清除：未被引用的块和段
+        removed_chunks = chunk_store_.removeUnreferenced(referenced, removed_bytes);
+        std::uint64_t segment_bytes = 0;
+        removed_segments = pack_store_.removeUnreferenced(segments, segment_bytes);
+        removed_bytes += segment_bytes;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "回收数据失败: " << e.what() << std::endl;
+        return false;
+    }
+}
 
+} // namespace backuprestore
@@ -1,13 +1,60 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <ctime>
 #include <string>
 #include <filesystem>
-#include <map>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <unordered_set>
 #include <vector>
+#include "core/batch_io.h"
+#include "core/binary_index.h"
+#include "core/dir_stats.h"
+#include "core/file_utils.h"
+#include "core/flat_index.h"
+#include "core/journal.h"
 #include "metadata/metadata.h"
+#include "storage/chunk_store.h"
+#include "storage/compressor.h"
+#include "storage/delta_store.h"
+#include "storage/pack_store.h"
 
 namespace backuprestore {
 
+/**
+ * @brief 快照概要（list-snapshots 使用）
+ */
+struct SnapshotInfo {
+    std::string name;
+    std::time_t created = 0;  // 清单文件的写入时间
+    std::uint32_t created_nsec = 0;
+    std::size_t files = 0;
+    std::uint64_t bytes = 0;  // 所引用文件的原始大小之和
+};
+
+/**
+ * @brief 批量存储中的一个文件（Repository::storeBatch）
+ */
+struct BatchStoreEntry {
+    std::filesystem::path source_path;
+    std::filesystem::path relative_path;
+    Metadata metadata;
+    bool ok = false;  // 输出：是否已存入仓库
+};
+
+/**
+ * @brief 批量还原中的一个文件（Repository::restoreBatch）
+ */
+struct BatchRestoreEntry {
+    std::filesystem::path relative_path;
+    std::filesystem::path target_path;
+    Metadata metadata;  // 输出：索引中的元数据
+    bool ok = false;    // 输出：是否已还原
+};
+
 /**
  * @brief 备份仓库类
  * 管理备份数据的存储结构和索引
@@ -26,6 +73,80 @@ public:
      */
     bool initialize();
 
+    /**
+     * @brief 设置是否使用去重块存储（内容定义分块，按哈希存储到 chunks/）
+     * 只影响之后的 storeFile；还原时按每个索引条目自身的存储方式读取
+     */
+    void setChunking(bool enabled) { chunking_ = enabled; }
+    bool isChunking() const { return chunking_; }
+
+    /**
+     * @brief 设置是否压缩 data/ 镜像数据（LzCompressor）
+     * 只影响之后的 storeFile 且只对镜像模式的普通文件生效；块存储中的块不压缩
+     * @param enabled 是否启用
+     * @param level 压缩级别（1-9）
+     */
+    void setCompression(bool enabled, int level = 6) {
+        compressing_ = enabled;
+        compressor_.setCompressionLevel(level);
+    }
+    bool isCompressing() const { return compressing_; }
+
+    /**
+     * @brief 设置镜像模式下是否用硬链接代替复制（源文件之后不会被修改时使用）
+     * 硬链接失败（如跨文件系统）时自动退回普通复制；只影响 storeFile
+     */
+    void setHardLink(bool enabled) { hardlink_ = enabled; }
+    bool isHardLink() const { return hardlink_; }
+
+    /**
+     * @brief 设置是否为普通文件记录内容校验和（XXH64，默认开启）
+     * 校验和在存储时边读边算；镜像模式下不小于 4 MiB 的文件仍用 reflink 等内核复制，
+     * 由另一个线程读取源文件计算，更小的文件用 read/write 边复制边计算
+     */
+    void setChecksums(bool enabled) { checksums_ = enabled; }
+    bool isChecksums() const { return checksums_; }
+
+    /**
+     * @brief 设置小文件打包阈值：镜像模式下小于该大小的普通文件追加到 packs/ 段文件，不再各占一个 inode
+     * 只影响之后的 storeFile；0 表示关闭（默认）。--compress 时段中的数据同样压缩
+     */
+    void setPackThreshold(std::uint64_t bytes) { pack_threshold_ = bytes; }
+    std::uint64_t getPackThreshold() const { return pack_threshold_; }
+
+    /**
+     * @brief 设置差量存储阈值：镜像模式下不小于该大小的普通文件修改后只保存相对上一版本的差量（deltas/）
+     * 只影响之后的 storeFile，且不与 --compress、--hardlink 同时生效；0 表示关闭（默认）
+     */
+    void setDeltaThreshold(std::uint64_t bytes) { delta_threshold_ = bytes; }
+    std::uint64_t getDeltaThreshold() const { return delta_threshold_; }
+
+    /**
+     * @brief 设置差量链的最大长度（默认 8）：达到后下一个版本整体存储，还原时最多叠加这么多个差量
+     */
+    void setDeltaDepth(std::uint32_t depth) { max_delta_depth_ = depth; }
+
+    /**
+     * @brief 按复制方式统计的文件数（storeFile 与还原共用），格式如 "reflink 3, read/write 1"
+     * @return 没有复制过文件时返回空串
+     */
+    std::string copyStatsSummary() const;
+
+    /**
+     * @brief 获取块存储（用于读取去重统计）
+     */
+    const ChunkStore& chunkStore() const { return chunk_store_; }
+
+    /**
+     * @brief 获取小文件段存储（用于读取打包统计）
+     */
+    const SimplePackStore& packStore() const { return pack_store_; }
+
+    /**
+     * @brief 获取差量存储（用于读取差量统计）
+     */
+    const DeltaStore& deltaStore() const { return delta_store_; }
+
     /**
      * @brief 保存文件到仓库
      * @param source_path 源文件路径
@@ -37,6 +158,28 @@ public:
                    const std::filesystem::path& relative_path,
                    const Metadata& metadata);
 
+    /**
+     * @brief 记录硬链接条目：数据由同一 inode 的 metadata.hardlink 条目保存，这里只写入索引
+     * 该路径之前自己保存的镜像或差量被删除
+     * @param relative_path 相对路径
+     * @param metadata 文件元数据（hardlink 为数据所在条目的相对路径）
+     * @return 是否成功
+     */
+    bool storeHardLink(const std::filesystem::path& relative_path, const Metadata& metadata);
+
+    /**
+     * @brief 该文件是否适合走 storeBatch 的批量路径（小普通文件，非块存储、非硬链接模式）
+     */
+    bool canStoreBatched(const Metadata& metadata) const;
+
+    /**
+     * @brief 批量保存一组文件：源文件经 io_uring 一次读入，镜像/压缩数据一次写出，段文件追加照常
+     * 结果与逐个调用 storeFile 相同；无法走批量路径或批量 I/O 失败的条目退回 storeFile。
+     * 可被多个线程同时调用，每个线程使用自己的 io
+     * @param entries 待存储的文件，结果写入各条目的 ok
+     */
+    void storeBatch(std::vector<BatchStoreEntry>& entries, BatchIo& io);
+
     /**
      * @brief 从仓库恢复文件
      * @param relative_path 相对路径
@@ -48,40 +191,385 @@ public:
                      const std::filesystem::path& target_path,
                      Metadata& metadata);
 
+    /**
+     * @brief 恢复文件数据并在写入用的 fd 上应用元数据（不创建父目录）
+     * 供并行还原使用：调用方先建好目录骨架
+     * @param relative_path 相对路径
+     * @param target_path 目标路径
+     * @param metadata 输出元数据
+     * @param sync SyncPolicy::File 时关闭前 fdatasync（其它策略由调用方在最后处理）
+     * @return 是否成功
+     */
+    bool restoreFileData(const std::filesystem::path& relative_path,
+                         const std::filesystem::path& target_path,
+                         Metadata& metadata,
+                         SyncPolicy sync = SyncPolicy::None);
+
+    /**
+     * @brief 还原硬链接条目：在 target_path 处创建指向 anchor（同一 inode 已还原的路径）的硬链接，已存在的文件先删除
+     * anchor 为空或无法链接（如文件系统不支持）时按 restoreFileData 从数据所在的条目复制数据
+     * @param metadata 输出元数据
+     * @return 是否成功
+     */
+    bool restoreHardLink(const std::filesystem::path& relative_path,
+                         const std::filesystem::path& anchor,
+                         const std::filesystem::path& target_path,
+                         Metadata& metadata,
+                         SyncPolicy sync = SyncPolicy::None);
+
+    /**
+     * @brief 批量恢复一组文件的数据并应用元数据（不创建父目录），语义同 restoreFileData
+     * 小的非稀疏普通文件经 io_uring 批量读取镜像、创建并写入目标、fdatasync 和关闭；
+     * 其它条目及批量 I/O 失败的条目退回逐个文件的还原路径
+     * @param entries 待还原的文件，结果写入各条目的 metadata 与 ok
+     */
+    void restoreBatch(std::vector<BatchRestoreEntry>& entries, BatchIo& io,
+                      SyncPolicy sync = SyncPolicy::None);
+
+    /**
+     * @brief 该条目能否分段并行还原（未压缩的 data/ 镜像普通文件，非稀疏、非硬链接；仅 POSIX）
+     */
+    bool canRestoreSplit(const Metadata& metadata) const;
+
+    /**
+     * @brief 分段还原第一步：创建（或截断）目标文件并设好长度（不创建父目录）
+     */
+    bool beginSplitRestore(const Metadata& metadata, const std::filesystem::path& target_path);
+
+    /**
+     * @brief 分段还原第二步：把镜像的 [offset, offset + length) 复制到目标的相同偏移，可被多个线程同时调用
+     */
+    bool restoreRange(const std::filesystem::path& relative_path, const std::filesystem::path& target_path,
+                      std::uint64_t offset, std::uint64_t length);
+
+    /**
+     * @brief 分段还原第三步：所有区段写完后在目标上应用元数据，SyncPolicy::File 时 fdatasync
+     */
+    bool finishSplitRestore(const std::filesystem::path& target_path, const Metadata& metadata,
+                            SyncPolicy sync = SyncPolicy::None);
+
+    /**
+     * @brief 仓库根目录
+     */
+    const std::filesystem::path& path() const { return repo_path_; }
+
+    /**
+     * @brief 校验仓库中一个条目的数据：重新读取（必要时解压/拼接块）并与索引中的大小和校验和比较
+     * 没有校验和的条目只比较大小；可被多个线程同时调用
+     * @param relative_path 相对路径
+     * @param metadata 该条目的索引元数据
+     * @param error 输出失败原因
+     * @return 数据完好时返回 true
+     */
+    bool verifyFile(const std::filesystem::path& relative_path,
+                    const Metadata& metadata,
+                    std::string& error) const;
+
+    /**
+     * @brief 判断文件自上次备份以来是否未变化（增量备份使用）
+     * @param relative_path 相对路径
+     * @param metadata 本次读取到的元数据
+     * @return true 表示索引中有一致的记录且仓库数据仍在
+     */
+    bool isUnchanged(const std::filesystem::path& relative_path,
+                     const Metadata& metadata) const;
+
+    /**
+     * @brief 删除索引中不在 keep 集合里的条目及其仓库数据（增量备份清理已删除文件）
+     * @param keep 需要保留的相对路径
+     * @return 删除的条目数
+     */
+    std::size_t retainOnly(const std::set<std::filesystem::path>& keep);
+
+    /**
+     * @brief 删除 remove 返回 true 的条目及其仓库数据（按路径顺序依次询问，删除方式同 retainOnly）
+     * @return 删除的条目数
+     */
+    std::size_t removeWhere(const std::function<bool(const std::string&, const Metadata&)>& remove);
+
+    /**
+     * @brief 开始记录备份日志（journal.bin）：之后每个存入仓库的条目都追加到日志，每 256 条写出一次
+     * 日志已存在（上次备份被中断）时先把其中的条目载入索引，增量比较据此跳过已完成的文件。
+     * 在 loadIndex 之后调用；saveIndex 成功后日志被删除
+     * @param resumed 输出从日志载入的条目数
+     * @return 是否成功
+     */
+    bool beginJournal(std::size_t& resumed);
+
+    /**
+     * @brief 写出日志中缓冲的条目（先写出它们引用的段数据）并关闭日志，日志文件保留供下次续传
+     * 备份被取消或失败时调用
+     */
+    void endJournal();
+
+    /**
+     * @brief 删除上次中断留下的日志（不续传）
+     */
+    void discardJournal();
+
     /**
      * @brief 保存索引（文件列表和元数据）
+     * 写出二进制索引 index.bin（临时文件 + rename），成功后删除旧的 index.txt 和备份日志
      * @return 是否成功
      */
     bool saveIndex();
 
     /**
      * @brief 加载索引
+     * 优先 mmap 打开 index.bin 原地查询（不整体解析）；不存在时读取旧格式 index.txt
      * @return 是否成功
      */
     bool loadIndex();
 
     /**
-     * @brief 获取仓库中的所有文件列表
+     * @brief 索引中所有条目的只读视图（按路径字节序），按下标或迭代器访问，不复制路径列表
+     * 视图在下一次修改或重新加载索引前有效
      */
-    std::vector<std::filesystem::path> listFiles() const;
+    IndexView files();
 
     /**
      * @brief 获取文件的元数据
      */
     bool getMetadata(const std::filesystem::path& relative_path, Metadata& metadata) const;
 
+    /**
+     * @brief 列出目录 dir（相对仓库根，'/' 分隔，空串为根目录）的直接子项中从第 offset 个起的至多 limit 个
+     * 子项按索引顺序排列（目录按"名称/"比较）；子目录附带子树的汇总，文件附带元数据。
+     * 在有序索引上二分跳过每个子目录的整棵子树，耗时与 offset + limit 成正比，与目录下的条目总数无关
+     * @param total 非空时输出直接子项总数
+     * @return dir 不存在或不是目录时返回 false
+     */
+    bool listDirectory(const std::string& dir, std::size_t offset, std::size_t limit,
+                       std::vector<DirectoryEntry>& entries, std::size_t* total = nullptr);
+
+    /**
+     * @brief 目录 dir 之下（递归）的文件数、字节数和直接子项数
+     * 首次调用时读取随索引写出的 .dirs 附属文件，不存在或与索引不符时遍历一遍索引统计，之后直接查表
+     * @return dir 不是目录时返回 false
+     */
+    bool directoryTotals(const std::string& dir, DirectoryTotals& totals);
+
+    /**
+     * @brief 快照名是否合法：非空，只含字母、数字和 . _ -，且不以 . 开头
+     */
+    static bool isValidSnapshotName(const std::string& name);
+
+    /**
+     * @brief 把当前索引保存为快照清单 snapshots/<name>.bin（格式同 index.bin）
+     * 清单只引用块存储中的块；所有普通文件条目都必须是块存储条目
+     * @return 同名快照已存在或有镜像条目时返回 false
+     */
+    bool createSnapshot(const std::string& name);
+
+    /**
+     * @brief 快照是否存在
+     */
+    bool hasSnapshot(const std::string& name) const;
+
+    /**
+     * @brief 之后的 loadIndex 改为只读地打开指定快照的清单（用于还原/校验历史版本）
+     * @return 快照不存在时返回 false
+     */
+    bool useSnapshot(const std::string& name);
+
+    /**
+     * @brief 列出所有快照，按创建时间从旧到新排列
+     */
+    std::vector<SnapshotInfo> listSnapshots() const;
+
+    /**
+     * @brief 删除快照清单（不删除数据，数据由 collectGarbage 回收）
+     */
+    bool deleteSnapshot(const std::string& name);
+
+    /**
+     * @brief 删除当前索引和所有快照都不再引用的块，以及不再有任何记录被引用的段文件
+     * 任一清单无法读取时不删除任何数据；仍有部分记录被引用的段整段保留
+     * @param removed_chunks 输出删除的块数
+     * @param removed_segments 输出删除的段文件数
+     * @param removed_bytes 输出删除的字节数（块与段合计）
+     * @return 是否成功
+     */
+    bool collectGarbage(std::size_t& removed_chunks, std::size_t& removed_segments,
+                        std::uint64_t& removed_bytes);
+
 private:
     std::filesystem::path repo_path_;
     std::filesystem::path data_dir_;   // 数据目录
-    std::filesystem::path index_file_; // 索引文件
+    std::filesystem::path index_file_; // 二进制索引文件（index.bin）
+    std::filesystem::path legacy_index_file_; // 旧版文本索引（index.txt，仅用于迁移读取）
+    std::filesystem::path snapshots_dir_;     // 快照清单目录（snapshots/）
+    std::filesystem::path journal_file_;      // 备份日志（journal.bin，仅在备份中断后存在）
+    bool read_only_ = false;                  // useSnapshot 之后索引只读
     
-    // 索引：相对路径 -> 元数据
-    std::map<std::filesystem::path, Metadata> index_;
+    // 索引：相对路径（'/' 分隔）-> 元数据
+    FlatIndex index_;
+    // 并行备份时保护 index_ 的写入
+    mutable std::mutex index_mutex_;
+
+    // 已 mmap 的二进制索引；disk_only_ 为 true 时查询直接走 disk_index_，index_ 为空
+    BinaryIndex disk_index_;
+    bool disk_only_ = false;
+
+    BackupJournal journal_;  // 由 index_mutex_ 保护
+
+    // 各目录的汇总，由 index_mutex_ 保护；索引修改或重新加载后失效
+    DirectoryStats dir_stats_;
+    bool dir_stats_valid_ = false;
+
+    ChunkStore chunk_store_;  // 去重块存储（chunks/）
+    bool chunking_ = false;
+
+    LzCompressor compressor_; // data/ 镜像数据的压缩器
+    bool compressing_ = false;
+
+    bool hardlink_ = false;
+    bool checksums_ = true;
+
+    SimplePackStore pack_store_;  // 小文件段存储（packs/）
+    std::uint64_t pack_threshold_ = 0;
+
+    DeltaStore delta_store_;  // 大文件的差量存储（deltas/）
+    std::uint64_t delta_threshold_ = 0;
+    std::uint32_t max_delta_depth_ = 8;
+
+    std::mutex dirs_mutex_;
+    std::unordered_set<std::string> known_dirs_;
+    // 各复制方式的使用次数（下标为 CopyStrategy）；还原路径是 const 的，因此为 mutable
+    mutable std::array<std::atomic<std::size_t>, static_cast<std::size_t>(CopyStrategy::Count)> copy_counts_{};
+
+    /**
+     * @brief 把源文件存入 data/ 镜像（未压缩）；按元数据中的类型处理，不再 stat 源文件
+     * @param checksum 非空时输出普通文件内容的 XXH64
+     * @param layout 非空时输出普通文件的数据区段表
+     */
+    bool storeMirror(const std::filesystem::path& source_path,
+                     const std::filesystem::path& storage_path,
+                     const Metadata& metadata,
+                     std::uint64_t* checksum,
+                     SparseMap* layout);
+
+    /**
+     * @brief 小文件整体读入内存，按需压缩后追加到段文件，并在 stored 中记录位置
+     * @param checksum 非空时输出文件内容的 XXH64
+     */
+    bool storePacked(const std::filesystem::path& source_path,
+                     const std::filesystem::path& relative_path,
+                     Metadata& stored,
+                     std::uint64_t* checksum);
+
+    /**
+     * @brief 把已读入内存的小文件内容（未压缩）按需压缩后追加到段文件，并在 stored 中记录位置
+     */
+    bool appendPacked(const std::uint8_t* data, std::size_t size,
+                      const std::filesystem::path& relative_path,
+                      Metadata& stored);
+
+    /**
+     * @brief 按当前设置为新存储的条目填写压缩、校验和与存储方式字段（数据尚未写入）
+     */
+    Metadata prepareStored(const Metadata& metadata) const;
+
+    /**
+     * @brief 数据写入后把条目记入索引；改存到段文件时删除旧的 data/ 镜像，不再按差量存储时删除旧的差量
+     */
+    void commitStored(const std::filesystem::path& relative_path, Metadata&& stored);
+
+    /**
+     * @brief 先写出段数据再写出日志缓冲（调用方需持有 index_mutex_）；失败时停止记录日志
+     */
+    void flushJournal();
+
+    /**
+     * @brief 按当前设置，该条目是否应存入段文件
+     */
+    bool shouldPack(const Metadata& metadata) const;
+
+    /**
+     * @brief 按当前设置，该条目是否按差量存储
+     */
+    bool shouldDelta(const Metadata& metadata) const;
+
+    /**
+     * @brief 差量存储：上一版本可用时只写入差量，否则（首次存储、链已达上限、签名缺失）整体写入镜像
+     * 稀疏文件改为普通镜像存储；在 stored 中填写校验和与差量层数
+     */
+    bool storeDelta(const std::filesystem::path& source_path,
+                    const std::filesystem::path& relative_path,
+                    Metadata& stored);
+
+    /**
+     * @brief 确保目录存在；已创建过的目录记录在 known_dirs_ 中，之后不再访问文件系统
+     */
+    bool ensureDirectory(const std::filesystem::path& dir);
+
+    /**
+     * @brief 复制镜像数据并记录复制方式
+     */
+    bool copyData(const std::filesystem::path& from, const std::filesystem::path& to,
+                  bool create_parents, bool allow_hardlink) const;
 
     /**
      * @brief 获取文件在仓库中的存储路径
      */
     std::filesystem::path getStoragePath(const std::filesystem::path& relative_path) const;
+
+    /**
+     * @brief 将 mmap 索引完整解析进 index_（首次修改索引前调用，调用方需持有 index_mutex_）
+     */
+    void materialize();
+
+    /**
+     * @brief 把 index_ 写成二进制索引文件（调用方需持有 index_mutex_ 且已 materialize）
+     */
+    bool writeIndex(const std::filesystem::path& file);
+
+    /**
+     * @brief 快照清单文件路径
+     */
+    std::filesystem::path snapshotPath(const std::string& name) const;
+
+    /**
+     * @brief 按当前存储设置，新存储的条目应使用的压缩算法（空表示不压缩）
+     */
+    std::string compressionFor(const Metadata& metadata) const;
+
+    /**
+     * @brief 硬链接条目的数据所在条目：relative_path 与 metadata 换成该条目的路径和元数据
+     * @param error 目标条目不存在或本身也是硬链接条目时输出原因
+     * @return 是否找到
+     */
+    bool resolveHardLink(std::filesystem::path& relative_path, Metadata& metadata,
+                         std::string& error) const;
+
+    /**
+     * @brief 当前索引的目录汇总（调用方持有 index_mutex_）：按需读取附属文件或重新统计
+     */
+    const DirectoryStats& directoryStatsLocked();
+
+    /**
+     * @brief 查找待恢复文件的元数据
+     */
+    bool lookupForRestore(const std::filesystem::path& relative_path,
+                          Metadata& metadata) const;
+
+    /**
+     * @brief 按条目的存储方式（镜像、压缩镜像、差量、段文件或块存储）写出文件数据并应用元数据
+     */
+    bool restoreData(const std::filesystem::path& relative_path,
+                     const Metadata& metadata,
+                     const std::filesystem::path& target_path,
+                     bool create_parents,
+                     SyncPolicy sync) const;
+
+    /**
+     * @brief 按存储方式读出普通文件的数据区段内容（不含空洞），按顺序交给 sink
+     * @param error 失败时输出原因（sink 失败时也会填写）
+     */
+    bool readStoredData(const std::filesystem::path& relative_path,
+                        const Metadata& metadata,
+                        const ByteSink& sink,
+                        std::string& error) const;
 };
 
 } // namespace backuprestore
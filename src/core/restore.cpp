@@ -1,10 +1,28 @@
 #include "core/restore.h"
 #include "core/file_utils.h"
+#include "core/io_scheduler.h"
+#include "core/progress.h"
+#include "core/stats.h"
+#include "core/thread_pool.h"
 #include "metadata/metadata.h"
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <set>
+#include <unordered_map>
 
 namespace backuprestore {
 
+namespace {
+
+// 批量 I/O 时每批的文件数
+const std::size_t kBatchFiles = 64;
+
+// 不小于该大小的镜像文件交给调度器切成区段，由多个线程并行复制
+const std::uint64_t kSplitFileSize = 2 * IoScheduler::kDefaultChunkSize;
+
+} // namespace
+
 Restore::Restore(std::shared_ptr<Repository> repo) : repo_(repo) {
 }
 
@@ -15,47 +33,327 @@ bool Restore::execute(const std::filesystem::path& target_root) {
         return false;
     }
 
-    // 获取所有文件列表
-    auto files = repo_->listFiles();
-    std::cout << "仓库中有 " << files.size() << " 个文件" << std::endl;
+    // 索引视图：按下标访问条目，不复制整个路径列表；指定前缀时只包含对应的一段
+    const IndexView files = repo_->files().prefix(prefix_);
+    if (prefix_.empty()) {
+        std::cout << "仓库中有 " << files.size() << " 个文件" << std::endl;
+    } else if (files.empty()) {
+        std::cerr << "仓库中没有匹配的文件: " << prefix_ << std::endl;
+        return false;
+    } else {
+        std::cout << "仓库中 " << prefix_ << " 下有 " << files.size() << " 个文件" << std::endl;
+    }
 
     restore_count_ = 0;
     failed_count_ = 0;
 
-    // 还原每个文件
-    for (const auto& relative_path : files) {
-        if (restoreFile(relative_path, target_root)) {
+    // 第一步：目录骨架只创建一次，后续复制不再逐个检查父目录
+    std::vector<std::filesystem::path> dirs;
+    if (!createDirectorySkeleton(files, target_root, dirs)) {
+        return false;
+    }
+
+    // 第二步：并行还原；每个文件在写入用的 fd 上直接应用元数据后关闭
+    // 硬链接条目没有自己的数据，留到第二步之后链接到同一 inode 已还原的路径
+    std::size_t jobs = jobs_ == 0 ? ThreadPool::defaultThreads() : jobs_;
+    std::vector<char> linked(files.size(), 0);
+    std::vector<std::size_t> links;
+    std::vector<std::uint64_t> sizes(files.size(), 0);
+    std::unordered_map<std::size_t, Metadata> splits;  // 可分段并行复制的大镜像文件
+    {
+        std::uint64_t total_bytes = 0;
+        Metadata metadata;
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            if (files.metadata(i, metadata)) {
+                total_bytes += metadata.size;
+                sizes[i] = metadata.size;
+                if (!metadata.hardlink.empty()) {
+                    linked[i] = 1;
+                    links.push_back(i);
+                } else if (metadata.size >= kSplitFileSize && repo_->canRestoreSplit(metadata)) {
+                    splits.emplace(i, metadata);
+                }
+            }
+        }
+        if (progress_) {
+            progress_->start(files.size(), total_bytes, "还原");
+        }
+    }
+
+    const bool batched = batch_io_ && BatchIo::supported();
+    if (batch_io_ && !batched) {
+        std::cerr << "提示: 当前内核不支持 io_uring，改用线程池逐个文件还原" << std::endl;
+    }
+
+    std::vector<char> restored(files.size(), 0);
+    if (batched) {
+        const std::size_t batches = (files.size() + kBatchFiles - 1) / kBatchFiles;
+        ThreadPool::parallelFor(batches, jobs, [&](std::size_t b) {
+            const std::size_t begin = b * kBatchFiles;
+            restoreBatch(files, begin, std::min(files.size(), begin + kBatchFiles), target_root, linked,
+                         restored);
+        });
+    } else {
+        // 小文件与大文件分两条队列，按仓库与目标所在设备限制并发；未压缩的大镜像文件切成区段并行复制
+        IoScheduler scheduler(jobs);
+        const std::uint64_t src_dev = IoScheduler::deviceOf(repo_->path());
+        const std::uint64_t dst_dev = IoScheduler::deviceOf(target_root);
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            if (!linked[i]) {
+                scheduler.add(i, sizes[i], src_dev, dst_dev, splits.count(i) > 0);
+            }
+        }
+        IoScheduler::Splitter splitter;
+        splitter.begin = [&](std::size_t i) {
+            if (progress_ && progress_->cancelled()) {
+                return false;
+            }
+            return repo_->beginSplitRestore(splits.at(i), target_root / files.path(i));
+        };
+        splitter.range = [&](std::size_t i, std::uint64_t offset, std::uint64_t length) {
+            const std::filesystem::path relative_path = files.path(i);
+            return repo_->restoreRange(relative_path, target_root / relative_path, offset, length);
+        };
+        splitter.finish = [&](std::size_t i, bool ok) {
+            const std::filesystem::path relative_path = files.path(i);
+            const Metadata& metadata = splits.at(i);
+            ok = ok && repo_->finishSplitRestore(target_root / relative_path, metadata, sync_);
+            restored[i] = ok ? 1 : 0;
+            if (!ok && progress_ && progress_->cancelled()) {
+                return;
+            }
+            if (!ok) {
+                std::cerr << "还原文件失败: " << relative_path << std::endl;
+            }
+            if (progress_) {
+                if (ok) {
+                    progress_->fileDone(metadata.size);
+                } else {
+                    progress_->fileFailed();
+                }
+                progress_->poll(relative_path);
+            }
+        };
+        scheduler.run([&](std::size_t i) {
+            if (progress_ && progress_->cancelled()) {
+                return;
+            }
+            Metadata metadata;
+            const std::filesystem::path relative_path = files.path(i);
+            restored[i] = restoreFileData(relative_path, target_root, metadata) ? 1 : 0;
+            if (progress_) {
+                if (restored[i]) {
+                    progress_->fileDone(metadata.size);
+                } else {
+                    progress_->fileFailed();
+                }
+                progress_->poll(relative_path);
+            }
+        }, &splitter);
+    }
+
+    if (!links.empty()) {
+        restoreHardLinks(files, links, target_root, restored);
+    }
+
+    if (progress_ && progress_->cancelled()) {
+        progress_->finish(false);
+        std::cerr << "还原已取消" << std::endl;
+        return false;
+    }
+
+    // 第三步：按持久化策略落盘
+    if (!syncTarget(target_root, dirs)) {
+        std::cerr << "警告: 还原结果未能全部落盘" << std::endl;
+    }
+
+    for (char ok : restored) {
+        if (ok) {
             restore_count_++;
         } else {
             failed_count_++;
         }
     }
 
+    if (progress_) {
+        progress_->finish(failed_count_ == 0);
+    }
+
     std::cout << "还原完成: " << restore_count_ << " 个文件已还原, " 
               << failed_count_ << " 个文件失败" << std::endl;
+    std::string copies = repo_->copyStatsSummary();
+    if (!copies.empty()) {
+        std::cout << "复制方式: " << copies << std::endl;
+    }
 
     return failed_count_ == 0;
 }
 
-bool Restore::restoreFile(const std::filesystem::path& relative_path,
-                          const std::filesystem::path& target_root) {
-    try {
-        // 计算目标路径
-        auto target_path = target_root / relative_path;
+bool Restore::createDirectorySkeleton(const IndexView& files,
+                                      const std::filesystem::path& target_root,
+                                      std::vector<std::filesystem::path>& created) {
+    // 收集所有祖先目录；std::set 的路径序保证父目录排在子目录之前
+    std::set<std::filesystem::path> dirs;
+    for (const auto& path : files) {
+        const std::filesystem::path relative_path(path);
+        for (auto dir = relative_path.parent_path(); !dir.empty(); dir = dir.parent_path()) {
+            if (!dirs.insert(dir).second) {
+                break;  // 更上层的目录已经收集过
+            }
+        }
+    }
 
-        // 从仓库恢复文件
-        Metadata metadata;
-        if (!repo_->restoreFile(relative_path, target_path, metadata)) {
+    if (!FileUtils::createDirectories(target_root)) {
+        return false;
+    }
+
+    created.clear();
+    created.reserve(dirs.size());
+    for (const auto& dir : dirs) {
+        std::error_code ec;
+        std::filesystem::create_directory(target_root / dir, ec);
+        if (ec) {
+            std::cerr << "创建目录失败: " << (target_root / dir) << " - " << ec.message() << std::endl;
             return false;
         }
+        created.push_back(dir);
+    }
+    return true;
+}
+
+bool Restore::syncTarget(const std::filesystem::path& target_root,
+                         const std::vector<std::filesystem::path>& dirs) const {
+    switch (sync_) {
+        case SyncPolicy::None:
+            return true;
+        case SyncPolicy::Filesystem:
+            return FileUtils::syncFilesystem(target_root);
+        case SyncPolicy::File:
+            break;
+    }
+    // 文件数据已逐个 fdatasync；再 fsync 各目录，使新建的目录项也持久化（子目录先于父目录）
+    bool ok = true;
+    for (auto it = dirs.rbegin(); it != dirs.rend(); ++it) {
+        ok = FileUtils::syncDirectory(target_root / *it) && ok;
+    }
+    return FileUtils::syncDirectory(target_root) && ok;
+}
+
+bool Restore::restoreFileData(const std::filesystem::path& relative_path,
+                              const std::filesystem::path& target_root,
+                              Metadata& metadata) {
+    try {
+        // 计算目标路径
+        auto target_path = target_root / relative_path;
 
-        return true;
+        // 从仓库恢复文件数据（计入单文件耗时直方图）
+        LatencyTimer latency;
+        return repo_->restoreFileData(relative_path, target_path, metadata, sync_);
     } catch (const std::exception& e) {
         std::cerr << "还原文件失败: " << relative_path << " - " << e.what() << std::endl;
         return false;
     }
 }
 
-} // namespace backuprestore
+void Restore::restoreHardLinks(const IndexView& files, const std::vector<std::size_t>& links,
+                               const std::filesystem::path& target_root,
+                               std::vector<char>& restored) {
+    // 数据所在条目在视图中的下标（不在本次还原范围内时没有）
+    std::vector<std::string> data_of(links.size());
+    std::unordered_map<std::string, std::size_t> data_index;
+    Metadata metadata;
+    for (std::size_t k = 0; k < links.size(); ++k) {
+        if (files.metadata(links[k], metadata)) {
+            data_of[k] = metadata.hardlink;
+            data_index.emplace(metadata.hardlink, files.size());
+        }
+    }
+    for (auto it = files.begin(); it != files.end(); ++it) {
+        auto found = data_index.find(*it);
+        if (found != data_index.end()) {
+            found->second = it.index();
+        }
+    }
+
+    // 每组链接到同一个已还原的路径；数据所在条目没有还原时，组内第一个链接复制数据后作为后续链接的目标
+    std::unordered_map<std::string, std::filesystem::path> anchors;
+    for (std::size_t k = 0; k < links.size(); ++k) {
+        if (progress_ && progress_->cancelled()) {
+            return;
+        }
+        const std::size_t i = links[k];
+        const std::filesystem::path relative_path = files.path(i);
+        const std::filesystem::path target_path = target_root / relative_path;
+        std::filesystem::path& anchor = anchors[data_of[k]];
+        if (anchor.empty() && !data_of[k].empty()) {
+            const std::size_t pos = data_index[data_of[k]];
+            if (pos < files.size() && restored[pos]) {
+                anchor = target_root / data_of[k];
+            }
+        }
+        try {
+            restored[i] = repo_->restoreHardLink(relative_path, anchor, target_path, metadata, sync_) ? 1 : 0;
+        } catch (const std::exception& e) {
+            std::cerr << "还原文件失败: " << relative_path << " - " << e.what() << std::endl;
+        }
+        if (restored[i] && anchor.empty()) {
+            anchor = target_path;
+        }
+        if (progress_) {
+            if (restored[i]) {
+                progress_->fileDone(metadata.size);
+            } else {
+                progress_->fileFailed();
+            }
+            progress_->poll(relative_path);
+        }
+    }
+}
 
+void Restore::restoreBatch(const IndexView& files, std::size_t begin, std::size_t end,
+                           const std::filesystem::path& target_root,
+                           const std::vector<char>& skip,
+                           std::vector<char>& restored) {
+    if (progress_ && progress_->cancelled()) {
+        return;
+    }
+    std::vector<BatchRestoreEntry> batch;
+    std::vector<std::size_t> owners;  // batch[k] 对应的视图下标
+    for (std::size_t i = begin; i < end; ++i) {
+        if (skip[i]) {
+            continue;
+        }
+        BatchRestoreEntry entry;
+        entry.relative_path = files.path(i);
+        entry.target_path = target_root / entry.relative_path;
+        batch.push_back(std::move(entry));
+        owners.push_back(i);
+    }
+    if (batch.empty()) {
+        return;
+    }
+    try {
+        // 每个工作线程持有一个队列，线程退出时释放
+        thread_local BatchIo io;
+        LatencyTimer latency(batch.size());
+        repo_->restoreBatch(batch, io, sync_);
+    } catch (const std::exception& e) {
+        std::cerr << "还原文件失败: " << batch.front().relative_path << " 等 " << batch.size() << " 个文件 - " << e.what() << std::endl;
+    }
+    for (std::size_t k = 0; k < batch.size(); ++k) {
+        const BatchRestoreEntry& entry = batch[k];
+        restored[owners[k]] = entry.ok ? 1 : 0;
+        if (progress_) {
+            if (entry.ok) {
+                progress_->fileDone(entry.metadata.size);
+            } else {
+                progress_->fileFailed();
+            }
+        }
+    }
+    if (progress_) {
+        progress_->poll(batch.back().relative_path);
+    }
+}
 
+} // namespace backuprestore
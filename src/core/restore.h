@@ -2,10 +2,15 @@
 
 #include <filesystem>
 #include <memory>
+#include <string>
+#include <vector>
+#include "core/file_utils.h"
 #include "core/repository.h"
 
 namespace backuprestore {
 
+class ProgressReporter;
+
 /**
  * @brief 还原操作类
  * 负责从仓库恢复文件到目录树
@@ -35,16 +40,83 @@ public:
      */
     std::size_t getFailedCount() const { return failed_count_; }
 
+    /**
+     * @brief 设置并行还原的工作线程数
+     * @param jobs 线程数（0 表示硬件并发数，1 表示串行）
+     */
+    void setJobs(std::size_t jobs) { jobs_ = jobs; }
+
+    /**
+     * @brief 设置持久化策略（默认 SyncPolicy::None）
+     */
+    void setSync(SyncPolicy sync) { sync_ = sync; }
+
+    /**
+     * @brief 设置进度汇总器（可选）
+     * 工作线程每还原一个文件累加计数并 poll；取消后不再还原新文件
+     */
+    void setProgress(ProgressReporter* progress) { progress_ = progress; }
+
+    /**
+     * @brief 设置是否使用 io_uring 批量 I/O（仅 Linux 5.6+）
+     * 小文件每 64 个一批读取仓库数据、写入目标并关闭（Repository::restoreBatch）；
+     * 内核不支持时提示后退回线程池逐个文件还原
+     */
+    void setBatchIo(bool enabled) { batch_io_ = enabled; }
+
+    /**
+     * @brief 只还原路径等于 prefix 或位于目录 prefix 之下的条目（相对仓库根，'/' 分隔；空串表示全部）
+     * 在有序索引中二分查找出对应的范围，不解析范围之外的条目
+     */
+    void setPrefix(const std::string& prefix) { prefix_ = prefix; }
+
 private:
     std::shared_ptr<Repository> repo_;
     std::size_t restore_count_ = 0;
     std::size_t failed_count_ = 0;
+    std::size_t jobs_ = 1;
+    SyncPolicy sync_ = SyncPolicy::None;
+    bool batch_io_ = false;
+    std::string prefix_;
+    ProgressReporter* progress_ = nullptr;
+
+    /**
+     * @brief 第一步：一次性创建所有文件所需的目录骨架
+     * @param created 输出创建的目录（相对路径，父目录在前）
+     * @return 是否成功
+     */
+    bool createDirectorySkeleton(const IndexView& files,
+                                 const std::filesystem::path& target_root,
+                                 std::vector<std::filesystem::path>& created);
+
+    /**
+     * @brief 第三步：按持久化策略同步目标目录（File 策略下 fsync 各目录，Filesystem 策略下 syncfs）
+     */
+    bool syncTarget(const std::filesystem::path& target_root,
+                    const std::vector<std::filesystem::path>& dirs) const;
+
+    /**
+     * @brief 第二步：还原单个文件（数据与元数据）
+     */
+    bool restoreFileData(const std::filesystem::path& relative_path,
+                         const std::filesystem::path& target_root,
+                         Metadata& metadata);
+
+    /**
+     * @brief 第二步（批量 I/O）：经本线程的 io_uring 队列还原 files[begin, end) 中 skip 未标记的条目
+     */
+    void restoreBatch(const IndexView& files, std::size_t begin, std::size_t end,
+                      const std::filesystem::path& target_root,
+                      const std::vector<char>& skip,
+                      std::vector<char>& restored);
 
     /**
-     * @brief 还原单个文件
+     * @brief 第二步之后：硬链接条目 files[links[k]] 链接到同一 inode 已还原的路径（串行）
+     * 数据所在的条目不在本次还原范围内或还原失败时，组内第一个链接复制数据，其余链接到它
      */
-    bool restoreFile(const std::filesystem::path& relative_path,
-                     const std::filesystem::path& target_root);
+    void restoreHardLinks(const IndexView& files, const std::vector<std::size_t>& links,
+                          const std::filesystem::path& target_root,
+                          std::vector<char>& restored);
 };
 
 } // namespace backuprestore
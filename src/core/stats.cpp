@@ -0,0 +1,172 @@
+#include "core/stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
+
+namespace backuprestore {
+
+namespace {
+
+std::atomic<bool> g_enabled{false};
+
+/**
+ * @brief 一个线程的计数块：只有所属线程写入，用 relaxed load+store 累加（普通读改写，无 lock 前缀），
+ * snapshot 从其它线程读取时不会撕裂
+ */
+struct ThreadCounters {
+    struct Phase {
+        std::atomic<std::uint64_t> ns{0};
+        std::atomic<std::uint64_t> bytes{0};
+        std::atomic<std::uint64_t> ops{0};
+    };
+
+    std::array<Phase, kStatPhaseCount> phases;
+    std::array<std::atomic<std::uint64_t>, kLatencyBuckets> latency{};
+    std::atomic<std::uint64_t> latency_count{0};
+    std::atomic<std::uint64_t> latency_max_ns{0};
+
+    ThreadCounters();
+    ~ThreadCounters();
+};
+
+void bump(std::atomic<std::uint64_t>& counter, std::uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 全局登记表：存活线程的计数块 + 已退出线程的累计
+ */
+struct Registry {
+    std::mutex mutex;
+    std::unordered_set<ThreadCounters*> live;
+    Stats::Report retired;
+};
+
+Registry& registry() {
+    // 有意不析构：线程局部计数块可能在静态对象析构之后才退出
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+void accumulate(Stats::Report& report, const ThreadCounters& counters) {
+    for (std::size_t i = 0; i < kStatPhaseCount; ++i) {
+        report.phases[i].ns += counters.phases[i].ns.load(std::memory_order_relaxed);
+        report.phases[i].bytes += counters.phases[i].bytes.load(std::memory_order_relaxed);
+        report.phases[i].ops += counters.phases[i].ops.load(std::memory_order_relaxed);
+    }
+    for (std::size_t i = 0; i < kLatencyBuckets; ++i) {
+        report.latency[i] += counters.latency[i].load(std::memory_order_relaxed);
+    }
+    report.latency_count += counters.latency_count.load(std::memory_order_relaxed);
+    report.latency_max_ns = std::max(report.latency_max_ns,
+                                     counters.latency_max_ns.load(std::memory_order_relaxed));
+}
+
+ThreadCounters::ThreadCounters() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.live.insert(this);
+}
+
+ThreadCounters::~ThreadCounters() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    accumulate(r.retired, *this);
+    r.live.erase(this);
+}
+
+ThreadCounters& local() {
+    thread_local ThreadCounters counters;
+    return counters;
+}
+
+std::size_t bucketFor(std::uint64_t ns) {
+    std::uint64_t us = ns / 1000;
+    std::size_t bucket = 0;
+    while (us > 0 && bucket + 1 < kLatencyBuckets) {
+        us >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+} // namespace
+
+void Stats::enable(bool enabled) {
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Stats::enabled() {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void Stats::add(StatPhase phase, std::uint64_t ns, std::uint64_t bytes, std::uint64_t ops) {
+    auto& counters = local().phases[static_cast<std::size_t>(phase)];
+    bump(counters.ns, ns);
+    bump(counters.bytes, bytes);
+    bump(counters.ops, ops);
+}
+
+void Stats::recordLatency(std::uint64_t ns) {
+    ThreadCounters& counters = local();
+    bump(counters.latency[bucketFor(ns)], 1);
+    bump(counters.latency_count, 1);
+    if (ns > counters.latency_max_ns.load(std::memory_order_relaxed)) {
+        counters.latency_max_ns.store(ns, std::memory_order_relaxed);
+    }
+}
+
+Stats::Report Stats::snapshot() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    Report report = r.retired;
+    for (const ThreadCounters* counters : r.live) {
+        accumulate(report, *counters);
+    }
+    return report;
+}
+
+const char* Stats::phaseName(StatPhase phase) {
+    switch (phase) {
+        case StatPhase::Scan:          return "scan";
+        case StatPhase::Stat:          return "stat";
+        case StatPhase::Filter:        return "filter";
+        case StatPhase::Read:          return "read";
+        case StatPhase::Compress:      return "compress";
+        case StatPhase::Encrypt:       return "encrypt";
+        case StatPhase::Write:         return "write";
+        case StatPhase::MetadataApply: return "metadata_apply";
+        case StatPhase::IndexSave:     return "index_save";
+        case StatPhase::Count:         break;
+    }
+    return "unknown";
+}
+
+std::uint64_t Stats::bucketUpperUs(std::size_t bucket) {
+    if (bucket + 1 >= kLatencyBuckets) {
+        return 0;
+    }
+    return std::uint64_t(1) << bucket;
+}
+
+std::uint64_t Stats::percentileUs(const Report& report, double quantile) {
+    if (report.latency_count == 0) {
+        return 0;
+    }
+    const double target = quantile * static_cast<double>(report.latency_count);
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kLatencyBuckets; ++i) {
+        seen += report.latency[i];
+        if (report.latency[i] > 0 && static_cast<double>(seen) >= target) {
+            std::uint64_t upper = bucketUpperUs(i);
+            // 最后一桶没有上界，用最大值代替；上界也不超过实际最大值
+            std::uint64_t max_us = (report.latency_max_ns + 999) / 1000;
+            return upper == 0 ? max_us : std::min(upper, max_us);
+        }
+    }
+    return (report.latency_max_ns + 999) / 1000;
+}
+
+} // namespace backuprestore
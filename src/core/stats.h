@@ -0,0 +1,152 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace backuprestore {
+
+/**
+ * @brief 计时阶段
+ * 各阶段的耗时按线程累加（多线程时可能超过总耗时）；
+ * compress/encrypt 同时包含解压/解密，write 也包含内核内复制（reflink/copy_file_range/sendfile）
+ */
+enum class StatPhase {
+    Scan,           // 读取目录项（getdents）
+    Stat,           // 扫描时 stat / readlink
+    Filter,         // 过滤器判定
+    Read,           // 从源文件或仓库读取数据
+    Compress,       // 压缩/解压
+    Encrypt,        // 加密/解密
+    Write,          // 写入仓库、目标文件或包文件
+    MetadataApply,  // 还原时应用权限/属主/时间
+    IndexSave,      // 保存仓库索引
+    Count
+};
+
+constexpr std::size_t kStatPhaseCount = static_cast<std::size_t>(StatPhase::Count);
+
+/**
+ * @brief 单个文件存储/还原耗时的直方图桶数：桶 0 为 <1us，桶 k 为 [2^(k-1), 2^k) us，最后一桶不设上限
+ */
+constexpr std::size_t kLatencyBuckets = 32;
+
+/**
+ * @brief 阶段计数器与单文件耗时直方图
+ *
+ * 计数写入线程局部的计数块（只有所属线程写，relaxed 原子读写，没有锁也没有总线竞争），
+ * 线程退出时并入全局累计，snapshot() 汇总全局累计与仍存活线程的计数块。
+ * 未启用时 StatTimer 只做一次 relaxed 读取，不取时间
+ */
+class Stats {
+public:
+    struct PhaseTotals {
+        std::uint64_t ns = 0;
+        std::uint64_t bytes = 0;
+        std::uint64_t ops = 0;
+    };
+
+    struct Report {
+        std::array<PhaseTotals, kStatPhaseCount> phases{};
+        std::array<std::uint64_t, kLatencyBuckets> latency{};
+        std::uint64_t latency_count = 0;
+        std::uint64_t latency_max_ns = 0;
+    };
+
+    static void enable(bool enabled);
+
+    static bool enabled();
+
+    /**
+     * @brief 单调时钟（纳秒）
+     */
+    static std::uint64_t now() {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    /**
+     * @brief 累加一个阶段的耗时、字节数和操作数（调用方已确认 enabled()）
+     */
+    static void add(StatPhase phase, std::uint64_t ns, std::uint64_t bytes, std::uint64_t ops = 1);
+
+    /**
+     * @brief 记录一个文件的存储/还原耗时
+     */
+    static void recordLatency(std::uint64_t ns);
+
+    /**
+     * @brief 汇总所有线程的计数（其它线程可能仍在累加，结果是某一时刻的近似值）
+     */
+    static Report snapshot();
+
+    static const char* phaseName(StatPhase phase);
+
+    /**
+     * @brief 直方图桶 bucket 的上界（微秒，不含）；最后一桶返回 0 表示无上界
+     */
+    static std::uint64_t bucketUpperUs(std::size_t bucket);
+
+    /**
+     * @brief 按直方图估计的分位数（取所在桶的上界，微秒）
+     */
+    static std::uint64_t percentileUs(const Report& report, double quantile);
+};
+
+/**
+ * @brief 作用域计时：析构时把耗时计入 phase；字节数可在作用域内补充
+ */
+class StatTimer {
+public:
+    explicit StatTimer(StatPhase phase, std::uint64_t bytes = 0)
+        : phase_(phase), bytes_(bytes), active_(Stats::enabled()), start_(active_ ? Stats::now() : 0) {
+    }
+
+    ~StatTimer() {
+        if (active_) {
+            Stats::add(phase_, Stats::now() - start_, bytes_);
+        }
+    }
+
+    StatTimer(const StatTimer&) = delete;
+    StatTimer& operator=(const StatTimer&) = delete;
+
+    void addBytes(std::uint64_t bytes) { bytes_ += bytes; }
+
+private:
+    StatPhase phase_;
+    std::uint64_t bytes_;
+    bool active_;
+    std::uint64_t start_;
+};
+
+/**
+ * @brief 作用域计时：析构时把耗时记入单文件耗时直方图
+ * 批量处理多个文件时按文件数均摊，每个文件记一次平均耗时
+ */
+class LatencyTimer {
+public:
+    explicit LatencyTimer(std::size_t files = 1)
+        : active_(Stats::enabled() && files > 0), files_(files), start_(active_ ? Stats::now() : 0) {}
+
+    ~LatencyTimer() {
+        if (active_) {
+            const std::uint64_t each = (Stats::now() - start_) / files_;
+            for (std::size_t i = 0; i < files_; ++i) {
+                Stats::recordLatency(each);
+            }
+        }
+    }
+
+    LatencyTimer(const LatencyTimer&) = delete;
+    LatencyTimer& operator=(const LatencyTimer&) = delete;
+
+private:
+    bool active_;
+    std::size_t files_;
+    std::uint64_t start_;
+};
+
+} // namespace backuprestore
@@ -0,0 +1,100 @@
+#include "core/thread_pool.h"
+#include <atomic>
+#include <iostream>
+
+namespace backuprestore {
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0) {
+        threads = defaultThreads();
+    }
+    workers_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    task_cv_.notify_all();
+    for (auto& t : workers_) {
+        t.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    task_cv_.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return tasks_.empty() && active_ == 0; });
+}
+
+std::size_t ThreadPool::defaultThreads() {
+    unsigned int n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+void ThreadPool::parallelFor(std::size_t count, std::size_t jobs,
+                             const std::function<void(std::size_t)>& fn) {
+    if (jobs <= 1 || count <= 1) {
+        for (std::size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    // 动态分配下标：文件大小差异很大，静态切分容易让某个线程拖尾
+    std::atomic<std::size_t> next{0};
+    ThreadPool pool(jobs < count ? jobs : count);
+    for (std::size_t t = 0; t < pool.size(); ++t) {
+        pool.submit([&] {
+            for (std::size_t i = next.fetch_add(1, std::memory_order_relaxed);
+                 i < count;
+                 i = next.fetch_add(1, std::memory_order_relaxed)) {
+                fn(i);
+            }
+        });
+    }
+    pool.wait();
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            task_cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;  // stopping_ 且队列已空
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+            ++active_;
+        }
+
+        try {
+            task();
+        } catch (const std::exception& e) {
+            std::cerr << "线程池任务异常: " << e.what() << std::endl;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --active_;
+            if (tasks_.empty() && active_ == 0) {
+                done_cv_.notify_all();
+            }
+        }
+    }
+}
+
+} // namespace backuprestore
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace backuprestore {
+
+/**
+ * @brief 固定大小的线程池
+ * 用于并行备份/还原，任务之间不保证执行顺序
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief 构造函数
+     * @param threads 工作线程数（0 表示使用 defaultThreads()）
+     */
+    explicit ThreadPool(std::size_t threads);
+
+    /**
+     * @brief 析构时等待所有任务完成并回收线程
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief 提交任务
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * @brief 阻塞直到已提交的任务全部完成
+     */
+    void wait();
+
+    /**
+     * @brief 工作线程数
+     */
+    std::size_t size() const { return workers_.size(); }
+
+    /**
+     * @brief 默认线程数（硬件并发数，至少为1）
+     */
+    static std::size_t defaultThreads();
+
+    /**
+     * @brief 并行处理 [0, count) 区间，jobs<=1 时在当前线程顺序执行
+     * @param count 任务数量
+     * @param jobs 并发数
+     * @param fn 处理函数，参数为下标
+     */
+    static void parallelFor(std::size_t count, std::size_t jobs,
+                            const std::function<void(std::size_t)>& fn);
+
+private:
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable task_cv_;
+    std::condition_variable done_cv_;
+    std::size_t active_ = 0;
+    bool stopping_ = false;
+
+    void workerLoop();
+};
+
+} // namespace backuprestore
@@ -0,0 +1,67 @@
+#include "core/verify.h"
+#include "core/thread_pool.h"
+#include "metadata/metadata.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace backuprestore {
+
+Verify::Verify(std::shared_ptr<Repository> repo) : repo_(repo) {
+}
+
+bool Verify::execute() {
+    if (!repo_->loadIndex()) {
+        std::cerr << "加载索引失败" << std::endl;
+        return false;
+    }
+
+    const IndexView files = repo_->files();
+    std::cout << "仓库中有 " << files.size() << " 个文件" << std::endl;
+
+    verified_count_ = 0;
+    failed_count_ = 0;
+    unchecked_count_ = 0;
+
+    // 各文件互不相关，按下标写结果，避免加锁；失败信息最后按索引顺序输出
+    std::size_t jobs = jobs_ == 0 ? ThreadPool::defaultThreads() : jobs_;
+    std::vector<char> passed(files.size(), 0);
+    std::vector<char> checked(files.size(), 0);
+    std::vector<std::string> errors(files.size());
+    ThreadPool::parallelFor(files.size(), jobs, [&](std::size_t i) {
+        Metadata metadata;
+        if (!files.metadata(i, metadata)) {
+            errors[i] = "索引中没有元数据";
+            return;
+        }
+        checked[i] = (metadata.is_symlink || metadata.has_checksum || !metadata.hardlink.empty()) ? 1 : 0;
+        try {
+            passed[i] = repo_->verifyFile(files.path(i), metadata, errors[i]) ? 1 : 0;
+        } catch (const std::exception& e) {
+            errors[i] = e.what();
+        }
+    });
+
+    for (auto it = files.begin(); it != files.end(); ++it) {
+        const std::size_t i = it.index();
+        if (!passed[i]) {
+            std::cerr << "校验失败: " << std::filesystem::path(*it) << " - " << errors[i] << std::endl;
+            failed_count_++;
+        } else if (checked[i]) {
+            verified_count_++;
+        } else {
+            unchecked_count_++;
+        }
+    }
+
+    std::cout << "校验完成: " << verified_count_ << " 个文件通过, "
+              << failed_count_ << " 个文件失败";
+    if (unchecked_count_ > 0) {
+        std::cout << ", " << unchecked_count_ << " 个文件没有校验和（只检查了大小）";
+    }
+    std::cout << std::endl;
+
+    return failed_count_ == 0;
+}
+
+} // namespace backuprestore
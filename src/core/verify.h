@@ -0,0 +1,56 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include "core/repository.h"
+
+namespace backuprestore {
+
+/**
+ * @brief 仓库校验操作类
+ * 重新读取仓库中每个文件的数据，与索引记录的大小和 XXH64 校验和比较
+ */
+class Verify {
+public:
+    /**
+     * @brief 构造函数
+     * @param repo 备份仓库
+     */
+    explicit Verify(std::shared_ptr<Repository> repo);
+
+    /**
+     * @brief 执行校验
+     * @return 所有文件都通过时返回 true
+     */
+    bool execute();
+
+    /**
+     * @brief 获取通过校验的文件数量
+     */
+    std::size_t getVerifiedCount() const { return verified_count_; }
+
+    /**
+     * @brief 获取校验失败的文件数量
+     */
+    std::size_t getFailedCount() const { return failed_count_; }
+
+    /**
+     * @brief 获取没有校验和（只检查了大小）的文件数量
+     */
+    std::size_t getUncheckedCount() const { return unchecked_count_; }
+
+    /**
+     * @brief 设置并行校验的工作线程数
+     * @param jobs 线程数（0 表示硬件并发数，1 表示串行）
+     */
+    void setJobs(std::size_t jobs) { jobs_ = jobs; }
+
+private:
+    std::shared_ptr<Repository> repo_;
+    std::size_t verified_count_ = 0;
+    std::size_t failed_count_ = 0;
+    std::size_t unchecked_count_ = 0;
+    std::size_t jobs_ = 0;
+};
+
+} // namespace backuprestore
@@ -0,0 +1,306 @@
+#include "core/watch.h"
+#include "core/dir_scanner.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace backuprestore {
+
+namespace {
+
+// 路径本身或某级父目录在 dirs 中
+bool coveredBy(const std::set<std::string>& dirs, const std::string& path) {
+    for (std::size_t pos = path.size(); pos != std::string::npos && pos > 0; pos = path.rfind('/', pos - 1)) {
+        if (dirs.count(path.substr(0, pos))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string joinPath(const std::string& dir, const char* name) {
+    return dir.empty() ? std::string(name) : dir + "/" + name;
+}
+
+std::string timestamp() {
+    std::time_t now = std::time(nullptr);
+    std::tm tm{};
+#ifdef _WIN32
+    localtime_s(&tm, &now);
+#else
+    localtime_r(&now, &tm);
+#endif
+    char buf[16];
+    std::size_t n = std::strftime(buf, sizeof(buf), "%H:%M:%S", &tm);
+    return std::string(buf, n);
+}
+
+#ifdef __linux__
+const std::uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY |
+                                 IN_CLOSE_WRITE | IN_ATTRIB | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+#endif
+
+} // namespace
+
+Watch::Watch(Backup& backup) : backup_(backup) {
+}
+
+Watch::~Watch() {
+#ifdef __linux__
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+#endif
+}
+
+bool Watch::supported() {
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Watch::execute(const std::filesystem::path& source_root, const FilterBase* filter) {
+#ifdef __linux__
+    root_ = source_root;
+    filter_ = filter;
+    fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ < 0) {
+        std::cerr << "无法创建 inotify 实例: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // 先添加监视再做首次备份：备份过程中发生的变化留到下一轮
+    addWatches("");
+    std::cout << "监视 " << dirs_.size() << " 个目录" << std::endl;
+    if (!backup_.execute(root_, filter_)) {
+        return false;
+    }
+
+    std::cout << "持续备份: 每 " << interval_ << " 秒备份一次变化的文件，Ctrl-C 退出" << std::endl;
+    while (!stopping()) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(interval_);
+        for (;;) {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (left <= 0 || stopping()) {
+                break;
+            }
+            pollfd pfd{fd_, POLLIN, 0};
+            // 信号会使 poll 以 EINTR 返回，随即检查停止标志
+            if (::poll(&pfd, 1, static_cast<int>(left)) > 0) {
+                readEvents();
+            }
+        }
+        readEvents();
+        if (!dirty_files_.empty() || !dirty_dirs_.empty() || rescan_ || limited_) {
+            flush();
+        }
+    }
+
+    std::cout << "持续备份已停止: " << flush_count_ << " 轮只备份变化的文件, "
+              << rescan_count_ << " 轮完整备份" << std::endl;
+    return true;
+#else
+    (void)source_root;
+    (void)filter;
+    std::cerr << "持续备份仅支持 Linux" << std::endl;
+    return false;
+#endif
+}
+
+void Watch::addWatches(const std::string& relative) {
+#ifdef __linux__
+    auto add = [&](const std::string& dir) {
+        int wd = ::inotify_add_watch(fd_, (root_ / dir).c_str(), kWatchMask);
+        if (wd >= 0) {
+            dirs_[wd] = dir;  // 同一目录再次添加时返回原来的描述符
+            return true;
+        }
+        if (errno == ENOSPC && !limited_) {
+            limited_ = true;
+            std::cerr << "警告: inotify 监视数达到上限（fs.inotify.max_user_watches），改为每轮完整备份"
+                      << std::endl;
+        }
+        return false;
+    };
+    if (!add(relative) || limited_) {
+        return;
+    }
+
+    std::error_code ec;
+    std::filesystem::recursive_directory_iterator it(
+        root_ / relative, std::filesystem::directory_options::skip_permission_denied, ec), end;
+    for (; !ec && it != end; it.increment(ec)) {
+        std::error_code type_ec;
+        if (it->is_symlink(type_ec) || !it->is_directory(type_ec)) {
+            continue;
+        }
+        if (filter_ && !filter_->shouldDescend(it->path())) {
+            it.disable_recursion_pending();
+            continue;
+        }
+        const std::string dir = it->path().lexically_relative(root_).generic_string();
+        if (!add(dir) && limited_) {
+            return;
+        }
+    }
+#else
+    (void)relative;
+#endif
+}
+
+void Watch::removeWatches(const std::string& relative) {
+#ifdef __linux__
+    const std::string prefix = relative + "/";
+    for (auto it = dirs_.begin(); it != dirs_.end();) {
+        if (it->second == relative || it->second.compare(0, prefix.size(), prefix) == 0) {
+            ::inotify_rm_watch(fd_, it->first);
+            it = dirs_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+#else
+    (void)relative;
+#endif
+}
+
+void Watch::readEvents() {
+#ifdef __linux__
+    alignas(inotify_event) char buffer[64 * 1024];
+    for (;;) {
+        ssize_t n = ::read(fd_, buffer, sizeof(buffer));
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return;  // EAGAIN：队列已读空
+        }
+        for (char* p = buffer; p < buffer + n;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) {
+                std::cerr << "警告: inotify 事件队列溢出，下一轮执行完整的增量备份" << std::endl;
+                rescan_ = true;
+                continue;
+            }
+            auto dir = dirs_.find(event->wd);
+            if (dir == dirs_.end()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                dirs_.erase(dir);  // 目录已删除或监视已移除
+                continue;
+            }
+            if (event->len == 0 || event->name[0] == '\0') {
+                continue;  // 目录自身的事件，由父目录中的事件覆盖
+            }
+            const std::string path = joinPath(dir->second, event->name);
+            if (!(event->mask & IN_ISDIR)) {
+                dirty_files_.insert(path);
+            } else if (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)) {
+                if (event->mask & IN_MOVED_FROM) {
+                    removeWatches(path);
+                }
+                dirty_dirs_.insert(path);
+            }
+        }
+    }
+#endif
+}
+
+void Watch::flush() {
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t changes = dirty_files_.size() + dirty_dirs_.size();
+    bool ok;
+    bool rescan = rescan_ || limited_;
+    if (rescan) {
+        // 丢失的事件可能包括新建的目录：重新添加监视，再完整比较一遍
+        if (rescan_) {
+            addWatches("");
+        }
+        rescan_ = false;
+        dirty_files_.clear();
+        dirty_dirs_.clear();
+        ok = backup_.execute(root_, filter_);
+    } else {
+        // 变化的目录整棵重新扫描；位于这些目录之下的路径不再单独处理
+        std::vector<FileRecord> records;
+        std::vector<std::string> scope;
+        std::set<std::string> scanned;
+        auto scanDir = [&](const std::string& dir) {
+            if (filter_ && !filter_->shouldDescend(root_ / dir)) {
+                return;
+            }
+            addWatches(dir);
+            DirScanner::scan(root_, records, 1, filter_, false, dir);
+        };
+        for (const auto& dir : dirty_dirs_) {
+            if (coveredBy(scanned, dir)) {
+                continue;
+            }
+            scanned.insert(dir);
+            scope.push_back(dir);
+            FileRecord record;
+            if (DirScanner::statEntry(root_, dir, record) == DirScanner::EntryKind::Directory) {
+                scanDir(dir);
+            }
+        }
+        for (const auto& file : dirty_files_) {
+            if (coveredBy(scanned, file)) {
+                continue;
+            }
+            scope.push_back(file);
+            FileRecord record;
+            switch (DirScanner::statEntry(root_, file, record)) {
+                case DirScanner::EntryKind::File:
+                    records.push_back(std::move(record));
+                    break;
+                case DirScanner::EntryKind::Directory:
+                    scanDir(file);  // 事件之后路径被替换成了目录
+                    break;
+                default:
+                    break;  // 已删除或不支持的类型：从仓库中移除
+            }
+        }
+        dirty_files_.clear();
+        dirty_dirs_.clear();
+        ok = backup_.executeChanges(root_, records, scope, filter_);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!ok) {
+        // 本轮的变化可能只存了一部分：下一轮完整比较
+        if (!stopping()) {
+            std::cerr << "警告: 本轮备份失败，下一轮执行完整的增量备份" << std::endl;
+        }
+        rescan_ = true;
+        return;
+    }
+    if (rescan) {
+        ++rescan_count_;
+        return;  // 完整备份已输出汇总
+    }
+    ++flush_count_;
+    char elapsed[32];
+    std::snprintf(elapsed, sizeof(elapsed), "%.2f", seconds);
+    std::cout << "[" << timestamp() << "] " << changes << " 个路径变化: " << backup_.getBackupCount()
+              << " 个文件已备份, " << backup_.getUnchangedCount() << " 个未变化, "
+              << backup_.getRemovedCount() << " 个已从仓库移除, 用时 " << elapsed << "s" << std::endl;
+}
+
+} // namespace backuprestore
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include "core/backup.h"
+#include "filters/filter_base.h"
+
+namespace backuprestore {
+
+/**
+ * @brief 持续备份（backup --watch）：监视源目录的变化，定期只备份变化的路径
+ *
+ * 启动时先为源目录下的每个目录添加 inotify 监视，再执行一次完整的增量备份；之后把收到的事件
+ * 合并为变化路径集合（同一路径多次变化只记一次），每个周期交给 Backup::executeChanges，
+ * 只 stat 和存储这些路径并保存索引，不再扫描整棵目录树。新建或移入的目录扫描其子树并添加监视。
+ * 事件队列溢出（IN_Q_OVERFLOW）、监视数达到上限或一轮备份失败时，退回完整的增量备份。仅 Linux
+ */
+class Watch {
+public:
+    /**
+     * @brief 构造函数
+     * @param backup 已设置好选项的备份操作（须为增量模式）
+     */
+    explicit Watch(Backup& backup);
+    ~Watch();
+
+    Watch(const Watch&) = delete;
+    Watch& operator=(const Watch&) = delete;
+
+    /**
+     * @brief 当前平台是否支持持续备份
+     */
+    static bool supported();
+
+    /**
+     * @brief 监视并备份，直到 stop 标志被设置；退出前把已收到的变化备份完
+     * @param source_root 源目录根路径
+     * @param filter 过滤器（可选）：shouldDescend 返回 false 的目录不添加监视
+     * @return 首次备份失败或无法监视时返回 false
+     */
+    bool execute(const std::filesystem::path& source_root, const FilterBase* filter = nullptr);
+
+    /**
+     * @brief 设置两次备份之间的间隔（秒，默认 10）
+     */
+    void setInterval(std::uint32_t seconds) { interval_ = seconds; }
+
+    /**
+     * @brief 设置停止标志（通常由 SIGINT/SIGTERM 处理函数设置）
+     */
+    void setStopFlag(const volatile std::sig_atomic_t* stop) { stop_ = stop; }
+
+    /**
+     * @brief 只备份变化路径的轮数、退回完整增量备份的轮数（不含首次备份）
+     */
+    std::size_t getFlushCount() const { return flush_count_; }
+    std::size_t getRescanCount() const { return rescan_count_; }
+
+private:
+    Backup& backup_;
+    std::uint32_t interval_ = 10;
+    const volatile std::sig_atomic_t* stop_ = nullptr;
+    std::filesystem::path root_;
+    const FilterBase* filter_ = nullptr;
+    int fd_ = -1;
+    std::unordered_map<int, std::string> dirs_;  // 监视描述符 -> 目录（相对源目录，根目录为空）
+    std::set<std::string> dirty_files_;
+    std::set<std::string> dirty_dirs_;           // 新建、删除或移动过的目录：整棵子树重新扫描
+    bool rescan_ = false;                        // 有事件丢失或上一轮失败，下一轮完整备份
+    bool limited_ = false;                       // 监视数达到上限，每轮都完整备份
+    std::size_t flush_count_ = 0;
+    std::size_t rescan_count_ = 0;
+
+    bool stopping() const { return stop_ && *stop_ != 0; }
+
+    /**
+     * @brief 为目录 relative 及其子目录添加监视（已监视的目录更新其路径）
+     */
+    void addWatches(const std::string& relative);
+
+    /**
+     * @brief 移除目录 relative 及其子目录的监视（目录被移走后，旧的监视会以旧路径报告事件）
+     */
+    void removeWatches(const std::string& relative);
+
+    /**
+     * @brief 读出队列中的所有事件，合并到变化路径集合
+     */
+    void readEvents();
+
+    /**
+     * @brief 备份收集到的变化并清空集合
+     */
+    void flush();
+};
+
+} // namespace backuprestore
@@ -0,0 +1,151 @@
+#include "filters/attribute_filter.h"
+#include "filters/path_matcher.h"
+
+#include <sys/stat.h>
+#include <cctype>
+#include <limits>
+
+namespace backuprestore {
+
+namespace {
+
+// 解析 "数字 + 可选后缀"，后缀转换为倍数；后缀未知时返回 false
+template <typename Multiplier>
+bool parseScaled(const std::string& text, std::uint64_t limit, std::uint64_t& value, Multiplier multiplier) {
+    std::size_t pos = 0;
+    std::uint64_t number = 0;
+    while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) {
+        std::uint64_t digit = static_cast<std::uint64_t>(text[pos] - '0');
+        if (number > (limit - digit) / 10) {
+            return false;
+        }
+        number = number * 10 + digit;
+        ++pos;
+    }
+    if (pos == 0) {
+        return false;
+    }
+    std::string suffix;
+    for (; pos < text.size(); ++pos) {
+        suffix += static_cast<char>(std::tolower(static_cast<unsigned char>(text[pos])));
+    }
+    std::uint64_t scale = 0;
+    if (!multiplier(suffix, scale)) {
+        return false;
+    }
+    if (number != 0 && scale > limit / number) {
+        return false;
+    }
+    value = number * scale;
+    return true;
+}
+
+} // namespace
+
+bool AttributeFilter::shouldInclude(const std::filesystem::path& path) const {
+    Metadata metadata;
+    if (!metadata.loadFromFile(path)) {
+        return false;
+    }
+    return matchMetadata(metadata);
+}
+
+bool AttributeFilter::shouldIncludeEntry(const std::filesystem::path&, const Metadata& metadata) const {
+    return matchMetadata(metadata);
+}
+
+SizeFilter::SizeFilter(std::uint64_t min_size, std::uint64_t max_size)
+    : min_size_(min_size), max_size_(max_size) {
+}
+
+bool SizeFilter::matchMetadata(const Metadata& metadata) const {
+    return metadata.size >= min_size_ && metadata.size <= max_size_;
+}
+
+TimeFilter::TimeFilter(std::time_t newer_than, std::time_t older_than)
+    : newer_than_(newer_than), older_than_(older_than) {
+}
+
+bool TimeFilter::matchMetadata(const Metadata& metadata) const {
+    return metadata.mtime >= newer_than_ && metadata.mtime < older_than_;
+}
+
+FileTypeFilter::FileTypeFilter(Kind kind)
+    : kind_(kind) {
+}
+
+bool FileTypeFilter::matchMetadata(const Metadata& metadata) const {
+    switch (kind_) {
+        case Kind::Symlink:
+            return metadata.is_symlink;
+        case Kind::Regular:
+#ifdef S_ISREG
+            return !metadata.is_symlink && S_ISREG(metadata.mode);
+#else
+            return !metadata.is_symlink;
+#endif
+    }
+    return false;
+}
+
+UserFilter::UserFilter(Field field, std::uint32_t id)
+    : field_(field), id_(id) {
+}
+
+bool UserFilter::matchMetadata(const Metadata& metadata) const {
+    return (field_ == Field::Uid ? metadata.uid : metadata.gid) == id_;
+}
+
+NameFilter::NameFilter(std::string pattern)
+    : pattern_(std::move(pattern)) {
+}
+
+bool NameFilter::shouldInclude(const std::filesystem::path& path) const {
+    const std::string& native = path.native();
+    std::size_t slash = native.find_last_of('/');
+    return PathMatcher::globMatch(pattern_, slash == std::string::npos ? native : native.substr(slash + 1));
+}
+
+bool parseSize(const std::string& text, std::uint64_t& bytes) {
+    return parseScaled(text, std::numeric_limits<std::uint64_t>::max(), bytes,
+        [](std::string suffix, std::uint64_t& scale) {
+            // "1M"、"1MB"、"1MiB" 等价
+            if (suffix.size() > 1 && suffix.back() == 'b') {
+                suffix.pop_back();
+                if (suffix.size() > 1 && suffix.back() == 'i') {
+                    suffix.pop_back();
+                }
+            }
+            if (suffix.empty() || suffix == "b") {
+                scale = 1;
+                return true;
+            }
+            static const std::string kUnits = "kmgt";
+            std::size_t index = kUnits.find(suffix[0]);
+            if (suffix.size() != 1 || index == std::string::npos) {
+                return false;
+            }
+            scale = std::uint64_t(1) << (10 * (index + 1));
+            return true;
+        });
+}
+
+bool parseDuration(const std::string& text, std::int64_t& seconds) {
+    std::uint64_t value = 0;
+    bool ok = parseScaled(text, static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()), value,
+        [](const std::string& suffix, std::uint64_t& scale) {
+            if (suffix.empty() || suffix == "s") scale = 1;
+            else if (suffix == "m") scale = 60;
+            else if (suffix == "h") scale = 3600;
+            else if (suffix == "d") scale = 86400;
+            else if (suffix == "w") scale = 7 * 86400;
+            else return false;
+            return true;
+        });
+    if (ok) {
+        seconds = static_cast<std::int64_t>(value);
+    }
+    return ok;
+}
+
+} // namespace backuprestore
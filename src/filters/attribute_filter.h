@@ -0,0 +1,134 @@
+#pragma once
+
+#include "filters/filter_base.h"
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+namespace backuprestore {
+
+/**
+ * @brief 按元数据判断的过滤器基类
+ * 备份时使用扫描记录中的元数据（shouldIncludeEntry），不再 stat；
+ * 只给出路径时（shouldInclude）才从文件系统读取一次元数据
+ */
+class AttributeFilter : public FilterBase {
+public:
+    bool shouldInclude(const std::filesystem::path& path) const override;
+
+    bool shouldIncludeEntry(const std::filesystem::path& path, const Metadata& metadata) const override;
+
+    unsigned cost() const override { return 1; }
+
+protected:
+    virtual bool matchMetadata(const Metadata& metadata) const = 0;
+};
+
+/**
+ * @brief 大小过滤器：size >= min_size 且 size <= max_size
+ */
+class SizeFilter : public AttributeFilter {
+public:
+    SizeFilter(std::uint64_t min_size, std::uint64_t max_size);
+
+    Type getType() const override { return Type::Size; }
+
+protected:
+    bool matchMetadata(const Metadata& metadata) const override;
+
+private:
+    std::uint64_t min_size_;
+    std::uint64_t max_size_;
+};
+
+/**
+ * @brief 修改时间过滤器：mtime >= newer_than 且 mtime < older_than（Unix 时间，秒）
+ */
+class TimeFilter : public AttributeFilter {
+public:
+    TimeFilter(std::time_t newer_than, std::time_t older_than);
+
+    Type getType() const override { return Type::Time; }
+
+protected:
+    bool matchMetadata(const Metadata& metadata) const override;
+
+private:
+    std::time_t newer_than_;
+    std::time_t older_than_;
+};
+
+/**
+ * @brief 文件类型过滤器（扫描只产生普通文件和符号链接）
+ */
+class FileTypeFilter : public AttributeFilter {
+public:
+    enum class Kind {
+        Regular,
+        Symlink
+    };
+
+    explicit FileTypeFilter(Kind kind);
+
+    Type getType() const override { return Type::FileType; }
+
+protected:
+    bool matchMetadata(const Metadata& metadata) const override;
+
+private:
+    Kind kind_;
+};
+
+/**
+ * @brief 属主过滤器：uid 或 gid 等于给定值
+ */
+class UserFilter : public AttributeFilter {
+public:
+    enum class Field {
+        Uid,
+        Gid
+    };
+
+    UserFilter(Field field, std::uint32_t id);
+
+    Type getType() const override { return Type::User; }
+
+protected:
+    bool matchMetadata(const Metadata& metadata) const override;
+
+private:
+    Field field_;
+    std::uint32_t id_;
+};
+
+/**
+ * @brief 文件名过滤器：最后一个路径分量匹配 glob（语法同 PathMatcher::globMatch）
+ * 只看路径，不需要元数据
+ */
+class NameFilter : public FilterBase {
+public:
+    explicit NameFilter(std::string pattern);
+
+    bool shouldInclude(const std::filesystem::path& path) const override;
+
+    Type getType() const override { return Type::Name; }
+
+    unsigned cost() const override { return 2; }
+
+private:
+    std::string pattern_;
+};
+
+/**
+ * @brief 解析大小："123"、"4K"、"1M"、"2G"、"1T"（1024 进制，后缀不区分大小写，可带 B/iB）
+ * @return 格式错误或溢出时返回 false
+ */
+bool parseSize(const std::string& text, std::uint64_t& bytes);
+
+/**
+ * @brief 解析时长："90"/"90s"、"30m"、"24h"、"7d"、"2w"
+ * @return 格式错误或溢出时返回 false
+ */
+bool parseDuration(const std::string& text, std::int64_t& seconds);
+
+} // namespace backuprestore
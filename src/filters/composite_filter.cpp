@@ -0,0 +1,92 @@
+#include "filters/composite_filter.h"
+#include <algorithm>
+
+namespace backuprestore {
+
+void CompositeFilter::add(std::unique_ptr<FilterBase> filter) {
+    if (!filter) {
+        return;
+    }
+    // 插到第一个开销更高的子过滤器之前，相同开销保持添加顺序
+    auto pos = std::upper_bound(children_.begin(), children_.end(), filter->cost(),
+        [](unsigned cost, const std::unique_ptr<FilterBase>& child) {
+            return cost < child->cost();
+        });
+    children_.insert(pos, std::move(filter));
+}
+
+unsigned CompositeFilter::cost() const {
+    unsigned total = 0;
+    for (const auto& child : children_) {
+        total += child->cost();
+    }
+    return total;
+}
+
+bool AndFilter::shouldInclude(const std::filesystem::path& path) const {
+    for (const auto& child : children_) {
+        if (!child->shouldInclude(path)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AndFilter::shouldIncludeEntry(const std::filesystem::path& path, const Metadata& metadata) const {
+    for (const auto& child : children_) {
+        if (!child->shouldIncludeEntry(path, metadata)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AndFilter::shouldDescend(const std::filesystem::path& dir) const {
+    for (const auto& child : children_) {
+        if (!child->shouldDescend(dir)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool OrFilter::shouldInclude(const std::filesystem::path& path) const {
+    for (const auto& child : children_) {
+        if (child->shouldInclude(path)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool OrFilter::shouldIncludeEntry(const std::filesystem::path& path, const Metadata& metadata) const {
+    for (const auto& child : children_) {
+        if (child->shouldIncludeEntry(path, metadata)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool OrFilter::shouldDescend(const std::filesystem::path& dir) const {
+    for (const auto& child : children_) {
+        if (child->shouldDescend(dir)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+NotFilter::NotFilter(std::unique_ptr<FilterBase> filter)
+    : filter_(std::move(filter)) {
+}
+
+bool NotFilter::shouldInclude(const std::filesystem::path& path) const {
+    return !filter_->shouldInclude(path);
+}
+
+bool NotFilter::shouldIncludeEntry(const std::filesystem::path& path, const Metadata& metadata) const {
+    return !filter_->shouldIncludeEntry(path, metadata);
+}
+
+} // namespace backuprestore
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "filters/filter_base.h"
+#include <memory>
+#include <vector>
+
+namespace backuprestore {
+
+/**
+ * @brief 组合过滤器基类：持有子过滤器，按开销从低到高排列以便短路求值
+ */
+class CompositeFilter : public FilterBase {
+public:
+    /**
+     * @brief 添加子过滤器（按 cost() 稳定排序插入）
+     */
+    void add(std::unique_ptr<FilterBase> filter);
+
+    bool empty() const { return children_.empty(); }
+
+    std::size_t size() const { return children_.size(); }
+
+    Type getType() const override { return Type::Composite; }
+
+    unsigned cost() const override;
+
+protected:
+    std::vector<std::unique_ptr<FilterBase>> children_;
+};
+
+/**
+ * @brief 所有子过滤器都包含时才包含（没有子过滤器时包含一切）
+ */
+class AndFilter : public CompositeFilter {
+public:
+    bool shouldInclude(const std::filesystem::path& path) const override;
+
+    bool shouldIncludeEntry(const std::filesystem::path& path, const Metadata& metadata) const override;
+
+    /**
+     * @brief 任一子过滤器拒绝进入时不进入
+     */
+    bool shouldDescend(const std::filesystem::path& dir) const override;
+};
+
+/**
+ * @brief 任一子过滤器包含即包含（没有子过滤器时不包含任何文件）
+ */
+class OrFilter : public CompositeFilter {
+public:
+    bool shouldInclude(const std::filesystem::path& path) const override;
+
+    bool shouldIncludeEntry(const std::filesystem::path& path, const Metadata& metadata) const override;
+
+    /**
+     * @brief 任一子过滤器允许进入即进入
+     */
+    bool shouldDescend(const std::filesystem::path& dir) const override;
+};
+
+/**
+ * @brief 对子过滤器取反
+ * 子过滤器拒绝进入某目录只说明其中没有文件被它包含，取反后不能据此裁剪，因此总是进入
+ */
+class NotFilter : public FilterBase {
+public:
+    explicit NotFilter(std::unique_ptr<FilterBase> filter);
+
+    bool shouldInclude(const std::filesystem::path& path) const override;
+
+    bool shouldIncludeEntry(const std::filesystem::path& path, const Metadata& metadata) const override;
+
+    Type getType() const override { return Type::Composite; }
+
+    unsigned cost() const override { return filter_->cost(); }
+
+private:
+    std::unique_ptr<FilterBase> filter_;
+};
+
+} // namespace backuprestore
@@ -2,6 +2,7 @@
 
 #include <filesystem>
 #include <string>
+#include "metadata/metadata.h"
 
 namespace backuprestore {
 
@@ -20,19 +21,47 @@ public:
      */
     virtual bool shouldInclude(const std::filesystem::path& path) const = 0;
 
+    /**
+     * @brief 使用扫描时已获取的元数据判断文件是否应该被包含（不再访问文件系统）
+     * 默认忽略元数据，按路径判断；按大小、时间等属性过滤的子类应重写此函数
+     * @param path 文件路径
+     * @param metadata 文件元数据（mode/size/mtime/uid/gid 有效）
+     */
+    virtual bool shouldIncludeEntry(const std::filesystem::path& path, const Metadata& metadata) const {
+        (void)metadata;
+        return shouldInclude(path);
+    }
+
+    /**
+     * @brief 判断目录下是否可能有文件被包含（扫描时据此跳过整棵子树）
+     * 返回 false 时调用方可以不进入该目录；默认总是进入
+     * @param dir 目录路径（与 shouldInclude 的路径形式相同）
+     */
+    virtual bool shouldDescend(const std::filesystem::path& dir) const {
+        (void)dir;
+        return true;
+    }
+
     /**
      * @brief 过滤器类型
      */
     enum class Type {
-        Path,           // 路径过滤器（已实现）
-        FileType,       // 文件类型过滤（预留）
-        Name,           // 文件名过滤（预留）
-        Time,           // 时间过滤（预留）
-        Size,           // 大小过滤（预留）
-        User            // 用户过滤（预留）
+        Path,           // 路径过滤器
+        FileType,       // 文件类型过滤
+        Name,           // 文件名过滤
+        Time,           // 时间过滤
+        Size,           // 大小过滤
+        User,           // 用户过滤
+        Composite       // 组合过滤器（AND/OR/NOT）
     };
 
     virtual Type getType() const = 0;
+
+    /**
+     * @brief 判断一次的相对开销，组合过滤器据此先执行廉价的判断
+     * 元数据比较为 1，文件名匹配为 2，完整路径匹配为 4
+     */
+    virtual unsigned cost() const { return 4; }
 };
 
 } // namespace backuprestore
@@ -1,65 +1,63 @@
 #include "filters/path_filter.h"
-#include <algorithm>
-#include <iostream>
 
 namespace backuprestore {
 
+namespace {
+
+// POSIX 下直接引用 path 内部的字符串，避免每次匹配都复制
+#ifdef _WIN32
+std::string pathString(const std::filesystem::path& path) {
+    return path.generic_string();
+}
+#else
+const std::string& pathString(const std::filesystem::path& path) {
+    return path.native();
+}
+#endif
+
+} // namespace
+
 void PathFilter::addInclude(const std::string& pattern) {
-    include_patterns_.push_back(pattern);
+    include_.add(pattern);
 }
 
 void PathFilter::addExclude(const std::string& pattern) {
-    exclude_patterns_.push_back(pattern);
+    exclude_.add(pattern);
 }
 
 void PathFilter::clear() {
-    include_patterns_.clear();
-    exclude_patterns_.clear();
+    include_.clear();
+    exclude_.clear();
 }
 
 bool PathFilter::shouldInclude(const std::filesystem::path& path) const {
     // 如果没有任何规则，默认包含
-    if (include_patterns_.empty() && exclude_patterns_.empty()) {
+    if (include_.empty() && exclude_.empty()) {
         return true;
     }
 
-    std::string path_str = path.string();
+    const auto& path_str = pathString(path);
 
     // 先检查排除规则
-    for (const auto& exclude : exclude_patterns_) {
-        if (matchesPattern(path, exclude)) {
-            return false;
-        }
+    if (exclude_.matches(path_str)) {
+        return false;
     }
 
-    // 如果有包含规则，检查是否匹配
-    if (!include_patterns_.empty()) {
-        for (const auto& include : include_patterns_) {
-            if (matchesPattern(path, include)) {
-                return true;
-            }
-        }
-        return false;  // 不匹配任何包含规则
-    }
-
-    return true;  // 没有排除规则且没有包含规则（或已通过排除检查）
+    // 如果有包含规则，必须匹配其中之一
+    return include_.empty() || include_.matches(path_str);
 }
 
-bool PathFilter::matchesPattern(const std::filesystem::path& path, 
-                                const std::string& pattern) const {
-    std::string path_str = path.string();
-    
-    // 简单前缀匹配
-    if (pattern.back() == '/') {
-        // 目录模式：检查是否为该目录下的文件
-        std::string dir_pattern = pattern.substr(0, pattern.length() - 1);
-        return path_str.find(dir_pattern) == 0;
-    } else {
-        // 精确匹配或包含匹配
-        return path_str == pattern || path_str.find(pattern) != std::string::npos;
+bool PathFilter::shouldDescend(const std::filesystem::path& dir) const {
+    if (include_.empty() && exclude_.empty()) {
+        return true;
     }
+
+    const auto& dir_str = pathString(dir);
+    if (exclude_.matchesEverythingUnder(dir_str)) {
+        return false;
+    }
+    return include_.empty() || include_.mayMatchUnder(dir_str);
 }
 
 } // namespace backuprestore
 
-
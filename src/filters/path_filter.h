@@ -1,6 +1,7 @@
 #pragma once
 
 #include "filters/filter_base.h"
+#include "filters/path_matcher.h"
 #include <vector>
 #include <string>
 
@@ -8,7 +9,8 @@ namespace backuprestore {
 
 /**
  * @brief 路径过滤器
- * 支持 include/exclude 路径模式
+ * 支持 include/exclude 路径模式（目录前缀、子串、glob，见 PathMatcher）
+ * 规则在添加时编译，之后 shouldInclude/shouldDescend 可被多个线程同时调用
  */
 class PathFilter : public FilterBase {
 public:
@@ -28,20 +30,18 @@ public:
     void clear();
 
     bool shouldInclude(const std::filesystem::path& path) const override;
-    Type getType() const override { return Type::Path; }
-
-private:
-    std::vector<std::string> include_patterns_;
-    std::vector<std::string> exclude_patterns_;
 
     /**
-     * @brief 检查路径是否匹配模式（简单前缀匹配）
-     * TODO: 支持更复杂的模式（glob/regex）
+     * @brief 目录被整体排除，或 include 规则不可能匹配其中任何路径时返回 false
      */
-    bool matchesPattern(const std::filesystem::path& path, 
-                        const std::string& pattern) const;
+    bool shouldDescend(const std::filesystem::path& dir) const override;
+
+    Type getType() const override { return Type::Path; }
+
+private:
+    PathMatcher include_;
+    PathMatcher exclude_;
 };
 
 } // namespace backuprestore
 
-
@@ -0,0 +1,265 @@
+#include "filters/path_matcher.h"
+#include <deque>
+
+namespace backuprestore {
+
+namespace {
+
+const std::size_t kAlphabet = 256;
+
+bool isGlob(const std::string& pattern) {
+    return pattern.find_first_of("*?[") != std::string::npos;
+}
+
+// 插入一个模式到稠密前缀树，返回终止节点
+std::int32_t trieInsert(std::vector<std::int32_t>& next, const std::string& s) {
+    if (next.empty()) {
+        next.assign(kAlphabet, -1);
+    }
+    std::int32_t node = 0;
+    for (unsigned char c : s) {
+        std::size_t slot = static_cast<std::size_t>(node) * kAlphabet + c;
+        if (next[slot] < 0) {
+            std::int32_t created = static_cast<std::int32_t>(next.size() / kAlphabet);
+            next[slot] = created;
+            next.resize(next.size() + kAlphabet, -1);
+        }
+        node = next[slot];
+    }
+    return node;
+}
+
+// '[...]' 字符类：p 指向 '[' 之后；成功时 p 移到 ']' 之后
+bool matchClass(const std::string& pat, std::size_t& p, char c) {
+    bool negate = p < pat.size() && (pat[p] == '!' || pat[p] == '^');
+    if (negate) ++p;
+    bool matched = false;
+    bool first = true;
+    while (p < pat.size() && (first || pat[p] != ']')) {
+        first = false;
+        char lo = pat[p++];
+        char hi = lo;
+        if (p + 1 < pat.size() && pat[p] == '-' && pat[p + 1] != ']') {
+            hi = pat[p + 1];
+            p += 2;
+        }
+        if (lo <= c && c <= hi) matched = true;
+    }
+    if (p < pat.size()) ++p;  // 跳过 ']'
+    return matched != negate;
+}
+
+bool globAt(const std::string& pat, std::size_t p, const std::string& s, std::size_t i) {
+    while (p < pat.size()) {
+        char pc = pat[p];
+        if (pc == '*') {
+            bool deep = p + 1 < pat.size() && pat[p + 1] == '*';
+            std::size_t rest = p + (deep ? 2 : 1);
+            // "**/" 也匹配零层目录
+            if (deep && rest < pat.size() && pat[rest] == '/' && globAt(pat, rest + 1, s, i)) {
+                return true;
+            }
+            for (std::size_t k = i;; ++k) {
+                if (globAt(pat, rest, s, k)) return true;
+                if (k >= s.size() || (!deep && s[k] == '/')) return false;
+            }
+        }
+        if (i >= s.size()) return false;
+        if (pc == '?') {
+            if (s[i] == '/') return false;
+            ++p;
+        } else if (pc == '[') {
+            ++p;
+            if (s[i] == '/' || !matchClass(pat, p, s[i])) return false;
+        } else {
+            if (pc != s[i]) return false;
+            ++p;
+        }
+        ++i;
+    }
+    return i == s.size();
+}
+
+} // namespace
+
+void PathMatcher::add(const std::string& pattern) {
+    if (pattern.empty()) {
+        return;
+    }
+    if (isGlob(pattern)) {
+        Glob glob;
+        glob.pattern = pattern;
+        // 以 '/' 结尾的 glob 表示目录：匹配该目录下的所有路径
+        if (pattern.back() == '/') {
+            glob.pattern = pattern + "**";
+        }
+        glob.basename_only = glob.pattern.find('/') == std::string::npos;
+        // 待匹配的是完整路径：不以 '/' 开头的多级模式可以从任意一级目录开始匹配
+        if (!glob.basename_only && glob.pattern[0] != '/' && glob.pattern.compare(0, 3, "**/") != 0) {
+            glob.pattern = "**/" + glob.pattern;
+        }
+        globs_.push_back(std::move(glob));
+    } else if (pattern.back() == '/') {
+        prefixes_.push_back(pattern.substr(0, pattern.size() - 1));
+    } else {
+        substrings_.push_back(pattern);
+    }
+    build();
+}
+
+void PathMatcher::clear() {
+    prefixes_.clear();
+    substrings_.clear();
+    globs_.clear();
+    build();
+}
+
+void PathMatcher::build() {
+    buildPrefixTrie();
+    buildAutomaton();
+}
+
+void PathMatcher::buildPrefixTrie() {
+    prefix_next_.clear();
+    prefix_end_.clear();
+    if (prefixes_.empty()) {
+        return;
+    }
+    std::vector<std::int32_t> ends;
+    for (const auto& prefix : prefixes_) {
+        ends.push_back(trieInsert(prefix_next_, prefix));
+    }
+    prefix_end_.assign(prefix_next_.size() / kAlphabet, 0);
+    for (auto node : ends) {
+        prefix_end_[static_cast<std::size_t>(node)] = 1;
+    }
+}
+
+void PathMatcher::buildAutomaton() {
+    ac_next_.clear();
+    ac_out_.clear();
+    if (substrings_.empty()) {
+        return;
+    }
+    std::vector<std::int32_t> ends;
+    for (const auto& s : substrings_) {
+        ends.push_back(trieInsert(ac_next_, s));
+    }
+    const std::size_t nodes = ac_next_.size() / kAlphabet;
+    ac_out_.assign(nodes, 0);
+    for (auto node : ends) {
+        ac_out_[static_cast<std::size_t>(node)] = 1;
+    }
+
+    // BFS 计算失配指针，同时把缺失的转移补全为失配节点的转移（得到 DFA）
+    std::vector<std::int32_t> fail(nodes, 0);
+    std::deque<std::int32_t> queue;
+    for (std::size_t c = 0; c < kAlphabet; ++c) {
+        std::int32_t child = ac_next_[c];
+        if (child < 0) {
+            ac_next_[c] = 0;
+        } else {
+            fail[static_cast<std::size_t>(child)] = 0;
+            queue.push_back(child);
+        }
+    }
+    while (!queue.empty()) {
+        std::int32_t node = queue.front();
+        queue.pop_front();
+        std::size_t base = static_cast<std::size_t>(node) * kAlphabet;
+        std::size_t fail_base = static_cast<std::size_t>(fail[static_cast<std::size_t>(node)]) * kAlphabet;
+        ac_out_[static_cast<std::size_t>(node)] |= ac_out_[static_cast<std::size_t>(fail[static_cast<std::size_t>(node)])];
+        for (std::size_t c = 0; c < kAlphabet; ++c) {
+            std::int32_t child = ac_next_[base + c];
+            if (child < 0) {
+                ac_next_[base + c] = ac_next_[fail_base + c];
+            } else {
+                fail[static_cast<std::size_t>(child)] = ac_next_[fail_base + c];
+                queue.push_back(child);
+            }
+        }
+    }
+}
+
+bool PathMatcher::matchesPrefix(const std::string& path) const {
+    if (prefix_next_.empty()) {
+        return false;
+    }
+    std::int32_t node = 0;
+    for (unsigned char c : path) {
+        if (prefix_end_[static_cast<std::size_t>(node)]) return true;
+        node = prefix_next_[static_cast<std::size_t>(node) * kAlphabet + c];
+        if (node < 0) return false;
+    }
+    return prefix_end_[static_cast<std::size_t>(node)] != 0;
+}
+
+bool PathMatcher::containsSubstring(const std::string& text) const {
+    if (ac_next_.empty()) {
+        return false;
+    }
+    std::int32_t node = 0;
+    for (unsigned char c : text) {
+        node = ac_next_[static_cast<std::size_t>(node) * kAlphabet + c];
+        if (ac_out_[static_cast<std::size_t>(node)]) return true;
+    }
+    return false;
+}
+
+bool PathMatcher::matches(const std::string& path) const {
+    if (matchesPrefix(path) || containsSubstring(path)) {
+        return true;
+    }
+    if (globs_.empty()) {
+        return false;
+    }
+    std::size_t slash = path.find_last_of('/');
+    const std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    for (const auto& glob : globs_) {
+        if (globMatch(glob.pattern, glob.basename_only ? name : path)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PathMatcher::matchesEverythingUnder(const std::string& dir) const {
+    // 子树中的路径都形如 dir + "/" + ...：包含某个前缀或子串的 dir + "/" 会传递给所有后代
+    const std::string base = dir + "/";
+    if (matchesPrefix(base) || containsSubstring(base)) {
+        return true;
+    }
+    for (const auto& glob : globs_) {
+        const auto& p = glob.pattern;
+        if (p.size() >= 3 && p.compare(p.size() - 3, 3, "/**") == 0 &&
+            globMatch(p.substr(0, p.size() - 3), dir)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PathMatcher::mayMatchUnder(const std::string& dir) const {
+    if (!substrings_.empty() || !globs_.empty()) {
+        return true;
+    }
+    if (prefix_next_.empty()) {
+        return false;
+    }
+    // 沿前缀树走 dir + "/"：途中遇到终止节点说明整棵子树都匹配；
+    // 走完仍在树中说明有更深的前缀模式落在子树内
+    const std::string base = dir + "/";
+    std::int32_t node = 0;
+    for (unsigned char c : base) {
+        if (prefix_end_[static_cast<std::size_t>(node)]) return true;
+        node = prefix_next_[static_cast<std::size_t>(node) * kAlphabet + c];
+        if (node < 0) return false;
+    }
+    return true;
+}
+
+bool PathMatcher::globMatch(const std::string& pattern, const std::string& text) {
+    return globAt(pattern, 0, text, 0);
+}
+
+} // namespace backuprestore
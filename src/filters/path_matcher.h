@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace backuprestore {
+
+/**
+ * @brief 编译后的一组路径模式，判断路径是否匹配其中任意一个
+ *
+ * 模式分为三类（与 PathFilter 原有语义一致，另增加 glob）：
+ * - 以 '/' 结尾：目录前缀，路径以去掉末尾 '/' 的模式开头即匹配（所有前缀合并为一棵前缀树）
+ * - 含 '*'、'?' 或 '['：glob；'*' 与 '?' 不跨越 '/'，连续两个 '*' 可跨越；不含 '/' 的 glob 只匹配文件名，
+ *   不以 '/' 开头的多级 glob 可从路径中任意一级目录开始匹配，以 '/' 结尾的 glob 匹配该目录下的所有路径
+ * - 其它：子串，路径中包含该模式即匹配（所有子串编译为一个 Aho-Corasick 自动机）
+ * 匹配时一次遍历路径即可判断全部前缀和子串模式，与模式数量无关
+ */
+class PathMatcher {
+public:
+    /**
+     * @brief 添加模式并重新编译（空模式忽略）
+     */
+    void add(const std::string& pattern);
+
+    void clear();
+
+    bool empty() const { return prefixes_.empty() && substrings_.empty() && globs_.empty(); }
+
+    /**
+     * @brief 路径是否匹配任意模式
+     */
+    bool matches(const std::string& path) const;
+
+    /**
+     * @brief 目录 dir 下的每个路径是否都一定匹配（用于整棵子树排除）
+     * 只根据前缀、子串和以 '/' 结尾的目录 glob 判断，其它 glob 不会使其返回 true
+     */
+    bool matchesEverythingUnder(const std::string& dir) const;
+
+    /**
+     * @brief 目录 dir 下是否可能存在匹配的路径（用于 include 规则下的子树裁剪）
+     * 无法确定时（存在子串或 glob 模式）保守地返回 true
+     */
+    bool mayMatchUnder(const std::string& dir) const;
+
+    /**
+     * @brief glob 匹配（整串匹配，'*'/'?' 不匹配 '/'，连续两个 '*' 匹配任意字符）
+     */
+    static bool globMatch(const std::string& pattern, const std::string& text);
+
+private:
+    struct Glob {
+        std::string pattern;
+        bool basename_only = false;  // 模式不含 '/'：只与最后一个路径分量比较
+    };
+
+    std::vector<std::string> prefixes_;
+    std::vector<std::string> substrings_;
+    std::vector<Glob> globs_;
+
+    // 前缀树与 Aho-Corasick 自动机都使用稠密转移表：next[node * 256 + byte]，-1 表示无转移
+    std::vector<std::int32_t> prefix_next_;
+    std::vector<std::uint8_t> prefix_end_;
+    std::vector<std::int32_t> ac_next_;    // 已补全为 DFA，不存在 -1
+    std::vector<std::uint8_t> ac_out_;
+
+    void build();
+    void buildPrefixTrie();
+    void buildAutomaton();
+
+    bool matchesPrefix(const std::string& path) const;
+    bool containsSubstring(const std::string& text) const;
+};
+
+} // namespace backuprestore
@@ -3,6 +3,7 @@
 #include "core/backup.h"
 #include "core/restore.h"
 #include "core/file_utils.h"
+#include "core/progress.h"
 #include "filters/path_filter.h"
 #include "metadata/metadata.h"
 #include "metadata/filesystem.h"
@@ -52,36 +53,25 @@ bool GuiOperations::backupWithProgress(
         }
     }
 
-    // 通知开始
-    if (callback) {
-        callback->onStart(files.size(), "备份");
-    }
+    // 通知开始；进度与取消检查由 reporter 合并为每秒至多 10 次
+    ProgressReporter reporter(callback);
+    reporter.start(files.size(), 0, "备份");
 
-    std::size_t success_count = 0;
     std::size_t failed_count = 0;
-    std::size_t skipped_count = 0;
 
     // 处理每个文件
     for (std::size_t i = 0; i < files.size(); ++i) {
         const auto& file_path = files[i];
 
-        // 检查是否取消
-        if (callback && callback->shouldCancel()) {
-            if (callback) {
-                callback->onComplete(success_count, failed_count, skipped_count, false);
-            }
+        // 检查是否取消（reporter 只在发出进度事件时调用 shouldCancel）
+        if (reporter.poll(files[i])) {
+            reporter.finish(false);
             return false;
         }
 
-        // 更新进度
-        if (callback) {
-            double percentage = (i + 1) * 100.0 / files.size();
-            callback->onProgress(file_path, i + 1, files.size(), percentage);
-        }
-
         // 应用过滤器
         if (filter && !filter->shouldInclude(file_path)) {
-            skipped_count++;
+            reporter.fileSkipped();
             if (callback) {
                 callback->onFileSkipped(file_path, "被过滤器排除");
             }
@@ -91,7 +81,7 @@ bool GuiOperations::backupWithProgress(
         // 检查文件类型
         auto file_type = FilesystemUtils::getFileType(file_path);
         if (!FilesystemUtils::isBackupSupported(file_type)) {
-            skipped_count++;
+            reporter.fileSkipped();
             if (callback) {
                 callback->onFileSkipped(file_path, "不支持的文件类型");
             }
@@ -104,6 +94,7 @@ bool GuiOperations::backupWithProgress(
             Metadata metadata;
             if (!metadata.loadFromFile(file_path)) {
                 failed_count++;
+                reporter.fileFailed();
                 if (callback) {
                     callback->onFileError(file_path, "读取元数据失败");
                 }
@@ -111,18 +102,20 @@ bool GuiOperations::backupWithProgress(
             }
 
             if (repo->storeFile(file_path, relative_path, metadata)) {
-                success_count++;
+                reporter.fileDone(metadata.size);
                 if (callback) {
                     callback->onFileSuccess(file_path);
                 }
             } else {
                 failed_count++;
+                reporter.fileFailed();
                 if (callback) {
                     callback->onFileError(file_path, "存储到仓库失败");
                 }
             }
         } catch (const std::exception& e) {
             failed_count++;
+            reporter.fileFailed();
             if (callback) {
                 callback->onFileError(file_path, std::string("异常: ") + e.what());
             }
@@ -134,17 +127,13 @@ bool GuiOperations::backupWithProgress(
         if (callback) {
             callback->onFileError(repo_path, "保存索引失败");
         }
-        if (callback) {
-            callback->onComplete(success_count, failed_count, skipped_count, false);
-        }
+        reporter.finish(false);
         return false;
     }
 
-    // 通知完成
+    // 通知完成（先发出最后一个进度事件）
     bool overall_success = failed_count == 0;
-    if (callback) {
-        callback->onComplete(success_count, failed_count, skipped_count, overall_success);
-    }
+    reporter.finish(overall_success);
 
     return overall_success;
 }
@@ -152,7 +141,8 @@ bool GuiOperations::backupWithProgress(
 bool GuiOperations::restoreWithProgress(
     const std::filesystem::path& repo_path,
     const std::filesystem::path& target_root,
-    ProgressCallback* callback) {
+    ProgressCallback* callback,
+    const std::string& prefix) {
     
     // 创建仓库
     auto repo = std::make_shared<Repository>(repo_path);
@@ -163,76 +153,72 @@ bool GuiOperations::restoreWithProgress(
         return false;
     }
 
-    // 获取文件列表
-    auto files = repo->listFiles();
+    // 索引视图（不复制路径列表），只包含前缀对应的一段
+    const IndexView files = repo->files().prefix(prefix);
 
-    // 通知开始
-    if (callback) {
-        callback->onStart(files.size(), "还原");
-    }
+    // 通知开始；进度与取消检查由 reporter 合并为每秒至多 10 次
+    ProgressReporter reporter(callback);
+    reporter.start(files.size(), 0, "还原");
 
-    std::size_t success_count = 0;
     std::size_t failed_count = 0;
-    std::size_t skipped_count = 0;
 
     // 还原每个文件
-    for (std::size_t i = 0; i < files.size(); ++i) {
-        const auto& relative_path = files[i];
+    for (const auto& path : files) {
+        const std::filesystem::path relative_path(path);
 
-        // 检查是否取消
-        if (callback && callback->shouldCancel()) {
-            if (callback) {
-                callback->onComplete(success_count, failed_count, skipped_count, false);
-            }
+        // 检查是否取消（reporter 只在发出进度事件时调用 shouldCancel）
+        if (reporter.poll(relative_path)) {
+            reporter.finish(false);
             return false;
         }
 
-        // 更新进度
-        if (callback) {
-            double percentage = (i + 1) * 100.0 / files.size();
-            callback->onProgress(relative_path, i + 1, files.size(), percentage);
-        }
-
         // 还原文件
         try {
             auto target_path = target_root / relative_path;
             Metadata metadata;
             if (repo->restoreFile(relative_path, target_path, metadata)) {
-                success_count++;
+                reporter.fileDone(metadata.size);
                 if (callback) {
                     callback->onFileSuccess(relative_path);
                 }
             } else {
                 failed_count++;
+                reporter.fileFailed();
                 if (callback) {
                     callback->onFileError(relative_path, "还原文件失败");
                 }
             }
         } catch (const std::exception& e) {
             failed_count++;
+            reporter.fileFailed();
             if (callback) {
                 callback->onFileError(relative_path, std::string("异常: ") + e.what());
             }
         }
     }
 
-    // 通知完成
+    // 通知完成（先发出最后一个进度事件）
     bool overall_success = failed_count == 0;
-    if (callback) {
-        callback->onComplete(success_count, failed_count, skipped_count, overall_success);
-    }
+    reporter.finish(overall_success);
 
     return overall_success;
 }
 
 std::vector<std::filesystem::path> GuiOperations::listBackupFiles(
-    const std::filesystem::path& repo_path) {
+    const std::filesystem::path& repo_path,
+    const std::string& prefix) {
     
     auto repo = std::make_shared<Repository>(repo_path);
     if (!repo->loadIndex()) {
         return {};
     }
-    return repo->listFiles();
+    const IndexView view = repo->files().prefix(prefix);
+    std::vector<std::filesystem::path> files;
+    files.reserve(view.size());
+    for (const auto& path : view) {
+        files.emplace_back(path);
+    }
+    return files;
 }
 
 bool GuiOperations::validateRepository(const std::filesystem::path& repo_path) {
@@ -243,13 +229,15 @@ bool GuiOperations::validateRepository(const std::filesystem::path& repo_path) {
 
     // 检查必要的目录和文件
     auto data_dir = repo_path / "data";
-    auto index_file = repo_path / "index.txt";
+    auto index_file = repo_path / "index.bin";
+    auto legacy_index_file = repo_path / "index.txt";
 
     if (!std::filesystem::exists(data_dir) || !std::filesystem::is_directory(data_dir)) {
         return false;
     }
 
-    if (!std::filesystem::exists(index_file) || !std::filesystem::is_regular_file(index_file)) {
+    if (!std::filesystem::is_regular_file(index_file) &&
+        !std::filesystem::is_regular_file(legacy_index_file)) {
         return false;
     }
 
@@ -258,5 +246,32 @@ bool GuiOperations::validateRepository(const std::filesystem::path& repo_path) {
     return repo->loadIndex();
 }
 
+RepositoryBrowser::RepositoryBrowser() = default;
+
+RepositoryBrowser::~RepositoryBrowser() = default;
+
+bool RepositoryBrowser::open(const std::filesystem::path& repo_path, const std::string& snapshot) {
+    repo_.reset();
+    auto repo = std::make_shared<Repository>(repo_path);
+    if (!snapshot.empty() && !repo->useSnapshot(snapshot)) {
+        return false;
+    }
+    if (!repo->loadIndex()) {
+        return false;
+    }
+    repo_ = std::move(repo);
+    return true;
+}
+
+bool RepositoryBrowser::listDirectory(const std::string& dir, std::size_t offset, std::size_t limit,
+                                      std::vector<DirectoryEntry>& entries, std::size_t* total) {
+    entries.clear();
+    return repo_ && repo_->listDirectory(dir, offset, limit, entries, total);
+}
+
+bool RepositoryBrowser::directoryTotals(const std::string& dir, DirectoryTotals& totals) {
+    return repo_ && repo_->directoryTotals(dir, totals);
+}
+
 } // namespace backuprestore
 
@@ -1,12 +1,34 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <string>
 #include <functional>
 #include <memory>
+#include <vector>
+#include "core/dir_stats.h"
 
 namespace backuprestore {
 
+class Repository;
+
+/**
+ * @brief 合并后的进度事件（由 ProgressReporter 按固定频率发出）
+ */
+struct ProgressEvent {
+    std::filesystem::path current_file;  // 发出事件的线程正在处理或刚处理完的文件
+    std::size_t files_done = 0;          // 已处理的文件数（成功 + 失败 + 跳过）
+    std::size_t files_total = 0;
+    std::size_t failed = 0;
+    std::size_t skipped = 0;
+    std::uint64_t bytes_done = 0;
+    std::uint64_t bytes_total = 0;       // 0 表示总字节数未知
+    double percentage = 0.0;             // 按字节计算（总字节数未知时按文件数）
+    double elapsed_seconds = 0.0;
+    double files_per_second = 0.0;       // 自上一个事件以来的速率
+    double bytes_per_second = 0.0;
+};
+
 /**
  * @brief GUI 进度回调接口
  * 用于在 GUI 界面中显示备份/还原操作的进度和状态
@@ -34,6 +56,15 @@ public:
                            std::size_t total_files,
                            double percentage) = 0;
 
+    /**
+     * @brief 合并后的进度更新（每秒至多若干次，见 ProgressReporter）
+     * 默认转为 onProgress，只关心百分比的实现无需重写
+     * @param event 进度事件
+     */
+    virtual void onProgressUpdate(const ProgressEvent& event) {
+        onProgress(event.current_file, event.files_done, event.files_total, event.percentage);
+    }
+
     /**
      * @brief 文件处理成功
      * @param file_path 文件路径
@@ -70,6 +101,7 @@ public:
 
     /**
      * @brief 检查是否应该取消操作
+     * 经 ProgressReporter 调用时只在发出进度事件时检查，取消在一个上报周期内生效
      * @return true 如果应该取消
      */
     virtual bool shouldCancel() const = 0;
@@ -102,20 +134,25 @@ public:
      * @param repo_path 备份仓库路径
      * @param target_root 目标目录根路径
      * @param callback 进度回调接口
+     * @param prefix 只还原该文件或目录下的条目（相对仓库根，空串表示全部）
      * @return 是否成功
      */
     static bool restoreWithProgress(
         const std::filesystem::path& repo_path,
         const std::filesystem::path& target_root,
-        ProgressCallback* callback = nullptr);
+        ProgressCallback* callback = nullptr,
+        const std::string& prefix = std::string());
 
     /**
      * @brief 列出备份仓库中的文件
+     * 一次复制出前缀下的全部路径；条目很多的仓库用 RepositoryBrowser 按目录分页浏览
      * @param repo_path 备份仓库路径
+     * @param prefix 只列出该文件或目录下的条目（二分查找索引，不读取其余条目；空串表示全部）
      * @return 文件列表（相对路径）
      */
     static std::vector<std::filesystem::path> listBackupFiles(
-        const std::filesystem::path& repo_path);
+        const std::filesystem::path& repo_path,
+        const std::string& prefix = std::string());
 
     /**
      * @brief 验证备份仓库是否有效
@@ -125,5 +162,45 @@ public:
     static bool validateRepository(const std::filesystem::path& repo_path);
 };
 
+/**
+ * @brief 按目录分页浏览备份仓库
+ * 打开一次仓库后反复取页：索引保持映射，目录汇总只在首次调用时读取，
+ * 每页的耗时与 offset + limit 成正比，与仓库的条目总数无关
+ */
+class RepositoryBrowser {
+public:
+    RepositoryBrowser();
+    ~RepositoryBrowser();
+
+    /**
+     * @brief 打开仓库（或其中的快照）
+     * @param repo_path 备份仓库路径
+     * @param snapshot 快照名称（空串表示当前索引）
+     * @return 是否成功
+     */
+    bool open(const std::filesystem::path& repo_path, const std::string& snapshot = std::string());
+
+    /**
+     * @brief 列出目录的一页直接子项（见 Repository::listDirectory）
+     * @param dir 目录（相对仓库根，空串为根目录）
+     * @param offset 跳过的子项数
+     * @param limit 本页至多返回的子项数
+     * @param entries 输出的子项
+     * @param total 非空时输出直接子项总数
+     * @return 未打开仓库、dir 不存在或不是目录时返回 false
+     */
+    bool listDirectory(const std::string& dir, std::size_t offset, std::size_t limit,
+                       std::vector<DirectoryEntry>& entries, std::size_t* total = nullptr);
+
+    /**
+     * @brief 目录之下（递归）的文件数和字节数
+     * @return 未打开仓库或 dir 不是目录时返回 false
+     */
+    bool directoryTotals(const std::string& dir, DirectoryTotals& totals);
+
+private:
+    std::shared_ptr<Repository> repo_;
+};
+
 } // namespace backuprestore
 
@@ -2,13 +2,29 @@
 #include <string>
 #include <memory>
 #include <filesystem>
+#include <ctime>
+#include <limits>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <vector>
 
 #include "core/repository.h"
 #include "core/backup.h"
+#include "core/package_restore.h"
 #include "core/restore.h"
+#include "core/verify.h"
+#include "core/prune.h"
+#include "core/progress.h"
+#include "core/stats.h"
+#include "core/watch.h"
 #include "filters/path_filter.h"
+#include "filters/attribute_filter.h"
+#include "filters/composite_filter.h"
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <sys/resource.h>
 #endif
 
 
@@ -24,38 +40,247 @@ static void printUsage(const char* program_name) {
     std::cout << "命令:" << std::endl;
     std::cout << "  backup  <源目录> <仓库路径>                         备份目录到仓库" << std::endl;
     std::cout << "  restore <仓库路径> <目标目录>                      从仓库还原到目标目录" << std::endl;
-    std::cout << "  export  <仓库路径> <输出包文件.sepkg>              将仓库目录打包成单文件" << std::endl;
-    std::cout << "  import  <包文件.sepkg> <仓库路径>                  从单文件包恢复仓库目录" << std::endl;
+    std::cout << "  verify  <仓库路径>                                 重新读取仓库数据并核对大小和校验和" << std::endl;
+    std::cout << "  list-snapshots <仓库路径>                          列出仓库中的快照" << std::endl;
+    std::cout << "  prune   <仓库路径>                                 按保留规则删除快照并回收未引用的块" << std::endl;
+    std::cout << "  export  <仓库路径> <输出包文件.sepkg|->            将仓库目录打包成单文件（- 表示写到标准输出）" << std::endl;
+    std::cout << "  import  <包文件.sepkg|-> <仓库路径>                从单文件包恢复仓库目录（- 表示从标准输入读取）" << std::endl;
+    std::cout << "  restore-package <包文件.sepkg> <目标目录>         不经过中间仓库，直接从包还原目录树" << std::endl;
+    std::cout << "  list    <包文件.sepkg>                             列出包内条目（只读取目录）" << std::endl;
+    std::cout << "  extract <包文件.sepkg> <路径|前缀> <输出目录>      只提取指定文件或目录下的条目" << std::endl;
     std::cout << std::endl;
 
     std::cout << "backup 选项:" << std::endl;
-    std::cout << "  --include <路径>    包含路径（可多次指定）" << std::endl;
-    std::cout << "  --exclude <路径>    排除路径（可多次指定）" << std::endl;
+    std::cout << "  --include <模式>    包含路径（可多次指定；/ 结尾为目录前缀，含 *?[ 为 glob，其它为子串）" << std::endl;
+    std::cout << "  --exclude <模式>    排除路径（可多次指定，模式同 --include；被整体排除的目录不会被扫描）" << std::endl;
+    std::cout << "  --jobs <N>          并行备份线程数（默认 1，0 表示CPU核数）" << std::endl;
+    std::cout << "  --incremental       增量备份：跳过未变化文件，移除已删除文件" << std::endl;
+    std::cout << "  --chunked           使用内容定义分块的去重块存储（chunks/）" << std::endl;
+    std::cout << "  --compress          用 LZ 压缩 data/ 中的镜像数据（不影响 --chunked 的块）" << std::endl;
+    std::cout << "  --level <1-9>       压缩级别（默认 6，越大压缩率越高、压缩越慢）" << std::endl;
+    std::cout << "  --hardlink          镜像数据用硬链接代替复制（仅适用于之后不会被修改的源文件）" << std::endl;
+    std::cout << "  --snapshot [名称]   备份后保存为快照（默认以时间命名；隐含 --chunked --incremental）" << std::endl;
+    std::cout << "  --no-checksum       不记录 XXH64 内容校验和（镜像模式可使用 reflink 等内核复制，verify 只能检查大小）" << std::endl;
+    std::cout << "  --pack-small <大小> 小于该大小的文件追加到 packs/ 段文件（镜像模式，如 64K；与 --compress 可同时使用）" << std::endl;
+    std::cout << "  --delta <大小>      不小于该大小的文件修改后只保存相对上一版本的差量（镜像模式，如 64M；不与 --compress、--hardlink 同时生效）" << std::endl;
+    std::cout << "  --delta-depth <N>   差量链最多叠加 N 个版本（默认 8），之后的版本整体存储" << std::endl;
+    std::cout << "  --progress          在 stderr 显示进度（每秒 10 次），Ctrl-C 取消且不更新索引" << std::endl;
+    std::cout << "  --io-uring          用 io_uring 批量 statx/读/写小文件（Linux 5.6+，不支持时退回线程池）" << std::endl;
+    std::cout << "  --no-resume         不从上次中断的备份续传，丢弃仓库中的 journal.bin 重新开始" << std::endl;
+    std::cout << "  --watch [秒]        持续备份：完整备份一次后用 inotify 监视源目录，每隔 N 秒（默认 10）只备份变化的文件；" << std::endl;
+    std::cout << "                      隐含 --incremental，事件队列溢出时退回完整比较，Ctrl-C/SIGTERM 备份完已收到的变化后退出" << std::endl;
+    std::cout << std::endl;
+
+    std::cout << "backup 属性条件（使用扫描时的元数据，不额外 stat；同组内为 AND，与 --include/--exclude 也为 AND）:" << std::endl;
+    std::cout << "  --min-size <大小>   大小不小于（支持 K/M/G/T 后缀，1024 进制）" << std::endl;
+    std::cout << "  --max-size <大小>   大小不大于" << std::endl;
+    std::cout << "  --newer <时长>      最近一段时间内修改过（支持 s/m/h/d/w 后缀，如 24h）" << std::endl;
+    std::cout << "  --older <时长>      超过一段时间未修改" << std::endl;
+    std::cout << "  --type f|l          普通文件 / 符号链接" << std::endl;
+    std::cout << "  --name <glob>       文件名匹配 glob（如 *.log）" << std::endl;
+    std::cout << "  --uid <N>           属主 uid 等于 N" << std::endl;
+    std::cout << "  --gid <N>           属组 gid 等于 N" << std::endl;
+    std::cout << "  --not               对紧随其后的一个条件取反（如 --not --uid 0）" << std::endl;
+    std::cout << "  --or                开始新的一组条件，各组之间为 OR" << std::endl;
+    std::cout << std::endl;
+
+    std::cout << "restore 选项:" << std::endl;
+    std::cout << "  --jobs <N>          并行还原线程数（默认 1，0 表示CPU核数）" << std::endl;
+    std::cout << "  --sync none|file|fs 持久化策略：不同步（默认）/ 每个文件 fdatasync 并 fsync 目录 / 最后一次 syncfs" << std::endl;
+    std::cout << "  --snapshot <名称>   还原指定快照（默认还原最近一次备份）" << std::endl;
+    std::cout << "  --path <前缀>       只还原该文件或目录下的条目（相对仓库根，如 etc/nginx；二分查找索引，不读取其余条目）" << std::endl;
+    std::cout << "  --progress          在 stderr 显示进度（每秒 10 次），Ctrl-C 取消" << std::endl;
+    std::cout << "  --io-uring          用 io_uring 批量读取仓库并写出小文件（Linux 5.6+，不支持时退回线程池）" << std::endl;
+    std::cout << std::endl;
+
+    std::cout << "verify 选项:" << std::endl;
+    std::cout << "  --jobs <N>          并行校验线程数（默认 0，即 CPU 核数）" << std::endl;
+    std::cout << "  --snapshot <名称>   校验指定快照" << std::endl;
+    std::cout << std::endl;
+
+    std::cout << "prune 选项（不给保留规则时只删除 --delete 指定的快照）:" << std::endl;
+    std::cout << "  --keep-last <N>     保留最新的 N 个快照" << std::endl;
+    std::cout << "  --keep-within <时长> 保留最近一段时间内创建的快照（如 30d）" << std::endl;
+    std::cout << "  --delete <名称>     删除指定快照（可多次指定）" << std::endl;
     std::cout << std::endl;
 
     std::cout << "export 选项:" << std::endl;
-    std::cout << "  --pack header|toc          打包算法（默认 header）" << std::endl;
-    std::cout << "  --compress none|rle        压缩算法（默认 none）" << std::endl;
-    std::cout << "  --encrypt none|xor|rc4     加密算法（默认 none）" << std::endl;
+    std::cout << "  --pack header|toc          打包算法（默认 header；输出为 - 时只能用 header）" << std::endl;
+    std::cout << "  --compress none|rle|lz     压缩算法（默认 none）" << std::endl;
+    std::cout << "  --level <1-9>              LZ 压缩级别（默认 6）" << std::endl;
+    std::cout << "  --encrypt none|xor|rc4|chacha20  加密算法（默认 none；chacha20 使用 PBKDF2 派生密钥）" << std::endl;
     std::cout << "  --password <密码>          加密/解密密码（encrypt!=none 必须）" << std::endl;
+    std::cout << "  --block-size <大小>        分块格式（v2）的块大小，支持 K/M/G 后缀（默认 1M，0 表示写出 v1 格式）" << std::endl;
+    std::cout << "  --jobs <N>                 并行压缩/加密的线程数（默认 0，即 CPU 核数）" << std::endl;
+    std::cout << "  --buffer-size <大小>       v1 流式导出的缓冲块大小，支持 K/M/G 后缀（默认 1M）" << std::endl;
     std::cout << std::endl;
 
     std::cout << "import 选项:" << std::endl;
     std::cout << "  --password <密码>          解密密码（包被加密时必须）" << std::endl;
+    std::cout << "  --jobs <N>                 v2 包并行解码的线程数（默认 0，即 CPU 核数）" << std::endl;
+    std::cout << std::endl;
+
+    std::cout << "restore-package 选项:" << std::endl;
+    std::cout << "  --password <密码>          解密密码（包被加密时必须）" << std::endl;
+    std::cout << "  --jobs <N>                 v2 包并行解码的线程数（默认 0，即 CPU 核数）" << std::endl;
+    std::cout << std::endl;
+
+    std::cout << "extract 选项:" << std::endl;
+    std::cout << "  --password <密码>          解密密码（包被加密时必须）" << std::endl;
+    std::cout << "  --buffer-size <大小>       v1 包的读取缓冲块大小，支持 K/M/G 后缀（默认 1M）" << std::endl;
+    std::cout << "  --jobs <N>                 v2 包并行解码的线程数（默认 0，即 CPU 核数）" << std::endl;
+    std::cout << std::endl;
+
+    std::cout << "通用选项（可用于任意命令）:" << std::endl;
+    std::cout << "  --stats[=json|text]        结束后向 stderr 输出各阶段耗时/字节数/次数和单文件耗时直方图（默认 text）" << std::endl;
     std::cout << std::endl;
 
     std::cout << "示例:" << std::endl;
     std::cout << "  " << program_name << " backup  .\\test\\source .\\test\\repo" << std::endl;
     std::cout << "  " << program_name << " restore .\\test\\repo   .\\test\\target" << std::endl;
+    std::cout << "  " << program_name << " restore .\\test\\repo   .\\test\\target --path etc/nginx" << std::endl;
+    std::cout << "  " << program_name << " verify  .\\test\\repo" << std::endl;
+    std::cout << "  " << program_name << " backup  .\\test\\source .\\test\\repo --snapshot daily" << std::endl;
+    std::cout << "  " << program_name << " prune   .\\test\\repo   --keep-last 30" << std::endl;
     std::cout << "  " << program_name << " export  .\\test\\repo   .\\test\\repo_full.sepkg --pack toc --compress rle --encrypt rc4 --password 123456" << std::endl;
     std::cout << "  " << program_name << " import  .\\test\\repo_full.sepkg .\\test\\repo --password 123456" << std::endl;
+    std::cout << "  " << program_name << " restore-package .\\test\\repo_full.sepkg .\\test\\target --password 123456" << std::endl;
+    std::cout << "  " << program_name << " export  ./repo - --compress lz | ssh host backup-restore import - ./repo" << std::endl;
+    std::cout << "  " << program_name << " extract .\\test\\repo_full.sepkg data/etc .\\test\\out --password 123456" << std::endl;
 }
 
-int main(int argc, char* argv[]) {
-    #ifdef _WIN32
-    SetConsoleOutputCP(CP_UTF8);
+// 解析选项的非负整数值（只允许十进制数字，不超过 T 的范围）；无效时输出错误并返回 false
+template <typename T>
+static bool parseCount(const std::string& option, const std::string& value, T& out) {
+    // 不超过 19 位时 stoull 不会溢出，范围由下面的比较检查
+    if (value.empty() || value.size() > 19 || value.find_first_not_of("0123456789") != std::string::npos ||
+        std::stoull(value) > static_cast<unsigned long long>(std::numeric_limits<T>::max())) {
+        std::cerr << "错误: " << option << " 的值无效: " << value << "（应为非负整数）" << std::endl;
+        return false;
+    }
+    out = static_cast<T>(std::stoull(value));
+    return true;
+}
+
+// 解析选项的字节数（格式同 --min-size，如 "4M"、"1MiB"）；无效时输出错误并返回 false
+static bool parseByteSize(const std::string& option, const std::string& value, std::size_t& out) {
+    std::uint64_t bytes = 0;
+    if (!parseSize(value, bytes) || bytes > std::numeric_limits<std::size_t>::max()) {
+        std::cerr << "错误: " << option << " 的值无效: " << value << "（应为字节数，可带 K/M/G/T 后缀）" << std::endl;
+        return false;
+    }
+    out = static_cast<std::size_t>(bytes);
+    return true;
+}
+
+// 按本地时间格式化，例如快照的默认名称 "20240131-235959"
+static std::string formatLocalTime(std::time_t t, const char* format) {
+    std::tm tm{};
+#ifdef _WIN32
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
 #endif
+    char buf[64];
+    std::size_t n = std::strftime(buf, sizeof(buf), format, &tm);
+    return std::string(buf, n);
+}
+
+// --progress：在 stderr 上原地刷新一行进度；Ctrl-C 只设置标志，由 ProgressReporter 在下一个上报周期取消
+static volatile std::sig_atomic_t g_interrupted = 0;
 
+static void onInterrupt(int) {
+    g_interrupted = 1;
+}
+
+class ConsoleProgress : public ProgressCallback {
+public:
+    ConsoleProgress() {
+        std::signal(SIGINT, onInterrupt);
+    }
+
+    ~ConsoleProgress() override {
+        std::signal(SIGINT, SIG_DFL);
+    }
+
+    void onStart(std::size_t, const std::string& operation_name) override {
+        operation_ = operation_name;
+    }
+
+    void onProgress(const std::filesystem::path&, std::size_t, std::size_t, double) override {}
+
+    void onProgressUpdate(const ProgressEvent& event) override {
+        char line[200];
+        std::snprintf(line, sizeof(line), "\r%s %5.1f%%  %zu/%zu 个文件  %.1f MB/s  %.0f 个文件/s  已用 %.1fs   ",
+                      operation_.c_str(), event.percentage, event.files_done, event.files_total,
+                      event.bytes_per_second / 1e6, event.files_per_second, event.elapsed_seconds);
+        std::cerr << line << std::flush;
+    }
+
+    void onFileSuccess(const std::filesystem::path&) override {}
+    void onFileError(const std::filesystem::path&, const std::string&) override {}
+    void onFileSkipped(const std::filesystem::path&, const std::string&) override {}
+
+    void onComplete(std::size_t, std::size_t, std::size_t, bool) override {
+        std::cerr << std::endl;
+    }
+
+    bool shouldCancel() const override {
+        return g_interrupted != 0;
+    }
+
+private:
+    std::string operation_;
+};
+
+// 解析一个 backup 属性条件；arg 不是属性条件时返回 false，值无效时 error 非空
+static bool parseAttributeCondition(const std::string& arg, const std::string& value, std::time_t now,
+                                    std::unique_ptr<FilterBase>& filter, std::string& error) {
+    const std::time_t kMinTime = std::numeric_limits<std::time_t>::min();
+    const std::time_t kMaxTime = std::numeric_limits<std::time_t>::max();
+    if (arg == "--min-size" || arg == "--max-size") {
+        std::uint64_t size = 0;
+        if (!parseSize(value, size)) {
+            error = "无效的大小: " + value;
+        } else if (arg == "--min-size") {
+            filter = std::make_unique<SizeFilter>(size, std::numeric_limits<std::uint64_t>::max());
+        } else {
+            filter = std::make_unique<SizeFilter>(0, size);
+        }
+    } else if (arg == "--newer" || arg == "--older") {
+        std::int64_t seconds = 0;
+        if (!parseDuration(value, seconds) || seconds > static_cast<std::int64_t>(now)) {
+            error = "无效的时长: " + value;
+        } else if (arg == "--newer") {
+            filter = std::make_unique<TimeFilter>(now - static_cast<std::time_t>(seconds), kMaxTime);
+        } else {
+            filter = std::make_unique<TimeFilter>(kMinTime, now - static_cast<std::time_t>(seconds));
+        }
+    } else if (arg == "--type") {
+        if (value == "f") {
+            filter = std::make_unique<FileTypeFilter>(FileTypeFilter::Kind::Regular);
+        } else if (value == "l") {
+            filter = std::make_unique<FileTypeFilter>(FileTypeFilter::Kind::Symlink);
+        } else {
+            error = "无效的文件类型（应为 f 或 l）: " + value;
+        }
+    } else if (arg == "--name") {
+        filter = std::make_unique<NameFilter>(value);
+    } else if (arg == "--uid" || arg == "--gid") {
+        if (value.empty() || value.size() > 10 || value.find_first_not_of("0123456789") != std::string::npos ||
+            std::stoull(value) > std::numeric_limits<std::uint32_t>::max()) {
+            error = "无效的 ID: " + value;
+        } else {
+            filter = std::make_unique<UserFilter>(arg == "--uid" ? UserFilter::Field::Uid : UserFilter::Field::Gid,
+                                                  static_cast<std::uint32_t>(std::stoull(value)));
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static int runCommand(int argc, char* argv[]) {
     if (argc < 2) {
         printUsage(argv[0]);
         return 1;
@@ -79,15 +304,160 @@ int main(int argc, char* argv[]) {
         // 解析过滤器选项
         std::unique_ptr<PathFilter> filter = std::make_unique<PathFilter>();
         bool has_filter = false;
+        std::size_t jobs = 1;
+        bool incremental = false;
+        bool chunked = false;
+        bool compress = false;
+        int level = 6;
+        bool hardlink = false;
+        bool checksums = true;
+        std::uint64_t pack_threshold = 0;
+        std::uint64_t delta_threshold = 0;
+        std::uint32_t delta_depth = 8;
+        bool snapshot = false;
+        std::string snapshot_name;
+        bool show_progress = false;
+        bool batch_io = false;
+        bool resume = true;
+        bool watch = false;
+        std::uint32_t watch_interval = 10;
+        // 属性条件：同一组内为 AND，--or 开始新的一组，各组之间为 OR
+        const std::time_t now = std::time(nullptr);
+        std::vector<std::unique_ptr<AndFilter>> groups;
+        groups.push_back(std::make_unique<AndFilter>());
+        bool negate_next = false;
         for (int i = 4; i < argc; i++) {
             std::string arg = argv[i];
-            if (arg == "--include" && i + 1 < argc) {
+            std::unique_ptr<FilterBase> condition;
+            std::string error;
+            if (i + 1 < argc && parseAttributeCondition(arg, argv[i + 1], now, condition, error)) {
+                ++i;
+                if (!condition) {
+                    std::cerr << "错误: " << error << std::endl;
+                    return 1;
+                }
+                if (negate_next) {
+                    condition = std::make_unique<NotFilter>(std::move(condition));
+                    negate_next = false;
+                }
+                groups.back()->add(std::move(condition));
+            } else if (arg == "--not") {
+                negate_next = !negate_next;
+            } else if (arg == "--or") {
+                if (groups.back()->empty() || negate_next) {
+                    std::cerr << "错误: --or 前缺少条件" << std::endl;
+                    return 1;
+                }
+                groups.push_back(std::make_unique<AndFilter>());
+            } else if (arg == "--include" && i + 1 < argc) {
                 filter->addInclude(argv[++i]);
                 has_filter = true;
             } else if (arg == "--exclude" && i + 1 < argc) {
                 filter->addExclude(argv[++i]);
                 has_filter = true;
+            } else if (arg == "--jobs" && i + 1 < argc) {
+                if (!parseCount(arg, argv[++i], jobs)) {
+                    return 1;
+                }
+            } else if (arg == "--incremental") {
+                incremental = true;
+            } else if (arg == "--chunked") {
+                chunked = true;
+            } else if (arg == "--compress") {
+                compress = true;
+            } else if (arg == "--level" && i + 1 < argc) {
+                if (!parseCount(arg, argv[++i], level)) {
+                    return 1;
+                }
+            } else if (arg == "--hardlink") {
+                hardlink = true;
+            } else if (arg == "--no-checksum") {
+                checksums = false;
+            } else if (arg == "--pack-small" && i + 1 < argc) {
+                if (!parseSize(argv[++i], pack_threshold)) {
+                    std::cerr << "错误: 无效的大小: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--delta" && i + 1 < argc) {
+                if (!parseSize(argv[++i], delta_threshold)) {
+                    std::cerr << "错误: 无效的大小: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--delta-depth" && i + 1 < argc) {
+                if (!parseCount(arg, argv[++i], delta_depth)) {
+                    return 1;
+                }
+            } else if (arg == "--snapshot") {
+                snapshot = true;
+                if (i + 1 < argc && argv[i + 1][0] != '-') {
+                    snapshot_name = argv[++i];
+                }
+            } else if (arg == "--progress") {
+                show_progress = true;
+            } else if (arg == "--io-uring") {
+                batch_io = true;
+            } else if (arg == "--no-resume") {
+                resume = false;
+            } else if (arg == "--watch") {
+                watch = true;
+                if (i + 1 < argc && argv[i + 1][0] != '-') {
+                    if (!parseCount(arg, argv[++i], watch_interval)) {
+                        return 1;
+                    }
+                }
+            }
+        }
+
+        if (negate_next || (groups.size() > 1 && groups.back()->empty())) {
+            std::cerr << "错误: --not/--or 后缺少条件" << std::endl;
+            return 1;
+        }
+
+        // 快照只引用按内容寻址的块：块存储 + 增量（未变化的文件直接沿用上次的块列表）
+        if (snapshot) {
+            if (snapshot_name.empty()) {
+                snapshot_name = formatLocalTime(now, "%Y%m%d-%H%M%S");
+            }
+            if (!Repository::isValidSnapshotName(snapshot_name)) {
+                std::cerr << "错误: 无效的快照名: " << snapshot_name << "（只能包含字母、数字和 . _ -）" << std::endl;
+                return 1;
             }
+            chunked = true;
+            incremental = true;
+        }
+
+        // 持续备份：首次完整比较后只备份变化的路径，之后的每一轮都以上一轮保存的索引为基准
+        if (watch) {
+            if (snapshot) {
+                std::cerr << "错误: --watch 不能与 --snapshot 同时使用" << std::endl;
+                return 1;
+            }
+            if (!Watch::supported()) {
+                std::cerr << "错误: --watch 仅支持 Linux" << std::endl;
+                return 1;
+            }
+            if (watch_interval == 0) {
+                std::cerr << "错误: --watch 的间隔至少为 1 秒" << std::endl;
+                return 1;
+            }
+            incremental = true;
+        }
+
+        // 组合过滤器：路径规则 AND 属性条件，按开销从低到高求值
+        AndFilter root_filter;
+        if (has_filter) {
+            root_filter.add(std::move(filter));
+        }
+        if (groups.size() == 1) {
+            if (!groups[0]->empty()) {
+                root_filter.add(std::move(groups[0]));
+            }
+        } else {
+            auto any = std::make_unique<OrFilter>();
+            for (auto& group : groups) {
+                any->add(std::move(group));
+            }
+            root_filter.add(std::move(any));
         }
 
         // 创建仓库
@@ -96,15 +466,57 @@ int main(int argc, char* argv[]) {
             std::cerr << "初始化仓库失败" << std::endl;
             return 1;
         }
+        repo->setChunking(chunked);
+        repo->setCompression(compress, level);
+        repo->setHardLink(hardlink);
+        repo->setChecksums(checksums);
+        repo->setPackThreshold(pack_threshold);
+        repo->setDeltaThreshold(delta_threshold);
+        repo->setDeltaDepth(delta_depth);
+        if (snapshot && repo->hasSnapshot(snapshot_name)) {
+            std::cerr << "错误: 快照已存在: " << snapshot_name << std::endl;
+            return 1;
+        }
 
         // 执行备份
         Backup backup(repo);
-        const FilterBase* filter_ptr = has_filter ? filter.get() : nullptr;
+        backup.setJobs(jobs);
+        backup.setIncremental(incremental);
+        backup.setBatchIo(batch_io);
+        backup.setResume(resume);
+        std::unique_ptr<ConsoleProgress> console;
+        std::unique_ptr<ProgressReporter> progress;
+        if (show_progress) {
+            console = std::make_unique<ConsoleProgress>();
+            progress = std::make_unique<ProgressReporter>(console.get());
+            backup.setProgress(progress.get());
+        }
+        const FilterBase* filter_ptr = root_filter.empty() ? nullptr : &root_filter;
+
+        if (watch) {
+            std::signal(SIGINT, onInterrupt);
+            std::signal(SIGTERM, onInterrupt);
+            Watch watcher(backup);
+            watcher.setInterval(watch_interval);
+            watcher.setStopFlag(&g_interrupted);
+            if (!watcher.execute(source_root, filter_ptr)) {
+                std::cerr << "持续备份失败" << std::endl;
+                return 1;
+            }
+            return 0;
+        }
 
         if (!backup.execute(source_root, filter_ptr)) {
             std::cerr << "备份失败" << std::endl;
             return 1;
         }
+        if (snapshot) {
+            if (!repo->createSnapshot(snapshot_name)) {
+                std::cerr << "创建快照失败" << std::endl;
+                return 1;
+            }
+            std::cout << "已创建快照: " << snapshot_name << std::endl;
+        }
 
         std::cout << "备份成功完成" << std::endl;
         return 0;
@@ -123,13 +535,55 @@ int main(int argc, char* argv[]) {
         std::filesystem::path repo_path = argv[2];
         std::filesystem::path target_root = argv[3];
 
+        std::size_t jobs = 1;
+        SyncPolicy sync = SyncPolicy::None;
+        std::string snapshot_name;
+        std::string prefix;
+        bool show_progress = false;
+        bool batch_io = false;
+        for (int i = 4; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--jobs" && i + 1 < argc) {
+                if (!parseCount(arg, argv[++i], jobs)) {
+                    return 1;
+                }
+            } else if (arg == "--sync" && i + 1 < argc) {
+                if (!parseSyncPolicy(argv[++i], sync)) {
+                    std::cerr << "错误: 无效的持久化策略: " << argv[i] << "（应为 none、file 或 fs）" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--snapshot" && i + 1 < argc) {
+                snapshot_name = argv[++i];
+            } else if (arg == "--path" && i + 1 < argc) {
+                prefix = std::filesystem::path(argv[++i]).generic_string();
+            } else if (arg == "--progress") {
+                show_progress = true;
+            } else if (arg == "--io-uring") {
+                batch_io = true;
+            }
+        }
+
         auto repo = std::make_shared<Repository>(repo_path);
+        if (!snapshot_name.empty() && !repo->useSnapshot(snapshot_name)) {
+            return 1;
+        }
         if (!repo->loadIndex()) {
             std::cerr << "加载仓库索引失败" << std::endl;
             return 1;
         }
 
         Restore restore(repo);
+        restore.setJobs(jobs);
+        restore.setSync(sync);
+        restore.setBatchIo(batch_io);
+        restore.setPrefix(prefix);
+        std::unique_ptr<ConsoleProgress> console;
+        std::unique_ptr<ProgressReporter> progress;
+        if (show_progress) {
+            console = std::make_unique<ConsoleProgress>();
+            progress = std::make_unique<ProgressReporter>(console.get());
+            restore.setProgress(progress.get());
+        }
         if (!restore.execute(target_root)) {
             std::cerr << "还原失败" << std::endl;
             return 1;
@@ -139,6 +593,105 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
+    // ===========================
+    // verify
+    // ===========================
+    if (command == "verify") {
+        if (argc < 3) {
+            std::cerr << "错误: verify命令需要仓库路径" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        std::filesystem::path repo_path = argv[2];
+
+        std::size_t jobs = 0;
+        std::string snapshot_name;
+        for (int i = 3; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--jobs" && i + 1 < argc) {
+                if (!parseCount(arg, argv[++i], jobs)) {
+                    return 1;
+                }
+            } else if (arg == "--snapshot" && i + 1 < argc) {
+                snapshot_name = argv[++i];
+            }
+        }
+
+        auto repo = std::make_shared<Repository>(repo_path);
+        if (!snapshot_name.empty() && !repo->useSnapshot(snapshot_name)) {
+            return 1;
+        }
+        Verify verify(repo);
+        verify.setJobs(jobs);
+        if (!verify.execute()) {
+            std::cerr << "校验失败" << std::endl;
+            return 1;
+        }
+
+        std::cout << "校验成功完成" << std::endl;
+        return 0;
+    }
+
+    // ===========================
+    // list-snapshots
+    // ===========================
+    if (command == "list-snapshots") {
+        if (argc < 3) {
+            std::cerr << "错误: list-snapshots命令需要仓库路径" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        Repository repo(argv[2]);
+        auto snapshots = repo.listSnapshots();
+        for (const auto& snapshot : snapshots) {
+            std::cout << snapshot.name << "\t" << formatLocalTime(snapshot.created, "%Y-%m-%d %H:%M:%S")
+                      << "\t" << snapshot.files << "\t" << snapshot.bytes << std::endl;
+        }
+        std::cout << "共 " << snapshots.size() << " 个快照" << std::endl;
+        return 0;
+    }
+
+    // ===========================
+    // prune
+    // ===========================
+    if (command == "prune") {
+        if (argc < 3) {
+            std::cerr << "错误: prune命令需要仓库路径" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        auto repo = std::make_shared<Repository>(argv[2]);
+        Prune prune(repo);
+        for (int i = 3; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--keep-last" && i + 1 < argc) {
+                std::size_t keep_last = 0;
+                if (!parseCount(arg, argv[++i], keep_last)) {
+                    return 1;
+                }
+                prune.setKeepLast(keep_last);
+            } else if (arg == "--keep-within" && i + 1 < argc) {
+                std::int64_t seconds = 0;
+                if (!parseDuration(argv[++i], seconds)) {
+                    std::cerr << "错误: 无效的时长: " << argv[i] << std::endl;
+                    return 1;
+                }
+                prune.setKeepWithin(seconds);
+            } else if (arg == "--delete" && i + 1 < argc) {
+                prune.addDelete(argv[++i]);
+            }
+        }
+
+        if (!prune.execute()) {
+            std::cerr << "清理失败" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
     // ===========================
     // export
     // ===========================
@@ -163,8 +716,24 @@ int main(int argc, char* argv[]) {
                 opt.compressAlg = pkg::parseCompress(argv[++i]);
             } else if (a == "--encrypt" && i + 1 < argc) {
                 opt.encryptAlg = pkg::parseEncrypt(argv[++i]);
+            } else if (a == "--level" && i + 1 < argc) {
+                if (!parseCount(a, argv[++i], opt.compressLevel)) {
+                    return 1;
+                }
             } else if (a == "--password" && i + 1 < argc) {
                 opt.password = argv[++i];
+            } else if (a == "--buffer-size" && i + 1 < argc) {
+                if (!parseByteSize(a, argv[++i], opt.bufferSize)) {
+                    return 1;
+                }
+            } else if (a == "--block-size" && i + 1 < argc) {
+                if (!parseByteSize(a, argv[++i], opt.blockSize)) {
+                    return 1;
+                }
+            } else if (a == "--jobs" && i + 1 < argc) {
+                if (!parseCount(a, argv[++i], opt.jobs)) {
+                    return 1;
+                }
             } else {
                 std::cerr << "警告: 未识别参数: " << a << std::endl;
             }
@@ -172,7 +741,8 @@ int main(int argc, char* argv[]) {
 
         try {
             pkg::export_repo_to_package(repoDir, pkgFile, opt);
-            std::cout << "Export OK: " << pkgFile << std::endl;
+            // 包写到标准输出时，提示信息改写到 stderr
+            (pkg::is_stdio_path(pkgFile) ? std::cerr : std::cout) << "Export OK: " << pkgFile << std::endl;
             return 0;
         } catch (const std::exception& e) {
             std::cerr << "Export FAIL: " << e.what() << std::endl;
@@ -193,19 +763,24 @@ int main(int argc, char* argv[]) {
         std::filesystem::path pkgFile = argv[2];
         std::filesystem::path repoDir = argv[3];
         std::string password;
+        std::size_t jobs = 0;
 
         // 解析 import 参数
         for (int i = 4; i < argc; ++i) {
             std::string a = argv[i];
             if (a == "--password" && i + 1 < argc) {
                 password = argv[++i];
+            } else if (a == "--jobs" && i + 1 < argc) {
+                if (!parseCount(a, argv[++i], jobs)) {
+                    return 1;
+                }
             } else {
                 std::cerr << "警告: 未识别参数: " << a << std::endl;
             }
         }
 
         try {
-            pkg::import_package_to_repo(pkgFile, repoDir, password);
+            pkg::import_package_to_repo(pkgFile, repoDir, password, jobs);
             std::cout << "Import OK: " << repoDir << std::endl;
             return 0;
         } catch (const std::exception& e) {
@@ -214,6 +789,116 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    // ===========================
+    // restore-package
+    // ===========================
+    if (command == "restore-package") {
+        if (argc < 4) {
+            std::cerr << "错误: restore-package命令需要包文件和目标目录" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        std::filesystem::path pkgFile = argv[2];
+        std::filesystem::path target_root = argv[3];
+        std::string password;
+        std::size_t jobs = 0;
+
+        for (int i = 4; i < argc; ++i) {
+            std::string a = argv[i];
+            if (a == "--password" && i + 1 < argc) {
+                password = argv[++i];
+            } else if (a == "--jobs" && i + 1 < argc) {
+                if (!parseCount(a, argv[++i], jobs)) {
+                    return 1;
+                }
+            } else {
+                std::cerr << "警告: 未识别参数: " << a << std::endl;
+            }
+        }
+
+        PackageRestore restore(pkgFile);
+        restore.setPassword(password);
+        restore.setJobs(jobs);
+        if (!restore.execute(target_root)) {
+            std::cerr << "从包还原失败" << std::endl;
+            return 1;
+        }
+        std::cout << "从包还原成功" << std::endl;
+        return 0;
+    }
+
+    // ===========================
+    // list
+    // ===========================
+    if (command == "list") {
+        if (argc < 3) {
+            std::cerr << "错误: list命令需要包文件" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        std::filesystem::path pkgFile = argv[2];
+        try {
+            auto items = pkg::list_package(pkgFile);
+            for (const auto& item : items) {
+                std::cout << item.originalSize << "\t" << item.storedSize << "\t" << item.relPath << std::endl;
+            }
+            return 0;
+        } catch (const std::exception& e) {
+            std::cerr << "List FAIL: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // ===========================
+    // extract
+    // ===========================
+    if (command == "extract") {
+        if (argc < 5) {
+            std::cerr << "错误: extract命令需要包文件、路径和输出目录" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        std::filesystem::path pkgFile = argv[2];
+        std::string pattern = argv[3];
+        std::filesystem::path outDir = argv[4];
+        std::string password;
+        std::size_t bufferSize = 1 << 20;
+        std::size_t jobs = 0;
+
+        for (int i = 5; i < argc; ++i) {
+            std::string a = argv[i];
+            if (a == "--password" && i + 1 < argc) {
+                password = argv[++i];
+            } else if (a == "--buffer-size" && i + 1 < argc) {
+                if (!parseByteSize(a, argv[++i], bufferSize)) {
+                    return 1;
+                }
+            } else if (a == "--jobs" && i + 1 < argc) {
+                if (!parseCount(a, argv[++i], jobs)) {
+                    return 1;
+                }
+            } else {
+                std::cerr << "警告: 未识别参数: " << a << std::endl;
+            }
+        }
+
+        try {
+            std::size_t n = pkg::extract_from_package(pkgFile, pattern, outDir, password, bufferSize, jobs);
+            if (n == 0) {
+                std::cerr << "Extract FAIL: no entry matches " << pattern << std::endl;
+                return 1;
+            }
+            std::cout << "Extract OK: " << n << " entries -> " << outDir << std::endl;
+            return 0;
+        } catch (const std::exception& e) {
+            std::cerr << "Extract FAIL: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
     // ===========================
     // unknown
     // ===========================
@@ -221,3 +906,174 @@ int main(int argc, char* argv[]) {
     printUsage(argv[0]);
     return 1;
 }
+
+// --stats 报告：进程资源占用 + 各阶段计数 + 单文件耗时直方图
+struct StatsContext {
+    std::string command;
+    int exit_code = 0;
+    std::uint64_t wall_ns = 0;
+    std::uint64_t user_us = 0;
+    std::uint64_t sys_us = 0;
+    std::uint64_t max_rss_kb = 0;
+};
+
+static void collectUsage(StatsContext& ctx) {
+#ifndef _WIN32
+    struct rusage usage{};
+    if (::getrusage(RUSAGE_SELF, &usage) == 0) {
+        ctx.user_us = static_cast<std::uint64_t>(usage.ru_utime.tv_sec) * 1000000 + usage.ru_utime.tv_usec;
+        ctx.sys_us = static_cast<std::uint64_t>(usage.ru_stime.tv_sec) * 1000000 + usage.ru_stime.tv_usec;
+        ctx.max_rss_kb = static_cast<std::uint64_t>(usage.ru_maxrss);
+    }
+#else
+    (void)ctx;
+#endif
+}
+
+static std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+static void printStatsJson(const StatsContext& ctx, const Stats::Report& report) {
+    std::ostream& os = std::cerr;
+    os << "{\"command\":\"" << jsonEscape(ctx.command) << "\""
+       << ",\"exit_code\":" << ctx.exit_code
+       << ",\"wall_ns\":" << ctx.wall_ns
+       << ",\"user_us\":" << ctx.user_us
+       << ",\"sys_us\":" << ctx.sys_us
+       << ",\"max_rss_kb\":" << ctx.max_rss_kb
+       << ",\"phases\":{";
+    for (std::size_t i = 0; i < kStatPhaseCount; ++i) {
+        const auto& phase = report.phases[i];
+        os << (i ? "," : "") << "\"" << Stats::phaseName(static_cast<StatPhase>(i)) << "\":{"
+           << "\"ns\":" << phase.ns << ",\"bytes\":" << phase.bytes << ",\"ops\":" << phase.ops << "}";
+    }
+    os << "},\"file_latency\":{"
+       << "\"count\":" << report.latency_count
+       << ",\"p50_us\":" << Stats::percentileUs(report, 0.50)
+       << ",\"p90_us\":" << Stats::percentileUs(report, 0.90)
+       << ",\"p99_us\":" << Stats::percentileUs(report, 0.99)
+       << ",\"max_us\":" << (report.latency_max_ns + 999) / 1000
+       << ",\"buckets\":[";
+    bool first = true;
+    for (std::size_t i = 0; i < kLatencyBuckets; ++i) {
+        if (report.latency[i] == 0) {
+            continue;
+        }
+        std::uint64_t upper = Stats::bucketUpperUs(i);
+        os << (first ? "" : ",") << "{\"lt_us\":";
+        if (upper == 0) {
+            os << "null";
+        } else {
+            os << upper;
+        }
+        os << ",\"count\":" << report.latency[i] << "}";
+        first = false;
+    }
+    os << "]}}" << std::endl;
+}
+
+static void printStatsText(const StatsContext& ctx, const Stats::Report& report) {
+    char line[160];
+    std::ostream& os = std::cerr;
+    os << "==== 统计: " << ctx.command << "（退出码 " << ctx.exit_code << "）====" << std::endl;
+    std::snprintf(line, sizeof(line), "墙钟 %.3f ms，用户态 %.3f ms，内核态 %.3f ms，最大常驻内存 %llu KiB",
+                  ctx.wall_ns / 1e6, ctx.user_us / 1e3, ctx.sys_us / 1e3,
+                  static_cast<unsigned long long>(ctx.max_rss_kb));
+    os << line << std::endl;
+    os << "阶段（耗时为各线程累加）:" << std::endl;
+    std::snprintf(line, sizeof(line), "  %-16s %14s %16s %12s %12s", "phase", "ms", "bytes", "ops", "MiB/s");
+    os << line << std::endl;
+    for (std::size_t i = 0; i < kStatPhaseCount; ++i) {
+        const auto& phase = report.phases[i];
+        if (phase.ops == 0) {
+            continue;
+        }
+        double mibps = phase.ns > 0 ? (phase.bytes / 1048576.0) / (phase.ns / 1e9) : 0.0;
+        std::snprintf(line, sizeof(line), "  %-16s %14.3f %16llu %12llu %12.1f",
+                      Stats::phaseName(static_cast<StatPhase>(i)), phase.ns / 1e6,
+                      static_cast<unsigned long long>(phase.bytes),
+                      static_cast<unsigned long long>(phase.ops), phase.bytes ? mibps : 0.0);
+        os << line << std::endl;
+    }
+    if (report.latency_count == 0) {
+        return;
+    }
+    std::snprintf(line, sizeof(line), "单文件耗时: %llu 个文件，p50 <%llu us，p90 <%llu us，p99 <%llu us，最大 %llu us",
+                  static_cast<unsigned long long>(report.latency_count),
+                  static_cast<unsigned long long>(Stats::percentileUs(report, 0.50)),
+                  static_cast<unsigned long long>(Stats::percentileUs(report, 0.90)),
+                  static_cast<unsigned long long>(Stats::percentileUs(report, 0.99)),
+                  static_cast<unsigned long long>((report.latency_max_ns + 999) / 1000));
+    os << line << std::endl;
+    for (std::size_t i = 0; i < kLatencyBuckets; ++i) {
+        if (report.latency[i] == 0) {
+            continue;
+        }
+        std::uint64_t upper = Stats::bucketUpperUs(i);
+        std::uint64_t lower = i == 0 ? 0 : (std::uint64_t(1) << (i - 1));
+        if (upper == 0) {
+            std::snprintf(line, sizeof(line), "  [%10llu us,        inf) %10llu",
+                          static_cast<unsigned long long>(lower),
+                          static_cast<unsigned long long>(report.latency[i]));
+        } else {
+            std::snprintf(line, sizeof(line), "  [%10llu us, %10llu) %10llu",
+                          static_cast<unsigned long long>(lower), static_cast<unsigned long long>(upper),
+                          static_cast<unsigned long long>(report.latency[i]));
+        }
+        os << line << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    SetConsoleOutputCP(CP_UTF8);
+#endif
+
+    // --stats 可出现在任意位置：先从参数中去掉，各命令的解析不受影响
+    std::vector<char*> args;
+    std::string stats_format;
+    for (int i = 0; i < argc; ++i) {
+        std::string a = argv[i];
+        if (i > 0 && (a == "--stats" || a == "--stats=text")) {
+            stats_format = "text";
+        } else if (i > 0 && a == "--stats=json") {
+            stats_format = "json";
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    if (stats_format.empty()) {
+        return runCommand(argc, argv);
+    }
+
+    Stats::enable(true);
+    StatsContext ctx;
+    ctx.command = args.size() > 1 ? args[1] : "";
+    const std::uint64_t start = Stats::now();
+    args.push_back(nullptr);
+    ctx.exit_code = runCommand(static_cast<int>(args.size() - 1), args.data());
+    ctx.wall_ns = Stats::now() - start;
+    collectUsage(ctx);
+
+    Stats::Report report = Stats::snapshot();
+    if (stats_format == "json") {
+        printStatsJson(ctx, report);
+    } else {
+        printStatsText(ctx, report);
+    }
+    return ctx.exit_code;
+}
@@ -39,28 +39,32 @@ FilesystemUtils::FileType FilesystemUtils::getFileType(const std::filesystem::pa
         throw std::runtime_error("stat/lstat failed: " + p);
     }
 
+    return getFileType(static_cast<std::uint32_t>(st.st_mode));
+}
+
+FilesystemUtils::FileType FilesystemUtils::getFileType(std::uint32_t mode) {
     // 符号链接判断（仅 POSIX）
 #ifndef _WIN32
 #ifdef S_IFLNK
-    if ((st.st_mode & S_IFMT) == S_IFLNK) {
+    if ((mode & S_IFMT) == S_IFLNK) {
         return FileType::Symlink;
     }
 #endif
 #endif
 
-    if (S_ISREG(st.st_mode)) return FileType::Regular;
-    if (S_ISDIR(st.st_mode)) return FileType::Directory;
-    if (S_ISBLK(st.st_mode)) return FileType::BlockDevice;
-    if (S_ISCHR(st.st_mode)) return FileType::CharacterDevice;
-    if (S_ISFIFO(st.st_mode)) return FileType::Fifo;
+    if (S_ISREG(mode)) return FileType::Regular;
+    if (S_ISDIR(mode)) return FileType::Directory;
+    if (S_ISBLK(mode)) return FileType::BlockDevice;
+    if (S_ISCHR(mode)) return FileType::CharacterDevice;
+    if (S_ISFIFO(mode)) return FileType::Fifo;
 
     // Socket：MinGW/Windows 通常不支持这种文件类型宏，因此跳过
 #ifdef S_IFSOCK
-    if (((st.st_mode) & S_IFMT) == S_IFSOCK) return FileType::Socket;
+    if (((mode) & S_IFMT) == S_IFSOCK) return FileType::Socket;
 #endif
 
     // 其他类型：认为不支持
-    throw std::runtime_error("Unsupported file type: " + p);
+    throw std::runtime_error("Unsupported file type: mode " + std::to_string(mode));
 }
 
 bool FilesystemUtils::isBackupSupported(FileType type) {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <filesystem>
 
@@ -26,6 +27,11 @@ public:
      */
     static FileType getFileType(const std::filesystem::path& path);
 
+    /**
+     * @brief 由 st_mode 得到文件类型（不访问文件系统）
+     */
+    static FileType getFileType(std::uint32_t mode);
+
     /**
      * @brief 检查文件类型是否支持备份
      */
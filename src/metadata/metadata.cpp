@@ -1,28 +1,76 @@
 #include "metadata/metadata.h"
+#include "core/stats.h"
+#include "storage/xxhash64.h"
 
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <fcntl.h>
 #include <utime.h>
 #include <array>
+#include <cerrno>
+#include <cstring>
 
 #include <sstream>
+#include <stdexcept>
 #include <iostream>
 
 #ifdef _WIN32
 // Windows 下很多 POSIX 函数不存在：lstat/utimensat/utimes/AT_*
 // 我们用 stat + utime 做简化兼容（足够实验）
 #include <io.h>
+#else
+#include <unistd.h>
 #endif
 
 namespace backuprestore {
 
+namespace {
+
+// 扩展字段值中的路径：制表符、换行和 % 写成 %XX，其余字节原样保留
+std::string escapeField(const std::string& value) {
+    static const char kHex[] = "0123456789ABCDEF";
+    std::string out;
+    out.reserve(value.size());
+    for (unsigned char c : value) {
+        if (c == '\t' || c == '\n' || c == '\r' || c == '%') {
+            out.push_back('%');
+            out.push_back(kHex[c >> 4]);
+            out.push_back(kHex[c & 0xF]);
+        } else {
+            out.push_back(static_cast<char>(c));
+        }
+    }
+    return out;
+}
+
+std::string unescapeField(const std::string& value) {
+    std::string out;
+    out.reserve(value.size());
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        if (value[i] == '%') {
+            if (i + 2 >= value.size()) {
+                throw std::invalid_argument("invalid escape: " + value);
+            }
+            out.push_back(static_cast<char>(std::stoi(value.substr(i + 1, 2), nullptr, 16)));
+            i += 2;
+        } else {
+            out.push_back(value[i]);
+        }
+    }
+    return out;
+}
+
+} // namespace
+
 bool Metadata::loadFromFile(const std::filesystem::path& path) {
-    if (!std::filesystem::exists(path)) {
+    // 使用 symlink_status：悬空的符号链接本身也应当被备份
+    auto status = std::filesystem::symlink_status(path);
+    if (!std::filesystem::exists(status)) {
         return false;
     }
 
     // 检查是否为符号链接（Windows 也支持 is_symlink，但后续 lstat 不一定可用）
-    is_symlink = std::filesystem::is_symlink(path);
+    is_symlink = std::filesystem::is_symlink(status);
     if (is_symlink) {
         try {
             symlink_target = std::filesystem::read_symlink(path).string();
@@ -57,6 +105,12 @@ bool Metadata::loadFromStat(const std::filesystem::path& path) {
 
     mode = st.st_mode;
     mtime = st.st_mtime;
+    size = static_cast<std::uint64_t>(st.st_size);
+#ifdef _WIN32
+    mtime_nsec = 0;
+#else
+    mtime_nsec = static_cast<std::uint32_t>(st.st_mtim.tv_nsec);
+#endif
     uid = st.st_uid;  // 预留（Windows 下意义不大）
     gid = st.st_gid;  // 预留（Windows 下意义不大）
 
@@ -64,10 +118,20 @@ bool Metadata::loadFromStat(const std::filesystem::path& path) {
 }
 
 bool Metadata::applyToFile(const std::filesystem::path& path) const {
+    StatTimer timer(StatPhase::MetadataApply);
     const std::string p = path.string();
 
+    // 属主：只有 root 能任意修改，普通用户的 EPERM 不视为失败（Windows 下没意义）；
+    // 先于 chmod 执行，因为 chown 会清除 setuid/setgid 位
+#ifndef _WIN32
+    if (lchown(p.c_str(), uid, gid) != 0 && errno != EPERM) {
+        std::cerr << "设置文件属主失败: " << path << " - " << std::strerror(errno) << std::endl;
+    }
+#endif
+
     // 应用权限（Windows 下 chmod 只能设置“只读”一类的属性，效果有限，但能跑）
-    if (chmod(p.c_str(), mode) != 0) {
+    // 符号链接没有独立权限，chmod 会穿透修改到目标文件，因此跳过
+    if (!is_symlink && chmod(p.c_str(), mode) != 0) {
         std::cerr << "设置文件权限失败: " << path << std::endl;
         // Windows 下权限可能不支持，我们这里不强制失败（避免影响实验）
 #ifndef _WIN32
@@ -92,15 +156,15 @@ bool Metadata::applyToFile(const std::filesystem::path& path) const {
     struct timespec times[2];
     times[0].tv_sec = mtime;  // atime
     times[1].tv_sec = mtime;  // mtime
-    times[0].tv_nsec = 0;
-    times[1].tv_nsec = 0;
+    times[0].tv_nsec = mtime_nsec;
+    times[1].tv_nsec = mtime_nsec;
 
     if (utimensat(AT_FDCWD, p.c_str(), times, AT_SYMLINK_NOFOLLOW) != 0) {
         struct timeval tv[2];
         tv[0].tv_sec = mtime;
-        tv[0].tv_usec = 0;
+        tv[0].tv_usec = mtime_nsec / 1000;
         tv[1].tv_sec = mtime;
-        tv[1].tv_usec = 0;
+        tv[1].tv_usec = mtime_nsec / 1000;
         if (utimes(p.c_str(), tv) != 0) {
             std::cerr << "设置文件时间失败: " << path << std::endl;
             return false;
@@ -108,32 +172,127 @@ bool Metadata::applyToFile(const std::filesystem::path& path) const {
     }
 #endif
 
-    // TODO: 应用 uid/gid（需要root权限，Windows 下也没意义）
-    // if (chown(p.c_str(), uid, gid) != 0) { ... }
+    return true;
+}
 
+#ifndef _WIN32
+bool Metadata::applyToFd(int fd, const std::filesystem::path& path) const {
+    StatTimer timer(StatPhase::MetadataApply);
+    // 先改属主：chown 会清除 setuid/setgid 位，之后的 fchmod 再设置回来
+    if (fchown(fd, uid, gid) != 0 && errno != EPERM) {
+        std::cerr << "设置文件属主失败: " << path << " - " << std::strerror(errno) << std::endl;
+    }
+    if (fchmod(fd, mode & 07777) != 0) {
+        std::cerr << "设置文件权限失败: " << path << " - " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    struct timespec times[2];
+    times[0].tv_sec = mtime;  // atime
+    times[1].tv_sec = mtime;  // mtime
+    times[0].tv_nsec = mtime_nsec;
+    times[1].tv_nsec = mtime_nsec;
+    if (futimens(fd, times) != 0) {
+        std::cerr << "设置文件时间失败: " << path << " - " << std::strerror(errno) << std::endl;
+        return false;
+    }
     return true;
 }
+#endif
+
+bool Metadata::sameContentAs(const Metadata& other) const {
+    return mode == other.mode &&
+           mtime == other.mtime &&
+           mtime_nsec == other.mtime_nsec &&
+           size == other.size &&
+           uid == other.uid &&
+           gid == other.gid &&
+           is_symlink == other.is_symlink &&
+           symlink_target == other.symlink_target &&
+           hardlink == other.hardlink;
+}
 
 std::string Metadata::serialize() const {
     std::ostringstream oss;
     oss << mode << ":" << mtime << ":" << uid << ":" << gid
         << ":" << (is_symlink ? 1 : 0) << ":" << symlink_target;
+    // 扩展字段：制表符分隔的 key=value，旧版本读取时会被忽略
+    oss << "\tsize=" << size << "\tmtime_ns=" << mtime_nsec;
+    std::string extra = serializeExtra();
+    if (!extra.empty()) {
+        oss << "\t" << extra;
+    }
+    return oss.str();
+}
+
+std::uint64_t SparseMap::dataLength(std::uint64_t size) const {
+    if (!sparse) {
+        return size;
+    }
+    std::uint64_t total = 0;
+    for (const auto& extent : extents) {
+        total += extent.length;
+    }
+    return total;
+}
+
+std::string Metadata::serializeExtra() const {
+    std::ostringstream oss;
+    bool first = true;
+    auto field = [&](const char* key) -> std::ostringstream& {
+        if (!first) oss << "\t";
+        first = false;
+        oss << key << "=";
+        return oss;
+    };
+    if (chunked) {
+        field("chunks");
+        for (std::size_t i = 0; i < chunks.size(); ++i) {
+            if (i > 0) oss << ",";
+            oss << chunks[i];
+        }
+    }
+    if (!compression.empty()) {
+        field("comp") << compression;
+    }
+    if (has_checksum) {
+        field("xxh64") << Xxh64::toHex(checksum);
+    }
+    if (packed) {
+        field("pack") << pack_segment << ":" << pack_offset << ":" << pack_length;
+    }
+    if (delta_depth > 0) {
+        field("delta") << delta_depth;
+    }
+    if (!hardlink.empty()) {
+        field("link") << escapeField(hardlink);
+    }
+    if (layout.sparse) {
+        // 数据区段 offset+length，逗号分隔；没有数据（整个文件是空洞）时为空
+        field("sparse");
+        for (std::size_t i = 0; i < layout.extents.size(); ++i) {
+            if (i > 0) oss << ",";
+            oss << layout.extents[i].offset << "+" << layout.extents[i].length;
+        }
+    }
     return oss.str();
 }
 
 bool Metadata::deserialize(const std::string& data) {
     // 期望格式：
-    // mode:mtime:uid:gid:is_symlink:symlink_target(可包含冒号)
+    // mode:mtime:uid:gid:is_symlink:symlink_target(可包含冒号)[\tkey=value]...
+    size_t ext_pos = data.find('\t');
+    const std::string base = data.substr(0, ext_pos);
+
     std::array<std::string, 6> fields;
     size_t start = 0;
 
     for (int i = 0; i < 5; ++i) {
-        size_t pos = data.find(':', start);
+        size_t pos = base.find(':', start);
         if (pos == std::string::npos) return false;
-        fields[i] = data.substr(start, pos - start);
+        fields[i] = base.substr(start, pos - start);
         start = pos + 1;
     }
-    fields[5] = data.substr(start); // 剩余全部
+    fields[5] = base.substr(start); // 剩余全部
 
     try {
         mode = std::stoul(fields[0]);
@@ -146,6 +305,13 @@ bool Metadata::deserialize(const std::string& data) {
         is_symlink = (s == 1);
 
         symlink_target = fields[5];
+
+        size = 0;
+        mtime_nsec = 0;
+        resetExtra();
+        if (ext_pos != std::string::npos) {
+            parseFields(data.substr(ext_pos + 1));
+        }
     } catch (const std::exception& e) {
         std::cerr << "反序列化元数据失败: " << e.what() << std::endl;
         return false;
@@ -154,4 +320,101 @@ bool Metadata::deserialize(const std::string& data) {
     return true;
 }
 
+bool Metadata::deserializeExtra(const std::string& data) {
+    resetExtra();
+    try {
+        parseFields(data);
+    } catch (const std::exception& e) {
+        std::cerr << "反序列化扩展字段失败: " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Metadata::resetExtra() {
+    chunked = false;
+    chunks.clear();
+    compression.clear();
+    has_checksum = false;
+    checksum = 0;
+    layout = SparseMap();
+    packed = false;
+    pack_segment = 0;
+    pack_offset = 0;
+    pack_length = 0;
+    delta_depth = 0;
+    hardlink.clear();
+}
+
+void Metadata::parseFields(const std::string& data) {
+    // 解析扩展字段（未知 key 忽略，便于向前兼容）
+    size_t start = 0;
+    while (start <= data.size()) {
+        size_t next = data.find('\t', start);
+        if (next == std::string::npos) next = data.size();
+        size_t eq = data.find('=', start);
+        if (eq != std::string::npos && eq < next) {
+            setField(data.substr(start, eq - start), data.substr(eq + 1, next - eq - 1));
+        }
+        start = next + 1;
+    }
+}
+
+void Metadata::setField(const std::string& key, const std::string& value) {
+    if (key == "size") {
+        size = std::stoull(value);
+    } else if (key == "mtime_ns") {
+        mtime_nsec = static_cast<std::uint32_t>(std::stoul(value));
+    } else if (key == "chunks") {
+        chunked = true;
+        chunks.clear();
+        size_t pos = 0;
+        while (pos < value.size()) {
+            size_t comma = value.find(',', pos);
+            if (comma == std::string::npos) comma = value.size();
+            chunks.push_back(value.substr(pos, comma - pos));
+            pos = comma + 1;
+        }
+    } else if (key == "comp") {
+        compression = value;
+    } else if (key == "xxh64") {
+        if (!Xxh64::fromHex(value, checksum)) {
+            throw std::invalid_argument("invalid xxh64: " + value);
+        }
+        has_checksum = true;
+    } else if (key == "pack") {
+        // <段序号>:<偏移>:<长度>
+        size_t first = value.find(':');
+        size_t second = first == std::string::npos ? first : value.find(':', first + 1);
+        if (second == std::string::npos) {
+            throw std::invalid_argument("invalid pack location: " + value);
+        }
+        pack_segment = static_cast<std::uint32_t>(std::stoul(value.substr(0, first)));
+        pack_offset = std::stoull(value.substr(first + 1, second - first - 1));
+        pack_length = std::stoull(value.substr(second + 1));
+        packed = true;
+    } else if (key == "delta") {
+        delta_depth = static_cast<std::uint32_t>(std::stoul(value));
+    } else if (key == "link") {
+        hardlink = unescapeField(value);
+    } else if (key == "sparse") {
+        layout.sparse = true;
+        layout.extents.clear();
+        size_t pos = 0;
+        while (pos < value.size()) {
+            size_t comma = value.find(',', pos);
+            if (comma == std::string::npos) comma = value.size();
+            size_t plus = value.find('+', pos);
+            if (plus == std::string::npos || plus > comma) {
+                throw std::invalid_argument("invalid sparse extent: " + value.substr(pos, comma - pos));
+            }
+            Extent extent;
+            extent.offset = std::stoull(value.substr(pos, plus - pos));
+            extent.length = std::stoull(value.substr(plus + 1, comma - plus - 1));
+            layout.extents.push_back(extent);
+            pos = comma + 1;
+        }
+    }
+}
+
 } // namespace backuprestore
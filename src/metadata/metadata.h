@@ -4,9 +4,32 @@
 #include <filesystem>
 #include <cstdint>
 #include <ctime>
+#include <vector>
 
 namespace backuprestore {
 
+/**
+ * @brief 文件中的一个数据区段 [offset, offset + length)
+ */
+struct Extent {
+    std::uint64_t offset = 0;
+    std::uint64_t length = 0;
+};
+
+/**
+ * @brief 稀疏文件的数据布局
+ * sparse 为 false 时整个文件都是数据；为 true 时 extents 之外的部分是空洞（读出为 0，不占空间）
+ */
+struct SparseMap {
+    bool sparse = false;
+    std::vector<Extent> extents;  // 按偏移升序、互不重叠
+
+    /**
+     * @brief 需要保存的数据字节数（稠密文件为 size）
+     */
+    std::uint64_t dataLength(std::uint64_t size) const;
+};
+
 /**
  * @brief 文件元数据类
  * 支持 mode（权限）和 mtime（修改时间）
@@ -20,6 +43,20 @@ public:
     std::uint32_t gid = 0;       // 组ID（预留）
     bool is_symlink = false;     // 是否为符号链接
     std::string symlink_target;  // 符号链接目标（如果适用）
+    std::uint64_t size = 0;      // 文件大小（字节）
+    std::uint32_t mtime_nsec = 0; // 修改时间的纳秒部分
+    bool chunked = false;        // 数据是否保存在去重块存储中（否则为 data/ 镜像）
+    std::vector<std::string> chunks; // 块ID列表（chunked 时有效，按文件顺序）
+    std::string compression;     // data/ 镜像数据的压缩算法（空表示未压缩，"lz" 表示 LzCompressor）
+    bool has_checksum = false;   // 是否记录了内容校验和（符号链接和旧仓库的条目没有）
+    std::uint64_t checksum = 0;  // 文件数据的 XXH64（稀疏文件只含数据区段），备份时随读取一并计算
+    SparseMap layout;            // 稀疏文件的数据区段：块存储和压缩镜像只保存这些区段的内容
+    bool packed = false;         // 数据是否保存在 packs/ 段文件中（小文件；compression 同样适用）
+    std::uint32_t pack_segment = 0;  // 段序号（packed 时有效）
+    std::uint64_t pack_offset = 0;   // 数据在段文件中的偏移
+    std::uint64_t pack_length = 0;   // 段文件中的数据长度（压缩后）
+    std::uint32_t delta_depth = 0;   // 镜像之上叠加的差量个数（0 表示镜像就是当前内容，见 DeltaStore）
+    std::string hardlink;            // 与另一条目是同一 inode 的硬链接时为该条目的相对路径：数据只存在那个条目中
 
     /**
      * @brief 从文件系统读取元数据
@@ -35,20 +72,69 @@ public:
      */
     bool applyToFile(const std::filesystem::path& path) const;
 
+#ifndef _WIN32
+    /**
+     * @brief 将元数据应用到已打开的普通文件（fchown、fchmod、futimens，不再解析路径）
+     * 非 root 时无权修改属主，EPERM 被忽略
+     * @param fd 可写打开的文件描述符
+     * @param path fd 对应的路径（仅用于错误信息）
+     * @return 是否成功
+     */
+    bool applyToFd(int fd, const std::filesystem::path& path) const;
+#endif
+
+    /**
+     * @brief 判断文件内容是否可能发生变化（用于增量备份）
+     * 比较类型、权限、属主、大小、纳秒级修改时间、符号链接目标及硬链接指向的条目
+     * @param other 另一份元数据（通常为上次备份时的记录）
+     * @return true 表示两者一致，可视为未变化
+     */
+    bool sameContentAs(const Metadata& other) const;
+
     /**
      * @brief 序列化为字符串（用于保存到备份仓库）
+     * 格式：基本字段 mode:mtime:uid:gid:is_symlink:symlink_target，
+     * 之后以制表符分隔追加 key=value 扩展字段
      * @return 序列化字符串
      */
     std::string serialize() const;
 
     /**
-     * @brief 从字符串反序列化
+     * @brief 从字符串反序列化（兼容不含扩展字段的旧格式）
      * @param data 序列化字符串
      * @return 是否成功
      */
     bool deserialize(const std::string& data);
 
+    /**
+     * @brief 序列化扩展字段（不含基本字段及 size/mtime_ns）
+     * 供二进制索引使用：定长字段存入记录，其余扩展字段以文本保存
+     * @return 制表符分隔的 key=value，无扩展字段时为空串
+     */
+    std::string serializeExtra() const;
+
+    /**
+     * @brief 从 serializeExtra() 的输出恢复扩展字段
+     * @return 是否成功
+     */
+    bool deserializeExtra(const std::string& data);
+
 private:
+    /**
+     * @brief 清空扩展字段（块列表等）
+     */
+    void resetExtra();
+
+    /**
+     * @brief 解析制表符分隔的 key=value 字段（数值非法时抛出异常）
+     */
+    void parseFields(const std::string& data);
+
+    /**
+     * @brief 设置单个扩展字段（未知 key 忽略）
+     */
+    void setField(const std::string& key, const std::string& value);
+
     /**
      * @brief 从stat结构获取元数据（Linux系统调用）
      */
@@ -0,0 +1,262 @@
+#include "storage/chunk_store.h"
+#include "storage/sha256.h"
+#include "storage/xxhash64.h"
+#include "core/file_utils.h"
+#include "core/stats.h"
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace backuprestore {
+
+namespace {
+
+// Gear 表：由固定种子的 splitmix64 生成，保证不同版本/机器上分块结果一致
+std::array<std::uint64_t, 256> makeGearTable() {
+    std::array<std::uint64_t, 256> table{};
+    std::uint64_t x = 0x9E3779B97F4A7C15ULL;
+    for (auto& v : table) {
+        x += 0x9E3779B97F4A7C15ULL;
+        std::uint64_t z = x;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        v = z ^ (z >> 31);
+    }
+    return table;
+}
+
+const std::array<std::uint64_t, 256> kGear = makeGearTable();
+
+// 归一化分块：平均块大小之前用更严格的掩码（15 位），之后用更宽松的掩码（11 位）
+// 取高位：左移的 Gear 哈希中高位取决于最近 64 个字节
+const std::uint64_t kMaskStrict = ~0ULL << (64 - 15);
+const std::uint64_t kMaskLoose = ~0ULL << (64 - 11);
+
+const std::size_t kReadBufferSize = 1024 * 1024;
+
+} // namespace
+
+std::size_t Chunker::findBoundary(const std::uint8_t* data, std::size_t len) {
+    if (len <= kMinSize) {
+        return len;
+    }
+    std::size_t limit = len < kMaxSize ? len : kMaxSize;
+    std::size_t normal = limit < kAvgSize ? limit : kAvgSize;
+
+    std::uint64_t fp = 0;
+    std::size_t i = kMinSize;
+    for (; i < normal; ++i) {
+        fp = (fp << 1) + kGear[data[i]];
+        if ((fp & kMaskStrict) == 0) {
+            return i + 1;
+        }
+    }
+    for (; i < limit; ++i) {
+        fp = (fp << 1) + kGear[data[i]];
+        if ((fp & kMaskLoose) == 0) {
+            return i + 1;
+        }
+    }
+    return limit;
+}
+
+ChunkStore::ChunkStore(const std::filesystem::path& root) : root_(root) {
+}
+
+std::filesystem::path ChunkStore::chunkPath(const std::string& id) const {
+    return root_ / id.substr(0, 2) / id.substr(2);
+}
+
+bool ChunkStore::hasChunk(const std::string& id) const {
+    std::error_code ec;
+    return std::filesystem::exists(chunkPath(id), ec);
+}
+
+std::size_t ChunkStore::removeUnreferenced(const std::unordered_set<std::string>& referenced,
+                                           std::uint64_t& removed_bytes) {
+    removed_bytes = 0;
+    std::size_t removed = 0;
+    std::error_code ec;
+    if (!std::filesystem::is_directory(root_, ec)) {
+        return 0;
+    }
+    for (const auto& prefix : std::filesystem::directory_iterator(root_, ec)) {
+        const std::string dir = prefix.path().filename().string();
+        if (dir.size() != 2 || !prefix.is_directory(ec)) {
+            continue;
+        }
+        for (const auto& entry : std::filesystem::directory_iterator(prefix.path(), ec)) {
+            // 块ID 为 64 位十六进制：目录名 2 位 + 文件名 62 位；".tmp." 临时文件长度不符
+            const std::string name = entry.path().filename().string();
+            if (name.size() != 62 || name.find('.') != std::string::npos) {
+                continue;
+            }
+            if (referenced.count(dir + name)) {
+                continue;
+            }
+            std::error_code size_ec;
+            std::uint64_t size = static_cast<std::uint64_t>(entry.file_size(size_ec));
+            std::error_code rm_ec;
+            if (std::filesystem::remove(entry.path(), rm_ec)) {
+                ++removed;
+                removed_bytes += size_ec ? 0 : size;
+            } else if (rm_ec) {
+                std::cerr << "警告: 删除块失败: " << entry.path() << " - " << rm_ec.message() << std::endl;
+            }
+        }
+    }
+    return removed;
+}
+
+bool ChunkStore::putChunk(const std::uint8_t* data, std::size_t len, std::string& id) {
+    id = Sha256::toHex(Sha256::hash(data, len));
+
+    auto path = chunkPath(id);
+    if (hasChunk(id)) {
+        dedup_chunks_.fetch_add(1, std::memory_order_relaxed);
+        dedup_bytes_.fetch_add(len, std::memory_order_relaxed);
+        return true;
+    }
+
+    try {
+        std::filesystem::create_directories(path.parent_path());
+
+        // 先写临时文件再 rename：并行备份写同一个块时不会读到半个块
+        auto tmp = path;
+        tmp += ".tmp." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) +
+               "." + std::to_string(tmp_counter_.fetch_add(1, std::memory_order_relaxed));
+        {
+            std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+            if (!ofs) {
+                std::cerr << "无法写入块文件: " << tmp << std::endl;
+                return false;
+            }
+            if (len > 0) {
+                StatTimer timer(StatPhase::Write, len);
+                ofs.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(len));
+            }
+            if (!ofs) {
+                std::cerr << "写入块文件失败: " << tmp << std::endl;
+                return false;
+            }
+        }
+        std::filesystem::rename(tmp, path);
+    } catch (const std::exception& e) {
+        std::cerr << "存储块失败: " << id << " - " << e.what() << std::endl;
+        return false;
+    }
+
+    new_chunks_.fetch_add(1, std::memory_order_relaxed);
+    new_bytes_.fetch_add(len, std::memory_order_relaxed);
+    return true;
+}
+
+bool ChunkStore::readChunk(const std::string& id, std::vector<std::uint8_t>& out) const {
+    std::ifstream ifs(chunkPath(id), std::ios::binary);
+    if (!ifs) {
+        std::cerr << "块不存在: " << id << std::endl;
+        return false;
+    }
+    ifs.seekg(0, std::ios::end);
+    auto n = ifs.tellg();
+    ifs.seekg(0, std::ios::beg);
+    out.resize(static_cast<std::size_t>(n));
+    if (n > 0) {
+        StatTimer timer(StatPhase::Read, static_cast<std::uint64_t>(n));
+        ifs.read(reinterpret_cast<char*>(out.data()), n);
+    }
+    if (!ifs) {
+        std::cerr << "读取块失败: " << id << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ChunkStore::storeFile(const std::filesystem::path& source_path,
+                           std::vector<std::string>& chunk_ids,
+                           std::uint64_t* checksum,
+                           SparseMap* layout) {
+    chunk_ids.clear();
+
+    ExtentReader reader;
+    if (!reader.open(source_path, layout != nullptr)) {
+        return false;
+    }
+
+    // 缓冲区中 [begin, end) 为尚未切分的数据；剩余不足一个最大块时再补读
+    std::vector<std::uint8_t> buffer(kReadBufferSize + Chunker::kMaxSize);
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    bool eof = false;
+    Xxh64 hasher;
+
+    for (;;) {
+        if (!eof && end - begin < Chunker::kMaxSize) {
+            if (begin > 0) {
+                std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+                end -= begin;
+                begin = 0;
+            }
+            // 数据区段首尾相接地读入，空洞不参与分块
+            std::int64_t n = reader.read(buffer.data() + end, buffer.size() - end);
+            if (n < 0) {
+                return false;
+            }
+            end += static_cast<std::size_t>(n);
+            eof = (end < buffer.size());
+        }
+
+        if (begin == end) {
+            break;
+        }
+
+        std::size_t n = Chunker::findBoundary(buffer.data() + begin, end - begin);
+        std::string id;
+        if (!putChunk(buffer.data() + begin, n, id)) {
+            return false;
+        }
+        if (checksum) {
+            hasher.update(buffer.data() + begin, n);
+        }
+        chunk_ids.push_back(std::move(id));
+        begin += n;
+    }
+
+    if (checksum) {
+        *checksum = hasher.digest();
+    }
+    if (layout) {
+        *layout = reader.layout();
+    }
+    return true;
+}
+
+bool ChunkStore::restoreFile(const std::vector<std::string>& chunk_ids,
+                             const std::filesystem::path& target_path) const {
+    std::ofstream ofs(target_path, std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+        std::cerr << "无法创建目标文件: " << target_path << std::endl;
+        return false;
+    }
+
+    std::vector<std::uint8_t> chunk;
+    for (const auto& id : chunk_ids) {
+        if (!readChunk(id, chunk)) {
+            return false;
+        }
+        if (!chunk.empty()) {
+            ofs.write(reinterpret_cast<const char*>(chunk.data()),
+                      static_cast<std::streamsize>(chunk.size()));
+        }
+    }
+
+    if (!ofs) {
+        std::cerr << "写入目标文件失败: " << target_path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace backuprestore
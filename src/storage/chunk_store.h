@@ -0,0 +1,119 @@
+#pragma once
+
+#include "metadata/metadata.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace backuprestore {
+
+/**
+ * @brief 内容定义分块器（FastCDC 风格的 Gear 滚动哈希）
+ * 块边界只取决于内容本身，文件中间插入/删除数据只影响附近的块
+ */
+class Chunker {
+public:
+    static constexpr std::size_t kMinSize = 2 * 1024;
+    static constexpr std::size_t kAvgSize = 8 * 1024;
+    static constexpr std::size_t kMaxSize = 64 * 1024;
+
+    /**
+     * @brief 在 data[0, len) 中寻找第一个块边界
+     * @return 第一个块的长度（len 不足 kMinSize 时返回 len）
+     */
+    static std::size_t findBoundary(const std::uint8_t* data, std::size_t len);
+};
+
+/**
+ * @brief 去重块存储
+ * 块以 SHA-256 十六进制作为名称保存在 <root>/<前2位>/<其余>，相同内容只存一份
+ */
+class ChunkStore {
+public:
+    /**
+     * @brief 构造函数
+     * @param root 块存储根目录（通常为 <仓库>/chunks）
+     */
+    explicit ChunkStore(const std::filesystem::path& root);
+
+    /**
+     * @brief 分块并存储一个文件
+     * @param source_path 源文件路径
+     * @param chunk_ids 输出：按顺序排列的块ID列表
+     * @param checksum 非空时输出文件内容的 XXH64（分块时顺带计算，不额外读取）
+     * @param layout 非空时跳过空洞，只对数据区段分块，并输出区段表
+     * @return 是否成功
+     */
+    bool storeFile(const std::filesystem::path& source_path,
+                   std::vector<std::string>& chunk_ids,
+                   std::uint64_t* checksum = nullptr,
+                   SparseMap* layout = nullptr);
+
+    /**
+     * @brief 按块列表重新拼接出文件
+     * @param chunk_ids 块ID列表
+     * @param target_path 目标文件路径
+     * @return 是否成功
+     */
+    bool restoreFile(const std::vector<std::string>& chunk_ids,
+                     const std::filesystem::path& target_path) const;
+
+    /**
+     * @brief 存储一个块（已存在则跳过写入）
+     * @param id 输出：块ID
+     * @return 是否成功
+     */
+    bool putChunk(const std::uint8_t* data, std::size_t len, std::string& id);
+
+    /**
+     * @brief 读取一个块
+     */
+    bool readChunk(const std::string& id, std::vector<std::uint8_t>& out) const;
+
+    /**
+     * @brief 块是否存在
+     */
+    bool hasChunk(const std::string& id) const;
+
+    /**
+     * @brief 块在磁盘上的路径
+     */
+    std::filesystem::path chunkPath(const std::string& id) const;
+
+    /**
+     * @brief 删除不在 referenced 集合中的块（垃圾回收）
+     * 只处理名称为块ID的文件，写入中的临时文件不受影响；不能与备份同时进行
+     * @param referenced 仍被引用的块ID
+     * @param removed_bytes 输出删除的字节数
+     * @return 删除的块数
+     */
+    std::size_t removeUnreferenced(const std::unordered_set<std::string>& referenced,
+                                   std::uint64_t& removed_bytes);
+
+    /**
+     * @brief 本次新写入的块数/字节数
+     */
+    std::size_t getNewChunks() const { return new_chunks_.load(); }
+    std::uint64_t getNewBytes() const { return new_bytes_.load(); }
+
+    /**
+     * @brief 本次因去重而复用的块数/字节数
+     */
+    std::size_t getDedupChunks() const { return dedup_chunks_.load(); }
+    std::uint64_t getDedupBytes() const { return dedup_bytes_.load(); }
+
+private:
+    std::filesystem::path root_;
+    std::atomic<std::size_t> new_chunks_{0};
+    std::atomic<std::uint64_t> new_bytes_{0};
+    std::atomic<std::size_t> dedup_chunks_{0};
+    std::atomic<std::uint64_t> dedup_bytes_{0};
+    std::atomic<std::uint64_t> tmp_counter_{0};
+};
+
+} // namespace backuprestore
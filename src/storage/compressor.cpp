@@ -1,6 +1,12 @@
 #include "storage/compressor.h"
 #include "core/file_utils.h"
+#include "core/stats.h"
+#include "storage/package/compress_lz.h"
+#include "storage/xxhash64.h"
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <optional>
 
 namespace backuprestore {
 
@@ -19,6 +25,172 @@ bool NoCompressor::decompress(const std::filesystem::path& input_path,
     return FileUtils::copyFile(input_path, output_path);
 }
 
-} // namespace backuprestore
+namespace {
+
+const std::size_t kStreamBufferSize = 1024 * 1024;
+
+// 每个线程复用一个编码器：其中的块缓冲和哈希表不随每个文件重新分配
+// 上一个文件中途失败时编码器里可能留有输入，取出时先丢弃
+pkg::LzEncoder& threadEncoder(int level) {
+    thread_local std::optional<pkg::LzEncoder> encoder;
+    if (!encoder || encoder->level() != level) {
+        encoder.emplace(level);
+    }
+    encoder->reset();
+    return *encoder;
+}
+
+// 以固定大小的缓冲块读取 input，经 codec 处理后交给 write(const uint8_t*, size_t)
+// Codec 需提供 update(const uint8_t*, size_t, std::vector<uint8_t>&)；hasher 非空时对输入计算 XXH64；
+// layout 非空时跳过 input 中的空洞，只处理数据区段，并输出区段表
+template <typename Codec, typename Finish, typename Write>
+bool streamInput(const std::filesystem::path& input_path,
+                 Codec& codec, Finish finish, Write write, Xxh64* hasher = nullptr,
+                 SparseMap* layout = nullptr) {
+    ExtentReader reader;
+    if (!reader.open(input_path, layout != nullptr)) {
+        return false;
+    }
+
+    std::vector<std::uint8_t> buffer(kStreamBufferSize);
+    std::vector<std::uint8_t> out;
+    for (;;) {
+        std::int64_t r = reader.read(buffer.data(), buffer.size());
+        if (r < 0) {
+            return false;
+        }
+        std::size_t n = static_cast<std::size_t>(r);
+        if (n == 0) {
+            break;
+        }
+        if (hasher) {
+            hasher->update(buffer.data(), n);
+        }
+        out.clear();
+        {
+            StatTimer timer(StatPhase::Compress, n);
+            codec.update(buffer.data(), n, out);
+        }
+        if (!write(out.data(), out.size())) {
+            return false;
+        }
+    }
+    out.clear();
+    {
+        StatTimer timer(StatPhase::Compress);
+        finish(out);
+    }
+    if (layout) {
+        *layout = reader.layout();
+    }
+    return write(out.data(), out.size());
+}
+
+// 写入 output（覆盖），必要时先创建父目录
+template <typename Codec, typename Finish>
+bool streamFile(const std::filesystem::path& input_path,
+                const std::filesystem::path& output_path,
+                Codec& codec, Finish finish, Xxh64* hasher = nullptr,
+                SparseMap* layout = nullptr) {
+    auto parent = output_path.parent_path();
+    if (!parent.empty()) {
+        FileUtils::createDirectories(parent);
+    }
+    std::ofstream ofs(output_path, std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+        std::cerr << "无法创建目标文件: " << output_path << std::endl;
+        return false;
+    }
+    bool ok = streamInput(input_path, codec, finish, [&](const std::uint8_t* data, std::size_t size) {
+        StatTimer timer(StatPhase::Write, size);
+        ofs.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        return true;
+    }, hasher, layout);
+    if (ok && !ofs) {
+        std::cerr << "写入目标文件失败: " << output_path << std::endl;
+        return false;
+    }
+    return ok;
+}
+
+} // namespace
+
+LzCompressor::LzCompressor(int level) {
+    setCompressionLevel(level);
+}
+
+void LzCompressor::setCompressionLevel(int level) {
+    level_ = std::clamp(level, pkg::kLzMinLevel, pkg::kLzMaxLevel);
+}
 
+bool LzCompressor::compress(const std::filesystem::path& input_path,
+                            const std::filesystem::path& output_path) {
+    return compress(input_path, output_path, nullptr, nullptr);
+}
+
+bool LzCompressor::compress(const std::filesystem::path& input_path,
+                            const std::filesystem::path& output_path,
+                            std::uint64_t* checksum,
+                            SparseMap* layout) {
+    pkg::LzEncoder& encoder = threadEncoder(level_);
+    Xxh64 hasher;
+    if (!streamFile(input_path, output_path, encoder,
+                    [&](std::vector<std::uint8_t>& out) { encoder.finish(out); },
+                    checksum ? &hasher : nullptr, layout)) {
+        return false;
+    }
+    if (checksum) {
+        *checksum = hasher.digest();
+    }
+    return true;
+}
+
+bool LzCompressor::decompressTo(const std::filesystem::path& input_path, const ByteSink& sink) {
+    pkg::LzDecoder decoder;
+    try {
+        return streamInput(input_path, decoder,
+                           [&](std::vector<std::uint8_t>&) { decoder.finish(); },
+                           [&](const std::uint8_t* data, std::size_t size) { return sink(data, size); });
+    } catch (const std::exception& e) {
+        std::cerr << "解压失败: " << input_path << " - " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void LzCompressor::compressBuffer(const std::uint8_t* data, std::size_t size,
+                                  std::vector<std::uint8_t>& out) const {
+    pkg::LzEncoder& encoder = threadEncoder(level_);
+    StatTimer timer(StatPhase::Compress, size);
+    out.clear();
+    encoder.update(data, size, out);
+    encoder.finish(out);
+}
+
+bool LzCompressor::decompressBuffer(const std::uint8_t* data, std::size_t size, const ByteSink& sink,
+                                    const std::string& name) {
+    pkg::LzDecoder decoder;
+    std::vector<std::uint8_t> out;
+    try {
+        StatTimer timer(StatPhase::Compress, size);
+        decoder.update(data, size, out);
+        decoder.finish();
+    } catch (const std::exception& e) {
+        std::cerr << "解压失败: " << name << " - " << e.what() << std::endl;
+        return false;
+    }
+    return sink(out.data(), out.size());
+}
 
+bool LzCompressor::decompress(const std::filesystem::path& input_path,
+                              const std::filesystem::path& output_path) {
+    pkg::LzDecoder decoder;
+    try {
+        return streamFile(input_path, output_path, decoder,
+                          [&](std::vector<std::uint8_t>&) { decoder.finish(); });
+    } catch (const std::exception& e) {
+        std::cerr << "解压失败: " << input_path << " - " << e.what() << std::endl;
+        return false;
+    }
+}
+
+} // namespace backuprestore
@@ -1,20 +1,21 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 #include <filesystem>
 #include <vector>
+#include "core/file_utils.h"
 
 namespace backuprestore {
 
 /**
- * @brief 压缩/解压接口（预留）
+ * @brief 压缩/解压接口
  * 
  * 压缩算法支持：
+ * - LZ77 类（LzCompressor，项目内实现，与 package 的 CompressAlg::LZ 格式相同）
  * - gzip (预留)
  * - bzip2 (预留)
  * - xz (预留)
- * 
- * TODO: 实现压缩功能（不依赖第三方库，可能需要自己实现或使用系统命令）
  */
 class Compressor {
 public:
@@ -64,6 +65,56 @@ public:
     void setCompressionLevel(int level) override {}
 };
 
+/**
+ * @brief LZ77 类压缩（哈希链匹配，解压只做 memcpy 级别的拷贝）
+ * 
+ * 压缩级别 1-9：级别越高，每个位置比较的候选匹配越多，压缩率更高、压缩更慢；
+ * 解压速度与级别无关。可被多个线程同时使用（每个线程复用自己的编码状态）
+ */
+class LzCompressor : public Compressor {
+public:
+    explicit LzCompressor(int level = 6);
+
+    bool compress(const std::filesystem::path& input_path,
+                  const std::filesystem::path& output_path) override;
+
+    /**
+     * @brief 压缩并输出原始数据的 XXH64（读取输入时顺带计算）
+     * @param layout 非空时只压缩输入的数据区段（跳过空洞），并输出区段表；
+     *               XXH64 同样只覆盖数据区段
+     */
+    bool compress(const std::filesystem::path& input_path,
+                  const std::filesystem::path& output_path,
+                  std::uint64_t* checksum,
+                  SparseMap* layout = nullptr);
+
+    bool decompress(const std::filesystem::path& input_path,
+                    const std::filesystem::path& output_path) override;
+
+    /**
+     * @brief 解压并把原始数据按顺序交给 sink
+     */
+    bool decompressTo(const std::filesystem::path& input_path, const ByteSink& sink);
+
+    /**
+     * @brief 压缩内存中的数据（小文件打包使用，格式与 compress 的输出相同）
+     */
+    void compressBuffer(const std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& out) const;
+
+    /**
+     * @brief 解压内存中的数据并交给 sink
+     * @param name 数据来源（仅用于错误信息）
+     */
+    static bool decompressBuffer(const std::uint8_t* data, std::size_t size, const ByteSink& sink,
+                                 const std::string& name);
+
+    int getCompressionLevel() const override { return level_; }
+    void setCompressionLevel(int level) override;
+
+private:
+    int level_;
+};
+
 } // namespace backuprestore
 
 
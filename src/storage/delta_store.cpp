@@ -0,0 +1,639 @@
+#include "storage/delta_store.h"
+#include "storage/sha256.h"
+#include "storage/xxhash64.h"
+#include "core/stats.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+namespace backuprestore {
+
+namespace {
+
+const char kSigMagic[8] = {'B', 'R', 'D', 'S', 'I', 'G', '0', '1'};
+const char kDeltaMagic[8] = {'B', 'R', 'D', 'E', 'L', 'T', 'A', '1'};
+const std::size_t kSigHeader = 8 + 4 + 8 + 8 + 8;  // magic + 块大小 + 文件大小 + XXH64 + 块数
+const std::size_t kSigEntry = 4 + 8;               // 弱校验和 + XXH64
+const std::size_t kOpSize = 1 + 8 + 8;             // 类型 + 偏移 + 长度
+const std::size_t kDeltaFooter = 8 + 8 + 8 + 8;    // 操作表偏移 + 操作数 + 版本大小 + magic
+const std::size_t kWindowSize = 8 * 1024 * 1024;
+const std::size_t kReadBufferSize = 1024 * 1024;
+const std::uint32_t kNone = 0xFFFFFFFFu;
+
+// 复制：offset 为上一版本中的偏移；字面数据：offset 为本差量文件中的偏移
+const std::uint8_t kOpCopy = 0;
+const std::uint8_t kOpLiteral = 1;
+
+struct Op {
+    std::uint8_t kind;
+    std::uint64_t offset;
+    std::uint64_t length;
+};
+
+// 一个版本的签名：第 i 块覆盖 [i * kBlockSize, min((i + 1) * kBlockSize, size))
+struct Signature {
+    std::uint64_t size = 0;
+    std::uint64_t checksum = 0;
+    std::vector<std::uint32_t> weak;
+    std::vector<std::uint64_t> strong;
+};
+
+void putLe(std::string& out, std::uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+std::uint64_t getLe(const char* p, int bytes) {
+    std::uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) v |= static_cast<std::uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    return v;
+}
+
+// rsync 弱校验和：a 为字节和，b 为按位置加权的和（首字节权重为块长），各取低 16 位
+inline std::uint32_t weakSum(std::uint32_t a, std::uint32_t b) {
+    return (b << 16) | (a & 0xFFFFu);
+}
+
+void sumBlock(const std::uint8_t* p, std::size_t n, std::uint32_t& a, std::uint32_t& b) {
+    a = 0;
+    b = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        a += p[i];
+        b += a;
+    }
+}
+
+// 弱校验和的位图预筛：大部分滚动位置不需要查哈希表
+inline std::size_t filterSlot(std::uint32_t weak) {
+    return (weak * 0x9E3779B1u) >> 12;  // 20 位
+}
+
+// 边读边生成签名和整体校验和：按 kBlockSize 对齐切块
+class SignatureBuilder {
+public:
+    void update(const std::uint8_t* p, std::size_t n) {
+        file_hash_.update(p, n);
+        sig_.size += n;
+        while (n > 0) {
+            std::size_t take = std::min(n, DeltaStore::kBlockSize - fill_);
+            block_hash_.update(p, take);
+            for (std::size_t i = 0; i < take; ++i) {
+                a_ += p[i];
+                b_ += a_;
+            }
+            fill_ += take;
+            p += take;
+            n -= take;
+            if (fill_ == DeltaStore::kBlockSize) {
+                finishBlock();
+            }
+        }
+    }
+
+    Signature& finish() {
+        if (fill_ > 0) {
+            finishBlock();
+        }
+        sig_.checksum = file_hash_.digest();
+        return sig_;
+    }
+
+private:
+    Signature sig_;
+    Xxh64 file_hash_;
+    Xxh64 block_hash_;
+    std::uint32_t a_ = 0;
+    std::uint32_t b_ = 0;
+    std::size_t fill_ = 0;
+
+    void finishBlock() {
+        sig_.weak.push_back(weakSum(a_, b_));
+        sig_.strong.push_back(block_hash_.digest());
+        block_hash_ = Xxh64();
+        a_ = 0;
+        b_ = 0;
+        fill_ = 0;
+    }
+};
+
+bool readSignatureHeader(std::ifstream& in, std::uint64_t& size, std::uint64_t& checksum,
+                         std::uint64_t& count) {
+    char header[kSigHeader];
+    if (!in.read(header, sizeof(header)) || std::memcmp(header, kSigMagic, sizeof(kSigMagic)) != 0 ||
+        getLe(header + 8, 4) != DeltaStore::kBlockSize) {
+        return false;
+    }
+    size = getLe(header + 12, 8);
+    checksum = getLe(header + 20, 8);
+    count = getLe(header + 28, 8);
+    return count == (size + DeltaStore::kBlockSize - 1) / DeltaStore::kBlockSize;
+}
+
+bool readSignature(const std::filesystem::path& file, Signature& sig) {
+    std::ifstream in(file, std::ios::binary);
+    std::uint64_t count = 0;
+    if (!in || !readSignatureHeader(in, sig.size, sig.checksum, count)) {
+        std::cerr << "签名文件缺失或已损坏: " << file << std::endl;
+        return false;
+    }
+    std::string entries(static_cast<std::size_t>(count * kSigEntry), '\0');
+    if (!entries.empty() && !in.read(&entries[0], static_cast<std::streamsize>(entries.size()))) {
+        std::cerr << "签名文件不完整: " << file << std::endl;
+        return false;
+    }
+    sig.weak.resize(static_cast<std::size_t>(count));
+    sig.strong.resize(static_cast<std::size_t>(count));
+    for (std::size_t i = 0; i < sig.weak.size(); ++i) {
+        sig.weak[i] = static_cast<std::uint32_t>(getLe(entries.data() + i * kSigEntry, 4));
+        sig.strong[i] = getLe(entries.data() + i * kSigEntry + 4, 8);
+    }
+    return true;
+}
+
+// 先写临时文件再 rename：中断时不会留下半个文件
+bool renameInto(const std::filesystem::path& tmp, const std::filesystem::path& file) {
+    std::error_code ec;
+    std::filesystem::rename(tmp, file, ec);
+    if (ec) {
+        std::cerr << "重命名失败: " << tmp << " -> " << file << " - " << ec.message() << std::endl;
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool writeSignature(const std::filesystem::path& file, const Signature& sig) {
+    std::string out(kSigMagic, sizeof(kSigMagic));
+    putLe(out, DeltaStore::kBlockSize, 4);
+    putLe(out, sig.size, 8);
+    putLe(out, sig.checksum, 8);
+    putLe(out, sig.weak.size(), 8);
+    out.reserve(kSigHeader + sig.weak.size() * kSigEntry);
+    for (std::size_t i = 0; i < sig.weak.size(); ++i) {
+        putLe(out, sig.weak[i], 4);
+        putLe(out, sig.strong[i], 8);
+    }
+    auto tmp = file;
+    tmp += ".tmp";
+    {
+        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+        StatTimer timer(StatPhase::Write, out.size());
+        if (!ofs || !ofs.write(out.data(), static_cast<std::streamsize>(out.size()))) {
+            std::cerr << "写入签名文件失败: " << tmp << std::endl;
+            return false;
+        }
+    }
+    return renameInto(tmp, file);
+}
+
+} // namespace
+
+DeltaStore::DeltaStore(const std::filesystem::path& root) : root_(root) {
+}
+
+std::filesystem::path DeltaStore::entryDir(const std::string& key) const {
+    // 以路径的哈希命名：目录层次与源目录无关，文件与目录同名等情况不会冲突
+    const std::string hex = Sha256::toHex(Sha256::hash(key.data(), key.size()));
+    return root_ / hex.substr(0, 2) / hex.substr(2);
+}
+
+std::filesystem::path DeltaStore::versionFile(const std::string& key, std::uint32_t version,
+                                              const char* ext) const {
+    return entryDir(key) / (std::to_string(version) + "." + ext);
+}
+
+void DeltaStore::remove(const std::string& key) {
+    std::error_code ec;
+    std::filesystem::remove_all(entryDir(key), ec);
+    if (ec) {
+        std::cerr << "警告: 删除差量失败: " << key << " - " << ec.message() << std::endl;
+    }
+}
+
+bool DeltaStore::hasSignature(const std::string& key, std::uint32_t depth,
+                              std::uint64_t size, std::uint64_t checksum) const {
+    std::ifstream in(versionFile(key, depth, "sig"), std::ios::binary);
+    std::uint64_t sig_size = 0;
+    std::uint64_t sig_checksum = 0;
+    std::uint64_t count = 0;
+    return in && readSignatureHeader(in, sig_size, sig_checksum, count) &&
+           sig_size == size && sig_checksum == checksum;
+}
+
+bool DeltaStore::storeBase(ExtentReader& source, const std::string& key,
+                           const std::filesystem::path& mirror_path, std::uint64_t& checksum) {
+    try {
+        // 新的差量链从这个版本开始
+        const auto dir = entryDir(key);
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+
+        SignatureBuilder builder;
+        const auto tmp = dir / "base.tmp";
+        {
+            std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+            if (!ofs) {
+                std::cerr << "无法写入文件: " << tmp << std::endl;
+                return false;
+            }
+            std::vector<std::uint8_t> buffer(kReadBufferSize);
+            for (;;) {
+                std::int64_t n = source.read(buffer.data(), buffer.size());
+                if (n < 0) {
+                    return false;
+                }
+                if (n == 0) {
+                    break;
+                }
+                builder.update(buffer.data(), static_cast<std::size_t>(n));
+                StatTimer timer(StatPhase::Write, static_cast<std::uint64_t>(n));
+                ofs.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(n));
+            }
+            if (!ofs) {
+                std::cerr << "写入文件失败: " << tmp << std::endl;
+                return false;
+            }
+        }
+        if (!renameInto(tmp, mirror_path)) {
+            return false;
+        }
+
+        const Signature& sig = builder.finish();
+        checksum = sig.checksum;
+        if (!writeSignature(versionFile(key, 0, "sig"), sig)) {
+            // 镜像已完整写入；没有签名时下一个版本仍整体存储
+            std::cerr << "警告: 下次备份将整体存储: " << key << std::endl;
+        }
+        base_files_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "整体存储失败: " << key << " - " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DeltaStore::storeDelta(ExtentReader& source, const std::string& key, std::uint32_t& depth,
+                            std::uint64_t& checksum) {
+    constexpr std::size_t B = kBlockSize;
+    Signature old;
+    if (!readSignature(versionFile(key, depth, "sig"), old)) {
+        return false;
+    }
+
+    // 上一版本的整块按弱校验和建链表（同一弱校验和的块按序号升序），最后的短块只在文件末尾比较
+    const std::uint32_t full_blocks = static_cast<std::uint32_t>(old.size / B);
+    const std::size_t last_len = static_cast<std::size_t>(old.size % B);
+    std::unordered_map<std::uint32_t, std::uint32_t> heads;
+    heads.reserve(full_blocks);
+    std::vector<std::uint32_t> next(full_blocks, kNone);
+    std::vector<std::uint64_t> filter((1u << 20) / 64, 0);
+    for (std::uint32_t i = full_blocks; i-- > 0;) {
+        auto it = heads.find(old.weak[i]);
+        if (it != heads.end()) {
+            next[i] = it->second;
+            it->second = i;
+        } else {
+            heads.emplace(old.weak[i], i);
+        }
+        std::size_t slot = filterSlot(old.weak[i]);
+        filter[slot / 64] |= 1ULL << (slot % 64);
+    }
+
+    const auto file = versionFile(key, depth + 1, "delta");
+    auto tmp = file;
+    tmp += ".tmp";
+    std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+    if (!ofs || !ofs.write(kDeltaMagic, sizeof(kDeltaMagic))) {
+        std::cerr << "无法写入差量文件: " << tmp << std::endl;
+        return false;
+    }
+    std::uint64_t write_pos = sizeof(kDeltaMagic);
+    std::uint64_t literal_bytes = 0;
+    std::uint64_t matched_bytes = 0;
+    std::vector<Op> ops;
+    auto literal = [&](const std::uint8_t* p, std::size_t n) {
+        if (n == 0) {
+            return true;
+        }
+        {
+            StatTimer timer(StatPhase::Write, n);
+            ofs.write(reinterpret_cast<const char*>(p), static_cast<std::streamsize>(n));
+        }
+        if (!ops.empty() && ops.back().kind == kOpLiteral) {
+            ops.back().length += n;
+        } else {
+            ops.push_back(Op{kOpLiteral, write_pos, n});
+        }
+        write_pos += n;
+        literal_bytes += n;
+        return static_cast<bool>(ofs);
+    };
+    auto copy = [&](std::uint64_t offset, std::uint64_t n) {
+        if (!ops.empty() && ops.back().kind == kOpCopy && ops.back().offset + ops.back().length == offset) {
+            ops.back().length += n;
+        } else {
+            ops.push_back(Op{kOpCopy, offset, n});
+        }
+        matched_bytes += n;
+    };
+
+    // 缓冲区中 [pos, pos + B) 为当前窗口，[lit, pos) 为尚未写出的字面数据；
+    // 剩余不足一个窗口加一字节时先写出字面数据再补读
+    SignatureBuilder builder;
+    std::vector<std::uint8_t> buf(kWindowSize + B);
+    std::size_t pos = 0;
+    std::size_t lit = 0;
+    std::size_t end = 0;
+    bool eof = false;
+    auto refill = [&]() {
+        if (!literal(buf.data() + lit, pos - lit)) {
+            return false;
+        }
+        std::memmove(buf.data(), buf.data() + pos, end - pos);
+        end -= pos;
+        pos = 0;
+        lit = 0;
+        while (end < buf.size()) {
+            std::int64_t n = source.read(buf.data() + end, buf.size() - end);
+            if (n < 0) {
+                return false;
+            }
+            if (n == 0) {
+                eof = true;
+                break;
+            }
+            builder.update(buf.data() + end, static_cast<std::size_t>(n));
+            end += static_cast<std::size_t>(n);
+        }
+        return true;
+    };
+
+    bool rolling = false;
+    std::uint32_t a = 0;
+    std::uint32_t b = 0;
+    std::uint32_t hint = 0;  // 上一个匹配块的下一块：顺序未变的区域不必查表
+    for (;;) {
+        if (!eof && end - pos <= B && !refill()) {
+            return false;
+        }
+        const std::size_t avail = end - pos;
+        if (avail < B) {
+            // 文件末尾不足一块：只可能与上一版本末尾的短块相同
+            if (avail > 0 && avail == last_len) {
+                sumBlock(buf.data() + pos, avail, a, b);
+                if (weakSum(a, b) == old.weak[full_blocks] &&
+                    Xxh64::hash(buf.data() + pos, avail) == old.strong[full_blocks]) {
+                    if (!literal(buf.data() + lit, pos - lit)) {
+                        return false;
+                    }
+                    copy(static_cast<std::uint64_t>(full_blocks) * B, avail);
+                    pos = end;
+                    lit = end;
+                }
+            }
+            break;
+        }
+        if (!rolling) {
+            sumBlock(buf.data() + pos, B, a, b);
+            rolling = true;
+        }
+        const std::uint32_t weak = weakSum(a, b);
+        std::uint32_t match = kNone;
+        const std::size_t slot = filterSlot(weak);
+        if (filter[slot / 64] & (1ULL << (slot % 64))) {
+            bool have_strong = false;
+            std::uint64_t strong = 0;
+            auto same = [&](std::uint32_t i) {
+                if (old.weak[i] != weak) {
+                    return false;
+                }
+                if (!have_strong) {
+                    strong = Xxh64::hash(buf.data() + pos, B);
+                    have_strong = true;
+                }
+                return old.strong[i] == strong;
+            };
+            if (hint < full_blocks && same(hint)) {
+                match = hint;
+            } else {
+                auto it = heads.find(weak);
+                for (std::uint32_t i = it == heads.end() ? kNone : it->second; i != kNone; i = next[i]) {
+                    if (same(i)) {
+                        match = i;
+                        break;
+                    }
+                }
+            }
+        }
+        if (match != kNone) {
+            if (!literal(buf.data() + lit, pos - lit)) {
+                return false;
+            }
+            copy(static_cast<std::uint64_t>(match) * B, B);
+            pos += B;
+            lit = pos;
+            rolling = false;
+            hint = match + 1;
+            continue;
+        }
+        if (pos + B >= end) {
+            break;  // 已到文件末尾，其余都是字面数据
+        }
+        // 窗口右移一字节
+        const std::uint32_t out = buf[pos];
+        const std::uint32_t in = buf[pos + B];
+        a += in - out;
+        b += a - static_cast<std::uint32_t>(B) * out;
+        ++pos;
+    }
+    if (!literal(buf.data() + lit, end - lit)) {
+        return false;
+    }
+
+    const Signature& sig = builder.finish();
+    checksum = sig.checksum;
+    if (sig.size == old.size && sig.checksum == old.checksum && literal_bytes == 0 &&
+        (ops.empty() || (ops.size() == 1 && ops[0].offset == 0))) {
+        // 内容未变（如非增量模式下重新存储）：沿用当前版本，差量链不加长
+        ofs.close();
+        std::error_code ec;
+        std::filesystem::remove(tmp, ec);
+        return true;
+    }
+
+    // 操作表与尾部
+    std::string table;
+    table.reserve(ops.size() * kOpSize + kDeltaFooter);
+    for (const Op& op : ops) {
+        putLe(table, op.kind, 1);
+        putLe(table, op.offset, 8);
+        putLe(table, op.length, 8);
+    }
+    putLe(table, write_pos, 8);
+    putLe(table, ops.size(), 8);
+    putLe(table, sig.size, 8);
+    table.append(kDeltaMagic, sizeof(kDeltaMagic));
+    ofs.write(table.data(), static_cast<std::streamsize>(table.size()));
+    ofs.close();
+    if (!ofs) {
+        std::cerr << "写入差量文件失败: " << tmp << std::endl;
+        return false;
+    }
+    if (!renameInto(tmp, file)) {
+        return false;
+    }
+
+    // 签名写入失败时差量仍然有效，只是下一个版本需要整体存储
+    if (!writeSignature(versionFile(key, depth + 1, "sig"), sig)) {
+        std::cerr << "警告: 下次备份将整体存储: " << key << std::endl;
+    }
+    std::error_code ec;
+    std::filesystem::remove(versionFile(key, depth, "sig"), ec);
+    ++depth;
+
+    delta_files_.fetch_add(1, std::memory_order_relaxed);
+    literal_bytes_.fetch_add(literal_bytes, std::memory_order_relaxed);
+    matched_bytes_.fetch_add(matched_bytes, std::memory_order_relaxed);
+    return true;
+}
+
+bool DeltaStore::read(const std::filesystem::path& base_path, const std::string& key, std::uint32_t depth,
+                      const ByteSink& sink, std::string& error) const {
+    // 一段输出：来自基础版本（source 0）或第 source 个差量文件
+    struct Segment {
+        std::uint32_t source;
+        std::uint64_t offset;
+        std::uint64_t length;
+    };
+    std::vector<Segment> segments;
+    std::vector<std::uint64_t> starts;  // 各段在当前版本中的起始偏移
+
+    std::error_code ec;
+    std::uint64_t size = static_cast<std::uint64_t>(std::filesystem::file_size(base_path, ec));
+    if (ec) {
+        error = "基础版本缺失或不可读: " + ec.message();
+        return false;
+    }
+    if (size > 0) {
+        segments.push_back(Segment{0, 0, size});
+    }
+
+    // 逐个差量把上一版本的区段表变换为下一版本的区段表，相邻且连续的段合并
+    std::vector<Segment> next;
+    std::string table;
+    for (std::uint32_t version = 1; version <= depth; ++version) {
+        starts.resize(segments.size());
+        std::uint64_t offset = 0;
+        for (std::size_t i = 0; i < segments.size(); ++i) {
+            starts[i] = offset;
+            offset += segments[i].length;
+        }
+
+        const auto file = versionFile(key, version, "delta");
+        std::ifstream in(file, std::ios::binary | std::ios::ate);
+        const std::uint64_t file_size = in ? static_cast<std::uint64_t>(in.tellg()) : 0;
+        char footer[kDeltaFooter];
+        if (file_size < sizeof(kDeltaMagic) + kDeltaFooter ||
+            !in.seekg(static_cast<std::streamoff>(file_size - kDeltaFooter)) ||
+            !in.read(footer, sizeof(footer)) ||
+            std::memcmp(footer + 24, kDeltaMagic, sizeof(kDeltaMagic)) != 0) {
+            error = "差量文件缺失或已损坏: " + file.string();
+            return false;
+        }
+        const std::uint64_t ops_offset = getLe(footer, 8);
+        const std::uint64_t count = getLe(footer + 8, 8);
+        const std::uint64_t target_size = getLe(footer + 16, 8);
+        if (ops_offset < sizeof(kDeltaMagic) || ops_offset > file_size - kDeltaFooter ||
+            count != (file_size - kDeltaFooter - ops_offset) / kOpSize ||
+            (file_size - kDeltaFooter - ops_offset) % kOpSize != 0) {
+            error = "差量文件已损坏: " + file.string();
+            return false;
+        }
+        table.resize(static_cast<std::size_t>(count * kOpSize));
+        in.seekg(static_cast<std::streamoff>(ops_offset));
+        if (!table.empty() && !in.read(&table[0], static_cast<std::streamsize>(table.size()))) {
+            error = "读取差量文件失败: " + file.string();
+            return false;
+        }
+
+        next.clear();
+        std::uint64_t next_size = 0;
+        auto push = [&](std::uint32_t source, std::uint64_t off, std::uint64_t len) {
+            if (!next.empty() && next.back().source == source && next.back().offset + next.back().length == off) {
+                next.back().length += len;
+            } else {
+                next.push_back(Segment{source, off, len});
+            }
+            next_size += len;
+        };
+        for (std::size_t k = 0; k < count; ++k) {
+            const char* p = table.data() + k * kOpSize;
+            const std::uint8_t kind = static_cast<std::uint8_t>(p[0]);
+            std::uint64_t off = getLe(p + 1, 8);
+            std::uint64_t len = getLe(p + 9, 8);
+            if (kind == kOpLiteral) {
+                if (off < sizeof(kDeltaMagic) || len > ops_offset || off > ops_offset - len) {
+                    error = "差量操作越界: " + file.string();
+                    return false;
+                }
+                push(version, off, len);
+                continue;
+            }
+            if (kind != kOpCopy || len > size || off > size - len) {
+                error = "差量操作越界: " + file.string();
+                return false;
+            }
+            // 上一版本中 [off, off + len) 可能跨越多段
+            std::size_t i = static_cast<std::size_t>(
+                std::upper_bound(starts.begin(), starts.end(), off) - starts.begin()) - 1;
+            while (len > 0) {
+                const Segment& s = segments[i];
+                std::uint64_t skip = off - starts[i];
+                std::uint64_t take = std::min(len, s.length - skip);
+                push(s.source, s.offset + skip, take);
+                off += take;
+                len -= take;
+                ++i;
+            }
+        }
+        if (next_size != target_size) {
+            error = "差量文件大小不一致: " + file.string();
+            return false;
+        }
+        segments.swap(next);
+        size = next_size;
+    }
+
+    // 按区段表顺序读出
+    std::vector<std::ifstream> sources(depth + 1);
+    std::vector<std::uint8_t> buffer(kReadBufferSize);
+    for (const Segment& s : segments) {
+        std::ifstream& in = sources[s.source];
+        const auto file = s.source == 0 ? base_path : versionFile(key, s.source, "delta");
+        if (!in.is_open()) {
+            in.open(file, std::ios::binary);
+        }
+        in.seekg(static_cast<std::streamoff>(s.offset));
+        std::uint64_t left = s.length;
+        while (left > 0) {
+            std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(left, buffer.size()));
+            {
+                StatTimer timer(StatPhase::Read, n);
+                in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(n));
+            }
+            if (!in) {
+                error = "读取失败或数据不完整: " + file.string();
+                return false;
+            }
+            if (!sink(buffer.data(), n)) {
+                error = "数据超出区段表或写入失败";
+                return false;
+            }
+            left -= n;
+        }
+    }
+    return true;
+}
+
+} // namespace backuprestore
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "core/file_utils.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace backuprestore {
+
+/**
+ * @brief 大文件的差量存储（rsync 风格）：镜像中保存基础版本，之后每个版本只保存相对上一版本的差量
+ *
+ * 每个文件在 <root>/<路径 SHA-256 的前2位>/<其余>/ 下保存：
+ * - <k>.delta：版本 k-1 到版本 k 的差量，由"复制上一版本的一段"和"字面数据"两种操作组成
+ * - <k>.sig：最新版本 k 的签名（每 64 KiB 一块：rsync 弱校验和 + XXH64），生成下一个差量时使用
+ * 基础版本（版本 0）就是 data/ 中的镜像文件。读取版本 k 时把差量 1..k 的操作合成一张区段表，
+ * 从镜像和各差量文件中顺序读出，不生成中间版本
+ */
+class DeltaStore {
+public:
+    static constexpr std::size_t kBlockSize = 64 * 1024;
+
+    /**
+     * @brief 构造函数
+     * @param root 差量存储根目录（通常为 <仓库>/deltas）
+     */
+    explicit DeltaStore(const std::filesystem::path& root);
+
+    /**
+     * @brief 整体存储一个版本：读取 source 写到 mirror_path（临时文件 + rename），同时生成版本 0 的签名
+     * 该文件之前的差量和签名被删除；mirror_path 的父目录须已存在
+     * @param source 已打开的源文件（按稠密文件读取）
+     * @param key 仓库中的相对路径
+     * @param checksum 输出文件内容的 XXH64
+     * @return 是否成功
+     */
+    bool storeBase(ExtentReader& source, const std::string& key,
+                   const std::filesystem::path& mirror_path, std::uint64_t& checksum);
+
+    /**
+     * @brief 版本 depth 的签名是否存在，且描述的正是大小为 size、校验和为 checksum 的内容
+     * 签名缺失（如上次备份在写入差量后中断）或与索引不符时调用方应改为整体存储
+     */
+    bool hasSignature(const std::string& key, std::uint32_t depth,
+                      std::uint64_t size, std::uint64_t checksum) const;
+
+    /**
+     * @brief 对照版本 depth 的签名生成版本 depth+1 的差量和签名，然后删除版本 depth 的签名
+     * 源文件只读一遍：查找匹配块、计算新签名和校验和同时进行；内容与版本 depth 完全相同时不生成新版本
+     * @param source 已打开的源文件（按稠密文件读取）
+     * @param depth 输入上一版本号，输出存储后的版本号
+     * @param checksum 输出文件内容的 XXH64
+     * @return 是否成功
+     */
+    bool storeDelta(ExtentReader& source, const std::string& key, std::uint32_t& depth,
+                    std::uint64_t& checksum);
+
+    /**
+     * @brief 读出版本 depth 的内容，按顺序交给 sink
+     * @param base_path 基础版本（data/ 中的镜像）
+     * @param error 失败时输出原因
+     */
+    bool read(const std::filesystem::path& base_path, const std::string& key, std::uint32_t depth,
+              const ByteSink& sink, std::string& error) const;
+
+    /**
+     * @brief 删除该文件的全部差量和签名
+     */
+    void remove(const std::string& key);
+
+    /**
+     * @brief 本次以差量存储的版本数、差量中写入的字面数据字节数、从上一版本复用的字节数
+     */
+    std::size_t getDeltaFiles() const { return delta_files_.load(); }
+    std::uint64_t getLiteralBytes() const { return literal_bytes_.load(); }
+    std::uint64_t getMatchedBytes() const { return matched_bytes_.load(); }
+
+    /**
+     * @brief 本次整体存储（首次存储或差量链达到上限后重新开始）的版本数
+     */
+    std::size_t getBaseFiles() const { return base_files_.load(); }
+
+private:
+    std::filesystem::path root_;
+    std::atomic<std::size_t> delta_files_{0};
+    std::atomic<std::uint64_t> literal_bytes_{0};
+    std::atomic<std::uint64_t> matched_bytes_{0};
+    std::atomic<std::size_t> base_files_{0};
+
+    /**
+     * @brief 该文件的差量目录
+     */
+    std::filesystem::path entryDir(const std::string& key) const;
+
+    /**
+     * @brief 版本 version 的差量（ext 为 "delta"）或签名（"sig"）文件
+     */
+    std::filesystem::path versionFile(const std::string& key, std::uint32_t version, const char* ext) const;
+};
+
+} // namespace backuprestore
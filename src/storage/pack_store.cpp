@@ -1,28 +1,391 @@
 #include "storage/pack_store.h"
+#include "core/file_utils.h"
+#include "core/stats.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 namespace backuprestore {
 
+namespace {
+
+const char kRecordMagic[4] = {'B', 'R', 'P', 'K'};
+const std::size_t kRecordHeaderSize = 16;
+const std::size_t kWriteBufferSize = 1024 * 1024;
+const std::size_t kSegmentNameDigits = 8;
+const char kSegmentSuffix[] = ".seg";
+
+void putU32(std::uint8_t* p, std::uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<std::uint8_t>(v >> (8 * i));
+}
+
+void putU64(std::uint8_t* p, std::uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = static_cast<std::uint8_t>(v >> (8 * i));
+}
+
+std::uint32_t getU32(const std::uint8_t* p) {
+    std::uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= static_cast<std::uint32_t>(p[i]) << (8 * i);
+    return v;
+}
+
+std::uint64_t getU64(const std::uint8_t* p) {
+    std::uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v |= static_cast<std::uint64_t>(p[i]) << (8 * i);
+    return v;
+}
+
+void encodeHeader(std::uint8_t* header, const std::string& name, std::uint64_t size) {
+    std::memcpy(header, kRecordMagic, 4);
+    putU32(header + 4, static_cast<std::uint32_t>(name.size()));
+    putU64(header + 8, size);
+}
+
+// 解析 "00000012.seg" 形式的段文件名，其它文件返回 0
+std::uint32_t parseSegmentName(const std::string& name) {
+    const std::size_t suffix = sizeof(kSegmentSuffix) - 1;
+    if (name.size() != kSegmentNameDigits + suffix ||
+        name.compare(kSegmentNameDigits, suffix, kSegmentSuffix) != 0) {
+        return 0;
+    }
+    std::uint32_t segment = 0;
+    for (std::size_t i = 0; i < kSegmentNameDigits; ++i) {
+        if (name[i] < '0' || name[i] > '9') {
+            return 0;
+        }
+        segment = segment * 10 + static_cast<std::uint32_t>(name[i] - '0');
+    }
+    return segment;
+}
+
+/**
+ * @brief 顺序读取段文件中的记录
+ * next 返回 false 时：eof() 为 true 表示正常结束，否则 error 中为原因
+ */
+class RecordReader {
+public:
+    explicit RecordReader(const std::filesystem::path& path)
+        : ifs_(path, std::ios::binary) {
+    }
+
+    bool isOpen() const { return static_cast<bool>(ifs_); }
+    bool eof() const { return eof_; }
+    const std::string& error() const { return error_; }
+    std::istream& stream() { return ifs_; }
+
+    bool next(std::string& name, std::uint64_t& length) {
+        std::uint8_t header[kRecordHeaderSize];
+        ifs_.read(reinterpret_cast<char*>(header), kRecordHeaderSize);
+        std::size_t got = static_cast<std::size_t>(ifs_.gcount());
+        if (got == 0) {
+            eof_ = true;
+            return false;
+        }
+        if (got != kRecordHeaderSize || std::memcmp(header, kRecordMagic, 4) != 0) {
+            error_ = "记录头损坏";
+            return false;
+        }
+        std::uint32_t name_len = getU32(header + 4);
+        length = getU64(header + 8);
+        name.assign(name_len, '\0');
+        ifs_.read(&name[0], name_len);
+        if (static_cast<std::uint32_t>(ifs_.gcount()) != name_len) {
+            error_ = "记录名称不完整";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::ifstream ifs_;
+    bool eof_ = false;
+    std::string error_;
+};
+
+// 解包时只接受仓库内的相对路径
+bool isSafeName(const std::string& name) {
+    std::filesystem::path p(name);
+    if (name.empty() || p.is_absolute() || p.has_root_name()) {
+        return false;
+    }
+    for (const auto& part : p) {
+        if (part == "..") {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+SimplePackStore::SimplePackStore(const std::filesystem::path& root, std::uint64_t segment_size)
+    : root_(root), segment_size_(segment_size) {
+}
+
+std::filesystem::path SimplePackStore::segmentPath(std::uint32_t segment) const {
+    std::string digits = std::to_string(segment);
+    if (digits.size() < kSegmentNameDigits) {
+        digits.insert(0, kSegmentNameDigits - digits.size(), '0');
+    }
+    return root_ / (digits + kSegmentSuffix);
+}
+
+bool SimplePackStore::hasSegment(std::uint32_t segment) const {
+    std::error_code ec;
+    return segment != 0 && std::filesystem::is_regular_file(segmentPath(segment), ec);
+}
+
+bool SimplePackStore::openSegment(std::uint64_t record_size) {
+    auto fits = [&] { return segment_used_ == 0 || segment_used_ + record_size <= segment_size_; };
+    if (out_.is_open() && fits()) {
+        return true;
+    }
+
+    if (segment_ == 0) {
+        // 第一次追加：找到最后一段，未写满时继续写在它后面
+        std::error_code ec;
+        std::filesystem::create_directories(root_, ec);
+        if (ec) {
+            std::cerr << "无法创建段目录: " << root_ << " - " << ec.message() << std::endl;
+            return false;
+        }
+        for (const auto& entry : std::filesystem::directory_iterator(root_, ec)) {
+            std::uint32_t segment = parseSegmentName(entry.path().filename().string());
+            if (segment > segment_) {
+                segment_ = segment;
+            }
+        }
+        if (segment_ != 0) {
+            segment_used_ = static_cast<std::uint64_t>(std::filesystem::file_size(segmentPath(segment_), ec));
+            if (ec) {
+                segment_used_ = segment_size_;  // 读不到大小：不再追加到这一段
+            }
+        }
+    }
+    if (segment_ == 0 || !fits()) {
+        out_.close();
+        ++segment_;
+        segment_used_ = 0;
+    }
+
+    if (!out_.is_open()) {
+        // 大缓冲区：小文件的记录在内存中合并，以大块顺序写入段文件
+        buffer_.resize(kWriteBufferSize);
+        out_.clear();
+        out_.rdbuf()->pubsetbuf(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        out_.open(segmentPath(segment_), std::ios::binary | std::ios::app);
+        if (!out_) {
+            std::cerr << "无法打开段文件: " << segmentPath(segment_) << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SimplePackStore::append(const std::string& name, const std::uint8_t* data, std::size_t size,
+                             PackLocation& location) {
+    const std::uint64_t record_size = kRecordHeaderSize + name.size() + size;
+    std::uint8_t header[kRecordHeaderSize];
+    encodeHeader(header, name, size);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!openSegment(record_size)) {
+        return false;
+    }
+    StatTimer timer(StatPhase::Write, record_size);
+    out_.write(reinterpret_cast<const char*>(header), kRecordHeaderSize);
+    out_.write(name.data(), static_cast<std::streamsize>(name.size()));
+    if (size > 0) {
+        out_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    }
+    if (!out_) {
+        std::cerr << "写入段文件失败: " << segmentPath(segment_) << std::endl;
+        // 这一段的末尾已不可信，之后的记录写到新段
+        out_.close();
+        segment_used_ = segment_size_;
+        return false;
+    }
+
+    location.segment = segment_;
+    location.offset = segment_used_ + kRecordHeaderSize + name.size();
+    location.length = size;
+    segment_used_ += record_size;
+
+    new_records_.fetch_add(1, std::memory_order_relaxed);
+    new_bytes_.fetch_add(size, std::memory_order_relaxed);
+    return true;
+}
+
+bool SimplePackStore::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!out_.is_open()) {
+        return true;
+    }
+    out_.close();
+    if (!out_) {
+        std::cerr << "写入段文件失败: " << segmentPath(segment_) << std::endl;
+        segment_used_ = segment_size_;
+        return false;
+    }
+    return true;
+}
+
+bool SimplePackStore::read(const PackLocation& location, std::vector<std::uint8_t>& out) const {
+    std::ifstream ifs(segmentPath(location.segment), std::ios::binary);
+    if (!ifs) {
+        std::cerr << "段文件不存在: " << segmentPath(location.segment) << std::endl;
+        return false;
+    }
+    out.resize(static_cast<std::size_t>(location.length));
+    ifs.seekg(static_cast<std::streamoff>(location.offset));
+    if (location.length > 0) {
+        StatTimer timer(StatPhase::Read, location.length);
+        ifs.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(location.length));
+    }
+    if (!ifs || static_cast<std::uint64_t>(ifs.gcount()) != location.length) {
+        std::cerr << "读取段文件失败: " << segmentPath(location.segment) << " @" << location.offset << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::size_t SimplePackStore::removeUnreferenced(const std::unordered_set<std::uint32_t>& referenced,
+                                                std::uint64_t& removed_bytes) {
+    removed_bytes = 0;
+    std::size_t removed = 0;
+    std::error_code ec;
+    if (!std::filesystem::is_directory(root_, ec)) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : std::filesystem::directory_iterator(root_, ec)) {
+        std::uint32_t segment = parseSegmentName(entry.path().filename().string());
+        if (segment == 0 || referenced.count(segment) || (out_.is_open() && segment == segment_)) {
+            continue;
+        }
+        std::error_code size_ec;
+        std::uint64_t size = static_cast<std::uint64_t>(entry.file_size(size_ec));
+        std::error_code rm_ec;
+        if (std::filesystem::remove(entry.path(), rm_ec)) {
+            ++removed;
+            removed_bytes += size_ec ? 0 : size;
+        } else if (rm_ec) {
+            std::cerr << "警告: 删除段文件失败: " << entry.path() << " - " << rm_ec.message() << std::endl;
+        }
+    }
+    if (removed > 0 && !out_.is_open()) {
+        segment_ = 0;  // 下次追加时重新查找最后一段
+        segment_used_ = 0;
+    }
+    return removed;
+}
+
 bool SimplePackStore::pack(const std::vector<std::filesystem::path>& files,
                            const std::filesystem::path& output_path) {
-    // TODO: 实现打包功能
-    // 当前实现：仅作为占位符
-    std::cerr << "PackStore::pack() 尚未实现" << std::endl;
-    return false;
+    std::ofstream ofs(output_path, std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+        std::cerr << "无法创建打包文件: " << output_path << std::endl;
+        return false;
+    }
+    for (const auto& file : files) {
+        // 记录名称为去掉根目录后的路径，解包时在输出目录下重建
+        const std::string name = file.relative_path().generic_string();
+        std::error_code ec;
+        std::uint64_t size = static_cast<std::uint64_t>(std::filesystem::file_size(file, ec));
+        if (ec) {
+            std::cerr << "获取文件大小失败: " << file << " - " << ec.message() << std::endl;
+            return false;
+        }
+        std::uint8_t header[kRecordHeaderSize];
+        encodeHeader(header, name, size);
+        ofs.write(reinterpret_cast<const char*>(header), kRecordHeaderSize);
+        ofs.write(name.data(), static_cast<std::streamsize>(name.size()));
+
+        std::uint64_t written = 0;
+        bool ok = FileUtils::readFile(file, [&](const std::uint8_t* data, std::size_t n) {
+            if (written + n > size) {
+                return false;
+            }
+            ofs.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(n));
+            written += n;
+            return static_cast<bool>(ofs);
+        });
+        if (!ok || written != size) {
+            std::cerr << "打包文件失败（文件在打包期间被修改或写入失败）: " << file << std::endl;
+            return false;
+        }
+    }
+    if (!ofs.flush()) {
+        std::cerr << "写入打包文件失败: " << output_path << std::endl;
+        return false;
+    }
+    return true;
 }
 
 bool SimplePackStore::unpack(const std::filesystem::path& pack_path,
                              const std::filesystem::path& output_dir) {
-    // TODO: 实现解包功能
-    std::cerr << "PackStore::unpack() 尚未实现" << std::endl;
-    return false;
+    RecordReader reader(pack_path);
+    if (!reader.isOpen()) {
+        std::cerr << "无法打开打包文件: " << pack_path << std::endl;
+        return false;
+    }
+    std::vector<char> buffer(kWriteBufferSize);
+    std::string name;
+    std::uint64_t length = 0;
+    while (reader.next(name, length)) {
+        if (!isSafeName(name)) {
+            std::cerr << "打包文件中的路径不安全: " << name << std::endl;
+            return false;
+        }
+        auto target = output_dir / std::filesystem::path(name);
+        if (!FileUtils::createDirectories(target.parent_path())) {
+            return false;
+        }
+        std::ofstream ofs(target, std::ios::binary | std::ios::trunc);
+        if (!ofs) {
+            std::cerr << "无法创建目标文件: " << target << std::endl;
+            return false;
+        }
+        for (std::uint64_t left = length; left > 0;) {
+            std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(left, buffer.size()));
+            reader.stream().read(buffer.data(), static_cast<std::streamsize>(n));
+            if (static_cast<std::size_t>(reader.stream().gcount()) != n) {
+                std::cerr << "打包文件已截断: " << pack_path << " - " << name << std::endl;
+                return false;
+            }
+            ofs.write(buffer.data(), static_cast<std::streamsize>(n));
+            left -= n;
+        }
+        if (!ofs) {
+            std::cerr << "写入目标文件失败: " << target << std::endl;
+            return false;
+        }
+    }
+    if (!reader.eof()) {
+        std::cerr << "打包文件已损坏: " << pack_path << " - " << reader.error() << std::endl;
+        return false;
+    }
+    return true;
 }
 
 std::vector<std::filesystem::path> SimplePackStore::list(const std::filesystem::path& pack_path) {
-    // TODO: 实现列表功能
-    return {};
+    std::vector<std::filesystem::path> names;
+    RecordReader reader(pack_path);
+    if (!reader.isOpen()) {
+        std::cerr << "无法打开打包文件: " << pack_path << std::endl;
+        return names;
+    }
+    std::string name;
+    std::uint64_t length = 0;
+    while (reader.next(name, length)) {
+        names.emplace_back(name);
+        reader.stream().seekg(static_cast<std::streamoff>(length), std::ios::cur);
+    }
+    if (!reader.eof()) {
+        std::cerr << "警告: 打包文件已损坏，只列出前 " << names.size() << " 条: " << pack_path
+                  << " - " << reader.error() << std::endl;
+    }
+    return names;
 }
 
 } // namespace backuprestore
-
-
@@ -1,20 +1,23 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
 #include <string>
 #include <filesystem>
+#include <unordered_set>
 #include <vector>
 
 namespace backuprestore {
 
 /**
- * @brief 打包/解包存储接口（预留）
- * 
+ * @brief 打包/解包存储接口
+ *
  * 数据格式说明：
- * - 打包格式：可以将多个文件打包成单个文件（如tar格式）
+ * - 打包格式：可以将多个文件打包成单个文件
  * - 索引分离：元数据索引与文件数据可以分离存储
  * - 版本控制：支持增量备份和版本管理
- * 
- * TODO: 实现打包功能
  */
 class PackStore {
 public:
@@ -45,11 +48,38 @@ public:
 };
 
 /**
- * @brief PackStore的简单实现（当前使用文件系统直接存储）
- * 预留接口，未来可以实现tar等打包格式
+ * @brief 段文件中一条记录的数据位置
+ */
+struct PackLocation {
+    std::uint32_t segment = 0;
+    std::uint64_t offset = 0;  // 数据在段文件中的偏移（记录头之后）
+    std::uint64_t length = 0;  // 数据长度
+};
+
+/**
+ * @brief 只追加的段存储：小文件按顺序追加到 <root>/<8位序号>.seg，每段写满 segment_size 后换下一段
+ *
+ * 记录格式：magic "BRPK"(4) + 名称长度(u32) + 数据长度(u64) + 名称 + 数据（小端）。
+ * 记录自描述，段文件不依赖索引即可 list/unpack；数据位置（PackLocation）记录在仓库索引中，
+ * 读取时直接按偏移定位。段文件从不原地修改，只有全部记录都不再被引用时才整体删除
  */
 class SimplePackStore : public PackStore {
 public:
+    static constexpr std::uint64_t kDefaultSegmentSize = 256ULL * 1024 * 1024;
+
+    /**
+     * @brief 只使用 pack/unpack/list（不绑定段目录）
+     */
+    SimplePackStore() = default;
+
+    /**
+     * @brief 构造函数
+     * @param root 段文件目录（通常为 <仓库>/packs）
+     * @param segment_size 单个段文件的目标大小（一条记录超过它时独占一段）
+     */
+    explicit SimplePackStore(const std::filesystem::path& root,
+                             std::uint64_t segment_size = kDefaultSegmentSize);
+
     bool pack(const std::vector<std::filesystem::path>& files,
               const std::filesystem::path& output_path) override;
 
@@ -57,8 +87,67 @@ public:
                 const std::filesystem::path& output_dir) override;
 
     std::vector<std::filesystem::path> list(const std::filesystem::path& pack_path) override;
-};
 
-} // namespace backuprestore
+    /**
+     * @brief 追加一条记录（线程安全；写入经过缓冲，flush 之后才保证可读）
+     * @param name 记录名称（仓库中的相对路径，仅用于 list/unpack）
+     * @param location 输出数据位置
+     * @return 是否成功
+     */
+    bool append(const std::string& name, const std::uint8_t* data, std::size_t size,
+                PackLocation& location);
 
+    /**
+     * @brief 写出缓冲区中的数据并关闭当前段（保存索引之前调用）
+     */
+    bool flush();
+
+    /**
+     * @brief 按位置读取一条记录的数据
+     */
+    bool read(const PackLocation& location, std::vector<std::uint8_t>& out) const;
 
+    /**
+     * @brief 段文件是否存在
+     */
+    bool hasSegment(std::uint32_t segment) const;
+
+    /**
+     * @brief 段文件路径
+     */
+    std::filesystem::path segmentPath(std::uint32_t segment) const;
+
+    /**
+     * @brief 删除不在 referenced 集合中的段（垃圾回收；不能与备份同时进行）
+     * @param removed_bytes 输出删除的字节数
+     * @return 删除的段数
+     */
+    std::size_t removeUnreferenced(const std::unordered_set<std::uint32_t>& referenced,
+                                   std::uint64_t& removed_bytes);
+
+    /**
+     * @brief 本次追加的记录数/数据字节数
+     */
+    std::size_t getNewRecords() const { return new_records_.load(); }
+    std::uint64_t getNewBytes() const { return new_bytes_.load(); }
+
+private:
+    std::filesystem::path root_;
+    std::uint64_t segment_size_ = kDefaultSegmentSize;
+
+    std::mutex mutex_;              // 保护以下追加状态
+    std::ofstream out_;             // 当前段（按需打开）
+    std::vector<char> buffer_;      // out_ 的写缓冲区
+    std::uint32_t segment_ = 0;     // 当前段序号，0 表示尚未选定
+    std::uint64_t segment_used_ = 0;
+
+    std::atomic<std::size_t> new_records_{0};
+    std::atomic<std::uint64_t> new_bytes_{0};
+
+    /**
+     * @brief 选定可追加的段：沿用未写满的最后一段，否则开始新段（调用方持有 mutex_）
+     */
+    bool openSegment(std::uint64_t record_size);
+};
+
+} // namespace backuprestore
@@ -4,8 +4,8 @@
 namespace pkg {
 
 enum class PackAlg { HeaderPerFile = 1, TocAtEnd = 2 };
-enum class CompressAlg { None = 0, RLE = 1 };
-enum class EncryptAlg { None = 0, XOR = 1, RC4 = 2 };
+enum class CompressAlg { None = 0, RLE = 1, LZ = 2 };
+enum class EncryptAlg { None = 0, XOR = 1, RC4 = 2, ChaCha20 = 3 };
 
 inline PackAlg parsePack(const std::string& s) {
     if (s == "toc") return PackAlg::TocAtEnd;
@@ -14,12 +14,14 @@ inline PackAlg parsePack(const std::string& s) {
 
 inline CompressAlg parseCompress(const std::string& s) {
     if (s == "rle") return CompressAlg::RLE;
+    if (s == "lz") return CompressAlg::LZ;
     return CompressAlg::None;
 }
 
 inline EncryptAlg parseEncrypt(const std::string& s) {
     if (s == "xor") return EncryptAlg::XOR;
     if (s == "rc4") return EncryptAlg::RC4;
+    if (s == "chacha20") return EncryptAlg::ChaCha20;
     return EncryptAlg::None;
 }
 
@@ -1,5 +1,8 @@
 #pragma once
+#include "core/stats.h"
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <istream>
 #include <ostream>
 #include <stdexcept>
@@ -9,57 +12,169 @@
 
 namespace pkg {
 
-inline void write_u8(std::ostream& os, uint8_t v) { os.put(static_cast<char>(v)); }
-
-inline uint8_t read_u8(std::istream& is) {
-    int c = is.get();
-    if (c == EOF) throw std::runtime_error("read_u8: EOF");
-    return static_cast<uint8_t>(c);
+// 小端整数的无检查读写：调用方保证 p 处至少有 sizeof(T) 字节
+// 小端主机上 memcpy 直接编译为一条 load/store，大端主机上再做一次字节交换
+template <typename T>
+inline T load_le(const uint8_t* p) {
+    static_assert(std::is_integral<T>::value, "load_le requires integral");
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    if (sizeof(T) == 2) v = static_cast<T>(__builtin_bswap16(static_cast<uint16_t>(v)));
+    if (sizeof(T) == 4) v = static_cast<T>(__builtin_bswap32(static_cast<uint32_t>(v)));
+    if (sizeof(T) == 8) v = static_cast<T>(__builtin_bswap64(static_cast<uint64_t>(v)));
+#endif
+    return v;
 }
 
 template <typename T>
-inline void write_le(std::ostream& os, T v) {
-    static_assert(std::is_integral<T>::value, "write_le requires integral");
-    for (size_t i = 0; i < sizeof(T); ++i) {
-        os.put(static_cast<char>((static_cast<uint64_t>(v) >> (8 * i)) & 0xFF));
-    }
+inline void store_le(uint8_t* p, T v) {
+    static_assert(std::is_integral<T>::value, "store_le requires integral");
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    if (sizeof(T) == 2) v = static_cast<T>(__builtin_bswap16(static_cast<uint16_t>(v)));
+    if (sizeof(T) == 4) v = static_cast<T>(__builtin_bswap32(static_cast<uint32_t>(v)));
+    if (sizeof(T) == 8) v = static_cast<T>(__builtin_bswap64(static_cast<uint64_t>(v)));
+#endif
+    std::memcpy(p, &v, sizeof(T));
 }
 
-template <typename T>
-inline T read_le(std::istream& is) {
-    static_assert(std::is_integral<T>::value, "read_le requires integral");
-    uint64_t v = 0;
-    for (size_t i = 0; i < sizeof(T); ++i) {
-        int c = is.get();
-        if (c == EOF) throw std::runtime_error("read_le: EOF");
-        v |= (static_cast<uint64_t>(static_cast<uint8_t>(c)) << (8 * i));
+// 只读字节视图（C++17 没有 std::span）：可以指向 vector 或 mmap 的区域
+struct ByteSpan {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    ByteSpan() = default;
+    ByteSpan(const uint8_t* d, size_t n) : data(d), size(n) {}
+    ByteSpan(const std::vector<uint8_t>& v) : data(v.data()), size(v.size()) {}
+};
+
+// 追加写入内存缓冲区，写完后一次性 flush 到流
+class ByteWriter {
+public:
+    explicit ByteWriter(size_t reserve = 0) { buf_.reserve(reserve); }
+
+    void u8(uint8_t v) { buf_.push_back(v); }
+
+    template <typename T>
+    void le(T v) {
+        size_t pos = grow(sizeof(T));
+        store_le<T>(buf_.data() + pos, v);
     }
-    return static_cast<T>(v);
-}
 
-inline void write_bytes(std::ostream& os, const std::vector<uint8_t>& buf) {
-    if (!buf.empty()) os.write(reinterpret_cast<const char*>(buf.data()),
-                               static_cast<std::streamsize>(buf.size()));
+    void bytes(const void* p, size_t n) {
+        if (n == 0) return;
+        size_t pos = grow(n);
+        std::memcpy(buf_.data() + pos, p, n);
+    }
+    void bytes(const std::vector<uint8_t>& v) { bytes(v.data(), v.size()); }
+
+    // u32 长度 + 内容
+    void string(const std::string& s) {
+        if (s.size() > UINT32_MAX) throw std::runtime_error("string too long");
+        size_t pos = grow(4 + s.size());
+        store_le<uint32_t>(buf_.data() + pos, static_cast<uint32_t>(s.size()));
+        if (!s.empty()) std::memcpy(buf_.data() + pos + 4, s.data(), s.size());
+    }
+
+    size_t size() const { return buf_.size(); }
+    const std::vector<uint8_t>& buffer() const { return buf_; }
+    void clear() { buf_.clear(); }
+
+    // 写到流并清空缓冲区
+    void flush(std::ostream& os) {
+        backuprestore::StatTimer timer(backuprestore::StatPhase::Write, buf_.size());
+        if (!buf_.empty()) os.write(reinterpret_cast<const char*>(buf_.data()),
+                                    static_cast<std::streamsize>(buf_.size()));
+        buf_.clear();
+    }
+
+private:
+    size_t grow(size_t n) {
+        size_t pos = buf_.size();
+        buf_.resize(pos + n);
+        return pos;
+    }
+
+    std::vector<uint8_t> buf_;
+};
+
+// 按偏移顺序读取 ByteSpan；越界时抛出异常
+// 解析定长记录时先 need(记录长度) 检查一次，再用 *_unchecked 读各字段
+class ByteReader {
+public:
+    explicit ByteReader(ByteSpan span) : p_(span.data), end_(span.data + span.size) {}
+
+    size_t remaining() const { return static_cast<size_t>(end_ - p_); }
+    const uint8_t* cursor() const { return p_; }
+
+    void need(size_t n) const {
+        if (n > remaining()) throw std::runtime_error("ByteReader: unexpected end of data");
+    }
+
+    uint8_t u8() {
+        need(1);
+        return *p_++;
+    }
+
+    template <typename T>
+    T le() {
+        need(sizeof(T));
+        return le_unchecked<T>();
+    }
+
+    template <typename T>
+    T le_unchecked() {
+        T v = load_le<T>(p_);
+        p_ += sizeof(T);
+        return v;
+    }
+
+    // u32 长度 + 内容
+    std::string string() {
+        uint32_t n = le<uint32_t>();
+        need(n);
+        std::string s(reinterpret_cast<const char*>(p_), n);
+        p_ += n;
+        return s;
+    }
+
+    ByteSpan bytes(size_t n) {
+        need(n);
+        ByteSpan s(p_, n);
+        p_ += n;
+        return s;
+    }
+
+    void skip(size_t n) {
+        need(n);
+        p_ += n;
+    }
+
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+};
+
+inline void write_bytes(std::ostream& os, ByteSpan buf) {
+    backuprestore::StatTimer timer(backuprestore::StatPhase::Write, buf.size);
+    if (buf.size > 0) os.write(reinterpret_cast<const char*>(buf.data),
+                               static_cast<std::streamsize>(buf.size));
 }
 
 inline std::vector<uint8_t> read_bytes(std::istream& is, size_t n) {
     std::vector<uint8_t> buf(n);
+    backuprestore::StatTimer timer(backuprestore::StatPhase::Read, n);
     if (n > 0) is.read(reinterpret_cast<char*>(buf.data()), static_cast<std::streamsize>(n));
     if (!is) throw std::runtime_error("read_bytes: failed");
     return buf;
 }
 
-inline void write_string(std::ostream& os, const std::string& s) {
-    write_le<uint32_t>(os, static_cast<uint32_t>(s.size()));
-    if (!s.empty()) os.write(s.data(), static_cast<std::streamsize>(s.size()));
-}
-
-inline std::string read_string(std::istream& is) {
-    uint32_t n = read_le<uint32_t>(is);
-    std::string s(n, '\0');
-    if (n > 0) is.read(&s[0], static_cast<std::streamsize>(n));
-    if (!is) throw std::runtime_error("read_string: failed");
-    return s;
+// 读取 n 字节到已有缓冲区（复用容量，用于逐条读取记录）
+inline void read_into(std::istream& is, std::vector<uint8_t>& buf, size_t n) {
+    buf.resize(n);
+    backuprestore::StatTimer timer(backuprestore::StatPhase::Read, n);
+    if (n > 0) is.read(reinterpret_cast<char*>(buf.data()), static_cast<std::streamsize>(n));
+    if (!is) throw std::runtime_error("read: unexpected end of file");
 }
 
 } // namespace pkg
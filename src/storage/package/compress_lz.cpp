@@ -0,0 +1,300 @@
+#include "compress_lz.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace pkg {
+
+namespace {
+
+constexpr size_t kMinMatch = 4;
+constexpr size_t kWindow = 65535;         // offset 用 u16 表示
+constexpr size_t kPrevSize = 1 << 16;     // prev_ 按位置取模，覆盖整个窗口
+constexpr int kHashBits = 16;              // 整块（256 KiB）使用的哈希表大小
+constexpr int kMinHashBits = 8;
+constexpr uint32_t kRawFlag = 0x80000000u;
+constexpr size_t kBlockHeader = 8;
+constexpr size_t kSlack = 32;             // 解码时输出缓冲的额外空间（整块拷贝用）
+
+inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline uint32_t hash4(const uint8_t* p, int bits) {
+    return (read32(p) * 2654435761u) >> (32 - bits);
+}
+
+// 哈希表位数随块长取 log2(n) 左右：每个位置约一到两个槽位，小块只需清空很小的表
+inline int hash_bits(size_t n) {
+    int bits = kMinHashBits;
+    while (bits < kHashBits && (size_t(1) << bits) < n) ++bits;
+    return bits;
+}
+
+inline void put_u32(std::vector<uint8_t>& out, size_t pos, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out[pos + i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+inline uint32_t get_u32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline void put_length(std::vector<uint8_t>& out, size_t len) {
+    while (len >= 255) {
+        out.push_back(255);
+        len -= 255;
+    }
+    out.push_back(static_cast<uint8_t>(len));
+}
+
+void emit_sequence(std::vector<uint8_t>& out, const uint8_t* lit, size_t litLen,
+                   size_t offset, size_t matchLen) {
+    size_t ml = matchLen ? matchLen - kMinMatch : 0;
+    out.push_back(static_cast<uint8_t>((std::min<size_t>(litLen, 15) << 4) |
+                                       std::min<size_t>(ml, 15)));
+    if (litLen >= 15) put_length(out, litLen - 15);
+    out.insert(out.end(), lit, lit + litLen);
+    if (matchLen == 0) return;  // 块尾：只有字面量
+    out.push_back(static_cast<uint8_t>(offset & 0xFF));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+    if (ml >= 15) put_length(out, ml - 15);
+}
+
+inline size_t read_length(const uint8_t*& ip, const uint8_t* end, size_t len) {
+    if (len != 15) return len;
+    for (;;) {
+        if (ip >= end) throw std::runtime_error("LZ data corrupted");
+        uint8_t b = *ip++;
+        len += b;
+        if (b != 255) return len;
+    }
+}
+
+// 解码块内的序列到 dst（调用方已预留 rawLen + kSlack 字节）
+// 短字面量和匹配按 16 字节整块拷贝，可能写出 oend 之后至多 kSlack 字节
+void decode_block(const uint8_t* ip, const uint8_t* end, uint8_t* dst, size_t rawLen) {
+    uint8_t* op = dst;
+    uint8_t* const oend = dst + rawLen;
+    while (ip < end) {
+        uint8_t token = *ip++;
+        size_t litLen = read_length(ip, end, token >> 4);
+        if (litLen > static_cast<size_t>(end - ip) || litLen > static_cast<size_t>(oend - op))
+            throw std::runtime_error("LZ data corrupted");
+        if (litLen <= 16 && end - ip >= 16) {
+            std::memcpy(op, ip, 16);
+        } else {
+            std::memcpy(op, ip, litLen);
+        }
+        op += litLen;
+        ip += litLen;
+        if (ip == end) break;
+
+        if (end - ip < 2) throw std::runtime_error("LZ data corrupted");
+        size_t offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        size_t matchLen = read_length(ip, end, token & 0x0F) + kMinMatch;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst) ||
+            matchLen > static_cast<size_t>(oend - op))
+            throw std::runtime_error("LZ data corrupted");
+
+        const uint8_t* match = op - offset;
+        if (offset >= 16) {
+            // 每次读取的 16 字节都已写好（间距 >= 16）
+            for (size_t i = 0; i < matchLen; i += 16) std::memcpy(op + i, match + i, 16);
+        } else {
+            // 短周期重复：已展开的部分以 offset 为周期，每次拷贝长度翻倍
+            size_t copied = 0;
+            size_t chunk = offset;
+            while (copied < matchLen) {
+                size_t n = std::min(chunk, matchLen - copied);
+                std::memcpy(op + copied, match, n);
+                copied += n;
+                chunk = copied;
+            }
+        }
+        op += matchLen;
+    }
+    if (op != oend) throw std::runtime_error("LZ size mismatch");
+}
+
+// 解码一个带块头的块，追加到 out
+void decode_frame(const uint8_t* blk, std::vector<uint8_t>& out) {
+    uint32_t rawLen = get_u32(blk);
+    uint32_t storedField = get_u32(blk + 4);
+    uint32_t stored = storedField & ~kRawFlag;
+    if (rawLen > LzEncoder::kBlockSize) throw std::runtime_error("LZ block too large");
+
+    size_t pos = out.size();
+    if (storedField & kRawFlag) {
+        if (stored != rawLen) throw std::runtime_error("LZ data corrupted");
+        out.insert(out.end(), blk + kBlockHeader, blk + kBlockHeader + rawLen);
+        return;
+    }
+    out.resize(pos + rawLen + kSlack);
+    decode_block(blk + kBlockHeader, blk + kBlockHeader + stored, out.data() + pos, rawLen);
+    out.resize(pos + rawLen);
+}
+
+} // namespace
+
+std::vector<uint8_t> lz_compress(const std::vector<uint8_t>& in, int level) {
+    std::vector<uint8_t> out;
+    LzEncoder enc(level);
+    enc.update(in.data(), in.size(), out);
+    enc.finish(out);
+    return out;
+}
+
+std::vector<uint8_t> lz_decompress(const std::vector<uint8_t>& in) {
+    std::vector<uint8_t> out;
+    LzDecoder dec;
+    dec.update(in.data(), in.size(), out);
+    dec.finish();
+    return out;
+}
+
+LzEncoder::LzEncoder(int level)
+    : level_(std::clamp(level, kLzMinLevel, kLzMaxLevel)) {}
+
+void LzEncoder::reset() {
+    block_.clear();
+}
+
+void LzEncoder::update(const uint8_t* in, size_t n, std::vector<uint8_t>& out) {
+    while (n > 0) {
+        // 输入中已有完整块：直接压缩，不经过 block_
+        if (block_.empty() && n >= kBlockSize) {
+            compressBlock(in, kBlockSize, out);
+            in += kBlockSize;
+            n -= kBlockSize;
+            continue;
+        }
+        size_t take = std::min(n, kBlockSize - block_.size());
+        block_.insert(block_.end(), in, in + take);
+        in += take;
+        n -= take;
+        if (block_.size() == kBlockSize) {
+            compressBlock(block_.data(), block_.size(), out);
+            block_.clear();
+        }
+    }
+}
+
+void LzEncoder::finish(std::vector<uint8_t>& out) {
+    if (!block_.empty()) compressBlock(block_.data(), block_.size(), out);
+    block_.clear();
+}
+
+void LzEncoder::compressBlock(const uint8_t* src, size_t n, std::vector<uint8_t>& out) {
+    const size_t headerPos = out.size();
+    out.resize(headerPos + kBlockHeader);
+    const size_t payloadPos = out.size();
+
+    // 级别 -> 每个位置最多比较的候选数：1, 2, 4, ..., 256
+    const int maxAttempts = 1 << (level_ - 1);
+    // 哈希表和链表按需扩大后一直保留；每块只清空本块用到的那部分哈希表
+    // prev_ 的槽位总在本块写入后才被读取，不需要清空
+    const int bits = hash_bits(n);
+    const size_t slots = size_t(1) << bits;
+    if (head_.size() < slots) head_.resize(slots);
+    if (prev_.size() < std::min(n, kPrevSize)) prev_.resize(std::min(n, kPrevSize));
+    std::fill_n(head_.begin(), slots, -1);
+
+    size_t anchor = 0;  // 尚未输出的字面量起点
+    size_t i = 0;
+    size_t misses = 0;
+    while (i + kMinMatch <= n) {
+        const uint32_t h = hash4(src + i, bits);
+        int32_t cand = head_[h];
+        prev_[i & (kPrevSize - 1)] = cand;
+        head_[h] = static_cast<int32_t>(i);
+
+        size_t bestLen = 0;
+        size_t bestOff = 0;
+        const uint32_t cur = read32(src + i);
+        for (int attempt = 0; attempt < maxAttempts && cand >= 0; ++attempt) {
+            size_t c = static_cast<size_t>(cand);
+            if (i - c > kWindow) break;
+            if (read32(src + c) == cur) {
+                size_t len = kMinMatch;
+                while (i + len < n && src[c + len] == src[i + len]) ++len;
+                if (len > bestLen) {
+                    bestLen = len;
+                    bestOff = i - c;
+                    if (i + len == n) break;
+                }
+            }
+            int32_t next = prev_[c & (kPrevSize - 1)];
+            if (next >= cand) break;  // 槽位已被更新的位置覆盖
+            cand = next;
+        }
+
+        if (bestLen < kMinMatch) {
+            // 低级别下连续未命中时加大步长，快速跳过不可压缩数据
+            ++misses;
+            i += (level_ <= 3) ? 1 + (misses >> 5) : 1;
+            continue;
+        }
+
+        emit_sequence(out, src + anchor, i - anchor, bestOff, bestLen);
+        misses = 0;
+
+        // 把匹配区间内的位置也加入哈希链
+        size_t end = i + bestLen;
+        for (size_t p = i + 1; p < end && p + kMinMatch <= n; ++p) {
+            const uint32_t hp = hash4(src + p, bits);
+            prev_[p & (kPrevSize - 1)] = head_[hp];
+            head_[hp] = static_cast<int32_t>(p);
+        }
+        i = end;
+        anchor = end;
+    }
+    if (anchor < n) emit_sequence(out, src + anchor, n - anchor, 0, 0);
+
+    size_t stored = out.size() - payloadPos;
+    if (stored >= n) {
+        // 压缩无收益：改为原样存储
+        out.resize(payloadPos);
+        out.insert(out.end(), src, src + n);
+        stored = n | kRawFlag;
+    }
+    put_u32(out, headerPos, static_cast<uint32_t>(n));
+    put_u32(out, headerPos + 4, static_cast<uint32_t>(stored));
+}
+
+void LzDecoder::update(const uint8_t* in, size_t n, std::vector<uint8_t>& out) {
+    while (n > 0) {
+        // 输入中已有完整块：直接解码，不经过 pending_
+        if (pending_.empty() && n >= kBlockHeader) {
+            size_t need = kBlockHeader + (get_u32(in + 4) & ~kRawFlag);
+            if (n >= need) {
+                decode_frame(in, out);
+                in += need;
+                n -= need;
+                continue;
+            }
+        }
+
+        // 块跨越输入边界：先暂存，凑齐后再解码
+        size_t need = kBlockHeader;
+        if (pending_.size() >= kBlockHeader) need += get_u32(pending_.data() + 4) & ~kRawFlag;
+        size_t take = std::min(n, need - pending_.size());
+        pending_.insert(pending_.end(), in, in + take);
+        in += take;
+        n -= take;
+        if (pending_.size() >= kBlockHeader &&
+            pending_.size() == kBlockHeader + (get_u32(pending_.data() + 4) & ~kRawFlag)) {
+            decode_frame(pending_.data(), out);
+            pending_.clear();
+        }
+    }
+}
+
+void LzDecoder::finish() {
+    if (!pending_.empty()) throw std::runtime_error("LZ data truncated");
+}
+
+} // namespace pkg
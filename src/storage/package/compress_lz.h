@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pkg {
+
+// LZ77 类压缩（LZ4 风格的序列编码 + 哈希链匹配）
+// 流格式：若干块，每块 [rawLen(u32)][storedLen(u32)][payload]
+//   storedLen 最高位为 1 表示该块未压缩（payload 即原始数据）
+// 块内序列：[token][字面量长度扩展][字面量][offset(u16)][匹配长度扩展]
+//   token 高 4 位为字面量长度，低 4 位为匹配长度-4，取值 15 时后跟 255 累加的扩展字节
+//   块的最后一个序列可以只有字面量（之后输入结束）
+constexpr int kLzMinLevel = 1;
+constexpr int kLzMaxLevel = 9;
+constexpr int kLzDefaultLevel = 6;
+
+std::vector<uint8_t> lz_compress(const std::vector<uint8_t>& in, int level = kLzDefaultLevel);
+std::vector<uint8_t> lz_decompress(const std::vector<uint8_t>& in);
+
+// 流式 LZ 编码：输入按固定 256 KiB 分块，输出与输入如何切分无关
+class LzEncoder {
+public:
+    explicit LzEncoder(int level = kLzDefaultLevel);
+
+    int level() const { return level_; }
+
+    void update(const uint8_t* in, size_t n, std::vector<uint8_t>& out);
+    // 输出最后一个不满的块
+    void finish(std::vector<uint8_t>& out);
+    // 丢弃暂存的输入（上一个流中途失败后复用编码器）
+    void reset();
+
+    static constexpr size_t kBlockSize = 256 * 1024;
+
+private:
+    int level_;
+    // 以下缓冲都在第一次用到时按块长分配，之后复用：小文件不必分配整块大小的哈希表
+    std::vector<uint8_t> block_;
+    std::vector<int32_t> head_;  // 哈希 -> 最近位置（大小随块长，最多 2^16）
+    std::vector<int32_t> prev_;  // 位置 -> 同哈希的上一个位置（64 KiB 窗口）
+
+    // 压缩 [src, src+n) 为一个块追加到 out；src 可以是调用方的输入，也可以是 block_
+    void compressBlock(const uint8_t* src, size_t n, std::vector<uint8_t>& out);
+};
+
+// 流式 LZ 解码：输入可在任意位置切分，凑齐一个块后整块解码
+class LzDecoder {
+public:
+    void update(const uint8_t* in, size_t n, std::vector<uint8_t>& out);
+    // 检查输入是否完整结束
+    void finish();
+
+private:
+    std::vector<uint8_t> pending_;  // 未凑齐的块（含 8 字节块头）
+};
+
+} // namespace pkg
@@ -1,38 +1,210 @@
 #include "compress_rle.h"
+#include <cstring>
 #include <stdexcept>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#define PKG_RLE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON) && \
+    !(defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define PKG_RLE_NEON 1
+#include <arm_neon.h>
+#endif
+
 namespace pkg {
 
+namespace {
+
+// p[0, n) 开头与 b 相同的字节数（调用方保证 p[0] == b）：一次比较 16 字节，由比较掩码找到第一个不同的字节
+inline size_t run_length(const uint8_t* p, size_t n, uint8_t b) {
+    // 文本和随机数据的 run 大多只有一两个字节：先逐字节比较几个，仍然相同再按块比较
+    size_t i = 1;
+    while (i < n && i < 4 && p[i] == b) ++i;
+    if (i < 4) return i;
+#if defined(PKG_RLE_SSE2)
+    const __m128i v = _mm_set1_epi8(static_cast<char>(b));
+    for (; i + 16 <= n; i += 16) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        const unsigned diff = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, v))) & 0xFFFFu;
+        if (diff) return i + static_cast<size_t>(__builtin_ctz(diff));
+    }
+#elif defined(PKG_RLE_NEON)
+    // NEON 没有 movemask：相等结果窄化为每字节 4 位的 64 位掩码
+    const uint8x16_t v = vdupq_n_u8(b);
+    for (; i + 16 <= n; i += 16) {
+        const uint8x16_t eq = vceqq_u8(vld1q_u8(p + i), v);
+        const uint64_t diff =
+            ~vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        if (diff) return i + static_cast<size_t>(__builtin_ctzll(diff)) / 4;
+    }
+#endif
+    // 其余平台与末尾：一次比较 8 字节
+    const uint64_t pattern = 0x0101010101010101ull * b;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        w ^= pattern;
+        if (w) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            return i + static_cast<size_t>(__builtin_clzll(w)) / 8;
+#else
+            return i + static_cast<size_t>(__builtin_ctzll(w)) / 8;
+#endif
+        }
+    }
+    while (i < n && p[i] == b) ++i;
+    return i;
+}
+
+// 写出长度为 len（>0）的 run：超过 255 的拆成若干 [255][byte] 加余数，与逐字节累计的拆分方式相同
+inline uint8_t* put_run(uint8_t* o, uint8_t b, size_t len) {
+    if (len < 255) {
+        o[0] = static_cast<uint8_t>(len);
+        o[1] = b;
+        return o + 2;
+    }
+    for (; len >= 255; len -= 255) {
+        o[0] = 255;
+        o[1] = b;
+        o += 2;
+    }
+    if (len > 0) {
+        o[0] = static_cast<uint8_t>(len);
+        o[1] = b;
+        o += 2;
+    }
+    return o;
+}
+
+} // namespace
+
 // 格式：[count(1字节)][byte(1字节)]...  count范围1..255
-std::vector<uint8_t> rle_compress(const std::vector<uint8_t>& in) {
-    std::vector<uint8_t> out;
-    if (in.empty()) return out;
+void rle_compress(ByteSpan in, std::vector<uint8_t>& out) {
+    out.clear();
+    RleEncoder enc;
+    enc.update(in.data, in.size, out);
+    enc.finish(out);
+}
 
-    size_t i = 0;
-    while (i < in.size()) {
-        uint8_t b = in[i];
-        size_t j = i + 1;
-        while (j < in.size() && in[j] == b && (j - i) < 255) ++j;
-        uint8_t count = static_cast<uint8_t>(j - i);
-        out.push_back(count);
-        out.push_back(b);
-        i = j;
+void rle_decompress(ByteSpan in, std::vector<uint8_t>& out) {
+    if (in.size % 2 != 0) throw std::runtime_error("RLE data corrupted");
+
+    // 先求出总长度，一次分配后顺序填充
+    size_t total = 0;
+    for (size_t i = 0; i < in.size; i += 2) {
+        if (in.data[i] == 0) throw std::runtime_error("RLE count=0 corrupted");
+        total += in.data[i];
+    }
+    out.resize(total);
+    rle_decompress_into(in, out.data(), total);
+}
+
+void rle_decompress(ByteSpan in, std::vector<uint8_t>& out, size_t size) {
+    // 每对最多展开 255 字节：声明的大小不可能达到时不按它分配
+    if (size > in.size / 2 * 255) throw std::runtime_error("RLE size mismatch");
+    out.resize(size);
+    rle_decompress_into(in, out.data(), size);
+}
+
+void rle_decompress_into(ByteSpan in, uint8_t* dst, size_t size) {
+    if (in.size % 2 != 0) throw std::runtime_error("RLE data corrupted");
+    size_t left = size;
+    for (size_t i = 0; i < in.size; i += 2) {
+        const uint8_t count = in.data[i];
+        if (count == 0) throw std::runtime_error("RLE count=0 corrupted");
+        if (count > left) throw std::runtime_error("RLE size mismatch");
+        // 不可压缩的数据几乎全是单字节的对：直接写入，省去 memset 的调用
+        if (count == 1) *dst = in.data[i + 1];
+        else std::memset(dst, in.data[i + 1], count);
+        dst += count;
+        left -= count;
     }
+    if (left != 0) throw std::runtime_error("RLE size mismatch");
+}
+
+std::vector<uint8_t> rle_compress(const std::vector<uint8_t>& in) {
+    std::vector<uint8_t> out;
+    rle_compress(ByteSpan(in), out);
     return out;
 }
 
 std::vector<uint8_t> rle_decompress(const std::vector<uint8_t>& in) {
     std::vector<uint8_t> out;
-    if (in.empty()) return out;
-    if (in.size() % 2 != 0) throw std::runtime_error("RLE data corrupted");
+    rle_decompress(ByteSpan(in), out);
+    return out;
+}
 
-    for (size_t i = 0; i < in.size(); i += 2) {
-        uint8_t count = in[i];
-        uint8_t b = in[i + 1];
-        if (count == 0) throw std::runtime_error("RLE count=0 corrupted");
-        out.insert(out.end(), count, b);
+void RleEncoder::update(const uint8_t* in, size_t n, std::vector<uint8_t>& out) {
+    if (n == 0) return;
+    // 每个 run 至少 1 个输入字节，加上跨块保留的 run 最多 n + 1 对
+    const size_t pos = out.size();
+    out.resize(pos + rle_compress_bound(n) + 2);
+    uint8_t* const begin = out.data() + pos;
+    uint8_t* o = begin;
+
+    size_t i = 0;
+    while (i < n) {
+        if (count_ == 0 || in[i] != byte_) {
+            if (count_ > 0) o = put_run(o, byte_, count_);
+            byte_ = in[i];
+            count_ = 0;
+        }
+        const size_t run = run_length(in + i, n - i, byte_);
+        i += run;
+        count_ += run;
+        if (i < n) {
+            o = put_run(o, byte_, count_);
+            count_ = 0;
+        }
     }
-    return out;
+    // 最后一个 run 可能延续到下一块：先写出其中完整的 255，余下的 1..255 个留到以后
+    const size_t keep = (count_ - 1) % 255 + 1;
+    if (count_ > keep) o = put_run(o, byte_, count_ - keep);
+    count_ = keep;
+
+    out.resize(pos + static_cast<size_t>(o - begin));
+}
+
+void RleEncoder::finish(std::vector<uint8_t>& out) {
+    if (count_ > 0) {
+        out.push_back(static_cast<uint8_t>(count_));
+        out.push_back(byte_);
+    }
+    count_ = 0;
+}
+
+void RleDecoder::update(const uint8_t* in, size_t n, std::vector<uint8_t>& out) {
+    if (n == 0) return;
+    // 先求出本块能展开的长度，out 一次扩大后逐对 memset 填充
+    const size_t first = pending_ ? 1 : 0;
+    size_t total = pending_ ? count_ : 0;
+    for (size_t i = first; i < n; i += 2) {
+        if (in[i] == 0) throw std::runtime_error("RLE count=0 corrupted");
+        if (i + 1 < n) total += in[i];
+    }
+    const size_t pos = out.size();
+    out.resize(pos + total);
+    uint8_t* p = out.data() + pos;
+
+    if (pending_) {
+        std::memset(p, in[0], count_);
+        p += count_;
+        pending_ = false;
+    }
+    size_t i = first;
+    for (; i + 1 < n; i += 2) {
+        if (in[i] == 1) *p = in[i + 1];
+        else std::memset(p, in[i + 1], in[i]);
+        p += in[i];
+    }
+    if (i < n) {
+        count_ = in[i];
+        pending_ = true;
+    }
+}
+
+void RleDecoder::finish() {
+    if (pending_) throw std::runtime_error("RLE data corrupted");
 }
 
 } // namespace pkg
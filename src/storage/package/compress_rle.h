@@ -1,10 +1,50 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <vector>
+#include "binary_io.h"
 
 namespace pkg {
 
+// 编码输出的上限（输入没有任何重复时每个字节一对）
+inline size_t rle_compress_bound(size_t n) { return 2 * n; }
+
+// 整体编码/解码：结果写入调用方提供的 out（先清空，容量复用），输入可以指向 mmap 的区域
+void rle_compress(ByteSpan in, std::vector<uint8_t>& out);
+void rle_decompress(ByteSpan in, std::vector<uint8_t>& out);
+
+// 已知原始大小（TocItem::originalSize、块头的 rawLen）时的解码：out 一次调整为 size，
+// 逐对 memset 填充，不再预扫描；展开后的长度与 size 不同时抛出异常
+void rle_decompress(ByteSpan in, std::vector<uint8_t>& out, size_t size);
+// 同上，解码到调用方提供的 dst[0, size)
+void rle_decompress_into(ByteSpan in, uint8_t* dst, size_t size);
+
 std::vector<uint8_t> rle_compress(const std::vector<uint8_t>& in);
 std::vector<uint8_t> rle_decompress(const std::vector<uint8_t>& in);
 
+// 流式 RLE 编码：跨块保留未结束的 run，输出与 rle_compress 整体编码逐字节相同
+class RleEncoder {
+public:
+    // 追加已确定的 [count][byte] 对到 out：out 按最坏情况扩大一次，写完后截短到实际长度
+    void update(const uint8_t* in, size_t n, std::vector<uint8_t>& out);
+    // 输出最后一个 run
+    void finish(std::vector<uint8_t>& out);
+
+private:
+    uint8_t byte_ = 0;
+    size_t count_ = 0;
+};
+
+// 流式 RLE 解码：输入可在任意位置切分（[count][byte] 对跨块时暂存 count）
+class RleDecoder {
+public:
+    void update(const uint8_t* in, size_t n, std::vector<uint8_t>& out);
+    // 检查输入是否完整结束
+    void finish();
+
+private:
+    bool pending_ = false;
+    uint8_t count_ = 0;
+};
+
 } // namespace pkg
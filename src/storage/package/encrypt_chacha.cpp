@@ -0,0 +1,422 @@
+#include "encrypt_chacha.h"
+#include "binary_io.h"
+#include "storage/sha256.h"
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PKG_CHACHA_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON) && \
+    !(defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define PKG_CHACHA_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace pkg {
+
+// ---------- PBKDF2-HMAC-SHA256 ----------
+
+namespace {
+
+using backuprestore::Sha256;
+
+// HMAC 的内外层在吸收 ipad/opad 之后的状态；每次迭代只需复制这两个状态
+struct HmacSha256 {
+    Sha256 inner;
+    Sha256 outer;
+
+    explicit HmacSha256(const std::string& key) {
+        uint8_t k[64] = {};
+        if (key.size() > 64) {
+            auto d = Sha256::hash(key.data(), key.size());
+            std::memcpy(k, d.data(), d.size());
+        } else if (!key.empty()) {
+            std::memcpy(k, key.data(), key.size());
+        }
+        uint8_t pad[64];
+        for (int i = 0; i < 64; ++i) pad[i] = k[i] ^ 0x36;
+        inner.update(pad, 64);
+        for (int i = 0; i < 64; ++i) pad[i] = k[i] ^ 0x5c;
+        outer.update(pad, 64);
+    }
+
+    Sha256::Digest mac(const void* data, size_t n) const {
+        Sha256 in = inner;
+        in.update(data, n);
+        auto d = in.finish();
+        Sha256 out = outer;
+        out.update(d.data(), d.size());
+        return out.finish();
+    }
+};
+
+} // namespace
+
+std::vector<uint8_t> pbkdf2_hmac_sha256(const std::string& password, const std::vector<uint8_t>& salt,
+                                        uint32_t iterations, size_t dkLen) {
+    if (iterations == 0) throw std::runtime_error("pbkdf2: iterations must be > 0");
+    HmacSha256 prf(password);
+    std::vector<uint8_t> dk;
+    dk.reserve(dkLen);
+
+    std::vector<uint8_t> msg(salt);
+    msg.resize(salt.size() + 4);
+    for (uint32_t blk = 1; dk.size() < dkLen; ++blk) {
+        // U1 = PRF(P, S || INT_BE(blk))，Ui = PRF(P, U(i-1))，T = U1 ^ U2 ^ ...
+        for (int i = 0; i < 4; ++i) msg[salt.size() + i] = static_cast<uint8_t>(blk >> (24 - 8 * i));
+        auto u = prf.mac(msg.data(), msg.size());
+        auto t = u;
+        for (uint32_t it = 1; it < iterations; ++it) {
+            u = prf.mac(u.data(), u.size());
+            for (size_t i = 0; i < t.size(); ++i) t[i] ^= u[i];
+        }
+        size_t take = std::min(t.size(), dkLen - dk.size());
+        dk.insert(dk.end(), t.begin(), t.begin() + take);
+    }
+    return dk;
+}
+
+ChaChaKey chacha_derive_key(const std::string& password, const std::vector<uint8_t>& salt) {
+    auto dk = pbkdf2_hmac_sha256(password, salt, kChaChaKdfIterations, 32);
+    ChaChaKey key;
+    std::memcpy(key.data(), dk.data(), key.size());
+    return key;
+}
+
+// ---------- 密钥流 ----------
+
+namespace {
+
+inline uint32_t rotl32(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+#define PKG_CHACHA_QR(a, b, c, d)                 \
+    a += b; d ^= a; d = rotl32(d, 16);            \
+    c += d; b ^= c; b = rotl32(b, 12);            \
+    a += b; d ^= a; d = rotl32(d, 8);             \
+    c += d; b ^= c; b = rotl32(b, 7)
+
+// 生成计数器为 counter 的一个 64 字节块
+void chacha_block(const uint32_t in[16], uint64_t counter, uint8_t out[64]) {
+    uint32_t s[16];
+    std::memcpy(s, in, sizeof(s));
+    s[12] = static_cast<uint32_t>(counter);
+    s[13] = static_cast<uint32_t>(counter >> 32);
+    uint32_t x[16];
+    std::memcpy(x, s, sizeof(x));
+    for (int r = 0; r < 10; ++r) {
+        PKG_CHACHA_QR(x[0], x[4], x[8], x[12]);
+        PKG_CHACHA_QR(x[1], x[5], x[9], x[13]);
+        PKG_CHACHA_QR(x[2], x[6], x[10], x[14]);
+        PKG_CHACHA_QR(x[3], x[7], x[11], x[15]);
+        PKG_CHACHA_QR(x[0], x[5], x[10], x[15]);
+        PKG_CHACHA_QR(x[1], x[6], x[11], x[12]);
+        PKG_CHACHA_QR(x[2], x[7], x[8], x[13]);
+        PKG_CHACHA_QR(x[3], x[4], x[9], x[14]);
+    }
+    for (int i = 0; i < 16; ++i) store_le<uint32_t>(out + 4 * i, x[i] + s[i]);
+}
+
+#undef PKG_CHACHA_QR
+
+// 用从 counter 开始的 nblocks 个块的密钥流异或 data
+using XorBlocksFn = void (*)(const uint32_t in[16], uint64_t counter, uint8_t* data, size_t nblocks);
+
+void xor_blocks_scalar(const uint32_t in[16], uint64_t counter, uint8_t* data, size_t nblocks) {
+    uint8_t ks[64];
+    for (size_t b = 0; b < nblocks; ++b, data += 64) {
+        chacha_block(in, counter + b, ks);
+        for (int i = 0; i < 64; ++i) data[i] ^= ks[i];
+    }
+}
+
+// 各 lane 的计数器（低/高 32 位），lane k 对应 counter + k
+inline void lane_counters(uint64_t counter, int lanes, uint32_t* lo, uint32_t* hi) {
+    for (int k = 0; k < lanes; ++k) {
+        lo[k] = static_cast<uint32_t>(counter + k);
+        hi[k] = static_cast<uint32_t>((counter + k) >> 32);
+    }
+}
+
+// SIMD 实现都是“竖排”：向量 v[i] 的第 k 个 lane 是第 k 个块的状态字 i，
+// 轮函数与标量版完全相同，最后转置回按块排列的字节序
+
+#ifdef PKG_CHACHA_X86
+
+#define PKG_SSE_ROTL(x, n) _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - (n)))
+#define PKG_SSE_QR(a, b, c, d)                                                       \
+    a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = PKG_SSE_ROTL(d, 16);      \
+    c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = PKG_SSE_ROTL(b, 12);      \
+    a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = PKG_SSE_ROTL(d, 8);       \
+    c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = PKG_SSE_ROTL(b, 7)
+
+// SSE2：一次 4 个块
+void xor_blocks_sse2(const uint32_t in[16], uint64_t counter, uint8_t* data, size_t nblocks) {
+    for (; nblocks >= 4; nblocks -= 4, counter += 4, data += 256) {
+        uint32_t lo[4], hi[4];
+        lane_counters(counter, 4, lo, hi);
+        __m128i s[16], x[16];
+        for (int i = 0; i < 16; ++i) s[i] = _mm_set1_epi32(static_cast<int>(in[i]));
+        s[12] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lo));
+        s[13] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi));
+        for (int i = 0; i < 16; ++i) x[i] = s[i];
+        for (int r = 0; r < 10; ++r) {
+            PKG_SSE_QR(x[0], x[4], x[8], x[12]);
+            PKG_SSE_QR(x[1], x[5], x[9], x[13]);
+            PKG_SSE_QR(x[2], x[6], x[10], x[14]);
+            PKG_SSE_QR(x[3], x[7], x[11], x[15]);
+            PKG_SSE_QR(x[0], x[5], x[10], x[15]);
+            PKG_SSE_QR(x[1], x[6], x[11], x[12]);
+            PKG_SSE_QR(x[2], x[7], x[8], x[13]);
+            PKG_SSE_QR(x[3], x[4], x[9], x[14]);
+        }
+        for (int i = 0; i < 16; ++i) x[i] = _mm_add_epi32(x[i], s[i]);
+
+        // 每 4 个状态字做一次 4x4 转置：结果 k 是第 k 个块的 16 字节
+        for (int g = 0; g < 4; ++g) {
+            __m128i t0 = _mm_unpacklo_epi32(x[4 * g], x[4 * g + 1]);
+            __m128i t1 = _mm_unpacklo_epi32(x[4 * g + 2], x[4 * g + 3]);
+            __m128i t2 = _mm_unpackhi_epi32(x[4 * g], x[4 * g + 1]);
+            __m128i t3 = _mm_unpackhi_epi32(x[4 * g + 2], x[4 * g + 3]);
+            __m128i r[4] = {_mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1),
+                            _mm_unpacklo_epi64(t2, t3), _mm_unpackhi_epi64(t2, t3)};
+            for (int k = 0; k < 4; ++k) {
+                auto* p = reinterpret_cast<__m128i*>(data + 64 * k + 16 * g);
+                _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), r[k]));
+            }
+        }
+    }
+    xor_blocks_scalar(in, counter, data, nblocks);
+}
+
+#undef PKG_SSE_QR
+#undef PKG_SSE_ROTL
+
+// AVX2：一次 8 个块；16/8 位循环移位用字节重排
+#define PKG_AVX_ROTL(x, n) _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - (n)))
+#define PKG_AVX_QR(a, b, c, d)                                                                \
+    a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a); d = _mm256_shuffle_epi8(d, rot16); \
+    c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = PKG_AVX_ROTL(b, 12);          \
+    a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a); d = _mm256_shuffle_epi8(d, rot8);  \
+    c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = PKG_AVX_ROTL(b, 7)
+
+__attribute__((target("avx2")))
+void xor_blocks_avx2(const uint32_t in[16], uint64_t counter, uint8_t* data, size_t nblocks) {
+    const __m256i rot16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                           2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i rot8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                                          3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+    for (; nblocks >= 8; nblocks -= 8, counter += 8, data += 512) {
+        uint32_t lo[8], hi[8];
+        lane_counters(counter, 8, lo, hi);
+        __m256i s[16], x[16];
+        for (int i = 0; i < 16; ++i) s[i] = _mm256_set1_epi32(static_cast<int>(in[i]));
+        s[12] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lo));
+        s[13] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hi));
+        for (int i = 0; i < 16; ++i) x[i] = s[i];
+        for (int r = 0; r < 10; ++r) {
+            PKG_AVX_QR(x[0], x[4], x[8], x[12]);
+            PKG_AVX_QR(x[1], x[5], x[9], x[13]);
+            PKG_AVX_QR(x[2], x[6], x[10], x[14]);
+            PKG_AVX_QR(x[3], x[7], x[11], x[15]);
+            PKG_AVX_QR(x[0], x[5], x[10], x[15]);
+            PKG_AVX_QR(x[1], x[6], x[11], x[12]);
+            PKG_AVX_QR(x[2], x[7], x[8], x[13]);
+            PKG_AVX_QR(x[3], x[4], x[9], x[14]);
+        }
+        for (int i = 0; i < 16; ++i) x[i] = _mm256_add_epi32(x[i], s[i]);
+
+        // 在每个 128 位 lane 内做 4x4 转置：r[g][k] 低半是块 k、高半是块 k+4 的第 g 个 16 字节
+        __m256i r[4][4];
+        for (int g = 0; g < 4; ++g) {
+            __m256i t0 = _mm256_unpacklo_epi32(x[4 * g], x[4 * g + 1]);
+            __m256i t1 = _mm256_unpacklo_epi32(x[4 * g + 2], x[4 * g + 3]);
+            __m256i t2 = _mm256_unpackhi_epi32(x[4 * g], x[4 * g + 1]);
+            __m256i t3 = _mm256_unpackhi_epi32(x[4 * g + 2], x[4 * g + 3]);
+            r[g][0] = _mm256_unpacklo_epi64(t0, t1);
+            r[g][1] = _mm256_unpackhi_epi64(t0, t1);
+            r[g][2] = _mm256_unpacklo_epi64(t2, t3);
+            r[g][3] = _mm256_unpackhi_epi64(t2, t3);
+        }
+        for (int k = 0; k < 4; ++k) {
+            __m256i ks[4] = {_mm256_permute2x128_si256(r[0][k], r[1][k], 0x20),  // 块 k 的 0..31
+                             _mm256_permute2x128_si256(r[2][k], r[3][k], 0x20),  // 块 k 的 32..63
+                             _mm256_permute2x128_si256(r[0][k], r[1][k], 0x31),  // 块 k+4 的 0..31
+                             _mm256_permute2x128_si256(r[2][k], r[3][k], 0x31)}; // 块 k+4 的 32..63
+            uint8_t* dst[4] = {data + 64 * k, data + 64 * k + 32,
+                               data + 64 * (k + 4), data + 64 * (k + 4) + 32};
+            for (int q = 0; q < 4; ++q) {
+                auto* p = reinterpret_cast<__m256i*>(dst[q]);
+                _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), ks[q]));
+            }
+        }
+    }
+    xor_blocks_sse2(in, counter, data, nblocks);
+}
+
+#undef PKG_AVX_QR
+#undef PKG_AVX_ROTL
+
+#endif // PKG_CHACHA_X86
+
+#ifdef PKG_CHACHA_NEON
+
+#define PKG_NEON_ROTL(x, n) vsriq_n_u32(vshlq_n_u32(x, n), x, 32 - (n))
+#define PKG_NEON_QR(a, b, c, d)                                                                 \
+    a = vaddq_u32(a, b); d = veorq_u32(d, a); d = vreinterpretq_u32_u16(vrev32q_u16(vreinterpretq_u16_u32(d))); \
+    c = vaddq_u32(c, d); b = veorq_u32(b, c); b = PKG_NEON_ROTL(b, 12);                          \
+    a = vaddq_u32(a, b); d = veorq_u32(d, a); d = PKG_NEON_ROTL(d, 8);                           \
+    c = vaddq_u32(c, d); b = veorq_u32(b, c); b = PKG_NEON_ROTL(b, 7)
+
+// NEON：一次 4 个块
+void xor_blocks_neon(const uint32_t in[16], uint64_t counter, uint8_t* data, size_t nblocks) {
+    for (; nblocks >= 4; nblocks -= 4, counter += 4, data += 256) {
+        uint32_t lo[4], hi[4];
+        lane_counters(counter, 4, lo, hi);
+        uint32x4_t s[16], x[16];
+        for (int i = 0; i < 16; ++i) s[i] = vdupq_n_u32(in[i]);
+        s[12] = vld1q_u32(lo);
+        s[13] = vld1q_u32(hi);
+        for (int i = 0; i < 16; ++i) x[i] = s[i];
+        for (int r = 0; r < 10; ++r) {
+            PKG_NEON_QR(x[0], x[4], x[8], x[12]);
+            PKG_NEON_QR(x[1], x[5], x[9], x[13]);
+            PKG_NEON_QR(x[2], x[6], x[10], x[14]);
+            PKG_NEON_QR(x[3], x[7], x[11], x[15]);
+            PKG_NEON_QR(x[0], x[5], x[10], x[15]);
+            PKG_NEON_QR(x[1], x[6], x[11], x[12]);
+            PKG_NEON_QR(x[2], x[7], x[8], x[13]);
+            PKG_NEON_QR(x[3], x[4], x[9], x[14]);
+        }
+        for (int i = 0; i < 16; ++i) x[i] = vaddq_u32(x[i], s[i]);
+
+        for (int g = 0; g < 4; ++g) {
+            uint64x2_t t0 = vreinterpretq_u64_u32(vzip1q_u32(x[4 * g], x[4 * g + 1]));
+            uint64x2_t t1 = vreinterpretq_u64_u32(vzip1q_u32(x[4 * g + 2], x[4 * g + 3]));
+            uint64x2_t t2 = vreinterpretq_u64_u32(vzip2q_u32(x[4 * g], x[4 * g + 1]));
+            uint64x2_t t3 = vreinterpretq_u64_u32(vzip2q_u32(x[4 * g + 2], x[4 * g + 3]));
+            uint32x4_t r[4] = {vreinterpretq_u32_u64(vzip1q_u64(t0, t1)), vreinterpretq_u32_u64(vzip2q_u64(t0, t1)),
+                               vreinterpretq_u32_u64(vzip1q_u64(t2, t3)), vreinterpretq_u32_u64(vzip2q_u64(t2, t3))};
+            for (int k = 0; k < 4; ++k) {
+                uint8_t* p = data + 64 * k + 16 * g;
+                vst1q_u8(p, veorq_u8(vld1q_u8(p), vreinterpretq_u8_u32(r[k])));
+            }
+        }
+    }
+    xor_blocks_scalar(in, counter, data, nblocks);
+}
+
+#undef PKG_NEON_QR
+#undef PKG_NEON_ROTL
+
+#endif // PKG_CHACHA_NEON
+
+struct ChaChaImpl {
+    const char* name;
+    XorBlocksFn fn;
+    bool (*supported)();
+};
+
+bool always() { return true; }
+#ifdef PKG_CHACHA_X86
+bool has_avx2() { return __builtin_cpu_supports("avx2"); }
+#endif
+
+// 按优先级从高到低排列
+const ChaChaImpl kImpls[] = {
+#ifdef PKG_CHACHA_X86
+    {"avx2", xor_blocks_avx2, has_avx2},
+    {"sse2", xor_blocks_sse2, always},
+#endif
+#ifdef PKG_CHACHA_NEON
+    {"neon", xor_blocks_neon, always},
+#endif
+    {"scalar", xor_blocks_scalar, always},
+};
+
+const ChaChaImpl* select_impl() {
+    for (const auto& impl : kImpls) {
+        if (impl.supported()) return &impl;
+    }
+    return &kImpls[sizeof(kImpls) / sizeof(kImpls[0]) - 1];
+}
+
+const ChaChaImpl*& current_impl() {
+    static const ChaChaImpl* impl = select_impl();
+    return impl;
+}
+
+} // namespace
+
+const char* chacha_impl_name() { return current_impl()->name; }
+
+bool chacha_set_impl(const std::string& name) {
+    for (const auto& impl : kImpls) {
+        if (name == impl.name && impl.supported()) {
+            current_impl() = &impl;
+            return true;
+        }
+    }
+    return false;
+}
+
+ChaChaStream::ChaChaStream(const ChaChaKey& key, uint64_t nonce, uint64_t offset) {
+    // "expand 32-byte k"
+    state_[0] = 0x61707865;
+    state_[1] = 0x3320646e;
+    state_[2] = 0x79622d32;
+    state_[3] = 0x6b206574;
+    for (int i = 0; i < 8; ++i) state_[4 + i] = load_le<uint32_t>(key.data() + 4 * i);
+    state_[12] = 0;
+    state_[13] = 0;
+    state_[14] = static_cast<uint32_t>(nonce);
+    state_[15] = static_cast<uint32_t>(nonce >> 32);
+    seek(offset);
+}
+
+void ChaChaStream::seek(uint64_t offset) {
+    counter_ = offset / 64;
+    ksPos_ = 64;
+    size_t within = static_cast<size_t>(offset % 64);
+    if (within != 0) {
+        chacha_block(state_, counter_++, ks_);
+        ksPos_ = within;
+    }
+}
+
+void ChaChaStream::process(uint8_t* data, size_t n) {
+    // 先用完上一次剩下的部分块
+    while (n > 0 && ksPos_ < 64) {
+        *data++ ^= ks_[ksPos_++];
+        --n;
+    }
+    size_t blocks = n / 64;
+    if (blocks > 0) {
+        current_impl()->fn(state_, counter_, data, blocks);
+        counter_ += blocks;
+        data += blocks * 64;
+        n -= blocks * 64;
+    }
+    if (n > 0) {
+        chacha_block(state_, counter_++, ks_);
+        for (size_t i = 0; i < n; ++i) data[i] ^= ks_[i];
+        ksPos_ = n;
+    }
+}
+
+void ChaChaStream::process(const uint8_t* in, uint8_t* out, size_t n) {
+    if (in != out && n > 0) std::memcpy(out, in, n);
+    process(out, n);
+}
+
+void chacha_crypt(ByteSpan in, uint8_t* out, const ChaChaKey& key, uint64_t nonce) {
+    ChaChaStream(key, nonce).process(in.data, out, in.size);
+}
+
+std::vector<uint8_t> chacha_crypt(const std::vector<uint8_t>& in, const ChaChaKey& key, uint64_t nonce) {
+    std::vector<uint8_t> out(in);
+    ChaChaStream(key, nonce).process(out.data(), out.size());
+    return out;
+}
+
+} // namespace pkg
@@ -0,0 +1,52 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "binary_io.h"
+
+namespace pkg {
+
+// ChaCha20 流加密（DJB 原版布局：64 位块计数器 + 64 位 nonce）
+// 密钥流只由 (key, nonce, 块计数器) 决定，因此可以 seek 到任意位置、各块并行加解密
+using ChaChaKey = std::array<uint8_t, 32>;
+
+// 口令 -> 密钥：PBKDF2-HMAC-SHA256，salt 为包头中的随机 salt
+constexpr uint32_t kChaChaKdfIterations = 100000;
+
+std::vector<uint8_t> pbkdf2_hmac_sha256(const std::string& password, const std::vector<uint8_t>& salt,
+                                        uint32_t iterations, size_t dkLen);
+
+ChaChaKey chacha_derive_key(const std::string& password, const std::vector<uint8_t>& salt);
+
+class ChaChaStream {
+public:
+    // offset: 起始字节位置（等价于构造后 seek）
+    ChaChaStream(const ChaChaKey& key, uint64_t nonce, uint64_t offset = 0);
+
+    // 跳到密钥流中的任意字节位置
+    void seek(uint64_t offset);
+    // 原地加密/解密
+    void process(uint8_t* data, size_t n);
+    // 从 in 读、写到 out（可以相同）；SIMD 实现是原地的，先复制到 out 再处理
+    void process(const uint8_t* in, uint8_t* out, size_t n);
+
+private:
+    uint32_t state_[16];
+    uint64_t counter_ = 0;   // 下一个要生成的块
+    uint8_t ks_[64];         // 当前部分使用的块的密钥流
+    size_t ksPos_ = 64;      // ks_ 中下一个可用字节，64 表示已用完
+};
+
+// out 至少 in.size 字节，可以等于 in.data（原地处理）
+void chacha_crypt(ByteSpan in, uint8_t* out, const ChaChaKey& key, uint64_t nonce);
+std::vector<uint8_t> chacha_crypt(const std::vector<uint8_t>& in, const ChaChaKey& key, uint64_t nonce);
+
+// 当前使用的密钥流实现：scalar / sse2 / avx2 / neon（启动时按 CPU 能力选择）
+const char* chacha_impl_name();
+// 强制使用指定实现（用于基准测试和对比验证）；CPU 不支持或名称未知时返回 false
+// 须在没有其它线程使用 ChaChaStream 时调用
+bool chacha_set_impl(const std::string& name);
+
+} // namespace pkg
@@ -1,5 +1,6 @@
 #include "encrypt_rc4.h"
 #include <array>
+#include <utility>
 
 namespace pkg {
 
@@ -12,32 +13,45 @@ static std::vector<uint8_t> make_key(const std::string& password, const std::vec
     return key;
 }
 
+void rc4_crypt(ByteSpan in, uint8_t* out,
+               const std::string& password,
+               const std::vector<uint8_t>& salt) {
+    Rc4Stream(password, salt).process(in.data, out, in.size);
+}
+
 std::vector<uint8_t> rc4_crypt(const std::vector<uint8_t>& in,
                               const std::string& password,
                               const std::vector<uint8_t>& salt) {
+    std::vector<uint8_t> out(in.size());
+    rc4_crypt(ByteSpan(in), out.data(), password, salt);
+    return out;
+}
+
+Rc4Stream::Rc4Stream(const std::string& password, const std::vector<uint8_t>& salt) {
     auto key = make_key(password, salt);
 
-    std::array<uint8_t, 256> S{};
-    for (int i = 0; i < 256; ++i) S[i] = static_cast<uint8_t>(i);
+    for (int i = 0; i < 256; ++i) S_[i] = static_cast<uint8_t>(i);
 
     // KSA
     int j = 0;
     for (int i = 0; i < 256; ++i) {
-        j = (j + S[i] + key[i % key.size()]) & 0xFF;
-        std::swap(S[i], S[j]);
+        j = (j + S_[i] + key[i % key.size()]) & 0xFF;
+        std::swap(S_[i], S_[j]);
     }
+}
 
+void Rc4Stream::process(const uint8_t* in, uint8_t* out, size_t n) {
     // PRGA
-    std::vector<uint8_t> out(in.size());
-    int i = 0; j = 0;
-    for (size_t k = 0; k < in.size(); ++k) {
+    int i = i_, j = j_;
+    for (size_t k = 0; k < n; ++k) {
         i = (i + 1) & 0xFF;
-        j = (j + S[i]) & 0xFF;
-        std::swap(S[i], S[j]);
-        uint8_t rnd = S[(S[i] + S[j]) & 0xFF];
+        j = (j + S_[i]) & 0xFF;
+        std::swap(S_[i], S_[j]);
+        uint8_t rnd = S_[(S_[i] + S_[j]) & 0xFF];
         out[k] = in[k] ^ rnd;
     }
-    return out;
+    i_ = i;
+    j_ = j;
 }
 
 } // namespace pkg
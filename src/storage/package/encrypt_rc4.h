@@ -1,14 +1,37 @@
 #pragma once
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
+#include "binary_io.h"
 
 namespace pkg {
 
 // RC4 流加密/解密（同一个函数）
 // salt: 每个包随机生成，用于增强 key
+// out 至少 in.size 字节，可以等于 in.data（原地处理）
+void rc4_crypt(ByteSpan in, uint8_t* out,
+               const std::string& password,
+               const std::vector<uint8_t>& salt);
+
 std::vector<uint8_t> rc4_crypt(const std::vector<uint8_t>& in,
                               const std::string& password,
                               const std::vector<uint8_t>& salt);
 
+// 流式 RC4：保存 S 盒与 i/j，分块处理与整体处理结果相同
+class Rc4Stream {
+public:
+    Rc4Stream(const std::string& password, const std::vector<uint8_t>& salt);
+    // 原地加密/解密
+    void process(uint8_t* data, size_t n) { process(data, data, n); }
+    // 从 in 读、写到 out（可以相同）
+    void process(const uint8_t* in, uint8_t* out, size_t n);
+
+private:
+    std::array<uint8_t, 256> S_{};
+    int i_ = 0;
+    int j_ = 0;
+};
+
 } // namespace pkg
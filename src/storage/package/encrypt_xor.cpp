@@ -19,15 +19,27 @@ static uint8_t next_byte(uint32_t& x) {
     return static_cast<uint8_t>(x & 0xFF);
 }
 
+void xor_crypt(ByteSpan in, uint8_t* out,
+               const std::string& password,
+               const std::vector<uint8_t>& salt) {
+    XorStream(password, salt).process(in.data, out, in.size);
+}
+
 std::vector<uint8_t> xor_crypt(const std::vector<uint8_t>& in,
                               const std::string& password,
                               const std::vector<uint8_t>& salt) {
     std::vector<uint8_t> out(in.size());
-    uint32_t state = fnv1a32(password, salt);
-    for (size_t i = 0; i < in.size(); ++i) {
-        out[i] = in[i] ^ next_byte(state);
-    }
+    xor_crypt(ByteSpan(in), out.data(), password, salt);
     return out;
 }
 
+XorStream::XorStream(const std::string& password, const std::vector<uint8_t>& salt)
+    : state_(fnv1a32(password, salt)) {}
+
+void XorStream::process(const uint8_t* in, uint8_t* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = in[i] ^ next_byte(state_);
+    }
+}
+
 } // namespace pkg
@@ -1,14 +1,34 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
+#include "binary_io.h"
 
 namespace pkg {
 
 // XOR 伪随机流加密/解密（同一个函数）
 // salt: 每个包随机生成，用于生成伪随机流
+// out 至少 in.size 字节，可以等于 in.data（原地处理）
+void xor_crypt(ByteSpan in, uint8_t* out,
+               const std::string& password,
+               const std::vector<uint8_t>& salt);
+
 std::vector<uint8_t> xor_crypt(const std::vector<uint8_t>& in,
                               const std::string& password,
                               const std::vector<uint8_t>& salt);
 
+// 流式 XOR：保存 xorshift 状态，分块处理与整体处理结果相同
+class XorStream {
+public:
+    XorStream(const std::string& password, const std::vector<uint8_t>& salt);
+    // 原地加密/解密
+    void process(uint8_t* data, size_t n) { process(data, data, n); }
+    // 从 in 读、写到 out（可以相同）
+    void process(const uint8_t* in, uint8_t* out, size_t n);
+
+private:
+    uint32_t state_;
+};
+
 } // namespace pkg
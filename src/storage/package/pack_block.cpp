@@ -0,0 +1,281 @@
+#include "pack_block.h"
+#include "binary_io.h"
+#include "compress_lz.h"
+#include "compress_rle.h"
+#include "encrypt_rc4.h"
+#include "encrypt_xor.h"
+#include "core/stats.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace pkg {
+
+PackageKey make_package_key(EncryptAlg enc, const std::string& password, const std::vector<uint8_t>& salt) {
+    PackageKey key;
+    key.enc = enc;
+    key.password = password;
+    key.salt = salt;
+    if (enc == EncryptAlg::ChaCha20) key.chacha = chacha_derive_key(password, salt);
+    return key;
+}
+
+// 采样的片段数与每个片段的大小：片段分散在整个块中，块的开头（如文件头）不会单独决定结果
+static constexpr size_t kSampleSlices = 16;
+static constexpr size_t kSampleSlice = 1024;
+// 字节熵达到该值（bit/字节）时 LZ 几乎不可能有收益：已压缩或加密的数据在 16 KiB 样本上约为 7.98
+static constexpr double kIncompressibleEntropy = 7.9;
+
+bool block_compressible(const uint8_t* raw, size_t n, CompressAlg comp) {
+    if (comp == CompressAlg::None || n == 0) return false;
+
+    const size_t slices = std::min(kSampleSlices, std::max<size_t>(1, n / kSampleSlice));
+    const size_t sliceLen = std::min(kSampleSlice, n / slices);
+    const size_t stride = n / slices;
+    size_t count[256] = {};
+    size_t repeats = 0;
+    size_t total = 0;
+    for (size_t s = 0; s < slices; ++s) {
+        const uint8_t* p = raw + s * stride;
+        ++count[p[0]];
+        for (size_t i = 1; i < sliceLen; ++i) {
+            ++count[p[i]];
+            repeats += (p[i] == p[i - 1]);
+        }
+        total += sliceLen;
+    }
+
+    if (comp == CompressAlg::RLE) return repeats * 2 > total;
+
+    double entropy = 0;
+    for (size_t c : count) {
+        if (c == 0) continue;
+        double q = static_cast<double>(c) / static_cast<double>(total);
+        entropy -= q * std::log2(q);
+    }
+    return entropy < kIncompressibleEntropy;
+}
+
+BlockHeader block_parse_header(const uint8_t* p) {
+    BlockHeader h;
+    h.rawLen = load_le<uint32_t>(p);
+    const uint32_t stored = load_le<uint32_t>(p + 4);
+    h.storedLen = stored & ~kBlockRawFlag;
+    h.raw = (stored & kBlockRawFlag) != 0;
+    h.nonce = load_le<uint64_t>(p + 8);
+    return h;
+}
+
+namespace {
+
+// 编码时的切片大小：与 LZ 的块大小一致，每片的压缩输出都是完整的 LZ 块，LzEncoder 不必暂存输入
+constexpr size_t kSliceSize = LzEncoder::kBlockSize;
+
+// 每个线程复用的压缩器与缓冲区：LzEncoder 内含最多约 768 KiB 的哈希表和块缓冲，不再逐块分配
+struct ThreadScratch {
+    std::unique_ptr<LzEncoder> lz;
+    std::vector<uint8_t> salt;
+};
+
+ThreadScratch& thread_scratch() {
+    thread_local ThreadScratch scratch;
+    return scratch;
+}
+
+// 压缩阶段：update 追加已确定的输出，finish 输出剩余部分；decode 整块解压到 out（rawLen 为块头记录的原始长度）
+template <CompressAlg C>
+struct CompressStage;
+
+template <>
+struct CompressStage<CompressAlg::RLE> {
+    explicit CompressStage(int) {}
+    void update(const uint8_t* in, size_t n, std::vector<uint8_t>& out) { rle.update(in, n, out); }
+    void finish(std::vector<uint8_t>& out) { rle.finish(out); }
+    static void decode(const std::vector<uint8_t>& stored, size_t rawLen, std::vector<uint8_t>& out) {
+        rle_decompress(ByteSpan(stored), out, rawLen);
+    }
+
+    RleEncoder rle;
+};
+
+template <>
+struct CompressStage<CompressAlg::LZ> {
+    explicit CompressStage(int level) : lz(encoder(level)) {}
+    void update(const uint8_t* in, size_t n, std::vector<uint8_t>& out) { lz.update(in, n, out); }
+    void finish(std::vector<uint8_t>& out) { lz.finish(out); }
+    static void decode(const std::vector<uint8_t>& stored, size_t, std::vector<uint8_t>& out) {
+        LzDecoder dec;
+        out.clear();
+        dec.update(stored.data(), stored.size(), out);
+        dec.finish();
+    }
+
+    static LzEncoder& encoder(int level) {
+        auto& lz = thread_scratch().lz;
+        if (!lz || lz->level() != std::clamp(level, kLzMinLevel, kLzMaxLevel))
+            lz = std::make_unique<LzEncoder>(level);
+        return *lz;
+    }
+
+    LzEncoder& lz;
+};
+
+// 加密阶段：每个块一个密钥流，process 可以分多次调用
+// XOR/RC4 用包 salt + nonce（小端 8 字节）派生，ChaCha20 直接以 nonce 作为 nonce
+template <EncryptAlg E>
+struct CipherStage;
+
+template <>
+struct CipherStage<EncryptAlg::None> {
+    CipherStage(const PackageKey&, uint64_t) {}
+    void process(uint8_t*, size_t) {}
+    void process(const uint8_t* in, uint8_t* out, size_t n) { std::memcpy(out, in, n); }
+};
+
+const std::vector<uint8_t>& block_salt(const std::vector<uint8_t>& salt, uint64_t nonce) {
+    auto& s = thread_scratch().salt;
+    s.resize(salt.size() + 8);
+    std::copy(salt.begin(), salt.end(), s.begin());
+    store_le<uint64_t>(s.data() + salt.size(), nonce);
+    return s;
+}
+
+template <>
+struct CipherStage<EncryptAlg::XOR> {
+    CipherStage(const PackageKey& key, uint64_t nonce) : stream(key.password, block_salt(key.salt, nonce)) {}
+    void process(uint8_t* data, size_t n) { stream.process(data, n); }
+    void process(const uint8_t* in, uint8_t* out, size_t n) { stream.process(in, out, n); }
+
+    XorStream stream;
+};
+
+template <>
+struct CipherStage<EncryptAlg::RC4> {
+    CipherStage(const PackageKey& key, uint64_t nonce) : stream(key.password, block_salt(key.salt, nonce)) {}
+    void process(uint8_t* data, size_t n) { stream.process(data, n); }
+    void process(const uint8_t* in, uint8_t* out, size_t n) { stream.process(in, out, n); }
+
+    Rc4Stream stream;
+};
+
+template <>
+struct CipherStage<EncryptAlg::ChaCha20> {
+    CipherStage(const PackageKey& key, uint64_t nonce) : stream(key.chacha, nonce) {}
+    void process(uint8_t* data, size_t n) { stream.process(data, n); }
+    void process(const uint8_t* in, uint8_t* out, size_t n) { stream.process(in, out, n); }
+
+    ChaChaStream stream;
+};
+
+template <CompressAlg C, EncryptAlg E>
+class BlockChain : public BlockCodec {
+public:
+    BlockChain(int level, const PackageKey& key) : level_(level), key_(key) {}
+
+    void encode(const uint8_t* raw, size_t n, uint64_t nonce,
+                std::vector<uint8_t>& out, bool skipCompress) const override {
+        const size_t headerPos = out.size();
+        const size_t dataPos = headerPos + kBlockHeaderSize;
+        out.resize(dataPos);
+
+        bool stored_raw = true;
+        if constexpr (C != CompressAlg::None) {
+            if (!skipCompress && block_compressible(raw, n, C)) stored_raw = !compress(raw, n, nonce, out, dataPos);
+        }
+        if (stored_raw) {
+            out.resize(dataPos + n);
+            CipherStage<E> cipher(key_, nonce);
+            crypt(cipher, raw, out.data() + dataPos, n);
+        }
+
+        size_t stored = out.size() - dataPos;
+        if (stored >= kBlockRawFlag) throw std::runtime_error("block too large");
+        uint32_t storedField = static_cast<uint32_t>(stored);
+        if (C != CompressAlg::None && stored_raw) storedField |= kBlockRawFlag;
+        uint8_t* hp = out.data() + headerPos;
+        store_le<uint32_t>(hp, static_cast<uint32_t>(n));
+        store_le<uint32_t>(hp + 4, storedField);
+        store_le<uint64_t>(hp + 8, nonce);
+    }
+
+    void decode(const BlockHeader& hdr, std::vector<uint8_t>& stored,
+                std::vector<uint8_t>& out) const override {
+        if (stored.size() != hdr.storedLen) throw std::runtime_error("block length mismatch");
+        {
+            CipherStage<E> cipher(key_, hdr.nonce);
+            crypt(cipher, stored.data(), stored.data(), stored.size());
+        }
+
+        bool decompressed = false;
+        if constexpr (C != CompressAlg::None) {
+            if (!hdr.raw) {
+                backuprestore::StatTimer timer(backuprestore::StatPhase::Compress, stored.size());
+                CompressStage<C>::decode(stored, hdr.rawLen, out);
+                decompressed = true;
+            }
+        }
+        if (!decompressed) out.swap(stored);
+        if (out.size() != hdr.rawLen) throw std::runtime_error("block size mismatch");
+    }
+
+private:
+    int level_;
+    const PackageKey& key_;
+
+    static void crypt(CipherStage<E>& cipher, const uint8_t* in, uint8_t* out, size_t n) {
+        if constexpr (E == EncryptAlg::None) {
+            if (in != out) std::memcpy(out, in, n);
+        } else {
+            backuprestore::StatTimer timer(backuprestore::StatPhase::Encrypt, n);
+            cipher.process(in, out, n);
+        }
+    }
+
+    // 逐片压缩并加密该片的输出；压缩结果已不比原始数据小时放弃（out 退回 dataPos）并返回 false
+    // 切片为 LZ 的整块，每片处理完后 LzEncoder 中没有暂存的输入，中途放弃后仍可复用
+    bool compress(const uint8_t* raw, size_t n, uint64_t nonce, std::vector<uint8_t>& out, size_t dataPos) const {
+        CompressStage<C> comp(level_);
+        CipherStage<E> cipher(key_, nonce);
+        size_t done = dataPos;
+        for (size_t off = 0; off < n; off += kSliceSize) {
+            const size_t len = std::min(kSliceSize, n - off);
+            {
+                backuprestore::StatTimer timer(backuprestore::StatPhase::Compress, len);
+                comp.update(raw + off, len, out);
+                if (off + len == n) comp.finish(out);
+            }
+            if (out.size() - dataPos >= n) {
+                out.resize(dataPos);
+                return false;
+            }
+            crypt(cipher, out.data() + done, out.data() + done, out.size() - done);
+            done = out.size();
+        }
+        return true;
+    }
+};
+
+template <CompressAlg C>
+std::unique_ptr<BlockCodec> make_chain(int level, const PackageKey& key) {
+    switch (key.enc) {
+    case EncryptAlg::None: return std::make_unique<BlockChain<C, EncryptAlg::None>>(level, key);
+    case EncryptAlg::XOR: return std::make_unique<BlockChain<C, EncryptAlg::XOR>>(level, key);
+    case EncryptAlg::RC4: return std::make_unique<BlockChain<C, EncryptAlg::RC4>>(level, key);
+    case EncryptAlg::ChaCha20: return std::make_unique<BlockChain<C, EncryptAlg::ChaCha20>>(level, key);
+    }
+    throw std::runtime_error("unsupported encryption algorithm");
+}
+
+} // namespace
+
+std::unique_ptr<BlockCodec> make_block_codec(CompressAlg comp, int level, const PackageKey& key) {
+    switch (comp) {
+    case CompressAlg::None: return make_chain<CompressAlg::None>(level, key);
+    case CompressAlg::RLE: return make_chain<CompressAlg::RLE>(level, key);
+    case CompressAlg::LZ: return make_chain<CompressAlg::LZ>(level, key);
+    }
+    throw std::runtime_error("unsupported compression algorithm");
+}
+
+} // namespace pkg
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "algorithms.h"
+#include "encrypt_chacha.h"
+
+namespace pkg {
+
+// 包格式 v2：每个条目的数据切成固定大小的块，每块独立压缩、独立派生密钥流
+// 块格式：[rawLen(u32)][storedLen(u32)][nonce(u64)][stored bytes]
+//   nonce = (条目序号 << 32) | 块序号：XOR/RC4 用 salt + nonce 派生该块的密钥流，
+//   ChaCha20 直接把它作为 nonce，因此各块可以并行编解码，一个块损坏不影响其它块
+// 包格式 v3（压缩的分块包）：storedLen 最高位为 1 表示该块未压缩（stored bytes 只经过加密），
+//   不可压缩的块（已压缩的图片、压缩包、音视频等）不再经过压缩器
+constexpr size_t kBlockHeaderSize = 16;
+constexpr size_t kMaxBlockSize = 64u << 20;  // 读取时拒绝更大的块，避免损坏的长度导致巨量分配
+constexpr uint32_t kBlockRawFlag = 0x80000000u;
+
+struct BlockHeader {
+    uint32_t rawLen = 0;
+    uint32_t storedLen = 0;  // 不含 kBlockRawFlag
+    uint64_t nonce = 0;
+    bool raw = false;        // 包声明了压缩算法但该块原样存储
+};
+
+inline uint64_t block_nonce(uint32_t entry, uint32_t block) {
+    return (static_cast<uint64_t>(entry) << 32) | block;
+}
+
+// 包级密钥材料：ChaCha20 的密钥派生（PBKDF2）开销较大，每个包只派生一次，各块共享
+struct PackageKey {
+    EncryptAlg enc = EncryptAlg::None;
+    std::string password;
+    std::vector<uint8_t> salt;
+    ChaChaKey chacha{};
+};
+
+PackageKey make_package_key(EncryptAlg enc, const std::string& password, const std::vector<uint8_t>& salt);
+
+// 采样判断块是否值得用 comp 压缩：在块中均匀取若干片段（共约 16 KiB），
+// LZ 要求字节熵明显低于 8 bit/字节，RLE 要求片段中与前一字节相同的字节过半（否则输出只会变大）
+bool block_compressible(const uint8_t* raw, size_t n, CompressAlg comp);
+
+BlockHeader block_parse_header(const uint8_t* p);
+
+// 块编解码链：压缩与加密算法在包级确定，make_block_codec 为每种 (CompressAlg, EncryptAlg) 组合实例化
+// 一份特化的实现，块内循环不再按枚举分支；压缩器与中间缓冲区按线程复用，编解码一个块不再分配内存
+// （out 的容量跨块保留时）。各线程可以同时使用同一个 BlockCodec
+class BlockCodec {
+public:
+    virtual ~BlockCodec() = default;
+
+    // 编码一个块（压缩 -> 加密），块头 + 数据追加到 out：输入按 256 KiB 切片，每片压缩后
+    // 紧接着加密刚输出的部分，数据只在缓存中经过一遍
+    // 压缩算法不为 None 时，skipCompress（调用方已知条目不可压缩）、采样判断不可压缩、或压缩后不比原始数据小的块
+    // 原样存储并在块头中标记 kBlockRawFlag
+    virtual void encode(const uint8_t* raw, size_t n, uint64_t nonce,
+                        std::vector<uint8_t>& out, bool skipCompress = false) const = 0;
+
+    // 解码一个块（原地解密 stored -> 解压；hdr.raw 时不解压），结果写入 out（容量复用）；数据损坏时抛出异常
+    virtual void decode(const BlockHeader& hdr, std::vector<uint8_t>& stored,
+                        std::vector<uint8_t>& out) const = 0;
+};
+
+// level 为 LZ 压缩级别（解码时不使用）；key 须在返回的对象之前一直有效
+std::unique_ptr<BlockCodec> make_block_codec(CompressAlg comp, int level, const PackageKey& key);
+
+} // namespace pkg
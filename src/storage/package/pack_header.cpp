@@ -1,32 +1,139 @@
 #include "pack_header.h"
 #include "binary_io.h"
+#include <stdexcept>
 
 namespace pkg {
 
 // 写入：fileCount + [path + origSize + storedSize + data]...
 void pack_header_write(std::ostream& os, const std::vector<Entry>& entries) {
-    write_le<uint32_t>(os, static_cast<uint32_t>(entries.size()));
+    pack_header_write_count(os, static_cast<uint32_t>(entries.size()));
     for (const auto& e : entries) {
-        write_string(os, e.relPath);
-        write_le<uint64_t>(os, e.originalSize);
-        write_le<uint64_t>(os, static_cast<uint64_t>(e.payload.size()));
+        pack_header_write_entry(os, e.relPath, e.originalSize, static_cast<uint64_t>(e.payload.size()));
         write_bytes(os, e.payload);
     }
 }
 
+void pack_header_write_count(std::ostream& os, uint32_t count) {
+    ByteWriter w(4);
+    w.le<uint32_t>(count);
+    w.flush(os);
+}
+
+std::streampos pack_header_write_entry(std::ostream& os, const std::string& relPath,
+                                       uint64_t originalSize, uint64_t storedSize) {
+    ByteWriter w(4 + relPath.size() + 16);
+    w.string(relPath);
+    w.le<uint64_t>(originalSize);
+    std::streampos pos = os.tellp() + static_cast<std::streamoff>(w.size());
+    w.le<uint64_t>(storedSize);
+    w.flush(os);
+    return pos;
+}
+
+void pack_header_patch_stored(std::ostream& os, std::streampos pos, uint64_t storedSize) {
+    std::streampos end = os.tellp();
+    os.seekp(pos);
+    ByteWriter w(8);
+    w.le<uint64_t>(storedSize);
+    w.flush(os);
+    os.seekp(end);
+    if (!os) throw std::runtime_error("patch storedSize failed");
+}
+
+namespace {
+
+// 路径长度上限：防止损坏的长度字段导致巨量分配
+constexpr uint32_t kMaxPathLen = 1u << 16;
+
+struct EntryHeader {
+    std::string relPath;
+    uint64_t originalSize = 0;
+    uint64_t storedSize = 0;
+};
+
+uint32_t read_count(std::istream& is) {
+    uint8_t b[4];
+    is.read(reinterpret_cast<char*>(b), 4);
+    if (!is) throw std::runtime_error("read: unexpected end of file");
+    return load_le<uint32_t>(b);
+}
+
+// 每条头部两次 read：先读路径长度，再一次读出路径 + 两个大小字段
+EntryHeader read_entry_header(std::istream& is, std::vector<uint8_t>& buf) {
+    uint32_t pathLen = read_count(is);
+    if (pathLen > kMaxPathLen) throw std::runtime_error("entry path too long");
+    read_into(is, buf, pathLen + 16);
+
+    ByteReader r(buf);
+    EntryHeader h;
+    h.relPath.assign(reinterpret_cast<const char*>(r.bytes(pathLen).data), pathLen);
+    h.originalSize = r.le_unchecked<uint64_t>();
+    h.storedSize = r.le_unchecked<uint64_t>();
+    return h;
+}
+
+} // namespace
+
+uint32_t pack_header_read_count(std::istream& is) {
+    return read_count(is);
+}
+
+TocItem pack_header_read_entry(std::istream& is, std::vector<uint8_t>& buf) {
+    EntryHeader h = read_entry_header(is, buf);
+    TocItem item;
+    item.relPath = std::move(h.relPath);
+    item.originalSize = h.originalSize;
+    item.storedSize = h.storedSize;
+    return item;
+}
+
 std::vector<Entry> pack_header_read(std::istream& is) {
-    uint32_t n = read_le<uint32_t>(is);
+    uint32_t n = read_count(is);
     std::vector<Entry> entries;
     entries.reserve(n);
+    std::vector<uint8_t> buf;
     for (uint32_t i = 0; i < n; ++i) {
+        EntryHeader h = read_entry_header(is, buf);
         Entry e;
-        e.relPath = read_string(is);
-        e.originalSize = read_le<uint64_t>(is);
-        uint64_t stored = read_le<uint64_t>(is);
-        e.payload = read_bytes(is, static_cast<size_t>(stored));
+        e.relPath = std::move(h.relPath);
+        e.originalSize = h.originalSize;
+        e.payload = read_bytes(is, static_cast<size_t>(h.storedSize));
         entries.push_back(std::move(e));
     }
     return entries;
 }
 
+std::vector<TocItem> pack_header_scan(std::istream& is, const StoredSizeFn& measure) {
+    auto start = is.tellg();
+    is.seekg(0, std::ios::end);
+    uint64_t endPos = static_cast<uint64_t>(is.tellg());
+    is.seekg(start);
+
+    uint32_t n = read_count(is);
+    std::vector<TocItem> items;
+    items.reserve(n);
+    std::vector<uint8_t> buf;
+    for (uint32_t i = 0; i < n; ++i) {
+        EntryHeader h = read_entry_header(is, buf);
+        TocItem item;
+        item.relPath = std::move(h.relPath);
+        item.originalSize = h.originalSize;
+        item.storedSize = h.storedSize;
+        item.offset = static_cast<uint64_t>(is.tellg());
+        if (item.storedSize == kUnknownStoredSize && measure) {
+            item.storedSize = measure(is, item);
+            if (!is || static_cast<uint64_t>(is.tellg()) > endPos)
+                throw std::runtime_error("header scan: truncated package");
+            items.push_back(std::move(item));
+            continue;
+        }
+        if (item.storedSize > endPos - item.offset)
+            throw std::runtime_error("header scan: truncated package");
+        is.seekg(static_cast<std::streamoff>(item.storedSize), std::ios::cur);
+        if (!is) throw std::runtime_error("header scan: truncated package");
+        items.push_back(std::move(item));
+    }
+    return items;
+}
+
 } // namespace pkg
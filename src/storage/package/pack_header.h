@@ -1,9 +1,11 @@
 #pragma once
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 #include <istream>
 #include <ostream>
+#include "pack_toc.h"
 
 namespace pkg {
 
@@ -17,4 +19,26 @@ struct Entry {
 void pack_header_write(std::ostream& os, const std::vector<Entry>& entries);
 std::vector<Entry> pack_header_read(std::istream& is);
 
+// 流式写入：先写条目数，再对每个条目写头部并紧接着写数据
+void pack_header_write_count(std::ostream& os, uint32_t count);
+// 写入时不知道大小的条目（写到管道的压缩分块条目）的 storedSize：数据由各块的块头界定，
+// 读取时按块累计原始长度，达到 originalSize 即为条目结尾（v1 条目不使用）
+constexpr uint64_t kUnknownStoredSize = UINT64_MAX;
+
+// 写条目头部，返回 storedSize 字段的位置（数据写完后可用 pack_header_patch_stored 回填）
+std::streampos pack_header_write_entry(std::ostream& os, const std::string& relPath,
+                                       uint64_t originalSize, uint64_t storedSize);
+void pack_header_patch_stored(std::ostream& os, std::streampos pos, uint64_t storedSize);
+
+// 只扫描条目头部：读取 path/大小后 seek 跳过数据，offset 为数据在包中的位置
+// storedSize 为 kUnknownStoredSize 的条目交给 measure：从数据开头读到条目结尾并返回实际的 storedSize；
+// measure 为空时这样的条目视为损坏
+using StoredSizeFn = std::function<uint64_t(std::istream&, const TocItem&)>;
+std::vector<TocItem> pack_header_scan(std::istream& is, const StoredSizeFn& measure = nullptr);
+
+// 顺序读取（不 seek，可用于管道）：先读条目数，再逐条读头部，调用方接着读 storedSize 字节的数据
+// buf 为复用的读缓冲区；返回的 offset 为 0
+uint32_t pack_header_read_count(std::istream& is);
+TocItem pack_header_read_entry(std::istream& is, std::vector<uint8_t>& buf);
+
 } // namespace pkg
@@ -1,10 +1,18 @@
 #include "pack_toc.h"
 #include "binary_io.h"
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
 namespace pkg {
 
 static const char TOC_MAGIC[4] = {'T','O','C','1'};
+static const char TOC2_MAGIC[4] = {'T','O','C','2'};
+static const char TOC3_MAGIC[4] = {'T','O','C','3'};
+
+// TOC3 每条的标志位
+static const uint8_t kTocHasChecksum = 1;
+static const uint8_t kTocSparse = 2;
 
 void pack_toc_write(std::ostream& os,
                     const std::vector<TocItem>& toc,
@@ -20,58 +28,126 @@ void pack_toc_write(std::ostream& os,
         write_bytes(os, blobs[i]);
     }
 
+    pack_toc_write_index(os, local);
+}
+
+void pack_toc_write_index(std::ostream& os, const std::vector<TocItem>& toc) {
     uint64_t tocOffset = static_cast<uint64_t>(os.tellp());
 
-    // 写 TOC block
-    os.write(TOC_MAGIC, 4);
-    write_le<uint32_t>(os, static_cast<uint32_t>(local.size()));
-    for (const auto& item : local) {
-        write_string(os, item.relPath);
-        write_le<uint64_t>(os, item.originalSize);
-        write_le<uint64_t>(os, item.offset);
-        write_le<uint64_t>(os, item.storedSize);
+    bool sparse = std::any_of(toc.begin(), toc.end(),
+                              [](const TocItem& item) { return item.layout.sparse; });
+    bool checksums = std::all_of(toc.begin(), toc.end(),
+                                 [](const TocItem& item) { return item.hasChecksum; });
+    // TOC3：checksum(8) + flags(1) + 区段数(4)，其后为各区段的 offset/length
+    const size_t fixed = sparse ? 37 : checksums ? 32 : 24;
+
+    // 整个 TOC 先编码到内存，再一次写出
+    size_t bytes = 4 + 4 + 8;
+    for (const auto& item : toc) {
+        bytes += 4 + item.relPath.size() + fixed;
+        if (sparse) bytes += 16 * item.layout.extents.size();
+    }
+    ByteWriter w(bytes);
+
+    w.bytes(sparse ? TOC3_MAGIC : checksums ? TOC2_MAGIC : TOC_MAGIC, 4);
+    w.le<uint32_t>(static_cast<uint32_t>(toc.size()));
+    for (const auto& item : toc) {
+        w.string(item.relPath);
+        w.le<uint64_t>(item.originalSize);
+        w.le<uint64_t>(item.offset);
+        w.le<uint64_t>(item.storedSize);
+        if (sparse) {
+            const auto& extents = item.layout.extents;
+            if (extents.size() > UINT32_MAX) throw std::runtime_error("too many extents: " + item.relPath);
+            w.le<uint64_t>(item.hasChecksum ? item.checksum : 0);
+            w.u8((item.hasChecksum ? kTocHasChecksum : 0) | (item.layout.sparse ? kTocSparse : 0));
+            w.le<uint32_t>(item.layout.sparse ? static_cast<uint32_t>(extents.size()) : 0);
+            if (!item.layout.sparse) continue;
+            for (const auto& e : extents) {
+                w.le<uint64_t>(e.offset);
+                w.le<uint64_t>(e.length);
+            }
+        } else if (checksums) {
+            w.le<uint64_t>(item.checksum);
+        }
     }
 
     // 文件末尾写 tocOffset（方便反向读）
-    write_le<uint64_t>(os, tocOffset);
+    w.le<uint64_t>(tocOffset);
+    w.flush(os);
 }
 
-void pack_toc_read(std::istream& is,
-                   std::vector<TocItem>& tocOut,
-                   std::vector<std::vector<uint8_t>>& blobsOut) {
+void pack_toc_read_index(std::istream& is, std::vector<TocItem>& tocOut) {
     // 读最后8字节 tocOffset
     is.seekg(0, std::ios::end);
     auto endPos = is.tellg();
     if (endPos < 8) throw std::runtime_error("file too small");
+    const uint64_t tocEnd = static_cast<uint64_t>(endPos) - 8;
 
-    is.seekg(endPos - std::streamoff(8), std::ios::beg);
-    uint64_t tocOffset = read_le<uint64_t>(is);
+    is.seekg(static_cast<std::streamoff>(tocEnd), std::ios::beg);
+    std::vector<uint8_t> buf = read_bytes(is, 8);
+    uint64_t tocOffset = load_le<uint64_t>(buf.data());
+    if (tocOffset > tocEnd) throw std::runtime_error("tocOffset out of range");
 
-    // 跳到 tocOffset 读取 TOC
+    // 一次读入整个 TOC，在内存里解析
     is.seekg(static_cast<std::streamoff>(tocOffset), std::ios::beg);
-
-    char magic[4];
-    is.read(magic, 4);
-    if (!is || std::string(magic, 4) != std::string(TOC_MAGIC, 4))
-        throw std::runtime_error("TOC magic mismatch");
-
-    uint32_t n = read_le<uint32_t>(is);
+    read_into(is, buf, static_cast<size_t>(tocEnd - tocOffset));
+    ByteReader r(buf);
+
+    r.need(8);
+    const uint8_t* magic = r.bytes(4).data;
+    const int version = std::memcmp(magic, TOC3_MAGIC, 4) == 0 ? 3
+                      : std::memcmp(magic, TOC2_MAGIC, 4) == 0 ? 2
+                      : std::memcmp(magic, TOC_MAGIC, 4) == 0 ? 1 : 0;
+    if (version == 0) throw std::runtime_error("TOC magic mismatch");
+    const size_t fixed = version == 3 ? 37 : version == 2 ? 32 : 24;
+    uint32_t n = r.le_unchecked<uint32_t>();
+    // 每条至少 4 + fixed 字节，先排除损坏的条目数
+    if (n > r.remaining() / (4 + fixed)) throw std::runtime_error("TOC truncated");
 
     tocOut.clear();
     tocOut.reserve(n);
 
     for (uint32_t i = 0; i < n; ++i) {
         TocItem item;
-        item.relPath = read_string(is);
-        item.originalSize = read_le<uint64_t>(is);
-        item.offset = read_le<uint64_t>(is);
-        item.storedSize = read_le<uint64_t>(is);
+        item.relPath = r.string();
+        r.need(fixed);
+        item.originalSize = r.le_unchecked<uint64_t>();
+        item.offset = r.le_unchecked<uint64_t>();
+        item.storedSize = r.le_unchecked<uint64_t>();
+        if (version == 2) {
+            item.checksum = r.le_unchecked<uint64_t>();
+            item.hasChecksum = true;
+        } else if (version == 3) {
+            item.checksum = r.le_unchecked<uint64_t>();
+            uint8_t flags = r.le_unchecked<uint8_t>();
+            uint32_t count = r.le_unchecked<uint32_t>();
+            item.hasChecksum = (flags & kTocHasChecksum) != 0;
+            item.layout.sparse = (flags & kTocSparse) != 0;
+            if (count > r.remaining() / 16) throw std::runtime_error("TOC truncated");
+            item.layout.extents.resize(count);
+            // 区段必须有序、不重叠且不超出文件大小
+            uint64_t end = 0;
+            for (auto& e : item.layout.extents) {
+                e.offset = r.le_unchecked<uint64_t>();
+                e.length = r.le_unchecked<uint64_t>();
+                if (e.offset < end || e.length > item.originalSize || e.offset > item.originalSize - e.length)
+                    throw std::runtime_error("invalid extent: " + item.relPath);
+                end = e.offset + e.length;
+            }
+        }
         tocOut.push_back(std::move(item));
     }
+}
+
+void pack_toc_read(std::istream& is,
+                   std::vector<TocItem>& tocOut,
+                   std::vector<std::vector<uint8_t>>& blobsOut) {
+    pack_toc_read_index(is, tocOut);
 
     // 根据 toc 读 blobs
     blobsOut.clear();
-    blobsOut.reserve(n);
+    blobsOut.reserve(tocOut.size());
 
     for (const auto& item : tocOut) {
         is.seekg(static_cast<std::streamoff>(item.offset), std::ios::beg);
@@ -1,4 +1,5 @@
 #pragma once
+#include "metadata/metadata.h"
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -7,12 +8,16 @@
 
 namespace pkg {
 
-// TOC 条目：路径 + 原始大小 + offset + storedSize
+// TOC 条目：路径 + 原始大小 + offset + storedSize (+ 原始数据的 XXH64，TOC2/TOC3 才有)
+// 稀疏条目（TOC3）只存储数据区段，blob 与校验和都只覆盖区段内容，按 layout 还原空洞
 struct TocItem {
     std::string relPath;
     uint64_t originalSize = 0;
     uint64_t offset = 0;
     uint64_t storedSize = 0;
+    uint64_t checksum = 0;
+    bool hasChecksum = false;
+    backuprestore::SparseMap layout;
 };
 
 // 算法2：先写所有数据 blob，末尾写 TOC + tocOffset
@@ -20,6 +25,14 @@ void pack_toc_write(std::ostream& os,
                     const std::vector<TocItem>& toc,
                     const std::vector<std::vector<uint8_t>>& blobs);
 
+// 流式写入：调用方已把各 blob 写入 os 并填好 offset/storedSize，这里只写 TOC + tocOffset
+// 有稀疏条目时写 TOC3（每条带标志和区段表），否则所有条目都有校验和时写 TOC2（每条多 8 字节），
+// 再否则写 TOC1
+void pack_toc_write_index(std::ostream& os, const std::vector<TocItem>& toc);
+
+// 只读取 TOC（不读任何 blob），用于列表和随机访问提取；TOC1/TOC2/TOC3 都能读
+void pack_toc_read_index(std::istream& is, std::vector<TocItem>& tocOut);
+
 void pack_toc_read(std::istream& is,
                    std::vector<TocItem>& tocOut,
                    std::vector<std::vector<uint8_t>>& blobsOut);
@@ -1,15 +1,41 @@
 #include "package_export.h"
 #include "binary_io.h"
+#include "compress_lz.h"
 #include "compress_rle.h"
 #include "encrypt_xor.h"
 #include "encrypt_rc4.h"
+#include "encrypt_chacha.h"
+#include "pack_block.h"
 #include "pack_header.h"
 #include "pack_toc.h"
+#include "core/file_utils.h"
+#include "core/stats.h"
+#include "core/thread_pool.h"
+#include "storage/xxhash64.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <exception>
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <random>
+#include <sstream>
 #include <vector>
 #include <stdexcept>
+#include <streambuf>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace pkg {
 
@@ -20,55 +46,616 @@ static std::vector<uint8_t> gen_salt(size_t n = 16) {
     return s;
 }
 
-static std::vector<uint8_t> read_file_all(const std::filesystem::path& p) {
-    std::ifstream ifs(p, std::ios::binary);
-    if (!ifs) throw std::runtime_error("open file failed: " + p.string());
-    ifs.seekg(0, std::ios::end);
-    auto n = ifs.tellg();
-    ifs.seekg(0, std::ios::beg);
-    std::vector<uint8_t> buf(static_cast<size_t>(n));
-    if (n > 0) ifs.read(reinterpret_cast<char*>(buf.data()), n);
-    if (!ifs) throw std::runtime_error("read file failed: " + p.string());
-    return buf;
-}
-
-static void write_file_all(const std::filesystem::path& p, const std::vector<uint8_t>& buf) {
+static void write_file_all(const std::filesystem::path& p, ByteSpan buf) {
     std::filesystem::create_directories(p.parent_path());
     std::ofstream ofs(p, std::ios::binary);
     if (!ofs) throw std::runtime_error("write file failed: " + p.string());
-    if (!buf.empty()) ofs.write(reinterpret_cast<const char*>(buf.data()),
-                                static_cast<std::streamsize>(buf.size()));
+    backuprestore::StatTimer timer(backuprestore::StatPhase::Write, buf.size);
+    if (buf.size > 0) ofs.write(reinterpret_cast<const char*>(buf.data),
+                                static_cast<std::streamsize>(buf.size));
+}
+
+// 按区段表把解码出的数据写到 ofs 中的原偏移：空洞跳过（seekp 越过文件末尾再写即留下空洞），
+// 连续的数据不重复 seekp
+static backuprestore::ExtentMapper::Writer seek_writer(std::ofstream& ofs) {
+    return [&ofs, next = uint64_t(0)](uint64_t offset, const uint8_t* data, size_t n) mutable {
+        backuprestore::StatTimer timer(backuprestore::StatPhase::Write, n);
+        if (offset != next) ofs.seekp(static_cast<std::streamoff>(offset));
+        ofs.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(n));
+        next = offset + n;
+        return static_cast<bool>(ofs);
+    };
+}
+
+// 稀疏条目写完数据区段后补齐文件长度（末尾的空洞）
+static void finish_sparse(const std::filesystem::path& p, const TocItem& item) {
+    if (!item.layout.sparse) return;
+    std::error_code ec;
+    std::filesystem::resize_file(p, item.originalSize, ec);
+    if (ec) throw std::runtime_error("resize file failed: " + p.string() + ": " + ec.message());
+}
+
+// 包文件名为 "-" 时使用的标准输入/输出流缓冲：不支持 seek，可以接管道
+// （如 export repo - | ssh host backup-restore import - repo）
+static constexpr size_t kStdioBuffer = 1 << 20;
+static constexpr int kStdinFd = 0;
+static constexpr int kStdoutFd = 1;
+
+static std::ptrdiff_t fd_write(int fd, const char* p, size_t n) {
+#ifdef _WIN32
+    return _write(fd, p, static_cast<unsigned>(std::min<size_t>(n, 1u << 30)));
+#else
+    return ::write(fd, p, n);
+#endif
+}
+
+static std::ptrdiff_t fd_read(int fd, char* p, size_t n) {
+#ifdef _WIN32
+    return _read(fd, p, static_cast<unsigned>(std::min<size_t>(n, 1u << 30)));
+#else
+    return ::read(fd, p, n);
+#endif
 }
 
+// Windows 的标准输入/输出默认是文本模式（会转换换行符）
+static void set_binary(int fd) {
+#ifdef _WIN32
+    _setmode(fd, _O_BINARY);
+#else
+    (void)fd;
+#endif
+}
+
+class FdOutBuf : public std::streambuf {
+public:
+    explicit FdOutBuf(int fd) : fd_(fd), buf_(kStdioBuffer) {
+        set_binary(fd);
+        reset();
+    }
+    ~FdOutBuf() override { drain(); }
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (!drain()) return traits_type::eof();
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    // 编码后的块等大段数据不经过缓冲区，直接 write
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        if (n < static_cast<std::streamsize>(buf_.size())) return std::streambuf::xsputn(s, n);
+        if (!drain() || !write_all(s, static_cast<size_t>(n))) return 0;
+        return n;
+    }
+
+    int sync() override { return drain() ? 0 : -1; }
+
+private:
+    int fd_;
+    std::vector<char> buf_;
+
+    void reset() { setp(buf_.data(), buf_.data() + buf_.size()); }
+
+    bool drain() {
+        bool ok = write_all(pbase(), static_cast<size_t>(pptr() - pbase()));
+        reset();
+        return ok;
+    }
+
+    bool write_all(const char* p, size_t n) {
+        while (n > 0) {
+            std::ptrdiff_t r = fd_write(fd_, p, n);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) return false;
+            p += r;
+            n -= static_cast<size_t>(r);
+        }
+        return true;
+    }
+};
+
+class FdInBuf : public std::streambuf {
+public:
+    explicit FdInBuf(int fd) : fd_(fd), buf_(kStdioBuffer) {
+        set_binary(fd);
+        setg(buf_.data(), buf_.data(), buf_.data());
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        std::ptrdiff_t r = read_some(buf_.data(), buf_.size());
+        if (r <= 0) return traits_type::eof();
+        setg(buf_.data(), buf_.data(), buf_.data() + r);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    // 先取走缓冲区中剩余的数据，剩下的大段数据直接读到目标缓冲区
+    std::streamsize xsgetn(char* s, std::streamsize n) override {
+        std::streamsize done = std::min<std::streamsize>(n, egptr() - gptr());
+        std::memcpy(s, gptr(), static_cast<size_t>(done));
+        gbump(static_cast<int>(done));
+        while (n - done >= static_cast<std::streamsize>(buf_.size())) {
+            std::ptrdiff_t r = read_some(s + done, static_cast<size_t>(n - done));
+            if (r <= 0) return done;
+            done += r;
+        }
+        if (done < n) done += std::streambuf::xsgetn(s + done, n - done);
+        return done;
+    }
+
+private:
+    int fd_;
+    std::vector<char> buf_;
+
+    std::ptrdiff_t read_some(char* p, size_t n) {
+        for (;;) {
+            std::ptrdiff_t r = fd_read(fd_, p, n);
+            if (r < 0 && errno == EINTR) continue;
+            return r;
+        }
+    }
+};
+
 static std::string to_rel_generic(const std::filesystem::path& base,
                                   const std::filesystem::path& p) {
     auto rel = std::filesystem::relative(p, base);
     return rel.generic_string(); // 强制用 /
 }
 
-static std::vector<uint8_t> apply_compress(const std::vector<uint8_t>& in, CompressAlg alg) {
-    if (alg == CompressAlg::RLE) return rle_compress(in);
-    return in;
-}
-static std::vector<uint8_t> apply_decompress(const std::vector<uint8_t>& in, CompressAlg alg) {
-    if (alg == CompressAlg::RLE) return rle_decompress(in);
-    return in;
-}
-static std::vector<uint8_t> apply_encrypt(const std::vector<uint8_t>& in, EncryptAlg alg,
-                                          const std::string& pw, const std::vector<uint8_t>& salt) {
-    if (alg == EncryptAlg::XOR) return xor_crypt(in, pw, salt);
-    if (alg == EncryptAlg::RC4) return rc4_crypt(in, pw, salt);
-    return in;
+// 按扩展名判断文件本身已经压缩（图片、音视频、压缩包、办公文档等）：v2 导出时这些条目的块不经过压缩器，
+// 也不必逐块采样
+static bool known_compressed(const std::filesystem::path& p) {
+    static const char* const kExts[] = {
+        "jpg", "jpeg", "png", "gif", "webp", "heic", "avif",
+        "mp3", "m4a", "aac", "ogg", "opus", "flac",
+        "mp4", "m4v", "mkv", "mov", "avi", "webm",
+        "zip", "gz", "tgz", "bz2", "xz", "zst", "7z", "rar", "lz4",
+        "jar", "apk", "docx", "xlsx", "pptx", "odt", "sepkg"};
+    std::string ext = p.extension().string();
+    if (ext.size() < 2) return false;
+    ext.erase(0, 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    for (const char* e : kExts) {
+        if (ext == e) return true;
+    }
+    return false;
 }
-static std::vector<uint8_t> apply_decrypt(const std::vector<uint8_t>& in, EncryptAlg alg,
-                                          const std::string& pw, const std::vector<uint8_t>& salt) {
-    // XOR/RC4 都是对称加密：同一个函数
-    return apply_encrypt(in, alg, pw, salt);
+
+// v1 整体读入的条目：就地解密 payload，需要解压时解压到 scratch，返回原始数据（指向 payload 或 scratch）
+// nonce 为条目序号（只有 ChaCha20 使用；XOR/RC4 每个条目都从同一状态开始）
+// rawSize 为条目记录的原始数据长度，RLE 据此一次分配 scratch
+static ByteSpan decode_entry(std::vector<uint8_t>& payload, CompressAlg alg, const PackageKey& key,
+                             uint64_t nonce, uint64_t rawSize, std::vector<uint8_t>& scratch) {
+    if (key.enc != EncryptAlg::None) {
+        // XOR/RC4/ChaCha20 都是对称加密：与加密相同的函数
+        backuprestore::StatTimer timer(backuprestore::StatPhase::Encrypt, payload.size());
+        if (key.enc == EncryptAlg::XOR) xor_crypt(payload, payload.data(), key.password, key.salt);
+        if (key.enc == EncryptAlg::RC4) rc4_crypt(payload, payload.data(), key.password, key.salt);
+        if (key.enc == EncryptAlg::ChaCha20) chacha_crypt(payload, payload.data(), key.chacha, nonce);
+    }
+    if (alg != CompressAlg::RLE && alg != CompressAlg::LZ) return payload;
+    backuprestore::StatTimer timer(backuprestore::StatPhase::Compress, payload.size());
+    if (alg == CompressAlg::RLE) {
+        rle_decompress(payload, scratch, static_cast<size_t>(rawSize));
+    } else {
+        LzDecoder lz;
+        scratch.clear();
+        lz.update(payload.data(), payload.size(), scratch);
+        lz.finish();
+    }
+    return scratch;
 }
 
 // 文件头： "SEXP01"(6) + ver(u8) + pack(u8) + comp(u8) + enc(u8) + saltLen(u32) + saltBytes
 static const char MAGIC[6] = {'S','E','X','P','0','1'};
 
+// 流式编码单个条目：压缩 -> 加密，RLE/LZ/XOR/RC4/ChaCha20 的状态跨块保留，
+// 因此分块输出与整体编码逐字节相同，import 端无需区分
+class EntryEncoder {
+public:
+    // lz: CompressAlg::LZ 时使用的编码器；finish 后可复用，由调用方跨条目共享
+    // nonce: 条目序号，作为 ChaCha20 的 nonce
+    EntryEncoder(CompressAlg comp, LzEncoder* lz, const PackageKey& key, uint64_t nonce)
+        : comp_(comp), lz_(comp == CompressAlg::LZ ? lz : nullptr) {
+        if (key.enc == EncryptAlg::XOR) xor_.emplace(key.password, key.salt);
+        if (key.enc == EncryptAlg::RC4) rc4_.emplace(key.password, key.salt);
+        if (key.enc == EncryptAlg::ChaCha20) chacha_.emplace(key.chacha, nonce);
+    }
+
+    // 编码一块输入；不压缩时原地加密 buf 并直接返回它，否则结果写入 scratch
+    const std::vector<uint8_t>& update(std::vector<uint8_t>& buf, size_t n,
+                                       std::vector<uint8_t>& scratch) {
+        if (comp_ == CompressAlg::None) {
+            buf.resize(n);
+            encrypt(buf);
+            return buf;
+        }
+        scratch.clear();
+        {
+            backuprestore::StatTimer timer(backuprestore::StatPhase::Compress, n);
+            if (lz_) lz_->update(buf.data(), n, scratch);
+            else rle_.update(buf.data(), n, scratch);
+        }
+        encrypt(scratch);
+        return scratch;
+    }
+
+    // 编码一块只读输入（如 mmap 的区域）：结果写入 scratch；不压缩也不加密时直接返回输入本身
+    ByteSpan update(ByteSpan in, std::vector<uint8_t>& scratch) {
+        if (comp_ == CompressAlg::None) {
+            if (!encrypting()) return in;
+            scratch.resize(in.size);
+            encrypt(in.data, scratch.data(), in.size);
+            return scratch;
+        }
+        scratch.clear();
+        {
+            backuprestore::StatTimer timer(backuprestore::StatPhase::Compress, in.size);
+            if (lz_) lz_->update(in.data, in.size, scratch);
+            else rle_.update(in.data, in.size, scratch);
+        }
+        encrypt(scratch);
+        return scratch;
+    }
+
+    // 结束条目，输出压缩器中剩余的数据
+    const std::vector<uint8_t>& finish(std::vector<uint8_t>& scratch) {
+        scratch.clear();
+        if (comp_ != CompressAlg::None) {
+            backuprestore::StatTimer timer(backuprestore::StatPhase::Compress);
+            if (lz_) lz_->finish(scratch);
+            else rle_.finish(scratch);
+        }
+        encrypt(scratch);
+        return scratch;
+    }
+
+private:
+    CompressAlg comp_;
+    RleEncoder rle_;
+    LzEncoder* lz_;
+    std::optional<XorStream> xor_;
+    std::optional<Rc4Stream> rc4_;
+    std::optional<ChaChaStream> chacha_;
+
+    bool encrypting() const { return xor_ || rc4_ || chacha_; }
+
+    void encrypt(std::vector<uint8_t>& buf) {
+        encrypt(buf.data(), buf.data(), buf.size());
+    }
+
+    void encrypt(const uint8_t* in, uint8_t* out, size_t n) {
+        if (!encrypting()) return;
+        backuprestore::StatTimer timer(backuprestore::StatPhase::Encrypt, n);
+        if (xor_) xor_->process(in, out, n);
+        if (rc4_) rc4_->process(in, out, n);
+        if (chacha_) chacha_->process(in, out, n);
+    }
+};
+
+// 以 bufferSize 为单位读取已打开文件的数据区段、编码并写入 os，返回写入的字节数（storedSize）
+// hasher 非空时顺带计算原始数据的 XXH64
+static uint64_t stream_entry(backuprestore::ExtentReader& reader, const std::filesystem::path& p,
+                             std::ostream& os, EntryEncoder& enc,
+                             std::vector<uint8_t>& buf, std::vector<uint8_t>& scratch,
+                             size_t bufferSize, backuprestore::Xxh64* hasher = nullptr) {
+    uint64_t stored = 0;
+    uint64_t remaining = reader.layout().dataLength(reader.size());
+    while (remaining > 0) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(remaining, bufferSize));
+        buf.resize(n);
+        if (reader.read(buf.data(), n) != static_cast<int64_t>(n))
+            throw std::runtime_error("file changed during export: " + p.string());
+        remaining -= n;
+        if (hasher) hasher->update(buf.data(), n);
+
+        const auto& out = enc.update(buf, n, scratch);
+        write_bytes(os, out);
+        stored += out.size();
+    }
+
+    const auto& tail = enc.finish(scratch);
+    write_bytes(os, tail);
+    stored += tail.size();
+
+    if (!os) throw std::runtime_error("write package failed");
+    return stored;
+}
+
+// 不小于该大小的稠密文件用 mmap 读取
+static constexpr uint64_t kMapThreshold = 1024 * 1024;
+
+// reader 已打开 p：大的稠密文件映射到 map 并返回 true，之后直接按映射区编码
+static bool map_input(const backuprestore::ExtentReader& reader, const std::filesystem::path& p,
+                      backuprestore::MappedFile& map) {
+    if (reader.layout().sparse || reader.size() < kMapThreshold || !map.open(p)) return false;
+    if (map.size() != reader.size()) throw std::runtime_error("file changed during export: " + p.string());
+    return true;
+}
+
+// stream_entry 的 mmap 版本：按 bufferSize 切片直接交给编码器，不经过读缓冲区；
+// 不压缩也不加密时映射区的数据直接写入 os
+static uint64_t stream_mapped(const backuprestore::MappedFile& map, std::ostream& os, EntryEncoder& enc,
+                              std::vector<uint8_t>& scratch, size_t bufferSize,
+                              backuprestore::Xxh64* hasher = nullptr) {
+    uint64_t stored = 0;
+    for (uint64_t off = 0; off < map.size();) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(map.size() - off, bufferSize));
+        ByteSpan in(map.data() + off, n);
+        off += n;
+        if (hasher) hasher->update(in.data, in.size);
+
+        ByteSpan out = enc.update(in, scratch);
+        write_bytes(os, out);
+        stored += out.size;
+    }
+
+    const auto& tail = enc.finish(scratch);
+    write_bytes(os, tail);
+    stored += tail.size();
+
+    if (!os) throw std::runtime_error("write package failed");
+    return stored;
+}
+
+// v1：整个条目作为一个流编码，一次只处理一个文件的一个缓冲块，内存占用与仓库大小无关
+// 压缩条目的 storedSize 在数据写完后回填，输出须可 seek（写到管道时由调用方拒绝）
+static void export_stream(const std::vector<std::filesystem::path>& files,
+                          const std::filesystem::path& repoDir,
+                          std::ostream& os, const Options& opt,
+                          const PackageKey& key,
+                          std::vector<TocItem>& toc) {
+    std::vector<uint8_t> buf;
+    std::vector<uint8_t> scratch;
+    buf.reserve(opt.bufferSize);
+
+    // LZ 编码器内含块缓冲和哈希表，所有条目共用一个
+    std::optional<LzEncoder> lz;
+    if (opt.compressAlg == CompressAlg::LZ) lz.emplace(opt.compressLevel);
+
+    // 只有 TOC 能记录区段表，header 布局按稠密文件读取
+    const bool holes = (opt.packAlg == PackAlg::TocAtEnd);
+    backuprestore::ExtentReader reader;
+    backuprestore::MappedFile map;
+    for (size_t i = 0; i < files.size(); ++i) {
+        const auto& abs = files[i];
+        std::string relPath = to_rel_generic(repoDir, abs);
+        if (!reader.open(abs, holes)) throw std::runtime_error("open file failed: " + abs.string());
+        uint64_t originalSize = reader.size();
+        EntryEncoder enc(opt.compressAlg, lz ? &*lz : nullptr, key, i);
+        const bool mapped = map_input(reader, abs, map);
+        auto stream = [&](std::ostream& out, backuprestore::Xxh64* hasher) {
+            return mapped ? stream_mapped(map, out, enc, scratch, opt.bufferSize, hasher)
+                          : stream_entry(reader, abs, out, enc, buf, scratch, opt.bufferSize, hasher);
+        };
+
+        if (opt.packAlg == PackAlg::HeaderPerFile) {
+            // 不压缩时 storedSize 等于原始大小，可以直接写；否则写完数据后回填
+            bool sizeKnown = (opt.compressAlg == CompressAlg::None);
+            auto pos = pack_header_write_entry(os, relPath, originalSize, sizeKnown ? originalSize : 0);
+            uint64_t stored = stream(os, nullptr);
+            if (!sizeKnown) pack_header_patch_stored(os, pos, stored);
+        } else {
+            TocItem t;
+            t.relPath = std::move(relPath);
+            t.originalSize = originalSize;
+            t.offset = static_cast<uint64_t>(os.tellp());
+            backuprestore::Xxh64 hasher;
+            t.storedSize = stream(os, &hasher);
+            t.checksum = hasher.digest();
+            t.hasChecksum = true;
+            t.layout = reader.layout();
+            toc.push_back(std::move(t));
+        }
+        map.close();
+    }
+}
+
+// v2 分块导出中的一个块
+struct EncodeJob {
+    size_t entry = 0;
+    uint32_t block = 0;
+    bool first = false;
+    bool last = false;
+    bool skipCompress = false; // 条目按扩展名已知不可压缩
+    ByteSpan input;            // 块的原始数据：指向 raw，或指向 map 中的对应区域
+    std::vector<uint8_t> raw;
+    std::shared_ptr<const backuprestore::MappedFile> map;  // 大文件的映射，最后一个引用它的块写出后解除
+    std::vector<uint8_t> out;  // 编码后的块（含块头）；空文件只有一个 input/out 都为空的任务
+    std::string error;         // 线程池会吞掉异常，编码错误记录在这里由写出线程抛出
+};
+
+// 在线程池上处理 [0, n)；pool 为空时在当前线程执行
+static void run_batch(backuprestore::ThreadPool* pool, size_t n, const std::function<void(size_t)>& fn) {
+    if (!pool || n <= 1) {
+        for (size_t i = 0; i < n; ++i) fn(i);
+        return;
+    }
+    for (size_t i = 0; i < n; ++i) pool->submit([&fn, i] { fn(i); });
+    pool->wait();
+}
+
+static size_t resolve_jobs(size_t jobs) {
+    return jobs == 0 ? backuprestore::ThreadPool::defaultThreads() : jobs;
+}
+
+// v2 不压缩时条目的 storedSize：每个块为块头 + 原始数据，写数据之前即可确定
+static uint64_t plain_blocks_size(uint64_t size, size_t blockSize) {
+    uint64_t blocks = (size + blockSize - 1) / blockSize;
+    return size + blocks * kBlockHeaderSize;
+}
+
+// v2：按 blockSize 切块，每批最多 jobs*4 个块（可跨条目）并行编码后按顺序写出
+// 读取与写出双缓冲：一个后台线程读取下一批的同时，当前批在线程池上编码并写出，
+// 磁盘读取与写出（如写入管道再经网络发送）互相重叠
+// 内存占用约为 2*jobs*4 个块（原始 + 编码后），与文件大小无关；
+// seekable 为 false（管道）且压缩时，条目头部的 storedSize 写为 kUnknownStoredSize，块照常边编码边写出
+static void export_blocks(const std::vector<std::filesystem::path>& files,
+                          const std::filesystem::path& repoDir,
+                          std::ostream& os, const Options& opt,
+                          const PackageKey& key,
+                          std::vector<TocItem>& toc, bool seekable) {
+    const size_t jobs = resolve_jobs(opt.jobs);
+    const size_t batchSize = jobs * 4;
+    std::vector<EncodeJob> batches[2] = {std::vector<EncodeJob>(batchSize), std::vector<EncodeJob>(batchSize)};
+    std::optional<backuprestore::ThreadPool> pool;
+    if (jobs > 1) pool.emplace(jobs);
+    const auto codec = make_block_codec(opt.compressAlg, opt.compressLevel, key);
+
+    // 读取状态：当前正在切块的文件；只有 TOC 能记录区段表，header 布局按稠密文件读取
+    // 只由 fill 访问，同一时刻只有一个 fill 在运行
+    const bool holes = (opt.packAlg == PackAlg::TocAtEnd);
+    size_t nextFile = 0;
+    backuprestore::ExtentReader reader;
+    std::shared_ptr<backuprestore::MappedFile> mapped;  // 当前文件的映射（小文件或稀疏文件为空）
+    bool reading = false;
+    uint64_t remaining = 0;
+    uint64_t mapPos = 0;
+    uint32_t blockIdx = 0;
+    bool skipCompress = false;
+    std::vector<uint64_t> sizes(files.size());
+    std::vector<backuprestore::SparseMap> layouts(holes ? files.size() : 0);
+
+    // 读取一批块到 batch，返回块数；读完所有文件后返回 0
+    auto fill = [&](std::vector<EncodeJob>& batch) {
+        size_t n = 0;
+        while (n < batchSize && (reading || nextFile < files.size())) {
+            if (!reading) {
+                const auto& p = files[nextFile];
+                if (!reader.open(p, holes)) throw std::runtime_error("open file failed: " + p.string());
+                sizes[nextFile] = reader.size();
+                remaining = reader.layout().dataLength(reader.size());
+                if (holes) layouts[nextFile] = reader.layout();
+                mapped = std::make_shared<backuprestore::MappedFile>();
+                if (!map_input(reader, p, *mapped)) mapped.reset();
+                mapPos = 0;
+                blockIdx = 0;
+                skipCompress = opt.compressAlg != CompressAlg::None && known_compressed(p);
+                reading = true;
+            }
+
+            EncodeJob& j = batch[n++];
+            size_t len = static_cast<size_t>(std::min<uint64_t>(remaining, opt.blockSize));
+            j.entry = nextFile;
+            j.block = blockIdx++;
+            j.first = (j.block == 0);
+            j.skipCompress = skipCompress;
+            j.map = mapped;
+            if (mapped) {
+                // 映射区在编码时才被访问：先让内核开始预读
+                mapped->prefetch(mapPos, len);
+                j.input = ByteSpan(mapped->data() + mapPos, len);
+                mapPos += len;
+            } else {
+                j.raw.resize(len);
+                if (len > 0 && reader.read(j.raw.data(), len) != static_cast<int64_t>(len))
+                    throw std::runtime_error("file changed during export: " + files[nextFile].string());
+                j.input = j.raw;
+            }
+            remaining -= len;
+            j.last = (remaining == 0);
+            if (j.last) {
+                reading = false;
+                mapped.reset();
+                ++nextFile;
+            }
+        }
+        return n;
+    };
+
+    // 写出状态：当前正在写的条目
+    std::streampos patchPos;
+    TocItem cur;
+    backuprestore::Xxh64 hasher;
+
+    // 预读线程：最后声明，当前批抛出异常时最先析构（等待正在运行的 fill 结束）
+    // 线程池会吞掉异常，fill 的错误记录在 prefetchError 中，等待它结束后由这里抛出
+    size_t nextN = 0;
+    std::exception_ptr prefetchError;
+    backuprestore::ThreadPool prefetcher(1);
+
+    size_t cur_batch = 0;
+    size_t n = fill(batches[cur_batch]);
+    while (n > 0) {
+        prefetcher.submit([&, b = cur_batch ^ 1] {
+            try {
+                nextN = fill(batches[b]);
+            } catch (...) {
+                prefetchError = std::current_exception();
+            }
+        });
+
+        std::vector<EncodeJob>& batch = batches[cur_batch];
+        run_batch(pool ? &*pool : nullptr, n, [&](size_t k) {
+            EncodeJob& j = batch[k];
+            j.out.clear();
+            j.error.clear();
+            if (j.input.size == 0) return;
+            try {
+                codec->encode(j.input.data, j.input.size,
+                              block_nonce(static_cast<uint32_t>(j.entry), j.block), j.out, j.skipCompress);
+            } catch (const std::exception& e) {
+                j.error = e.what();
+            }
+        });
+
+        for (size_t k = 0; k < n; ++k) {
+            EncodeJob& j = batch[k];
+            if (!j.error.empty())
+                throw std::runtime_error("encode failed: " + files[j.entry].string() + ": " + j.error);
+            if (j.first) {
+                cur = TocItem{};
+                cur.relPath = to_rel_generic(repoDir, files[j.entry]);
+                cur.originalSize = sizes[j.entry];
+                if (opt.packAlg == PackAlg::HeaderPerFile) {
+                    if (seekable) {
+                        patchPos = pack_header_write_entry(os, cur.relPath, cur.originalSize, 0);
+                    } else if (opt.compressAlg == CompressAlg::None) {
+                        pack_header_write_entry(os, cur.relPath, cur.originalSize,
+                                                plain_blocks_size(cur.originalSize, opt.blockSize));
+                    } else {
+                        pack_header_write_entry(os, cur.relPath, cur.originalSize, kUnknownStoredSize);
+                    }
+                } else {
+                    cur.offset = static_cast<uint64_t>(os.tellp());
+                }
+                hasher = backuprestore::Xxh64();
+            }
+            write_bytes(os, j.out);
+            cur.storedSize += j.out.size();
+            // 块按顺序写出，原始数据在这里顺序喂给校验和
+            if (opt.packAlg == PackAlg::TocAtEnd) hasher.update(j.input.data, j.input.size);
+            j.map.reset();
+            if (j.last) {
+                if (opt.packAlg == PackAlg::HeaderPerFile) {
+                    if (seekable) {
+                        pack_header_patch_stored(os, patchPos, cur.storedSize);
+                    } else if (opt.compressAlg == CompressAlg::None &&
+                               cur.storedSize != plain_blocks_size(cur.originalSize, opt.blockSize)) {
+                        throw std::runtime_error("file changed during export: " + files[j.entry].string());
+                    }
+                } else {
+                    cur.checksum = hasher.digest();
+                    cur.hasChecksum = true;
+                    cur.layout = std::move(layouts[j.entry]);
+                    toc.push_back(std::move(cur));
+                }
+            }
+        }
+        if (!os) throw std::runtime_error("write package failed");
+
+        prefetcher.wait();
+        if (prefetchError) std::rethrow_exception(prefetchError);
+        n = nextN;
+        cur_batch ^= 1;
+    }
+}
+
 bool export_repo_to_package(const std::filesystem::path& repoDir,
                             const std::filesystem::path& packageFile,
                             const Options& opt) {
@@ -78,10 +665,25 @@ bool export_repo_to_package(const std::filesystem::path& repoDir,
     if (opt.encryptAlg != EncryptAlg::None && opt.password.empty())
         throw std::runtime_error("encrypt enabled but password is empty");
 
+    if (opt.bufferSize == 0)
+        throw std::runtime_error("bufferSize must be positive");
+
+    if (opt.blockSize > kMaxBlockSize)
+        throw std::runtime_error("blockSize too large");
+
+    // 写到标准输出时不能 seek：TOC 布局的导入需要先读末尾的目录，只支持 header 布局
+    const bool toStdout = is_stdio_path(packageFile);
+    if (toStdout && opt.packAlg != PackAlg::HeaderPerFile)
+        throw std::runtime_error("writing to stdout requires the header layout");
+    // v1 条目没有块边界，压缩后的大小只能写完再回填
+    if (toStdout && opt.blockSize == 0 && opt.compressAlg != CompressAlg::None)
+        throw std::runtime_error("writing a compressed v1 package to stdout is not supported (use --block-size > 0)");
+
     auto salt = (opt.encryptAlg == EncryptAlg::None) ? std::vector<uint8_t>{} : gen_salt(16);
+    const PackageKey key = make_package_key(opt.encryptAlg, opt.password, salt);
 
-    // 收集 repoDir 下所有普通文件（包含 index.txt / data/...）
-    std::vector<Entry> entries;
+    // 收集 repoDir 下所有普通文件（包含 index / data/...），只保存路径，不读内容
+    std::vector<std::filesystem::path> files;
     for (auto& it : std::filesystem::recursive_directory_iterator(repoDir)) {
         if (!it.is_regular_file()) continue;
 
@@ -90,96 +692,702 @@ bool export_repo_to_package(const std::filesystem::path& repoDir,
         // 避免把输出包自己又打进去（如果你把包输出到 repoDir 里）
         // ⚠️ 注意：std::filesystem::equivalent 要求两个路径都存在，否则会抛异常
         try {
-            if (std::filesystem::exists(packageFile) && std::filesystem::equivalent(abs, packageFile)) {
+            if (!toStdout && std::filesystem::exists(packageFile) && std::filesystem::equivalent(abs, packageFile)) {
                 continue;
             }
         } catch (...) {
             // 忽略等价性检查错误（比如 packageFile 尚未创建时）
         }
 
-        auto raw = read_file_all(abs);
+        files.push_back(std::move(abs));
+    }
+    if (files.size() > UINT32_MAX) throw std::runtime_error("too many files");
 
-        Entry e;
-        e.relPath = to_rel_generic(repoDir, abs);
-        e.originalSize = static_cast<uint64_t>(raw.size());
+    std::ofstream file;
+    std::optional<FdOutBuf> pipe;
+    if (toStdout) {
+        pipe.emplace(kStdoutFd);
+    } else {
+        file.open(packageFile, std::ios::binary);
+        if (!file) throw std::runtime_error("cannot create package file: " + packageFile.string());
+    }
+    std::ostream os(toStdout ? static_cast<std::streambuf*>(&*pipe) : file.rdbuf());
 
-        auto c = apply_compress(raw, opt.compressAlg);
-        auto enc = apply_encrypt(c, opt.encryptAlg, opt.password, salt);
+    // 写头：压缩的分块包中可能有原样存储的块（块头带 kBlockRawFlag），写为 v3，旧版本会拒绝读取
+    const bool blocked = (opt.blockSize > 0);
+    const uint8_t version = !blocked ? 1 : opt.compressAlg != CompressAlg::None ? 3 : 2;
+    ByteWriter hw(64);
+    hw.bytes(MAGIC, 6);
+    hw.u8(version);
+    hw.u8(static_cast<uint8_t>(opt.packAlg));
+    hw.u8(static_cast<uint8_t>(opt.compressAlg));
+    hw.u8(static_cast<uint8_t>(opt.encryptAlg));
+    hw.le<uint32_t>(static_cast<uint32_t>(salt.size()));
+    hw.bytes(salt);
+    if (blocked) hw.le<uint32_t>(static_cast<uint32_t>(opt.blockSize));
+    hw.flush(os);
 
-        e.payload = std::move(enc);
-        entries.push_back(std::move(e));
+    std::vector<TocItem> toc;
+    if (opt.packAlg == PackAlg::HeaderPerFile) {
+        pack_header_write_count(os, static_cast<uint32_t>(files.size()));
+    } else {
+        toc.reserve(files.size());
     }
 
-    std::ofstream os(packageFile, std::ios::binary);
-    if (!os) throw std::runtime_error("cannot create package file: " + packageFile.string());
+    if (blocked) {
+        export_blocks(files, repoDir, os, opt, key, toc, !toStdout);
+    } else {
+        export_stream(files, repoDir, os, opt, key, toc);
+    }
 
-    // 写头
-    os.write(MAGIC, 6);
-    write_u8(os, 1); // version
-    write_u8(os, static_cast<uint8_t>(opt.packAlg));
-    write_u8(os, static_cast<uint8_t>(opt.compressAlg));
-    write_u8(os, static_cast<uint8_t>(opt.encryptAlg));
-    write_le<uint32_t>(os, static_cast<uint32_t>(salt.size()));
-    write_bytes(os, salt);
+    if (opt.packAlg == PackAlg::TocAtEnd) {
+        pack_toc_write_index(os, toc);
+    }
+    os.flush();
 
-    // 写包体
-    if (opt.packAlg == PackAlg::HeaderPerFile) {
-        pack_header_write(os, entries);
+    if (!os) throw std::runtime_error("write package failed: " + packageFile.string());
+    return true;
+}
+
+// 包头信息（magic 之后的字段）
+struct PackageHeader {
+    uint8_t version = 0;
+    PackAlg packAlg = PackAlg::HeaderPerFile;
+    CompressAlg compAlg = CompressAlg::None;
+    EncryptAlg encAlg = EncryptAlg::None;
+    std::vector<uint8_t> salt;
+    uint32_t blockSize = 0;  // v2/v3 才有：分块大小
+};
+
+static PackageHeader read_package_header(std::istream& is) {
+    // 定长部分：magic(6) + version + packAlg + compAlg + encAlg + saltLen(u32)
+    std::vector<uint8_t> buf = read_bytes(is, 14);
+    ByteReader r(buf);
+    if (std::memcmp(r.bytes(6).data, MAGIC, 6) != 0)
+        throw std::runtime_error("magic mismatch");
+
+    PackageHeader h;
+    h.version = r.le_unchecked<uint8_t>();
+    if (h.version < 1 || h.version > 3)
+        throw std::runtime_error("unsupported package version: " + std::to_string(h.version));
+    h.packAlg = static_cast<PackAlg>(r.le_unchecked<uint8_t>());
+    h.compAlg = static_cast<CompressAlg>(r.le_unchecked<uint8_t>());
+    h.encAlg = static_cast<EncryptAlg>(r.le_unchecked<uint8_t>());
+    if (static_cast<uint8_t>(h.encAlg) > static_cast<uint8_t>(EncryptAlg::ChaCha20))
+        throw std::runtime_error("unsupported encryption algorithm");
+
+    uint32_t saltLen = r.le_unchecked<uint32_t>();
+    if (saltLen > 4096) throw std::runtime_error("invalid salt length");
+    h.salt = read_bytes(is, saltLen);
+    if (h.version >= 2) {
+        read_into(is, buf, 4);
+        h.blockSize = load_le<uint32_t>(buf.data());
+        if (h.blockSize == 0 || h.blockSize > kMaxBlockSize)
+            throw std::runtime_error("invalid block size");
+    }
+    return h;
+}
+
+// 大小未知（kUnknownStoredSize）的条目中的块：原始长度须为正且不超过条目剩余的原始数据，
+// 否则无法确定条目在哪里结束
+static void check_streamed_block(const BlockHeader& bh, uint64_t rawLeft, const PackageHeader& h) {
+    if (bh.rawLen == 0 || bh.rawLen > rawLeft || bh.rawLen > h.blockSize || bh.storedLen > kMaxBlockSize)
+        throw std::runtime_error("invalid block length");
+}
+
+// 大小未知的分块条目：逐个读取块头并跳过块数据，直到原始长度累计到 originalSize，返回条目的 storedSize
+static uint64_t measure_blocks(std::istream& is, const TocItem& item, const PackageHeader& h) {
+    uint64_t stored = 0;
+    uint8_t hb[kBlockHeaderSize];
+    for (uint64_t rawLeft = item.originalSize; rawLeft > 0;) {
+        is.read(reinterpret_cast<char*>(hb), kBlockHeaderSize);
+        if (!is) throw std::runtime_error("header scan: truncated package");
+        const BlockHeader bh = block_parse_header(hb);
+        check_streamed_block(bh, rawLeft, h);
+        is.seekg(static_cast<std::streamoff>(bh.storedLen), std::ios::cur);
+        stored += kBlockHeaderSize + bh.storedLen;
+        rawLeft -= bh.rawLen;
+    }
+    return stored;
+}
+
+// 只读取条目目录：TOC 布局直接读末尾 TOC，header 布局逐条读头部并跳过数据
+static std::vector<TocItem> read_package_index(std::istream& is, const PackageHeader& h) {
+    std::vector<TocItem> items;
+    if (h.packAlg == PackAlg::HeaderPerFile) {
+        StoredSizeFn measure;
+        if (h.version >= 2) {
+            measure = [&h](std::istream& in, const TocItem& item) { return measure_blocks(in, item, h); };
+        }
+        items = pack_header_scan(is, measure);
     } else {
-        std::vector<TocItem> toc;
-        std::vector<std::vector<uint8_t>> blobs;
-        toc.reserve(entries.size());
-        blobs.reserve(entries.size());
+        pack_toc_read_index(is, items);
+    }
+    return items;
+}
 
-        for (auto& e : entries) {
-            TocItem t;
-            t.relPath = e.relPath;
-            t.originalSize = e.originalSize;
+// 按偏移读取包文件：POSIX 下用 pread（不共享文件位置），其它平台用 seekg + read
+class PackageReader {
+public:
+    explicit PackageReader(const std::filesystem::path& p) {
+#ifdef _WIN32
+        ifs_.open(p, std::ios::binary);
+        if (!ifs_) throw std::runtime_error("cannot open package file: " + p.string());
+#else
+        fd_ = ::open(p.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0) throw std::runtime_error("cannot open package file: " + p.string());
+#endif
+    }
 
-            toc.push_back(std::move(t));
-            blobs.push_back(std::move(e.payload));
+    ~PackageReader() {
+#ifndef _WIN32
+        if (fd_ >= 0) ::close(fd_);
+#endif
+    }
+
+    PackageReader(const PackageReader&) = delete;
+    PackageReader& operator=(const PackageReader&) = delete;
+
+    void readAt(uint64_t offset, uint8_t* dst, size_t n) {
+        backuprestore::StatTimer timer(backuprestore::StatPhase::Read, n);
+#ifdef _WIN32
+        ifs_.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+        ifs_.read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>(n));
+        if (!ifs_) throw std::runtime_error("read package failed");
+#else
+        while (n > 0) {
+            ssize_t r = ::pread(fd_, dst, n, static_cast<off_t>(offset));
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) throw std::runtime_error("read package failed");
+            dst += r;
+            offset += static_cast<uint64_t>(r);
+            n -= static_cast<size_t>(r);
         }
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    std::ifstream ifs_;
+#else
+    int fd_ = -1;
+#endif
+};
+
+// 解码单个条目并写到 outPath：以 bufferSize 为单位读取，解密/解压状态跨块保留
+// index 为条目在包中的序号（ChaCha20 的 nonce）
+static void extract_entry(PackageReader& reader, const TocItem& item, size_t index,
+                          const PackageHeader& h, const PackageKey& key,
+                          const std::filesystem::path& outPath, size_t bufferSize) {
+    std::optional<XorStream> xs;
+    std::optional<Rc4Stream> rc4;
+    std::optional<ChaChaStream> chacha;
+    if (key.enc == EncryptAlg::XOR) xs.emplace(key.password, key.salt);
+    if (key.enc == EncryptAlg::RC4) rc4.emplace(key.password, key.salt);
+    if (key.enc == EncryptAlg::ChaCha20) chacha.emplace(key.chacha, index);
+    RleDecoder rle;
+    LzDecoder lz;
+
+    std::filesystem::create_directories(outPath.parent_path());
+    std::ofstream ofs(outPath, std::ios::binary | std::ios::trunc);
+    if (!ofs) throw std::runtime_error("write file failed: " + outPath.string());
 
-        pack_toc_write(os, toc, blobs);
+    backuprestore::ExtentMapper mapper(item.layout, seek_writer(ofs));
+    std::vector<uint8_t> buf;
+    std::vector<uint8_t> raw;
+    uint64_t written = 0;
+    backuprestore::Xxh64 hasher;
+    for (uint64_t done = 0; done < item.storedSize;) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(item.storedSize - done, bufferSize));
+        buf.resize(n);
+        reader.readAt(item.offset + done, buf.data(), n);
+        done += n;
+
+        if (xs || rc4 || chacha) {
+            backuprestore::StatTimer timer(backuprestore::StatPhase::Encrypt, n);
+            if (xs) xs->process(buf.data(), n);
+            if (rc4) rc4->process(buf.data(), n);
+            if (chacha) chacha->process(buf.data(), n);
+        }
+
+        const std::vector<uint8_t>* out = &buf;
+        if (h.compAlg == CompressAlg::RLE || h.compAlg == CompressAlg::LZ) {
+            backuprestore::StatTimer timer(backuprestore::StatPhase::Compress, n);
+            raw.clear();
+            if (h.compAlg == CompressAlg::LZ) lz.update(buf.data(), n, raw);
+            else rle.update(buf.data(), n, raw);
+            out = &raw;
+        }
+        if (!mapper(out->data(), out->size()))
+            throw std::runtime_error(ofs ? "data exceeds extents: " + item.relPath
+                                         : "write file failed: " + outPath.string());
+        if (item.hasChecksum) hasher.update(out->data(), out->size());
+        written += out->size();
     }
+    if (h.compAlg == CompressAlg::RLE) rle.finish();
+    if (h.compAlg == CompressAlg::LZ) lz.finish();
 
-    return true;
+    ofs.close();
+    if (!ofs) throw std::runtime_error("write file failed: " + outPath.string());
+    if (written != item.layout.dataLength(item.originalSize))
+        throw std::runtime_error("size mismatch: " + item.relPath);
+    if (item.hasChecksum && hasher.digest() != item.checksum)
+        throw std::runtime_error("checksum mismatch: " + item.relPath);
+    finish_sparse(outPath, item);
 }
 
-bool import_package_to_repo(const std::filesystem::path& packageFile,
-                            const std::filesystem::path& repoDir,
-                            const std::string& password) {
+// extract_blocks 的数据来源：依次给出待提取的条目，并读取条目数据中 pos 处的 n 字节
+// 同一条目内 pos 只增不减；条目出错时可能不读完它的数据就转到下一个
+class EntrySource {
+public:
+    virtual ~EntrySource() = default;
+
+    // 第 i 个条目（i 从 0 依次递增），没有更多条目时返回 nullptr；指针在提取结束前有效
+    virtual const TocItem* entry(size_t i) = 0;
+
+    virtual void read(const TocItem& item, uint64_t pos, uint8_t* dst, size_t n) = 0;
+};
+
+// 包文件中已列出的条目：按 offset 用 pread 读取
+class SelectedEntries : public EntrySource {
+public:
+    SelectedEntries(PackageReader& reader, const std::vector<const TocItem*>& items)
+        : reader_(reader), items_(items) {}
+
+    const TocItem* entry(size_t i) override { return i < items_.size() ? items_[i] : nullptr; }
+
+    void read(const TocItem& item, uint64_t pos, uint8_t* dst, size_t n) override {
+        reader_.readAt(item.offset + pos, dst, n);
+    }
+
+private:
+    PackageReader& reader_;
+    const std::vector<const TocItem*>& items_;
+};
+
+// 顺序读取的 header 布局包（如标准输入）：读到一个条目时才解析它的头部，
+// 转到下一个条目前丢弃上一个条目未读完的数据
+// 大小未知（kUnknownStoredSize）的条目没有可丢弃的长度：extract_blocks 总是按块读完它们
+class StreamEntries : public EntrySource {
+public:
+    explicit StreamEntries(std::istream& is) : is_(is), count_(pack_header_read_count(is)) {}
+
+    const TocItem* entry(size_t i) override {
+        if (i >= count_) return nullptr;
+        while (items_.size() <= i) {
+            if (!items_.empty() && items_.back().storedSize != kUnknownStoredSize)
+                skip(items_.back().storedSize - consumed_);
+            items_.push_back(pack_header_read_entry(is_, buf_));
+            consumed_ = 0;
+        }
+        return &items_[i];
+    }
+
+    void read(const TocItem& item, uint64_t pos, uint8_t* dst, size_t n) override {
+        if (&item != &items_.back() || pos != consumed_ ||
+            (item.storedSize != kUnknownStoredSize && n > item.storedSize - consumed_))
+            throw std::runtime_error("stream read out of order");
+        backuprestore::StatTimer timer(backuprestore::StatPhase::Read, n);
+        is_.read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>(n));
+        if (!is_) throw std::runtime_error("read: unexpected end of file");
+        consumed_ += n;
+    }
+
+private:
+    std::istream& is_;
+    uint32_t count_;
+    std::deque<TocItem> items_;  // deque：追加时已有条目的地址不变
+    uint64_t consumed_ = 0;      // 最后一个条目中已读取的字节数
+    std::vector<uint8_t> buf_;
+
+    void skip(uint64_t n) {
+        while (n > 0) {
+            size_t step = static_cast<size_t>(std::min<uint64_t>(n, kStdioBuffer));
+            read_into(is_, buf_, step);
+            n -= step;
+        }
+    }
+};
+
+// v2 分块解码中的一个块
+struct DecodeJob {
+    const TocItem* item = nullptr;  // 所属条目（EntrySource 保证在提取结束前有效）
+    uint32_t block = 0;
+    bool first = false;
+    bool last = false;
+    bool hasBlock = false; // 空条目只有一个不含块的任务
+    BlockHeader hdr;
+    std::vector<uint8_t> stored;
+    std::vector<uint8_t> raw;
+    std::string error;
+};
+
+// v2：按顺序读取所选条目的各个块，每批最多 jobs*4 个块（可跨条目）并行解码后按顺序写出
+// 解码与写出双缓冲：一个后台线程写出上一批（及调用 done）的同时，当前批在线程池上解码，
+// 内存占用约为 2*jobs*4 个块（编码后 + 原始），与条目大小无关
+// 一个块损坏时只有它所在的条目失败（删除已写出的部分并记入 failures），其它条目照常提取
+// target 给出条目的输出路径；done 非空时在条目写完、通过校验并关闭后于写出线程中调用
+static size_t extract_blocks(EntrySource& source,
+                             const PackageHeader& h, const PackageKey& key,
+                             const EntryTargetFn& target, const EntryDoneFn& done,
+                             size_t jobs, std::vector<std::string>& failures) {
+    jobs = resolve_jobs(jobs);
+    const size_t batchSize = jobs * 4;
+    std::vector<DecodeJob> batches[2] = {std::vector<DecodeJob>(batchSize), std::vector<DecodeJob>(batchSize)};
+    std::optional<backuprestore::ThreadPool> pool;
+    if (jobs > 1) pool.emplace(jobs);
+    const auto codec = make_block_codec(h.compAlg, kLzDefaultLevel, key);
+
+    // 读取状态：当前条目已读取的字节数与已读块的原始长度，只由当前线程访问
+    size_t next = 0;
+    const TocItem* reading = nullptr;
+    uint64_t pos = 0;
+    uint64_t rawPos = 0;
+    uint32_t blockIdx = 0;
+
+    // 读取一批块到 batch，返回块数；没有更多条目时返回 0
+    auto fill = [&](std::vector<DecodeJob>& batch) {
+        size_t n = 0;
+        while (n < batchSize) {
+            if (!reading) {
+                reading = source.entry(next);
+                if (!reading) break;
+                pos = 0;
+                rawPos = 0;
+                blockIdx = 0;
+            }
+            const TocItem& item = *reading;
+            // 大小未知的条目（管道导出）以块的原始长度累计到 originalSize 为结尾
+            const bool streamed = (item.storedSize == kUnknownStoredSize);
+
+            DecodeJob& j = batch[n++];
+            j.item = reading;
+            j.block = blockIdx++;
+            j.first = (j.block == 0);
+            j.hasBlock = false;
+            j.error.clear();
+            const uint64_t left = streamed ? 0 : item.storedSize - pos;
+            if (streamed ? rawPos < item.originalSize : left > 0) {
+                try {
+                    uint8_t hb[kBlockHeaderSize];
+                    if (!streamed && left < kBlockHeaderSize) throw std::runtime_error("truncated block header");
+                    source.read(item, pos, hb, kBlockHeaderSize);
+                    j.hdr = block_parse_header(hb);
+                    if (streamed) {
+                        check_streamed_block(j.hdr, item.originalSize - rawPos, h);
+                    } else if (j.hdr.rawLen > h.blockSize || j.hdr.storedLen > left - kBlockHeaderSize) {
+                        throw std::runtime_error("invalid block length");
+                    }
+                    j.stored.resize(j.hdr.storedLen);
+                    source.read(item, pos + kBlockHeaderSize, j.stored.data(), j.stored.size());
+                    pos += kBlockHeaderSize + j.hdr.storedLen;
+                    rawPos += j.hdr.rawLen;
+                    j.hasBlock = true;
+                } catch (const std::exception& e) {
+                    // 块边界已不可信：放弃该条目剩余的块；大小未知的条目之后的数据也无法定位，整体失败
+                    if (streamed) throw std::runtime_error(item.relPath + ": " + e.what());
+                    j.error = e.what();
+                    pos = item.storedSize;
+                }
+            }
+            j.last = streamed ? rawPos == item.originalSize : pos == item.storedSize;
+            if (j.last) {
+                reading = nullptr;
+                ++next;
+            }
+        }
+        return n;
+    };
+
+    // 写出状态：当前正在写的条目，只由写出线程访问
+    std::filesystem::path outPath;
+    std::ofstream ofs;
+    std::optional<backuprestore::ExtentMapper> mapper;
+    bool failed = false;
+    std::string error;
+    uint64_t written = 0;
+    size_t extracted = 0;
+    backuprestore::Xxh64 hasher;
+
+    auto flush = [&](std::vector<DecodeJob>& batch, size_t n) {
+        for (size_t k = 0; k < n; ++k) {
+            DecodeJob& j = batch[k];
+            const TocItem& item = *j.item;
+            if (j.first) {
+                outPath = target(item);
+                failed = false;
+                error.clear();
+                written = 0;
+                hasher = backuprestore::Xxh64();
+                std::error_code ec;
+                std::filesystem::create_directories(outPath.parent_path(), ec);
+                ofs.clear();
+                ofs.open(outPath, std::ios::binary | std::ios::trunc);
+                mapper.emplace(item.layout, seek_writer(ofs));
+                if (!ofs) {
+                    failed = true;
+                    error = "write file failed";
+                }
+            }
+            if (!failed && !j.error.empty()) {
+                failed = true;
+                error = "block " + std::to_string(j.block) + ": " + j.error;
+            }
+            if (!failed && !j.raw.empty()) {
+                if (!(*mapper)(j.raw.data(), j.raw.size())) {
+                    failed = true;
+                    error = ofs ? "data exceeds extents" : "write file failed";
+                }
+                if (item.hasChecksum) hasher.update(j.raw.data(), j.raw.size());
+                written += j.raw.size();
+            }
+            if (j.last) {
+                ofs.close();
+                if (!failed && (!ofs || written != item.layout.dataLength(item.originalSize))) {
+                    failed = true;
+                    error = !ofs ? "write file failed" : "size mismatch";
+                }
+                if (!failed && item.hasChecksum && hasher.digest() != item.checksum) {
+                    failed = true;
+                    error = "checksum mismatch";
+                }
+                if (!failed) {
+                    try {
+                        finish_sparse(outPath, item);
+                        if (done) done(item, outPath);
+                    } catch (const std::exception& e) {
+                        failed = true;
+                        error = e.what();
+                    }
+                }
+                if (failed) {
+                    std::error_code ec;
+                    std::filesystem::remove(outPath, ec);
+                    failures.push_back(item.relPath + ": " + error);
+                } else {
+                    ++extracted;
+                }
+            }
+        }
+    };
+
+    // 写出线程：最后声明，当前批抛出异常时最先析构（等待正在运行的 flush 结束）
+    // 线程池会吞掉异常，flush 的错误记录在 writeError 中，等待它结束后由这里抛出
+    std::exception_ptr writeError;
+    backuprestore::ThreadPool writer(1);
+
+    size_t cur_batch = 0;
+    for (;;) {
+        std::vector<DecodeJob>& batch = batches[cur_batch];
+        size_t n = fill(batch);
+        if (n == 0) break;
+
+        run_batch(pool ? &*pool : nullptr, n, [&](size_t k) {
+            DecodeJob& j = batch[k];
+            j.raw.clear();
+            if (!j.hasBlock) return;
+            try {
+                codec->decode(j.hdr, j.stored, j.raw);
+            } catch (const std::exception& e) {
+                j.error = e.what();
+            }
+        });
+
+        writer.wait();
+        if (writeError) std::rethrow_exception(writeError);
+        writer.submit([&, b = &batch, n] {
+            try {
+                flush(*b, n);
+            } catch (...) {
+                writeError = std::current_exception();
+            }
+        });
+        cur_batch ^= 1;
+    }
+    writer.wait();
+    if (writeError) std::rethrow_exception(writeError);
+    return extracted;
+}
+
+// 条目按包内相对路径写到 dir 之下
+static EntryTargetFn under(const std::filesystem::path& dir) {
+    return [dir](const TocItem& item) { return dir / std::filesystem::path(item.relPath); };
+}
+
+static void throw_if_failed(const std::vector<std::string>& failures) {
+    if (failures.empty()) return;
+    throw std::runtime_error(std::to_string(failures.size()) + " entries corrupted, first: " + failures.front());
+}
+
+// path 精确匹配，或 path 以 prefix 为目录前缀（prefix 末尾的 / 可省略）
+static bool match_entry(const std::string& relPath, const std::string& pattern) {
+    if (pattern.empty() || relPath == pattern) return true;
+    std::string dir = pattern;
+    if (dir.back() != '/') dir += '/';
+    return relPath.compare(0, dir.size(), dir) == 0;
+}
+
+std::vector<TocItem> list_package(const std::filesystem::path& packageFile) {
     std::ifstream is(packageFile, std::ios::binary);
     if (!is) throw std::runtime_error("cannot open package file: " + packageFile.string());
 
-    // 读 magic
-    char magic[6];
-    is.read(magic, 6);
-    if (!is || std::string(magic, 6) != std::string(MAGIC, 6))
-        throw std::runtime_error("magic mismatch");
+    auto h = read_package_header(is);
+    return read_package_index(is, h);
+}
+
+size_t extract_from_package(const std::filesystem::path& packageFile,
+                            const std::string& pattern,
+                            const std::filesystem::path& outDir,
+                            const std::string& password,
+                            size_t bufferSize,
+                            size_t jobs) {
+    PackageHeader h;
+    std::vector<TocItem> items;
+    {
+        std::ifstream is(packageFile, std::ios::binary);
+        if (!is) throw std::runtime_error("cannot open package file: " + packageFile.string());
+        h = read_package_header(is);
+        items = read_package_index(is, h);
+    }
+
+    if (h.encAlg != EncryptAlg::None && password.empty())
+        throw std::runtime_error("package is encrypted but password is empty");
+    if (bufferSize == 0) bufferSize = 1;
 
-    auto ver = read_u8(is);
-    (void)ver;
+    PackageReader reader(packageFile);
+    const PackageKey key = make_package_key(h.encAlg, password, h.salt);
+    if (h.version >= 2) {
+        std::vector<const TocItem*> selected;
+        for (const auto& item : items) {
+            if (match_entry(item.relPath, pattern)) selected.push_back(&item);
+        }
+        std::vector<std::string> failures;
+        SelectedEntries source(reader, selected);
+        size_t extracted = extract_blocks(source, h, key, under(outDir), nullptr, jobs, failures);
+        throw_if_failed(failures);
+        return extracted;
+    }
 
-    PackAlg packAlg = static_cast<PackAlg>(read_u8(is));
-    CompressAlg compAlg = static_cast<CompressAlg>(read_u8(is));
-    EncryptAlg encAlg = static_cast<EncryptAlg>(read_u8(is));
+    size_t extracted = 0;
+    for (size_t i = 0; i < items.size(); ++i) {
+        const auto& item = items[i];
+        if (!match_entry(item.relPath, pattern)) continue;
+        extract_entry(reader, item, i, h, key, outDir / std::filesystem::path(item.relPath), bufferSize);
+        ++extracted;
+    }
+    return extracted;
+}
 
-    uint32_t saltLen = read_le<uint32_t>(is);
-    auto salt = read_bytes(is, saltLen);
+size_t extract_entries(const std::filesystem::path& packageFile,
+                       const std::string& password,
+                       const EntryTargetFn& target,
+                       const EntryDoneFn& done,
+                       std::vector<std::string>& failures,
+                       size_t jobs) {
+    PackageHeader h;
+    std::vector<TocItem> items;
+    {
+        std::ifstream is(packageFile, std::ios::binary);
+        if (!is) throw std::runtime_error("cannot open package file: " + packageFile.string());
+        h = read_package_header(is);
+        items = read_package_index(is, h);
+    }
 
-    if (encAlg != EncryptAlg::None && password.empty())
+    if (h.encAlg != EncryptAlg::None && password.empty())
         throw std::runtime_error("package is encrypted but password is empty");
 
+    // 每个条目只询问一次 target；items 之后不再修改，下标可由条目地址算出
+    std::vector<std::filesystem::path> outPaths(items.size());
+    std::vector<const TocItem*> selected;
+    for (size_t i = 0; i < items.size(); ++i) {
+        outPaths[i] = target(items[i]);
+        if (!outPaths[i].empty()) selected.push_back(&items[i]);
+    }
+    if (selected.empty()) return 0;
+
+    PackageReader reader(packageFile);
+    const PackageKey key = make_package_key(h.encAlg, password, h.salt);
+    if (h.version >= 2) {
+        SelectedEntries source(reader, selected);
+        auto outPathOf = [&](const TocItem& item) { return outPaths[&item - items.data()]; };
+        return extract_blocks(source, h, key, outPathOf, done, jobs, failures);
+    }
+
+    size_t extracted = 0;
+    for (const TocItem* item : selected) {
+        const size_t i = static_cast<size_t>(item - items.data());
+        try {
+            extract_entry(reader, *item, i, h, key, outPaths[i], 1 << 20);
+            if (done) done(*item, outPaths[i]);
+            ++extracted;
+        } catch (const std::exception& e) {
+            std::error_code ec;
+            std::filesystem::remove(outPaths[i], ec);
+            failures.push_back(item->relPath + ": " + e.what());
+        }
+    }
+    return extracted;
+}
+
+bool import_package_to_repo(const std::filesystem::path& packageFile,
+                            const std::filesystem::path& repoDir,
+                            const std::string& password,
+                            size_t jobs) {
+    // "-" 表示从标准输入顺序读取：只能是 header 布局，不 seek
+    const bool fromStdin = is_stdio_path(packageFile);
+    std::ifstream file;
+    std::optional<FdInBuf> pipe;
+    if (fromStdin) {
+        pipe.emplace(kStdinFd);
+    } else {
+        file.open(packageFile, std::ios::binary);
+        if (!file) throw std::runtime_error("cannot open package file: " + packageFile.string());
+    }
+    std::istream is(fromStdin ? static_cast<std::streambuf*>(&*pipe) : file.rdbuf());
+
+    auto h = read_package_header(is);
+    if (fromStdin && h.packAlg != PackAlg::HeaderPerFile)
+        throw std::runtime_error("reading from stdin requires the header layout");
+    if (h.encAlg != EncryptAlg::None && password.empty())
+        throw std::runtime_error("package is encrypted but password is empty");
+    const PackageKey key = make_package_key(h.encAlg, password, h.salt);
+
     std::filesystem::create_directories(repoDir);
 
-    if (packAlg == PackAlg::HeaderPerFile) {
-        auto entries = pack_header_read(is);
-        for (auto& e : entries) {
-            auto dec = apply_decrypt(e.payload, encAlg, password, salt);
-            auto raw = apply_decompress(dec, compAlg);
+    if (h.version >= 2) {
+        std::vector<std::string> failures;
+        if (fromStdin) {
+            StreamEntries source(is);
+            extract_blocks(source, h, key, under(repoDir), nullptr, jobs, failures);
+        } else {
+            auto items = read_package_index(is, h);
+            std::vector<const TocItem*> all;
+            all.reserve(items.size());
+            for (const auto& item : items) all.push_back(&item);
 
-            auto outPath = repoDir / std::filesystem::path(e.relPath);
+            PackageReader reader(packageFile);
+            SelectedEntries source(reader, all);
+            extract_blocks(source, h, key, under(repoDir), nullptr, jobs, failures);
+        }
+        throw_if_failed(failures);
+        return true;
+    }
+
+    if (h.packAlg == PackAlg::HeaderPerFile) {
+        // 逐条读取并写出，同一时刻只有一个条目的数据在内存中
+        uint32_t n = pack_header_read_count(is);
+        std::vector<uint8_t> buf;
+        std::vector<uint8_t> payload;
+        std::vector<uint8_t> scratch;
+        for (uint32_t i = 0; i < n; ++i) {
+            TocItem item = pack_header_read_entry(is, buf);
+            if (item.storedSize == kUnknownStoredSize)
+                throw std::runtime_error("invalid stored size: " + item.relPath);
+            read_into(is, payload, static_cast<size_t>(item.storedSize));
+            ByteSpan raw = decode_entry(payload, h.compAlg, key, i,
+                                        item.layout.dataLength(item.originalSize), scratch);
+
+            auto outPath = repoDir / std::filesystem::path(item.relPath);
             write_file_all(outPath, raw);
         }
     } else {
@@ -188,12 +1396,29 @@ bool import_package_to_repo(const std::filesystem::path& packageFile,
 
         pack_toc_read(is, toc, blobs);
 
+        std::vector<uint8_t> scratch;
         for (size_t i = 0; i < toc.size(); ++i) {
-            auto dec = apply_decrypt(blobs[i], encAlg, password, salt);
-            auto raw = apply_decompress(dec, compAlg);
+            ByteSpan raw = decode_entry(blobs[i], h.compAlg, key, i,
+                                        toc[i].layout.dataLength(toc[i].originalSize), scratch);
+            if (toc[i].hasChecksum &&
+                backuprestore::Xxh64::hash(raw.data, raw.size) != toc[i].checksum)
+                throw std::runtime_error("checksum mismatch: " + toc[i].relPath);
 
             auto outPath = repoDir / std::filesystem::path(toc[i].relPath);
-            write_file_all(outPath, raw);
+            if (!toc[i].layout.sparse) {
+                write_file_all(outPath, raw);
+                continue;
+            }
+            if (raw.size != toc[i].layout.dataLength(toc[i].originalSize))
+                throw std::runtime_error("size mismatch: " + toc[i].relPath);
+            std::filesystem::create_directories(outPath.parent_path());
+            std::ofstream ofs(outPath, std::ios::binary | std::ios::trunc);
+            backuprestore::ExtentMapper mapper(toc[i].layout, seek_writer(ofs));
+            if (!ofs || !mapper(raw.data, raw.size))
+                throw std::runtime_error("write file failed: " + outPath.string());
+            ofs.close();
+            if (!ofs) throw std::runtime_error("write file failed: " + outPath.string());
+            finish_sparse(outPath, toc[i]);
         }
     }
 
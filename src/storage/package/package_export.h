@@ -1,23 +1,64 @@
 #pragma once
+#include <cstddef>
 #include <filesystem>
+#include <functional>
 #include <string>
+#include <vector>
 #include "algorithms.h"
+#include "pack_toc.h"
 
 namespace pkg {
 
 struct Options {
     PackAlg packAlg = PackAlg::HeaderPerFile;
     CompressAlg compressAlg = CompressAlg::None;
+    int compressLevel = 6; // LZ 压缩级别 1-9（只影响压缩率/速度，不写入包）
     EncryptAlg encryptAlg = EncryptAlg::None;
     std::string password; // encrypt!=None 时必须提供
+    size_t bufferSize = 1 << 20; // v1 流式导出时每次读取的块大小（峰值内存约为其 3 倍）
+    size_t blockSize = 1 << 20;  // v2 分块格式的块大小；0 表示写出 v1 格式（整个条目一个流）
+    size_t jobs = 0;             // v2 并行编码线程数，0 表示 CPU 核数
 };
 
+// 包文件名为 "-" 时 export 写到标准输出、import 从标准输入读取（不 seek，可以接管道）；
+// 只支持 header 布局
+inline bool is_stdio_path(const std::filesystem::path& p) { return p == "-"; }
+
 bool export_repo_to_package(const std::filesystem::path& repoDir,
                             const std::filesystem::path& packageFile,
                             const Options& opt);
 
+// 同时支持 v1、v2 与 v3 包；jobs 为分块包的并行解码线程数（0 表示 CPU 核数）
 bool import_package_to_repo(const std::filesystem::path& packageFile,
                             const std::filesystem::path& repoDir,
-                            const std::string& password);
+                            const std::string& password,
+                            size_t jobs = 0);
+
+// 列出包内条目：只读取 TOC（header 布局则只读各条目头部），不读数据
+std::vector<TocItem> list_package(const std::filesystem::path& packageFile);
+
+// 提取 path 或以 path 为目录前缀的条目到 outDir（保留相对路径），只读取所需的数据块
+// pattern 为空时提取全部；返回提取的条目数
+size_t extract_from_package(const std::filesystem::path& packageFile,
+                            const std::string& pattern,
+                            const std::filesystem::path& outDir,
+                            const std::string& password,
+                            size_t bufferSize = 1 << 20,
+                            size_t jobs = 0);
+
+// extract_entries 的回调：target 给出条目的输出路径（空路径表示跳过该条目）；
+// done 在条目写完、通过大小和校验和检查并关闭后调用，抛出异常时该条目按失败处理
+using EntryTargetFn = std::function<std::filesystem::path(const TocItem&)>;
+using EntryDoneFn = std::function<void(const TocItem&, const std::filesystem::path&)>;
+
+// 把 target 选中的条目解码到各自的输出路径（restore-package 按仓库索引直接写到目标目录树）
+// 分块包的解码与写出重叠进行；出错的条目删除已写出的部分并记入 failures，其它条目照常提取
+// 返回成功提取的条目数
+size_t extract_entries(const std::filesystem::path& packageFile,
+                       const std::string& password,
+                       const EntryTargetFn& target,
+                       const EntryDoneFn& done,
+                       std::vector<std::string>& failures,
+                       size_t jobs = 0);
 
 } // namespace pkg
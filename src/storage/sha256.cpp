@@ -0,0 +1,132 @@
+#include "storage/sha256.h"
+#include <algorithm>
+#include <cstring>
+
+namespace backuprestore {
+
+namespace {
+
+const std::uint32_t kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline std::uint32_t rotr(std::uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+} // namespace
+
+Sha256::Sha256()
+    : state_{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+             0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19},
+      buffer_{} {
+}
+
+void Sha256::update(const void* data, std::size_t len) {
+    const auto* p = static_cast<const std::uint8_t*>(data);
+    total_len_ += len;
+
+    if (buffer_len_ > 0) {
+        std::size_t take = std::min(len, buffer_.size() - buffer_len_);
+        std::memcpy(buffer_.data() + buffer_len_, p, take);
+        buffer_len_ += take;
+        p += take;
+        len -= take;
+        if (buffer_len_ < buffer_.size()) {
+            return;
+        }
+        compress(buffer_.data());
+        buffer_len_ = 0;
+    }
+
+    while (len >= 64) {
+        compress(p);
+        p += 64;
+        len -= 64;
+    }
+
+    if (len > 0) {
+        std::memcpy(buffer_.data(), p, len);
+        buffer_len_ = len;
+    }
+}
+
+Sha256::Digest Sha256::finish() {
+    std::uint64_t bit_len = total_len_ * 8;
+
+    // 填充：0x80 + 若干 0 + 64 位大端长度
+    std::uint8_t pad[72] = {0x80};
+    std::size_t pad_len = (buffer_len_ < 56) ? (56 - buffer_len_) : (120 - buffer_len_);
+    for (int i = 0; i < 8; ++i) {
+        pad[pad_len + i] = static_cast<std::uint8_t>(bit_len >> (56 - 8 * i));
+    }
+    std::uint64_t saved_total = total_len_;
+    update(pad, pad_len + 8);
+    total_len_ = saved_total;
+
+    Digest out{};
+    for (int i = 0; i < 8; ++i) {
+        out[4 * i]     = static_cast<std::uint8_t>(state_[i] >> 24);
+        out[4 * i + 1] = static_cast<std::uint8_t>(state_[i] >> 16);
+        out[4 * i + 2] = static_cast<std::uint8_t>(state_[i] >> 8);
+        out[4 * i + 3] = static_cast<std::uint8_t>(state_[i]);
+    }
+    return out;
+}
+
+Sha256::Digest Sha256::hash(const void* data, std::size_t len) {
+    Sha256 h;
+    h.update(data, len);
+    return h.finish();
+}
+
+std::string Sha256::toHex(const Digest& digest) {
+    static const char kHex[] = "0123456789abcdef";
+    std::string s(digest.size() * 2, '0');
+    for (std::size_t i = 0; i < digest.size(); ++i) {
+        s[2 * i]     = kHex[digest[i] >> 4];
+        s[2 * i + 1] = kHex[digest[i] & 0x0F];
+    }
+    return s;
+}
+
+void Sha256::compress(const std::uint8_t* block) {
+    std::uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = (static_cast<std::uint32_t>(block[4 * i]) << 24) |
+               (static_cast<std::uint32_t>(block[4 * i + 1]) << 16) |
+               (static_cast<std::uint32_t>(block[4 * i + 2]) << 8) |
+               static_cast<std::uint32_t>(block[4 * i + 3]);
+    }
+    for (int i = 16; i < 64; ++i) {
+        std::uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        std::uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    std::uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+    std::uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+
+    for (int i = 0; i < 64; ++i) {
+        std::uint32_t S1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+        std::uint32_t ch = (e & f) ^ (~e & g);
+        std::uint32_t t1 = h + S1 + ch + kRoundConstants[i] + w[i];
+        std::uint32_t S0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+        std::uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        std::uint32_t t2 = S0 + maj;
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    state_[0] += a; state_[1] += b; state_[2] += c; state_[3] += d;
+    state_[4] += e; state_[5] += f; state_[6] += g; state_[7] += h;
+}
+
+} // namespace backuprestore
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace backuprestore {
+
+/**
+ * @brief SHA-256 摘要（FIPS 180-4，自行实现，不依赖第三方库）
+ * 用于内容寻址的块存储
+ */
+class Sha256 {
+public:
+    using Digest = std::array<std::uint8_t, 32>;
+
+    Sha256();
+
+    /**
+     * @brief 追加数据
+     */
+    void update(const void* data, std::size_t len);
+
+    /**
+     * @brief 结束计算并返回摘要（之后对象不可再 update）
+     */
+    Digest finish();
+
+    /**
+     * @brief 一次性计算摘要
+     */
+    static Digest hash(const void* data, std::size_t len);
+
+    /**
+     * @brief 摘要转为小写十六进制字符串
+     */
+    static std::string toHex(const Digest& digest);
+
+private:
+    std::array<std::uint32_t, 8> state_;
+    std::array<std::uint8_t, 64> buffer_;
+    std::size_t buffer_len_ = 0;
+    std::uint64_t total_len_ = 0;
+
+    void compress(const std::uint8_t* block);
+};
+
+} // namespace backuprestore
@@ -0,0 +1,167 @@
+#include "storage/xxhash64.h"
+#include <cstring>
+
+namespace backuprestore {
+
+namespace {
+
+const std::uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+const std::uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+const std::uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+const std::uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+const std::uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline std::uint64_t rotl(std::uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// 按小端读取（XXH64 定义在小端字节序上）
+inline std::uint64_t read64(const std::uint8_t* p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+inline std::uint32_t read32(const std::uint8_t* p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+inline std::uint64_t roundStep(std::uint64_t acc, std::uint64_t input) {
+    acc += input * kPrime2;
+    acc = rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+inline std::uint64_t mergeRound(std::uint64_t acc, std::uint64_t val) {
+    acc ^= roundStep(0, val);
+    return acc * kPrime1 + kPrime4;
+}
+
+// 处理若干完整的 32 字节条带，返回处理的字节数
+inline std::size_t consumeStripes(std::array<std::uint64_t, 4>& acc, const std::uint8_t* p, std::size_t len) {
+    std::uint64_t v1 = acc[0], v2 = acc[1], v3 = acc[2], v4 = acc[3];
+    const std::uint8_t* const start = p;
+    const std::uint8_t* const limit = p + (len & ~std::size_t(31));
+    while (p < limit) {
+        v1 = roundStep(v1, read64(p));
+        v2 = roundStep(v2, read64(p + 8));
+        v3 = roundStep(v3, read64(p + 16));
+        v4 = roundStep(v4, read64(p + 24));
+        p += 32;
+    }
+    acc = {v1, v2, v3, v4};
+    return static_cast<std::size_t>(p - start);
+}
+
+} // namespace
+
+Xxh64::Xxh64(std::uint64_t seed)
+    : acc_{seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1}, buffer_{}, seed_(seed) {
+}
+
+void Xxh64::update(const void* data, std::size_t len) {
+    const auto* p = static_cast<const std::uint8_t*>(data);
+    total_len_ += len;
+
+    if (buffer_len_ > 0) {
+        std::size_t take = std::min(len, buffer_.size() - buffer_len_);
+        std::memcpy(buffer_.data() + buffer_len_, p, take);
+        buffer_len_ += take;
+        p += take;
+        len -= take;
+        if (buffer_len_ < buffer_.size()) {
+            return;
+        }
+        consumeStripes(acc_, buffer_.data(), buffer_.size());
+        buffer_len_ = 0;
+    }
+
+    std::size_t used = consumeStripes(acc_, p, len);
+    p += used;
+    len -= used;
+    if (len > 0) {
+        std::memcpy(buffer_.data(), p, len);
+        buffer_len_ = len;
+    }
+}
+
+std::uint64_t Xxh64::digest() const {
+    std::uint64_t h;
+    if (total_len_ >= 32) {
+        h = rotl(acc_[0], 1) + rotl(acc_[1], 7) + rotl(acc_[2], 12) + rotl(acc_[3], 18);
+        for (std::uint64_t v : acc_) {
+            h = mergeRound(h, v);
+        }
+    } else {
+        h = seed_ + kPrime5;
+    }
+    h += total_len_;
+
+    // 尾部不足 32 字节的数据
+    const std::uint8_t* p = buffer_.data();
+    std::size_t len = buffer_len_;
+    for (; len >= 8; p += 8, len -= 8) {
+        h ^= roundStep(0, read64(p));
+        h = rotl(h, 27) * kPrime1 + kPrime4;
+    }
+    if (len >= 4) {
+        h ^= static_cast<std::uint64_t>(read32(p)) * kPrime1;
+        h = rotl(h, 23) * kPrime2 + kPrime3;
+        p += 4;
+        len -= 4;
+    }
+    for (; len > 0; ++p, --len) {
+        h ^= static_cast<std::uint64_t>(*p) * kPrime5;
+        h = rotl(h, 11) * kPrime1;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::uint64_t Xxh64::hash(const void* data, std::size_t len, std::uint64_t seed) {
+    Xxh64 hasher(seed);
+    hasher.update(data, len);
+    return hasher.digest();
+}
+
+std::string Xxh64::toHex(std::uint64_t value) {
+    static const char kDigits[] = "0123456789abcdef";
+    std::string out(16, '0');
+    for (int i = 15; i >= 0; --i) {
+        out[static_cast<std::size_t>(i)] = kDigits[value & 0xF];
+        value >>= 4;
+    }
+    return out;
+}
+
+bool Xxh64::fromHex(const std::string& text, std::uint64_t& value) {
+    if (text.size() != 16) {
+        return false;
+    }
+    std::uint64_t v = 0;
+    for (char c : text) {
+        int d;
+        if (c >= '0' && c <= '9') d = c - '0';
+        else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') d = c - 'A' + 10;
+        else return false;
+        v = (v << 4) | static_cast<std::uint64_t>(d);
+    }
+    value = v;
+    return true;
+}
+
+} // namespace backuprestore
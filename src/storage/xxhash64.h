@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace backuprestore {
+
+/**
+ * @brief XXH64 非加密哈希（与 xxHash 参考实现的 XXH64 结果一致，自行实现）
+ * 用于文件内容校验：四路独立累加器，每 32 字节只做 4 次乘法，速度接近内存带宽；
+ * 支持流式追加，任意切分输入得到的结果都相同
+ */
+class Xxh64 {
+public:
+    explicit Xxh64(std::uint64_t seed = 0);
+
+    /**
+     * @brief 追加数据
+     */
+    void update(const void* data, std::size_t len);
+
+    /**
+     * @brief 当前已追加数据的哈希值（不改变状态，可继续 update）
+     */
+    std::uint64_t digest() const;
+
+    /**
+     * @brief 一次性计算哈希值
+     */
+    static std::uint64_t hash(const void* data, std::size_t len, std::uint64_t seed = 0);
+
+    /**
+     * @brief 哈希值转为 16 位小写十六进制字符串
+     */
+    static std::string toHex(std::uint64_t value);
+
+    /**
+     * @brief 解析 toHex 的输出
+     * @return 格式错误时返回 false
+     */
+    static bool fromHex(const std::string& text, std::uint64_t& value);
+
+private:
+    std::array<std::uint64_t, 4> acc_;
+    std::array<std::uint8_t, 32> buffer_;
+    std::size_t buffer_len_ = 0;
+    std::uint64_t total_len_ = 0;
+    std::uint64_t seed_;
+};
+
+} // namespace backuprestore
@@ -0,0 +1,123 @@
+// 回收数据（Repository::collectGarbage）遇到损坏的当前索引时必须停止，不删除任何块和段
+//
+// 在临时目录中建一个仓库：一个文件分块保存到 chunks/，一个小文件追加到 packs/ 段文件，
+// 写出 index.bin 后把其中一条记录的扩展字段偏移改成越界值，再用新的 Repository 打开并回收。
+// 依次损坏两个条目，每次都要求回收失败，且 chunks/ 与 packs/ 中的文件一个不少。
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+
+#include <unistd.h>
+
+#include "core/repository.h"
+
+namespace fs = std::filesystem;
+using backuprestore::Metadata;
+using backuprestore::Repository;
+
+namespace {
+
+// 与 binary_index.cpp 的文件布局一致：头部 64 字节、每条记录 56 字节、扩展字段偏移位于记录第 24 字节
+constexpr std::uint64_t kHeaderSize = 64;
+constexpr std::uint64_t kRecordSize = 56;
+constexpr std::uint64_t kRecExtraOffset = 24;
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cerr << "失败: " << what << std::endl;
+        ++failures;
+    }
+}
+
+void writeFile(const fs::path& path, std::size_t size, unsigned seed) {
+    std::ofstream ofs(path, std::ios::binary);
+    std::uint32_t x = seed * 2654435761u + 1;
+    for (std::size_t i = 0; i < size; ++i) {
+        x = x * 1103515245u + 12345u;
+        ofs.put(static_cast<char>(x >> 16));
+    }
+}
+
+std::set<std::string> listFiles(const fs::path& dir) {
+    std::set<std::string> files;
+    if (!fs::exists(dir)) return files;
+    for (const auto& entry : fs::recursive_directory_iterator(dir)) {
+        if (entry.is_regular_file()) files.insert(fs::relative(entry.path(), dir).generic_string());
+    }
+    return files;
+}
+
+bool store(Repository& repo, const fs::path& source, const std::string& name) {
+    Metadata metadata;
+    return metadata.loadFromFile(source / name) && repo.storeFile(source / name, name, metadata);
+}
+
+// 把 index.bin 第 record 条记录的扩展字段偏移改成越界值，metadataAt 读它时会失败
+bool corruptRecord(const fs::path& index, std::uint64_t record) {
+    std::fstream file(index, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file) return false;
+    file.seekp(static_cast<std::streamoff>(kHeaderSize + record * kRecordSize + kRecExtraOffset));
+    const std::uint64_t bad = ~0ull;
+    file.write(reinterpret_cast<const char*>(&bad), sizeof(bad));
+    return static_cast<bool>(file);
+}
+
+void runCase(const fs::path& root, std::uint64_t record) {
+    const fs::path source = root / "source";
+    const fs::path repo_path = root / ("repo" + std::to_string(record));
+    {
+        Repository repo(repo_path);
+        check(repo.initialize(), "初始化仓库");
+        // 条目按路径排序：第 0 条 a.bin 分块保存，第 1 条 b.txt 追加到段文件
+        repo.setChunking(true);
+        check(store(repo, source, "a.bin"), "分块保存 a.bin");
+        repo.setChunking(false);
+        repo.setPackThreshold(64 * 1024);
+        check(store(repo, source, "b.txt"), "打包保存 b.txt");
+        check(repo.saveIndex(), "写出索引");
+    }
+
+    const std::set<std::string> chunks = listFiles(repo_path / "chunks");
+    const std::set<std::string> packs = listFiles(repo_path / "packs");
+    check(!chunks.empty(), "chunks/ 中应有块");
+    check(!packs.empty(), "packs/ 中应有段文件");
+    check(corruptRecord(repo_path / "index.bin", record), "损坏索引记录 " + std::to_string(record));
+
+    Repository repo(repo_path);
+    std::size_t removed_chunks = 0;
+    std::size_t removed_segments = 0;
+    std::uint64_t removed_bytes = 0;
+    check(!repo.collectGarbage(removed_chunks, removed_segments, removed_bytes),
+          "索引记录 " + std::to_string(record) + " 损坏时回收应失败");
+    check(removed_chunks == 0 && removed_segments == 0 && removed_bytes == 0, "回收失败时不应报告删除");
+    check(listFiles(repo_path / "chunks") == chunks, "记录 " + std::to_string(record) + " 损坏后块应全部保留");
+    check(listFiles(repo_path / "packs") == packs, "记录 " + std::to_string(record) + " 损坏后段文件应全部保留");
+}
+
+} // namespace
+
+int main() {
+    const fs::path root = fs::temp_directory_path() / ("br-gc-test-" + std::to_string(getpid()));
+    fs::remove_all(root);
+    fs::create_directories(root / "source");
+    writeFile(root / "source" / "a.bin", 256 * 1024, 1);
+    writeFile(root / "source" / "b.txt", 1000, 2);
+
+    runCase(root, 0);
+    runCase(root, 1);
+
+    fs::remove_all(root);
+    if (failures > 0) {
+        std::cerr << failures << " 项检查失败" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "全部通过" << std::endl;
+    return EXIT_SUCCESS;
+}